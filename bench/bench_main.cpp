@@ -0,0 +1,24 @@
+/**
+ * Main function of the GuardFW microbenchmarks.
+ *
+ * Usage: guardfw-bench [filter]
+ * Runs all benchmarks, or only benchmarks whose names contain the filter text.
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <exception>    // std::set_terminate()
+#include <string_view>  // std::string_view
+
+import guardfw.benchmark;
+import guardfw.exceptions;  // GuardFW::terminate_handler()
+
+int main(int argc, char* argv[])
+{
+    std::set_terminate(GuardFW::terminate_handler);
+
+    std::string_view filter = (argc > 1) ? argv[1] : "";  // NOLINT(*-pointer-arithmetic): argv access
+    GuardFW::benchmark::run_all(filter);
+}
@@ -0,0 +1,205 @@
+/**
+ * Microbenchmarks for modules/sharded_listener.cppm
+ *
+ * Measures the accept rate over loopback with one accepting thread per allowed CPU, which accepts and closes
+ * the connections of concurrent client threads (one per allowed CPU as well). All accepting threads sharing a
+ * single listening socket is compared with a SO_REUSEPORT group with one pinned shard per allowed CPU, where the
+ * connections are steered to the shard of the receiving CPU. Clients and accepting threads are pinned to the same
+ * CPUs in both cases, the result is reported in connections per second. Clients close with an abortive close
+ * (SO_LINGER 0), so no TIME_WAIT sockets accumulate, and limit the pending connections below the backlog.
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <arpa/inet.h>   // htonl()
+#include <atomic>        // std::atomic<>
+#include <chrono>        // std::chrono::steady_clock
+#include <cstddef>       // size_t
+#include <cstdint>       // uint64_t
+#include <cstdio>        // ::printf()
+#include <netinet/in.h>  // sockaddr_in, INADDR_LOOPBACK
+#include <optional>      // std::optional<>
+#include <sched.h>       // cpu_set_t, CPU_*
+#include <string_view>   // std::string_view
+#include <sys/epoll.h>   // epoll_event, EPOLL*
+#include <sys/socket.h>  // SOL_SOCKET, SO_LINGER, SOCK_*, linger
+#include <thread>        // std::thread, std::this_thread::yield()
+#include <vector>        // std::vector<>
+
+import guardfw.benchmark;
+import guardfw.sharded_listener;
+import guardfw.wrapped_epoll;
+import guardfw.wrapped_sched;
+import guardfw.wrapped_socket;
+import guardfw.wrapped_unistd;
+
+namespace
+{
+
+constexpr uint64_t connections_per_client = 5'000;
+constexpr uint64_t pending_per_client     = 32;  ///< connected, but not yet accepted connections of each client
+
+using GuardFW::benchmark::selected;
+
+/// Progress of a measurement, shared by all clients and accepting threads.
+struct Progress
+{
+    std::atomic<uint64_t> connected {0};
+    std::atomic<uint64_t> accepted {0};
+    uint64_t total {0};
+    uint64_t pending {0};  ///< limit of connected, but not yet accepted connections
+};
+
+/// Pins the calling thread to a CPU.
+void pin_to(unsigned int cpu)
+{
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+    GuardFW::sched_setaffinity(0, sizeof(cpu_set), &cpu_set);
+}
+
+/// Connects and abortively closes connections, as long as not too many connections are pending.
+void connect_clients(const struct sockaddr* address, socklen_t address_length, Progress& progress)
+{
+    for (uint64_t count = 0; count < connections_per_client; count++)
+    {
+        while (progress.connected.load(std::memory_order_relaxed) - progress.accepted.load(std::memory_order_relaxed)
+               >= progress.pending)
+            std::this_thread::yield();
+
+        const int client = GuardFW::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        GuardFW::setsockopt(client, SOL_SOCKET, SO_LINGER, linger {.l_onoff = 1, .l_linger = 0});
+        GuardFW::connect(client, address, address_length);
+        progress.connected.fetch_add(1, std::memory_order_relaxed);
+        GuardFW::close(client);
+    }
+}
+
+/// Waits for connections of a listening socket and accepts and closes them, until all connections are accepted.
+void accept_connections(int listener, Progress& progress)
+{
+    const int epoll = GuardFW::epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event event {.events = EPOLLIN, .data = {.fd = listener}};
+    GuardFW::epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event);
+
+    while (progress.accepted.load(std::memory_order_relaxed) < progress.total)
+    {
+        if (GuardFW::epoll_wait(epoll, &event, 1, 10) == 0)  // timeout, the last connections may be accepted by others
+            continue;
+        while (const std::optional<int> connection =
+                   GuardFW::accept4_nonblock(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC))
+        {
+            GuardFW::close(*connection);
+            progress.accepted.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    GuardFW::close(epoll);
+}
+
+/**
+ * Runs the clients and accepting threads on all CPUs and prints the accept rate.
+ *
+ * @tparam ACCEPT          Callable with the thread index, which pins the thread and accepts connections.
+ * @param  name            Name of the benchmark.
+ * @param  address         Address of the listening socket(s).
+ * @param  address_length  Length of address.
+ * @param  cpus            Allowed CPUs, one client and one accepting thread run on each CPU.
+ * @param  accept          Accepting thread function.
+ */
+template<typename ACCEPT>
+void measure(
+    std::string_view name,
+    const struct sockaddr* address,
+    socklen_t address_length,
+    const std::vector<unsigned int>& cpus,
+    ACCEPT&& accept
+)
+{
+    Progress progress;
+    progress.total   = connections_per_client * cpus.size();
+    progress.pending = pending_per_client * cpus.size();
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t index = 0; index < cpus.size(); index++)
+    {
+        threads.emplace_back([&accept, &progress, index] { accept(index, progress); });
+        threads.emplace_back([address, address_length, &progress, cpu = cpus[index]] {
+            pin_to(cpu);
+            connect_clients(address, address_length, progress);
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+    const auto stop = std::chrono::steady_clock::now();
+
+    const double elapsed_s = std::chrono::duration<double>(stop - start).count();
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg): allow printf
+    (void) printf(
+        "%-56.*s %10.0f conn/s %4zu threads\n",
+        static_cast<int>(name.size()),
+        name.data(),
+        static_cast<double>(progress.total) / elapsed_s,
+        cpus.size()
+    );
+}
+
+void bench_sharded_listener()
+{
+    struct sockaddr_in address {};
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    cpu_set_t allowed;
+    GuardFW::sched_getaffinity(0, sizeof(allowed), &allowed);
+    std::vector<unsigned int> cpus;
+    for (unsigned int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        if (CPU_ISSET(cpu, &allowed))
+            cpus.push_back(cpu);
+
+    if (selected("sharded_listener/accept/shared listener"))
+    {
+        const int listener = GuardFW::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        GuardFW::bind(listener, reinterpret_cast<const struct sockaddr*>(&address), sizeof(address));
+        GuardFW::listen(listener, SOMAXCONN);
+        struct sockaddr_in bound {};
+        socklen_t bound_length = sizeof(bound);
+        GuardFW::getsockname(listener, reinterpret_cast<struct sockaddr*>(&bound), &bound_length);
+
+        measure(
+            "sharded_listener/accept/shared listener",
+            reinterpret_cast<const struct sockaddr*>(&bound),
+            bound_length,
+            cpus,
+            [listener, &cpus](size_t index, Progress& progress) {
+                pin_to(cpus[index]);
+                accept_connections(listener, progress);
+            }
+        );
+        GuardFW::close(listener);
+    }
+
+    if (selected("sharded_listener/accept/sharded, steered"))
+    {
+        const GuardFW::ShardedListener listener(
+            reinterpret_cast<const struct sockaddr*>(&address), sizeof(address), cpus
+        );
+        measure(
+            "sharded_listener/accept/sharded, steered",
+            listener.local_address(),
+            listener.local_address_length(),
+            cpus,
+            [&listener](size_t shard, Progress& progress) {
+                listener.pin(shard);  // loopback connections are received on the CPU of the client
+                accept_connections(listener.socket(shard), progress);
+            }
+        );
+    }
+}
+
+const GuardFW::benchmark::Registration registration {"sharded_listener", bench_sharded_listener};
+
+}  // namespace
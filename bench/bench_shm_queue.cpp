@@ -0,0 +1,144 @@
+/**
+ * Microbenchmarks for modules/shm_queue.cppm
+ *
+ * Compares the shared-memory queue with POSIX message queues. The throughput benchmarks measure sending while
+ * another thread receives, the latency benchmarks measure a round trip to an echo thread over two queues.
+ * Both queue types use the same attributes, the default limit of unprivileged message queues is 10 messages.
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <cstddef>       // size_t
+#include <cstdint>       // uint64_t
+#include <cstdio>        // ::printf()
+#include <fcntl.h>       // O_CREAT, O_RDWR
+#include <mqueue.h>      // mq_attr
+#include <system_error>  // std::system_error
+#include <thread>        // std::thread
+
+import guardfw.benchmark;
+import guardfw.shm_queue;
+import guardfw.wrapped_mqueue;
+
+namespace
+{
+
+constexpr uint64_t iterations_throughput = 1'000'000;
+constexpr uint64_t iterations_latency    = 100'000;
+constexpr size_t max_messages            = 10;
+constexpr size_t message_size            = 64;
+
+using GuardFW::benchmark::do_not_optimize;
+using GuardFW::benchmark::run;
+using GuardFW::benchmark::selected;
+
+/// @return number of operations run() executes including warmup
+constexpr uint64_t total_operations(uint64_t iterations)
+{
+    return iterations + (iterations / 10) + 1;
+}
+
+void bench_shm_queue()
+{
+    const GuardFW::ShmQueueAttributes attributes {.max_messages = max_messages, .message_size = message_size};
+    char message[message_size] {};
+
+    if (selected("shm_queue/throughput/ShmQueue"))
+    {
+        GuardFW::ShmQueue queue(attributes);
+        std::thread receiver([&queue]() {
+            char buffer[message_size] {};
+            for (uint64_t count = 0; count < total_operations(iterations_throughput); count++)
+                do_not_optimize(queue.receive(buffer, sizeof(buffer), nullptr));
+        });
+        run("shm_queue/throughput/ShmQueue", iterations_throughput, [&queue, &message] {
+            queue.send(message, sizeof(message), 0);
+        });
+        receiver.join();
+    }
+
+    if (selected("shm_queue/round trip/ShmQueue"))
+    {
+        GuardFW::ShmQueue request(attributes);
+        GuardFW::ShmQueue response(attributes);
+        std::thread echo([&request, &response]() {
+            char buffer[message_size] {};
+            for (uint64_t count = 0; count < total_operations(iterations_latency); count++)
+                response.send(buffer, request.receive(buffer, sizeof(buffer), nullptr), 0);
+        });
+        run("shm_queue/round trip/ShmQueue", iterations_latency, [&request, &response, &message] {
+            request.send(message, sizeof(message), 0);
+            do_not_optimize(response.receive(message, sizeof(message), nullptr));
+        });
+        echo.join();
+    }
+}
+
+/// Opens an unnamed message queue by unlinking it immediately.
+mqd_t open_message_queue(const char* name)
+{
+    struct mq_attr attributes {};
+    attributes.mq_maxmsg  = static_cast<long>(max_messages);
+    attributes.mq_msgsize = static_cast<long>(message_size);
+    const mqd_t queue = GuardFW::mq_open(name, O_CREAT | O_RDWR, 0600, &attributes);
+    GuardFW::mq_unlink(name);
+    return queue;
+}
+
+void bench_mqueue()
+{
+    char message[message_size] {};
+
+    if (selected("shm_queue/throughput/mqueue"))
+    {
+        const mqd_t queue = open_message_queue("/guardfw-bench-mqueue");
+        std::thread receiver([queue]() {
+            char buffer[message_size] {};
+            for (uint64_t count = 0; count < total_operations(iterations_throughput); count++)
+                do_not_optimize(GuardFW::mq_receive(queue, buffer, sizeof(buffer), nullptr));
+        });
+        run("shm_queue/throughput/mqueue", iterations_throughput, [queue, &message] {
+            GuardFW::mq_send(queue, message, sizeof(message), 0);
+        });
+        receiver.join();
+        GuardFW::mq_close(queue);
+    }
+
+    if (selected("shm_queue/round trip/mqueue"))
+    {
+        const mqd_t request  = open_message_queue("/guardfw-bench-mqueue-request");
+        const mqd_t response = open_message_queue("/guardfw-bench-mqueue-response");
+        std::thread echo([request, response]() {
+            char buffer[message_size] {};
+            for (uint64_t count = 0; count < total_operations(iterations_latency); count++)
+                GuardFW::mq_send(response, buffer, GuardFW::mq_receive(request, buffer, sizeof(buffer), nullptr), 0);
+        });
+        run("shm_queue/round trip/mqueue", iterations_latency, [request, response, &message] {
+            GuardFW::mq_send(request, message, sizeof(message), 0);
+            do_not_optimize(GuardFW::mq_receive(response, message, sizeof(message), nullptr));
+        });
+        echo.join();
+        GuardFW::mq_close(request);
+        GuardFW::mq_close(response);
+    }
+}
+
+void bench_queues()
+{
+    bench_shm_queue();
+    try
+    {
+        bench_mqueue();
+    }
+    catch (const std::system_error& error)  // e.g. no mqueue filesystem in containers
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg): allow printf
+        (void) printf("message queues not available: %s\n", error.what());
+    }
+}
+
+const GuardFW::benchmark::Registration registration {"shm_queue", bench_queues};
+
+}  // namespace
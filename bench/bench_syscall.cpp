@@ -0,0 +1,125 @@
+/**
+ * Microbenchmarks for modules/wrappers/wrapped_syscall.cppm
+ *
+ * Compares direct system calls with the same calls through libc, mainly for the EAGAIN path of nonblocking calls.
+ * The difference is the saved cost of errno, cancellation point handling and the variadic syscall() function.
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <cerrno>            // errno
+#include <cstdint>           // uint64_t
+#include <sys/eventfd.h>     // EFD_NONBLOCK, EFD_SEMAPHORE
+#include <sys/socket.h>      // ::socketpair(), AF_UNIX, SOCK_DGRAM, SOCK_NONBLOCK, MSG_DONTWAIT
+#include <sys/syscall.h>     // SYS_getppid
+#include <unistd.h>          // ::read(), ::syscall()
+
+import guardfw.benchmark;
+import guardfw.file_desciptor;
+import guardfw.wrapped_eventfd;
+import guardfw.wrapped_socket;
+import guardfw.wrapped_syscall;
+import guardfw.wrapped_unistd;
+
+namespace
+{
+
+constexpr uint64_t iterations_syscall = 1'000'000;
+
+using GuardFW::benchmark::do_not_optimize;
+using GuardFW::benchmark::run;
+
+/// System call without arguments, which is not cached by libc.
+void bench_getppid()
+{
+    run("syscall/getppid/syscall()", iterations_syscall, [] {
+        do_not_optimize(::syscall(SYS_getppid));
+    });
+    run("syscall/getppid/direct_syscall()", iterations_syscall, [] {
+        do_not_optimize(GuardFW::direct_syscall(SYS_getppid));
+    });
+}
+
+/// Successful read() on an eventfd semaphore and read() on an empty eventfd, which reports EAGAIN.
+void bench_read()
+{
+    GuardFW::FileDescriptor fd = GuardFW::eventfd(0xFFFF'FFFFU, EFD_SEMAPHORE | EFD_NONBLOCK);
+    uint64_t value             = 0;
+
+    run("syscall/read success/raw", iterations_syscall, [fd, &value] {
+        ssize_t result = ::read(fd, &value, sizeof(value));
+        if (result == -1)
+            do_not_optimize(errno);
+        do_not_optimize(result);
+    });
+    run("syscall/read success/read", iterations_syscall, [fd, &value] {
+        do_not_optimize(GuardFW::read(fd, &value, sizeof(value)));
+    });
+    GuardFW::close(fd);
+
+    fd = GuardFW::eventfd(0, EFD_NONBLOCK);
+    run("syscall/read eagain/read_nonblock", iterations_syscall, [fd, &value] {
+        do_not_optimize(GuardFW::read_nonblock(fd, &value, sizeof(value)));
+    });
+    run("syscall/read eagain/kernel::read_nonblock", iterations_syscall, [fd, &value] {
+        do_not_optimize(GuardFW::kernel::read_nonblock(fd, &value, sizeof(value)));
+    });
+    GuardFW::close(fd);
+}
+
+/// write() on a full eventfd, which reports EAGAIN.
+void bench_write()
+{
+    const GuardFW::FileDescriptor fd = GuardFW::eventfd(0, EFD_NONBLOCK);
+    const uint64_t full              = 0xFFFF'FFFF'FFFF'FFFEULL;  // maximum counter value
+    const uint64_t one               = 1;
+    (void) GuardFW::write(fd, &full, sizeof(full));
+    run("syscall/write eagain/write_nonblock", iterations_syscall, [fd, &one] {
+        do_not_optimize(GuardFW::write_nonblock(fd, &one, sizeof(one)));
+    });
+    run("syscall/write eagain/kernel::write_nonblock", iterations_syscall, [fd, &one] {
+        do_not_optimize(GuardFW::kernel::write_nonblock(fd, &one, sizeof(one)));
+    });
+    GuardFW::close(fd);
+}
+
+/// recv() on an empty datagram socket and send() to a full one, which both report EAGAIN.
+void bench_send_recv()
+{
+    int fds[2] {GuardFW::file_descriptor_invalid, GuardFW::file_descriptor_invalid};
+    if (::socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0, fds) != 0)
+        return;
+    char byte = 'x';
+
+    run("syscall/recv eagain/recv_nonblock", iterations_syscall, [&fds, &byte] {
+        do_not_optimize(GuardFW::recv_nonblock(fds[1], &byte, 1, 0));
+    });
+    run("syscall/recv eagain/kernel::recv_nonblock", iterations_syscall, [&fds, &byte] {
+        do_not_optimize(GuardFW::kernel::recv_nonblock(fds[1], &byte, 1, 0));
+    });
+
+    while (::send(fds[0], &byte, 1, MSG_DONTWAIT) == 1)  // fills the receive queue
+        ;
+    run("syscall/send eagain/send_nonblock", iterations_syscall, [&fds, &byte] {
+        do_not_optimize(GuardFW::send_nonblock(fds[0], &byte, 1, 0));
+    });
+    run("syscall/send eagain/kernel::send_nonblock", iterations_syscall, [&fds, &byte] {
+        do_not_optimize(GuardFW::kernel::send_nonblock(fds[0], &byte, 1, 0));
+    });
+    GuardFW::close(fds[0]);
+    GuardFW::close(fds[1]);
+}
+
+void bench_syscall()
+{
+    bench_getppid();
+    bench_read();
+    bench_write();
+    bench_send_recv();
+}
+
+const GuardFW::benchmark::Registration registration {"syscall", bench_syscall};
+
+}  // namespace
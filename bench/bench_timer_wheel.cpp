@@ -0,0 +1,125 @@
+/**
+ * Microbenchmarks for modules/timer_wheel.cppm
+ *
+ * Compares scheduling and cancelling timers of a timing wheel on a single timerfd with one timerfd per timer.
+ * Both variants are measured with a population of armed background timers, the number of timerfds is limited by
+ * the soft limit of open file descriptors.
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <chrono>   // std::chrono::milliseconds
+#include <cstdint>  // uint64_t
+#include <memory>   // std::unique_ptr<>
+#include <time.h>   // itimerspec
+#include <vector>   // std::vector<>
+
+import guardfw.benchmark;
+import guardfw.file_desciptor;
+import guardfw.timer_wheel;
+import guardfw.wrapped_timerfd;
+import guardfw.wrapped_unistd;
+
+namespace
+{
+
+constexpr uint64_t iterations_wheel   = 1'000'000;
+constexpr uint64_t iterations_timerfd = 100'000;
+constexpr size_t background_timers    = 10'000;
+constexpr size_t background_timerfds  = 512;  ///< limited by RLIMIT_NOFILE
+
+using GuardFW::benchmark::do_not_optimize;
+using GuardFW::benchmark::run;
+
+constexpr struct itimerspec* no_old_value {nullptr};
+
+class IdleTimer : public GuardFW::Timer
+{
+public:
+    void on_expired(GuardFW::TimerWheel&) override {}
+};
+
+/// @return timeout of a background timer between 1 and 60 seconds
+std::chrono::milliseconds background_timeout(size_t index)
+{
+    return std::chrono::milliseconds(1'000 + (index * 7'919) % 59'000);
+}
+
+struct itimerspec timerfd_timeout(std::chrono::milliseconds timeout)
+{
+    struct itimerspec value {};
+    value.it_value.tv_sec  = static_cast<time_t>(timeout.count() / 1'000);
+    value.it_value.tv_nsec = static_cast<long>(timeout.count() % 1'000) * 1'000'000;
+    return value;
+}
+
+void bench_wheel()
+{
+    GuardFW::TimerWheel wheel;
+    std::vector<std::unique_ptr<IdleTimer>> background(background_timers);
+    for (size_t index = 0; index < background.size(); index++)
+    {
+        background[index] = std::make_unique<IdleTimer>();
+        wheel.schedule(*background[index], background_timeout(index));
+    }
+
+    IdleTimer timer;
+    run("timer/wheel/schedule+cancel", iterations_wheel, [&wheel, &timer] {
+        wheel.schedule(timer, std::chrono::seconds(30));
+        wheel.cancel(timer);
+    });
+
+    uint64_t round = 0;
+    run("timer/wheel/reschedule", iterations_wheel, [&wheel, &background, &round] {
+        const size_t index = round++ % background.size();
+        wheel.schedule(*background[index], background_timeout(index));
+    });
+
+    run("timer/wheel/schedule earliest+cancel", iterations_timerfd, [&wheel, &timer] {
+        wheel.schedule(timer, std::chrono::milliseconds(100));  // earliest, reprograms the timerfd once per tick
+        wheel.cancel(timer);
+    });
+    do_not_optimize(wheel.size());
+}
+
+void bench_timerfd()
+{
+    std::vector<GuardFW::FileDescriptor> background(background_timerfds);
+    for (size_t index = 0; index < background.size(); index++)
+    {
+        background[index] =
+            GuardFW::timerfd_create(GuardFW::constants::clock_monotonic, GuardFW::constants::tfd_cloexec);
+        const struct itimerspec value = timerfd_timeout(background_timeout(index));
+        GuardFW::timerfd_settime(background[index], 0, &value, no_old_value);
+    }
+
+    run("timer/timerfd/create+settime+close", iterations_timerfd, [] {
+        const GuardFW::FileDescriptor fd =
+            GuardFW::timerfd_create(GuardFW::constants::clock_monotonic, GuardFW::constants::tfd_cloexec);
+        const struct itimerspec value = timerfd_timeout(std::chrono::seconds(30));
+        GuardFW::timerfd_settime(fd, 0, &value, no_old_value);
+        GuardFW::close(fd);
+    });
+
+    uint64_t round = 0;
+    run("timer/timerfd/rearm", iterations_timerfd, [&background, &round] {
+        const size_t index            = round++ % background.size();
+        const struct itimerspec value = timerfd_timeout(background_timeout(index));
+        GuardFW::timerfd_settime(background[index], 0, &value, no_old_value);
+    });
+
+    for (GuardFW::FileDescriptor fd : background)
+        GuardFW::close(fd);
+}
+
+void bench_timer_wheel()
+{
+    bench_wheel();
+    bench_timerfd();
+}
+
+const GuardFW::benchmark::Registration registration {"timer_wheel", bench_timer_wheel};
+
+}  // namespace
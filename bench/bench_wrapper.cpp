@@ -0,0 +1,212 @@
+/**
+ * Microbenchmarks for modules/wrapper.cppm
+ *
+ * Compares raw Linux API calls with the same calls wrapped in different contexts for the success path,
+ * the soft error path (EAGAIN) and the error path (direct errors and thrown exceptions).
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <cerrno>           // errno
+#include <cstdint>          // uint64_t
+#include <expected>         // std::expected<>
+#include <optional>         // std::optional<>
+#include <source_location>  // std::source_location
+#include <system_error>     // std::system_error
+
+#include <sys/eventfd.h>  // EFD_NONBLOCK, EFD_SEMAPHORE
+#include <unistd.h>       // ::read()
+
+import guardfw.benchmark;
+import guardfw.file_desciptor;
+import guardfw.flight_recorder;
+import guardfw.wrapper;
+import guardfw.wrapped_eventfd;
+import guardfw.wrapped_unistd;
+
+namespace
+{
+
+constexpr uint64_t iterations_call    = 10'000'000;  ///< no syscall, only wrapper overhead
+constexpr uint64_t iterations_syscall = 1'000'000;   ///< syscall success and soft error paths
+constexpr uint64_t iterations_throw   = 100'000;     ///< exceptions are expensive
+
+using GuardFW::benchmark::do_not_optimize;
+using GuardFW::benchmark::run;
+
+/// ContextStd with recorded statistics
+using ContextStdStatistics = GuardFW::
+    Context<GuardFW::ErrorIndication::eqm1_errno, GuardFW::ErrorReport::exception, GuardFW::ErrorSpecial::statistics>;
+
+/// ContextStd with flight recorder
+using ContextStdFlightRecorder = GuardFW::Context<
+    GuardFW::ErrorIndication::eqm1_errno,
+    GuardFW::ErrorReport::exception,
+    GuardFW::ErrorSpecial::flight_recorder>;
+
+/// Always successful function without syscall, isolates the wrapper overhead.
+[[gnu::noinline]] int success_call(int value)
+{
+    asm volatile("" : "+r"(value));
+    return value;
+}
+
+/// Wrapper overhead without syscall.
+void bench_call()
+{
+    run("call/success/raw", iterations_call, [] {
+        int result = success_call(1);
+        if (result == -1)
+            do_not_optimize(errno);
+        do_not_optimize(result);
+    });
+    run("call/success/ContextStd", iterations_call, [] {
+        do_not_optimize(GuardFW::ContextStd::wrapper<success_call>(std::source_location::current(), 1));
+    });
+    run("call/success/ContextRepeatEINTR", iterations_call, [] {
+        do_not_optimize(GuardFW::ContextRepeatEINTR::wrapper<success_call>(std::source_location::current(), 1));
+    });
+    run("call/success/ContextNonblockRepeatEINTR", iterations_call, [] {
+        do_not_optimize(GuardFW::ContextNonblockRepeatEINTR::wrapper<success_call>(std::source_location::current(), 1));
+    });
+    run("call/success/ContextDirectErrors", iterations_call, [] {
+        do_not_optimize(GuardFW::ContextDirectErrors::wrapper<success_call>(std::source_location::current(), 1));
+    });
+    run("call/success/ContextStd+statistics", iterations_call, [] {
+        do_not_optimize(ContextStdStatistics::wrapper<success_call>(std::source_location::current(), 1));
+    });
+    run("call/success/ContextStd+flight_recorder", iterations_call, [] {
+        do_not_optimize(ContextStdFlightRecorder::wrapper<success_call>(std::source_location::current(), 1));
+    });
+    GuardFW::flight_recorder::enable_timestamps(false);
+    run("call/success/ContextStd+flight_recorder, no timestamps", iterations_call, [] {
+        do_not_optimize(ContextStdFlightRecorder::wrapper<success_call>(std::source_location::current(), 1));
+    });
+    GuardFW::flight_recorder::enable_timestamps(true);
+}
+
+/// Successful read() on an eventfd semaphore, which can be read ~4 billion times.
+void bench_read_success()
+{
+    GuardFW::FileDescriptor fd = GuardFW::eventfd(0xFFFF'FFFFU, EFD_SEMAPHORE | EFD_NONBLOCK);
+    uint64_t value             = 0;
+
+    run("read/success/raw", iterations_syscall, [fd, &value] {
+        ssize_t result = ::read(fd, &value, sizeof(value));
+        if (result == -1)
+            do_not_optimize(errno);
+        do_not_optimize(result);
+    });
+    run("read/success/ContextStd", iterations_syscall, [fd, &value] {
+        do_not_optimize(GuardFW::ContextStd::wrapper<::read, size_t>(
+            std::source_location::current(), fd, &value, sizeof(value)
+        ));
+    });
+    run("read/success/ContextRepeatEINTR", iterations_syscall, [fd, &value] {
+        do_not_optimize(GuardFW::ContextRepeatEINTR::wrapper<::read, size_t>(
+            std::source_location::current(), fd, &value, sizeof(value)
+        ));
+    });
+    run("read/success/ContextNonblockRepeatEINTR", iterations_syscall, [fd, &value] {
+        do_not_optimize(GuardFW::ContextNonblockRepeatEINTR::wrapper<::read, size_t>(
+            std::source_location::current(), fd, &value, sizeof(value)
+        ));
+    });
+    run("read/success/ContextDirectErrors", iterations_syscall, [fd, &value] {
+        do_not_optimize(GuardFW::ContextDirectErrors::wrapper<::read, size_t>(
+            std::source_location::current(), fd, &value, sizeof(value)
+        ));
+    });
+    run("read/success/ContextStd+statistics", iterations_syscall, [fd, &value] {
+        do_not_optimize(ContextStdStatistics::wrapper<::read, size_t>(
+            std::source_location::current(), fd, &value, sizeof(value)
+        ));
+    });
+    run("read/success/ContextStd+flight_recorder", iterations_syscall, [fd, &value] {
+        do_not_optimize(ContextStdFlightRecorder::wrapper<::read, size_t>(
+            std::source_location::current(), fd, &value, sizeof(value)
+        ));
+    });
+
+    GuardFW::close(fd);
+}
+
+/// read() on an empty nonblocking eventfd, which reports EAGAIN.
+void bench_read_eagain()
+{
+    GuardFW::FileDescriptor fd = GuardFW::eventfd(0, EFD_NONBLOCK);
+    uint64_t value             = 0;
+
+    run("read/eagain/raw", iterations_syscall, [fd, &value] {
+        ssize_t result = ::read(fd, &value, sizeof(value));
+        if (result == -1)
+            do_not_optimize(errno == EAGAIN);
+        do_not_optimize(result);
+    });
+    run("read/eagain/read_nonblock", iterations_syscall, [fd, &value] {
+        do_not_optimize(GuardFW::read_nonblock(fd, &value, sizeof(value)));
+    });
+    run("read/eagain/ContextDirectErrors", iterations_syscall, [fd, &value] {
+        do_not_optimize(GuardFW::ContextDirectErrors::wrapper<::read, size_t>(
+            std::source_location::current(), fd, &value, sizeof(value)
+        ));
+    });
+
+    GuardFW::close(fd);
+}
+
+/// read() on an invalid file descriptor, which reports EBADF.
+void bench_read_error()
+{
+    uint64_t value = 0;
+
+    run("read/ebadf/raw", iterations_throw, [&value] {
+        ssize_t result = ::read(GuardFW::file_descriptor_invalid, &value, sizeof(value));
+        if (result == -1)
+            do_not_optimize(errno);
+        do_not_optimize(result);
+    });
+    run("read/ebadf/ContextDirectErrors", iterations_throw, [&value] {
+        do_not_optimize(GuardFW::ContextDirectErrors::wrapper<::read, size_t>(
+            std::source_location::current(), GuardFW::file_descriptor_invalid, &value, sizeof(value)
+        ));
+    });
+    run("read/ebadf/ContextStd (throws)", iterations_throw, [&value] {
+        try
+        {
+            do_not_optimize(GuardFW::ContextStd::wrapper<::read, size_t>(
+                std::source_location::current(), GuardFW::file_descriptor_invalid, &value, sizeof(value)
+            ));
+        }
+        catch (const std::system_error& error)
+        {
+            do_not_optimize(error.code());
+        }
+    });
+    run("read/ebadf/ContextStd (throws, what())", iterations_throw, [&value] {
+        try
+        {
+            do_not_optimize(GuardFW::ContextStd::wrapper<::read, size_t>(
+                std::source_location::current(), GuardFW::file_descriptor_invalid, &value, sizeof(value)
+            ));
+        }
+        catch (const std::system_error& error)
+        {
+            do_not_optimize(error.what()[0]);
+        }
+    });
+}
+
+void bench_wrapper()
+{
+    bench_call();
+    bench_read_success();
+    bench_read_eagain();
+    bench_read_error();
+}
+
+const GuardFW::benchmark::Registration registration {"wrapper", bench_wrapper};
+
+}  // namespace
@@ -0,0 +1,218 @@
+/**
+ * Minimal microbenchmark harness for GuardFW.
+ *
+ * Benchmark groups register themselves with a static Registration object and are executed by guardfw-bench.
+ * Each benchmark reports the wall-clock time per operation and, if the kernel allows access to the hardware
+ * performance counters (see /proc/sys/kernel/perf_event_paranoid), the retired user-space instructions
+ * per operation.
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+module;
+
+#include <chrono>           // std::chrono::steady_clock
+#include <cstdint>          // uint64_t
+#include <cstdio>           // ::printf()
+#include <expected>         // std::expected<>
+#include <source_location>  // std::source_location
+#include <string_view>      // std::string_view
+#include <utility>          // std::pair<>
+#include <vector>           // std::vector<>
+
+#include <linux/perf_event.h>  // perf_event_attr, PERF_*
+#include <sys/syscall.h>       // SYS_perf_event_open
+#include <unistd.h>            // ::syscall()
+
+export module guardfw.benchmark;
+
+import guardfw.wrapper;
+import guardfw.file_desciptor;
+import guardfw.wrapped_ioctl;
+import guardfw.wrapped_unistd;
+
+namespace GuardFW::benchmark
+{
+
+/// Benchmark group, which runs a set of benchmarks via GuardFW::benchmark::run().
+using BenchmarkGroup = void (*)();
+
+/// All registered benchmark groups, function-local to be independent of the static initialization order.
+std::vector<std::pair<std::string_view, BenchmarkGroup>>& registry()
+{
+    static std::vector<std::pair<std::string_view, BenchmarkGroup>> groups;
+    return groups;
+}
+
+/**
+ * Counter for user-space instructions of the calling thread, based on perf_event_open().
+ *
+ * If performance counters are not accessible, the counter is invalid and no instructions are reported.
+ */
+class InstructionCounter
+{
+public:
+    InstructionCounter()
+    {
+        struct perf_event_attr attr {};
+        attr.type           = PERF_TYPE_HARDWARE;
+        attr.size           = sizeof(attr);
+        attr.config         = PERF_COUNT_HW_INSTRUCTIONS;
+        attr.disabled       = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+
+        // missing permissions or missing PMU are expected, so errors are returned directly
+        std::expected<FileDescriptor, Error> opened =
+            ContextDirectErrors::wrapper<::syscall, FileDescriptor>(
+                std::source_location::current(), SYS_perf_event_open, &attr, 0, -1, -1, 0UL
+            );
+        if (opened.has_value())
+            counter_fd = opened.value();
+    }
+
+    InstructionCounter(const InstructionCounter&)            = delete;
+    InstructionCounter(InstructionCounter&&)                 = delete;
+    InstructionCounter& operator=(const InstructionCounter&) = delete;
+    InstructionCounter& operator=(InstructionCounter&&)      = delete;
+
+    ~InstructionCounter()
+    {
+        if (valid())
+            GuardFW::close(counter_fd);
+    }
+
+    [[nodiscard]] bool valid() const noexcept
+    {
+        return counter_fd != file_descriptor_invalid;
+    }
+
+    void start()
+    {
+        if (valid())
+        {
+            GuardFW::ioctl_noretval(counter_fd, PERF_EVENT_IOC_RESET, nullptr);
+            GuardFW::ioctl_noretval(counter_fd, PERF_EVENT_IOC_ENABLE, nullptr);
+        }
+    }
+
+    [[nodiscard]] uint64_t stop()
+    {
+        uint64_t count = 0;
+        if (valid())
+        {
+            GuardFW::ioctl_noretval(counter_fd, PERF_EVENT_IOC_DISABLE, nullptr);
+            GuardFW::read_ignore_result(counter_fd, &count, sizeof(count));
+        }
+        return count;
+    }
+
+private:
+    FileDescriptor counter_fd {file_descriptor_invalid};
+};
+
+std::string_view active_filter;  ///< only benchmarks containing this text are executed
+
+/**
+ * Checks the filter, e.g. before starting helper threads for a benchmark.
+ *
+ * @param  name Name of the benchmark.
+ * @return      true if run() will execute the benchmark
+ */
+export [[nodiscard]] bool selected(std::string_view name) noexcept
+{
+    return active_filter.empty() || name.find(active_filter) != std::string_view::npos;
+}
+
+/**
+ * Prevents the compiler from optimizing away the calculation of a value.
+ *
+ * @tparam T     Type of value.
+ * @param  value Value, which shall be treated as used.
+ */
+export template<typename T>
+[[gnu::always_inline]] inline void do_not_optimize(const T& value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+/**
+ * Registers a benchmark group at static initialization time.
+ */
+export struct Registration
+{
+    Registration(std::string_view group, BenchmarkGroup function)
+    {
+        registry().emplace_back(group, function);
+    }
+};
+
+/**
+ * Runs a single benchmark and prints time and instructions per operation.
+ *
+ * @tparam OPERATION  Callable without arguments, which is inlined into the measurement loop.
+ * @param  name       Name of the benchmark, should be unique.
+ * @param  iterations Number of measured operations.
+ * @param  operation  Operation to be measured.
+ */
+export template<typename OPERATION>
+void run(std::string_view name, uint64_t iterations, OPERATION&& operation)
+{
+    if (!selected(name))
+        return;
+
+    for (uint64_t warmup = 0; warmup < (iterations / 10) + 1; warmup++)
+        operation();
+
+    InstructionCounter instructions;
+    instructions.start();
+    const auto start = std::chrono::steady_clock::now();
+
+    for (uint64_t iteration = 0; iteration < iterations; iteration++)
+        operation();
+
+    const auto stop                = std::chrono::steady_clock::now();
+    const uint64_t instructions_nr = instructions.stop();
+
+    const double elapsed_ns = std::chrono::duration<double, std::nano>(stop - start).count();
+    const double ops        = static_cast<double>(iterations);
+
+    if (instructions.valid())
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg): allow printf
+        (void) printf(
+            "%-56.*s %10.2f ns/op %10.1f instr/op\n",
+            static_cast<int>(name.size()),
+            name.data(),
+            elapsed_ns / ops,
+            static_cast<double>(instructions_nr) / ops
+        );
+    else
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg): allow printf
+        (void) printf(
+            "%-56.*s %10.2f ns/op %10s instr/op\n",
+            static_cast<int>(name.size()),
+            name.data(),
+            elapsed_ns / ops,
+            "n/a"
+        );
+}
+
+/**
+ * Runs all registered benchmark groups.
+ *
+ * @param filter Only benchmarks, whose names contain this text, are executed. Empty runs all benchmarks.
+ */
+export void run_all(std::string_view filter)
+{
+    active_filter = filter;
+    for (const auto& [group, function] : registry())
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg): allow printf
+        (void) printf("### %.*s\n", static_cast<int>(group.size()), group.data());
+        function();
+    }
+}
+
+}  // namespace GuardFW::benchmark
@@ -0,0 +1,27 @@
+# compile microbenchmarks
+
+option(COMPILE_BENCHMARKS "build microbenchmarks" ON)
+if (COMPILE_BENCHMARKS)
+    set(target_bench ${CMAKE_PROJECT_NAME}-bench)
+
+    add_executable(${target_bench})
+
+    target_sources(${target_bench}
+            PRIVATE
+            ${bench_sources}
+    )
+
+    # benchmark harness is a module, but it is not part of the installed library
+    target_sources(${target_bench}
+            PRIVATE
+            FILE_SET ${CMAKE_PROJECT_NAME}_bench_fileset
+            TYPE CXX_MODULES
+            FILES ${bench_module_sources}
+    )
+
+    target_link_libraries(${target_bench} PRIVATE
+            ${target_modules}
+            -lrt
+            -pthread
+    )
+endif ()
@@ -0,0 +1,330 @@
+/**
+ * Adaptive busy-poll receiving for low-latency sockets.
+ *
+ * The class BusyPollReceiver receives from a nonblocking socket in three phases: it spins with nonblocking receives
+ * for a time budget, then yields the CPU a few times, and finally sleeps in epoll_wait(). The spin budget adapts to
+ * the observed inter-arrival time of messages: if messages arrive faster than the maximum budget, spinning bridges
+ * the gaps and avoids the wakeup latency of epoll, otherwise the budget shrinks to the minimum to save CPU time.
+ * Statistics count the phase, in which each receive succeeded, for tuning the budget per socket.
+ *
+ * The kernel's own busy polling of the NIC queues (SO_BUSY_POLL, SO_PREFER_BUSY_POLL and EPIOCSPARAMS for the
+ * epoll instance) can be enabled by the options. It complements the user space spinning for real NICs. Kernels
+ * before Linux 6.9 do not support EPIOCSPARAMS, then only the socket options are set.
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+module;
+
+#include <sys/epoll.h>   // EPOLL*, epoll_event
+#include <sys/socket.h>  // SOL_SOCKET, SO_BUSY_POLL, SO_PREFER_BUSY_POLL, SO_BUSY_POLL_BUDGET, msghdr
+
+#include <algorithm>        // std::clamp()
+#include <cerrno>           // ENOTTY
+#include <chrono>           // std::chrono::steady_clock, std::chrono::nanoseconds, std::chrono::ceil()
+#include <cstddef>          // size_t
+#include <cstdint>          // uint16_t, uint32_t, uint64_t
+#include <optional>         // std::optional<>
+#include <source_location>  // std::source_location
+#include <system_error>     // std::system_error
+
+export module guardfw.busy_poll;
+
+import guardfw.file_desciptor;
+import guardfw.wrapped_epoll;
+import guardfw.wrapped_sched;
+import guardfw.wrapped_socket;
+import guardfw.wrapped_unistd;
+
+namespace GuardFW
+{
+
+/// Options for BusyPollReceiver.
+export struct BusyPollOptions
+{
+    std::chrono::nanoseconds min_spin {0};           ///< lower limit of the adaptive spin budget
+    std::chrono::nanoseconds max_spin {50'000};      ///< upper limit of the adaptive spin budget
+    std::chrono::nanoseconds initial_spin {10'000};  ///< spin budget before the first message
+    unsigned int yields {4};                         ///< sched_yield() calls between spinning and sleeping
+    unsigned int kernel_busy_poll_usecs {0};         ///< SO_BUSY_POLL and epoll busy poll time, 0 keeps it
+    uint16_t kernel_busy_poll_budget {0};            ///< packets per kernel busy poll, 0 keeps the default
+    bool kernel_prefer_busy_poll {false};            ///< SO_PREFER_BUSY_POLL, defers NIC interrupts
+    bool kernel_epoll_busy_poll {true};              ///< also busy polls the epoll instance, if supported
+};
+
+/// Number of receives by the phase, in which they succeeded.
+export struct BusyPollStatistics
+{
+    uint64_t immediate {0};                 ///< data was already available
+    uint64_t spun {0};                      ///< data arrived while spinning
+    uint64_t yielded {0};                   ///< data arrived while yielding
+    uint64_t slept {0};                     ///< data arrived after sleeping in epoll_wait()
+    uint64_t timeouts {0};                  ///< no data within the timeout
+    std::chrono::nanoseconds spin_time {};  ///< total time spent spinning, including unsuccessful spinning
+};
+
+/**
+ * Receiver with adaptive busy polling on a nonblocking socket.
+ *
+ * The socket remains owned by the caller. The receiver is not thread-safe, it is intended for a thread pinned to
+ * a dedicated core.
+ */
+export class BusyPollReceiver
+{
+public:
+    /**
+     * Registers the socket in an own epoll instance and applies the kernel busy poll options.
+     *
+     * @param sockfd          Nonblocking socket.
+     * @param options         Busy poll options.
+     * @param source_location Holds information about caller/calling position.
+     */
+    explicit BusyPollReceiver(
+        FileDescriptor sockfd,
+        const BusyPollOptions& options              = {},
+        const std::source_location& source_location = std::source_location::current()
+    )
+        : fd(sockfd)
+        , settings(options)
+        , budget(std::clamp(options.initial_spin, options.min_spin, options.max_spin))
+        , epoll_fd(GuardFW::epoll_create1(EPOLL_CLOEXEC, source_location))
+        , location(source_location)
+    {
+        try
+        {
+            struct epoll_event event {.events = EPOLLIN, .data = {.fd = fd}};
+            GuardFW::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event, source_location);
+
+            if (settings.kernel_busy_poll_usecs > 0)
+            {
+                GuardFW::setsockopt(
+                    fd, SOL_SOCKET, SO_BUSY_POLL, static_cast<int>(settings.kernel_busy_poll_usecs), source_location
+                );
+                if (settings.kernel_epoll_busy_poll)
+                    epoll_busy_poll = set_epoll_params(source_location);
+            }
+            if (settings.kernel_busy_poll_budget > 0)
+                GuardFW::setsockopt(
+                    fd, SOL_SOCKET, SO_BUSY_POLL_BUDGET, static_cast<int>(settings.kernel_busy_poll_budget),
+                    source_location
+                );
+            if (settings.kernel_prefer_busy_poll)
+                GuardFW::setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, 1, source_location);
+        }
+        catch (...)
+        {
+            GuardFW::close(epoll_fd, source_location);
+            throw;
+        }
+    }
+
+    BusyPollReceiver(const BusyPollReceiver&)            = delete;
+    BusyPollReceiver(BusyPollReceiver&&)                 = delete;
+    BusyPollReceiver& operator=(const BusyPollReceiver&) = delete;
+    BusyPollReceiver& operator=(BusyPollReceiver&&)      = delete;
+
+    ~BusyPollReceiver()
+    {
+        GuardFW::close(epoll_fd, location);
+    }
+
+    /**
+     * Receives data, spinning, yielding and sleeping until data is available.
+     *
+     * @param buf             Receive buffer.
+     * @param len             Length of buffer.
+     * @param flags           recv() flags.
+     * @param timeout         Timeout of the sleeping phase in ms, -1 waits infinitely.
+     * @param source_location Holds information about caller/calling position.
+     * @return                number of received bytes (0 at orderly shutdown), or std::nullopt at timeout
+     */
+    [[nodiscard]] std::optional<size_t> receive(
+        void* buf,
+        size_t len,
+        int flags                                   = 0,
+        int timeout                                 = -1,
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        return poll(
+            [this, buf, len, flags, &source_location] {
+                return GuardFW::recv_nonblock(fd, buf, len, flags, source_location);
+            },
+            timeout,
+            source_location
+        );
+    }
+
+    /**
+     * Receives a message, spinning, yielding and sleeping until data is available.
+     *
+     * @param msg             Message header with receive buffers.
+     * @param flags           recvmsg() flags.
+     * @param timeout         Timeout of the sleeping phase in ms, -1 waits infinitely.
+     * @param source_location Holds information about caller/calling position.
+     * @return                number of received bytes (0 at orderly shutdown), or std::nullopt at timeout
+     */
+    [[nodiscard]] std::optional<size_t> receive_message(
+        struct msghdr* msg,
+        int flags                                   = 0,
+        int timeout                                 = -1,
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        return poll(
+            [this, msg, flags, &source_location] {
+                return GuardFW::recvmsg_nonblock(fd, msg, flags, source_location);
+            },
+            timeout,
+            source_location
+        );
+    }
+
+    /// @return current spin budget
+    [[nodiscard]] std::chrono::nanoseconds spin_budget() const noexcept
+    {
+        return budget;
+    }
+
+    /// @return smoothed inter-arrival time of received data, 0 before the second receive
+    [[nodiscard]] std::chrono::nanoseconds inter_arrival_time() const noexcept
+    {
+        return gap;
+    }
+
+    /// @return receive statistics
+    [[nodiscard]] const BusyPollStatistics& statistics() const noexcept
+    {
+        return counters;
+    }
+
+    /// @return true, if the epoll instance busy polls, false if disabled or not supported by the kernel
+    [[nodiscard]] bool kernel_epoll_busy_poll() const noexcept
+    {
+        return epoll_busy_poll;
+    }
+
+    /// @return epoll instance, which may show the kernel busy poll parameters with epoll_get_params()
+    [[nodiscard]] FileDescriptor epoll() const noexcept
+    {
+        return epoll_fd;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr int gap_weight_shift {3};  ///< weight 1/8 of a new inter-arrival time
+
+    /// @return false, if the kernel does not support EPIOCSPARAMS (before Linux 6.9)
+    bool set_epoll_params(const std::source_location& source_location)
+    {
+        try
+        {
+            GuardFW::epoll_set_params(
+                epoll_fd,
+                {
+                    .busy_poll_usecs  = settings.kernel_busy_poll_usecs,
+                    .busy_poll_budget = settings.kernel_busy_poll_budget,
+                    .prefer_busy_poll = static_cast<uint8_t>(settings.kernel_prefer_busy_poll),
+                    .__pad            = 0,
+                },
+                source_location
+            );
+            return true;
+        }
+        catch (const std::system_error& error)
+        {
+            if (error.code().value() != ENOTTY)  // unknown ioctl
+                throw;
+            return false;
+        }
+    }
+
+    template<typename ATTEMPT>
+    std::optional<size_t> poll(ATTEMPT&& attempt, int timeout, const std::source_location& source_location)
+    {
+        std::optional<size_t> received = attempt();
+        if (received)
+        {
+            counters.immediate++;
+            return arrived(Clock::now(), *received);
+        }
+
+        const Clock::time_point spin_start = Clock::now();
+        const Clock::time_point spin_end   = spin_start + budget;
+        Clock::time_point now              = spin_start;
+        while (now < spin_end)
+        {
+            received = attempt();
+            now      = Clock::now();
+            if (received)
+            {
+                counters.spin_time += now - spin_start;
+                counters.spun++;
+                return arrived(now, *received);
+            }
+        }
+        counters.spin_time += now - spin_start;
+
+        for (unsigned int yield = 0; yield < settings.yields; yield++)
+        {
+            GuardFW::sched_yield(source_location);
+            received = attempt();
+            if (received)
+            {
+                counters.yielded++;
+                return arrived(Clock::now(), *received);
+            }
+        }
+
+        // the timeout is not restarted by spurious wakeups
+        const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(timeout);
+        int remaining                    = timeout;
+        struct epoll_event event {};
+        while (GuardFW::epoll_wait(epoll_fd, &event, 1, remaining, source_location) > 0)
+        {
+            received = attempt();
+            if (received)
+            {
+                counters.slept++;
+                return arrived(Clock::now(), *received);
+            }
+            if (timeout >= 0)
+            {
+                const auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - Clock::now());
+                remaining       = (left.count() > 0) ? static_cast<int>(left.count()) : 0;
+            }
+        }
+        counters.timeouts++;
+        return std::nullopt;
+    }
+
+    /// Updates the inter-arrival time and adapts the spin budget.
+    size_t arrived(Clock::time_point now, size_t received) noexcept
+    {
+        if (last_arrival != Clock::time_point {})
+        {
+            const std::chrono::nanoseconds sample = now - last_arrival;
+            gap = (gap.count() == 0) ? sample : gap + (sample - gap) / (1 << gap_weight_shift);
+            // spinning pays off, if the next message is expected within the maximum budget
+            budget = (gap <= settings.max_spin) ? std::clamp(2 * gap, settings.min_spin, settings.max_spin)
+                                                : settings.min_spin;
+        }
+        last_arrival = now;
+        return received;
+    }
+
+    FileDescriptor fd;
+    BusyPollOptions settings;
+    std::chrono::nanoseconds budget;
+    std::chrono::nanoseconds gap {0};  ///< smoothed inter-arrival time
+    Clock::time_point last_arrival {};
+    BusyPollStatistics counters;
+    FileDescriptor epoll_fd;
+    bool epoll_busy_poll {false};
+    std::source_location location;  ///< location of construction, reported by errors during destruction
+};
+
+}  // namespace GuardFW
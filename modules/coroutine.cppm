@@ -0,0 +1,680 @@
+/**
+ * C++20 coroutines over the nonblocking wrappers.
+ *
+ * The awaitables async_read(), async_write(), async_recv(), async_send() and async_accept4() first try their
+ * nonblocking wrapper inline. Only if it would block, the coroutine is suspended and the file descriptor is
+ * registered at the edge-triggered Reactor of the current Scheduler, which resumes the coroutine as soon as the
+ * retried call succeeds. Errors are thrown as std::system_error at the co_await, like the wrapped calls do.
+ * Coroutine frames of Task are allocated from a thread-local pool, so spawning a task does not need malloc().
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+module;
+
+#include <sys/epoll.h>   // EPOLL*
+#include <sys/socket.h>  // sockaddr, socklen_t
+
+#include <array>            // std::array<>
+#include <cerrno>           // EBUSY
+#include <coroutine>        // std::coroutine_handle<>, std::suspend_always, std::noop_coroutine()
+#include <cstddef>          // size_t, std::byte, std::max_align_t
+#include <cstdint>          // uint32_t
+#include <deque>            // std::deque<>
+#include <exception>        // std::exception_ptr
+#include <memory>           // std::unique_ptr<>
+#include <new>              // ::operator new()
+#include <optional>         // std::optional<>
+#include <source_location>  // std::source_location
+#include <span>             // std::span<>
+#include <type_traits>      // std::is_void_v<>
+#include <utility>          // std::exchange(), std::move()
+#include <vector>           // std::vector<>
+
+export module guardfw.coroutine;
+
+import guardfw.exceptions;
+import guardfw.file_desciptor;
+import guardfw.reactor;
+import guardfw.wrapped_socket;
+import guardfw.wrapped_unistd;
+
+namespace GuardFW
+{
+
+/**
+ * Thread-local pool for coroutine frames with free lists per size class.
+ *
+ * Frames are carved from chunks, which are only returned to the system when the thread exits. Frames larger than
+ * the largest size class are allocated with ::operator new().
+ */
+class FramePool
+{
+public:
+    static constexpr size_t granularity {64};
+    static constexpr size_t size_classes {32};  ///< up to 2 KiB frames
+    static constexpr size_t frames_per_chunk {32};
+
+    FramePool()                            = default;
+    FramePool(const FramePool&)            = delete;
+    FramePool(FramePool&&)                 = delete;
+    FramePool& operator=(const FramePool&) = delete;
+    FramePool& operator=(FramePool&&)      = delete;
+    ~FramePool()                           = default;
+
+    void* allocate(size_t size)
+    {
+        const size_t size_class = (size + granularity - 1) / granularity;
+        if (size_class > size_classes)
+            return ::operator new(size);
+
+        FreeFrame*& head = free_lists[size_class - 1];
+        if (head == nullptr)
+            refill(size_class);
+        FreeFrame* const frame = head;
+        head                   = frame->next;
+        return frame;
+    }
+
+    void deallocate(void* pointer, size_t size) noexcept
+    {
+        const size_t size_class = (size + granularity - 1) / granularity;
+        if (size_class > size_classes)
+        {
+            ::operator delete(pointer, size);
+            return;
+        }
+        FreeFrame* const frame     = static_cast<FreeFrame*>(pointer);
+        frame->next                = free_lists[size_class - 1];
+        free_lists[size_class - 1] = frame;
+    }
+
+private:
+    struct FreeFrame
+    {
+        FreeFrame* next;
+    };
+
+    struct alignas(granularity) Block
+    {
+        std::byte bytes[granularity];
+    };
+
+    void refill(size_t size_class)
+    {
+        chunks.emplace_back(std::make_unique<Block[]>(size_class * frames_per_chunk));
+        Block* const chunk = chunks.back().get();
+        for (size_t index = frames_per_chunk; index-- > 0;)
+        {
+            auto* const frame          = reinterpret_cast<FreeFrame*>(chunk + index * size_class);
+            frame->next                = free_lists[size_class - 1];
+            free_lists[size_class - 1] = frame;
+        }
+    }
+
+    std::array<FreeFrame*, size_classes> free_lists {};
+    std::vector<std::unique_ptr<Block[]>> chunks;
+};
+
+FramePool& frame_pool()
+{
+    thread_local FramePool pool;
+    return pool;
+}
+
+/// Reports the end of a detached task to the current Scheduler.
+void detached_task_finished(size_t spawned_index, std::exception_ptr exception) noexcept;
+
+/// Common part of the promises of Task, allocates frames from the frame pool.
+class PromiseBase
+{
+public:
+    static void* operator new(size_t size)
+    {
+        return frame_pool().allocate(size);
+    }
+
+    static void operator delete(void* frame, size_t size) noexcept
+    {
+        frame_pool().deallocate(frame, size);
+    }
+
+    /// Continues with the awaiting coroutine, or destroys the frame of a detached task.
+    struct FinalAwaiter
+    {
+        [[nodiscard]] bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        template<typename PROMISE>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<PROMISE> handle) noexcept
+        {
+            PromiseBase& promise = handle.promise();
+            if (promise.continuation)
+                return promise.continuation;
+            if (promise.detached)
+            {
+                std::exception_ptr exception = std::move(promise.exception);
+                const size_t spawned_index   = promise.spawned_index;
+                handle.destroy();
+                detached_task_finished(spawned_index, std::move(exception));
+            }
+            return std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    [[nodiscard]] std::suspend_always initial_suspend() const noexcept
+    {
+        return {};
+    }
+
+    [[nodiscard]] FinalAwaiter final_suspend() const noexcept
+    {
+        return {};
+    }
+
+    void unhandled_exception() noexcept
+    {
+        exception = std::current_exception();
+    }
+
+    std::coroutine_handle<> continuation;
+    std::exception_ptr exception;
+    size_t spawned_index {0};  ///< index of a detached task in the spawned tasks of its Scheduler
+    bool detached {false};
+};
+
+template<typename T>
+class Promise;
+
+/**
+ * Lazily started coroutine, which is started by co_await or by Scheduler::spawn().
+ *
+ * @tparam T Type of result.
+ */
+export template<typename T = void>
+class [[nodiscard]] Task
+{
+public:
+    using promise_type = Promise<T>;
+
+    explicit Task(std::coroutine_handle<promise_type> coroutine) noexcept
+        : handle(coroutine)
+    {}
+
+    Task(const Task&) = delete;
+    Task(Task&& other) noexcept
+        : handle(std::exchange(other.handle, nullptr))
+    {}
+    Task& operator=(const Task&) = delete;
+    Task& operator=(Task&&)      = delete;
+
+    ~Task()
+    {
+        if (handle)
+            handle.destroy();
+    }
+
+    /// Starts the task and suspends the awaiting coroutine until the task has finished.
+    struct Awaiter
+    {
+        [[nodiscard]] bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+        {
+            handle.promise().continuation = awaiting;
+            return handle;
+        }
+
+        T await_resume()
+        {
+            if (handle.promise().exception)
+                std::rethrow_exception(handle.promise().exception);
+            if constexpr (!std::is_void_v<T>)
+                return std::move(handle.promise().value.value());
+        }
+
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    Awaiter operator co_await() && noexcept
+    {
+        return {handle};
+    }
+
+    /// Transfers ownership of the coroutine frame, used by Scheduler::spawn().
+    std::coroutine_handle<promise_type> release() noexcept
+    {
+        return std::exchange(handle, nullptr);
+    }
+
+private:
+    std::coroutine_handle<promise_type> handle;
+};
+
+template<typename T>
+class Promise : public PromiseBase
+{
+public:
+    Task<T> get_return_object() noexcept
+    {
+        return Task<T>(std::coroutine_handle<Promise>::from_promise(*this));
+    }
+
+    void return_value(T result)
+    {
+        value.emplace(std::move(result));
+    }
+
+    std::optional<T> value;
+};
+
+template<>
+class Promise<void> : public PromiseBase
+{
+public:
+    Task<void> get_return_object() noexcept
+    {
+        return Task<void>(std::coroutine_handle<Promise>::from_promise(*this));
+    }
+
+    void return_void() const noexcept {}
+};
+
+/// Suspended I/O operation, which is retried when its file descriptor became ready.
+class IoOperation
+{
+public:
+    IoOperation()                              = default;
+    IoOperation(const IoOperation&)            = delete;
+    IoOperation(IoOperation&&)                 = delete;
+    IoOperation& operator=(const IoOperation&) = delete;
+    IoOperation& operator=(IoOperation&&)      = delete;
+    virtual ~IoOperation()                     = default;
+
+    /// @return true if the operation has completed with a result or an error
+    virtual bool attempt() noexcept = 0;
+
+    std::coroutine_handle<> handle;
+};
+
+/// Waiting operations of a file descriptor, registered at the Reactor.
+class IoWaiters : public EventHandler
+{
+public:
+    void on_events(Reactor&, FileDescriptor, uint32_t events) override
+    {
+        if (reader != nullptr && (events & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP)) != 0)
+            resume_if_completed(reader);
+        if (writer != nullptr && (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) != 0)
+            resume_if_completed(writer);
+    }
+
+    IoOperation* reader {nullptr};
+    IoOperation* writer {nullptr};
+    bool registered {false};
+
+private:
+    /// Spurious events and events consumed by other operations leave the operation waiting.
+    static void resume_if_completed(IoOperation*& operation)
+    {
+        if (!operation->attempt())
+            return;
+        std::exchange(operation, nullptr)->handle.resume();
+    }
+};
+
+/**
+ * Single-threaded scheduler for coroutines, which runs spawned tasks and waits for I/O with a Reactor.
+ */
+export class Scheduler
+{
+public:
+    /**
+     * Creates the reactor.
+     *
+     * @param batch_size      Maximum number of events per epoll_pwait2() call.
+     * @param source_location Holds information about caller/calling position.
+     */
+    explicit Scheduler(
+        size_t batch_size = 256, const std::source_location& source_location = std::source_location::current()
+    )
+        : event_loop(batch_size, source_location)
+    {}
+
+    Scheduler(const Scheduler&)            = delete;
+    Scheduler(Scheduler&&)                 = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+    Scheduler& operator=(Scheduler&&)      = delete;
+
+    /// Destroys spawned tasks, which have not finished, e.g. tasks waiting for I/O after an exception of run().
+    ~Scheduler()
+    {
+        for (const std::unique_ptr<IoWaiters>& fd_waiters : waiters)  // operations are part of the destroyed frames
+            if (fd_waiters)
+            {
+                fd_waiters->reader = nullptr;
+                fd_waiters->writer = nullptr;
+            }
+
+        Scheduler* const previous = std::exchange(current_scheduler, this);  // for destructors within the frames
+        for (std::coroutine_handle<Promise<void>> handle : spawned)
+            handle.destroy();
+        current_scheduler = previous;
+    }
+
+    /**
+     * Spawns a detached task, which is started by run().
+     *
+     * @param task Task, its frame is destroyed when it finishes.
+     */
+    void spawn(Task<void> task)
+    {
+        std::coroutine_handle<Promise<void>> handle = task.release();
+        handle.promise().detached                   = true;
+        handle.promise().spawned_index              = spawned.size();
+        spawned.push_back(handle);
+        ready.push_back(handle);
+    }
+
+    /**
+     * Runs all spawned tasks until they have finished.
+     *
+     * An exception, which escapes a detached task, is rethrown, the remaining tasks stay suspended.
+     *
+     * @param source_location Holds information about caller/calling position.
+     */
+    void run(const std::source_location& source_location = std::source_location::current())
+    {
+        Scheduler* const previous = std::exchange(current_scheduler, this);
+        try
+        {
+            while (!spawned.empty())
+            {
+                while (!ready.empty())
+                {
+                    std::coroutine_handle<> handle = ready.front();
+                    ready.pop_front();
+                    handle.resume();
+                    rethrow_task_exception();
+                }
+                if (!spawned.empty())
+                {
+                    (void) event_loop.run_once(nullptr, source_location);
+                    rethrow_task_exception();
+                }
+            }
+        }
+        catch (...)
+        {
+            current_scheduler = previous;
+            throw;
+        }
+        current_scheduler = previous;
+    }
+
+    /**
+     * Unregisters a file descriptor, must be called before a waited-for file descriptor is closed.
+     *
+     * @param fd              File descriptor without waiting operations.
+     * @param source_location Holds information about caller/calling position.
+     */
+    void forget(FileDescriptor fd, const std::source_location& source_location = std::source_location::current())
+    {
+        const auto index = static_cast<size_t>(fd);
+        if (index < waiters.size() && waiters[index] && waiters[index]->registered)
+        {
+            event_loop.remove(fd, source_location);
+            waiters[index]->registered = false;
+        }
+    }
+
+    /// @return scheduler, which runs the calling coroutine
+    [[nodiscard]] static Scheduler& current() noexcept
+    {
+        return *current_scheduler;
+    }
+
+    /// @return reactor, e.g. for registering additional event handlers
+    [[nodiscard]] Reactor& reactor() noexcept
+    {
+        return event_loop;
+    }
+
+    /**
+     * Suspends an operation until its file descriptor became ready, called by the awaitables.
+     *
+     * @param fd              Nonblocking file descriptor.
+     * @param write           true to wait for writability, false to wait for readability.
+     * @param operation       Operation, which is retried on events.
+     * @param source_location Holds information about caller/calling position.
+     */
+    void wait(FileDescriptor fd, bool write, IoOperation& operation, const std::source_location& source_location)
+    {
+        const auto index = static_cast<size_t>(fd);
+        if (index >= waiters.size())
+            waiters.resize(index + 1);
+        if (!waiters[index])
+            waiters[index] = std::make_unique<IoWaiters>();
+
+        IoWaiters& fd_waiters = *waiters[index];
+        IoOperation*& slot    = write ? fd_waiters.writer : fd_waiters.reader;
+        if (slot != nullptr)  // only one coroutine may wait per file descriptor and direction
+            throw_system_error(EBUSY, "Scheduler::wait", source_location);
+        if (!fd_waiters.registered)
+        {
+            event_loop.add(fd, fd_waiters, Reactor::default_events, source_location);
+            fd_waiters.registered = true;
+        }
+        slot = &operation;
+    }
+
+private:
+    friend void detached_task_finished(size_t spawned_index, std::exception_ptr exception) noexcept;
+
+    void rethrow_task_exception()
+    {
+        if (task_exception)
+            std::rethrow_exception(std::exchange(task_exception, nullptr));
+    }
+
+    static thread_local Scheduler* current_scheduler;
+
+    Reactor event_loop;
+    std::deque<std::coroutine_handle<>> ready;
+    std::vector<std::unique_ptr<IoWaiters>> waiters;            ///< indexed by file descriptor
+    std::vector<std::coroutine_handle<Promise<void>>> spawned;  ///< unfinished detached tasks
+    std::exception_ptr task_exception;  ///< first exception of a detached task
+};
+
+thread_local Scheduler* Scheduler::current_scheduler {nullptr};
+
+void detached_task_finished(size_t spawned_index, std::exception_ptr exception) noexcept
+{
+    Scheduler& scheduler = Scheduler::current();
+    std::coroutine_handle<Promise<void>> moved = scheduler.spawned.back();  // replaces the finished task
+    moved.promise().spawned_index              = spawned_index;
+    scheduler.spawned[spawned_index]           = moved;
+    scheduler.spawned.pop_back();
+    if (exception && !scheduler.task_exception)
+        scheduler.task_exception = std::move(exception);
+}
+
+/**
+ * Awaitable, which tries a nonblocking operation inline and suspends only if it would block.
+ *
+ * @tparam RESULT    Result type of the operation.
+ * @tparam OPERATION Callable, which returns std::optional<RESULT> with std::nullopt if the call would block.
+ */
+template<typename RESULT, typename OPERATION>
+class IoAwaitable : private IoOperation
+{
+public:
+    IoAwaitable(FileDescriptor fd, bool write, OPERATION&& operation, const std::source_location& source_location)
+        : file_descriptor(fd)
+        , for_writing(write)
+        , call(std::move(operation))
+        , location(source_location)
+    {}
+
+    [[nodiscard]] bool await_ready() noexcept
+    {
+        return attempt();
+    }
+
+    void await_suspend(std::coroutine_handle<> coroutine)
+    {
+        handle = coroutine;
+        Scheduler::current().wait(file_descriptor, for_writing, *this, location);
+    }
+
+    RESULT await_resume()
+    {
+        if (exception)
+            std::rethrow_exception(exception);
+        return result.value();
+    }
+
+private:
+    bool attempt() noexcept override
+    {
+        try
+        {
+            result = call();
+            return result.has_value();
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+            return true;
+        }
+    }
+
+    FileDescriptor file_descriptor;
+    bool for_writing;
+    OPERATION call;
+    std::source_location location;
+    std::optional<RESULT> result;
+    std::exception_ptr exception;
+};
+
+template<typename RESULT, typename OPERATION>
+IoAwaitable<RESULT, OPERATION> make_awaitable(
+    FileDescriptor fd, bool write, OPERATION&& operation, const std::source_location& source_location
+)
+{
+    return {fd, write, std::move(operation), source_location};
+}
+
+/**
+ * Reads from a nonblocking file descriptor, suspends until data is available.
+ *
+ * @param fd              Nonblocking file descriptor.
+ * @param buffer          Buffer for data.
+ * @param source_location Holds information about caller/calling position.
+ * @return                awaitable for the number of read bytes, 0 at EOF
+ */
+export [[nodiscard]] auto async_read(
+    FileDescriptor fd,
+    std::span<std::byte> buffer,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return make_awaitable<size_t>(fd, false, [=]() {
+        return GuardFW::read_nonblock(fd, buffer.data(), buffer.size(), source_location);
+    }, source_location);
+}
+
+/**
+ * Writes to a nonblocking file descriptor, suspends until data can be written.
+ *
+ * @param fd              Nonblocking file descriptor.
+ * @param buffer          Data.
+ * @param source_location Holds information about caller/calling position.
+ * @return                awaitable for the number of written bytes, which may be less than the buffer size
+ */
+export [[nodiscard]] auto async_write(
+    FileDescriptor fd,
+    std::span<const std::byte> buffer,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return make_awaitable<size_t>(fd, true, [=]() {
+        return GuardFW::write_nonblock(fd, buffer.data(), buffer.size(), source_location);
+    }, source_location);
+}
+
+/**
+ * Receives from a nonblocking socket, suspends until data is available.
+ *
+ * @param sockfd          Nonblocking socket.
+ * @param buffer          Buffer for data.
+ * @param flags           recv() flags.
+ * @param source_location Holds information about caller/calling position.
+ * @return                awaitable for the number of received bytes, 0 if the peer has shut down
+ */
+export [[nodiscard]] auto async_recv(
+    FileDescriptor sockfd,
+    std::span<std::byte> buffer,
+    int flags                                   = 0,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return make_awaitable<size_t>(sockfd, false, [=]() {
+        return GuardFW::recv_nonblock(sockfd, buffer.data(), buffer.size(), flags, source_location);
+    }, source_location);
+}
+
+/**
+ * Sends to a nonblocking socket, suspends until data can be sent.
+ *
+ * @param sockfd          Nonblocking socket.
+ * @param buffer          Data.
+ * @param flags           send() flags, MSG_NOSIGNAL is recommended.
+ * @param source_location Holds information about caller/calling position.
+ * @return                awaitable for the number of sent bytes, which may be less than the buffer size
+ */
+export [[nodiscard]] auto async_send(
+    FileDescriptor sockfd,
+    std::span<const std::byte> buffer,
+    int flags                                   = 0,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return make_awaitable<size_t>(sockfd, true, [=]() {
+        return GuardFW::send_nonblock(sockfd, buffer.data(), buffer.size(), flags, source_location);
+    }, source_location);
+}
+
+/**
+ * Accepts a connection on a nonblocking listening socket, suspends until a connection is pending.
+ *
+ * @param sockfd          Nonblocking listening socket.
+ * @param addr            Receives the peer address, may be nullptr.
+ * @param addrlen         Size of addr, receives the size of the peer address, may be nullptr.
+ * @param flags           accept4() flags, SOCK_NONBLOCK is needed for further awaitables.
+ * @param source_location Holds information about caller/calling position.
+ * @return                awaitable for the connected socket
+ */
+export [[nodiscard]] auto async_accept4(
+    FileDescriptor sockfd,
+    struct sockaddr* addr,
+    socklen_t* addrlen,
+    int flags,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return make_awaitable<FileDescriptor>(sockfd, false, [=]() {
+        return GuardFW::accept4_nonblock(sockfd, addr, addrlen, flags, source_location);
+    }, source_location);
+}
+
+}  // namespace GuardFW
@@ -0,0 +1,687 @@
+/**
+ * Streaming file reader and writer with O_DIRECT and a pipeline of aligned buffers.
+ *
+ * DirectFileWriter and DirectFileReader bypass the page cache with O_DIRECT, so streaming large files does not
+ * evict hot data. They draw page-aligned buffers from an AlignedBufferPool and keep all buffers of the pipeline
+ * in flight with io_uring: with two buffers, one buffer is filled or consumed while the other one is transferred.
+ * If the file system does not support O_DIRECT or buffered I/O is requested, the page cache is used, but the
+ * written and consumed ranges are dropped from it with sync_file_range() and posix_fadvise().
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+module;
+
+#include <fcntl.h>           // O_*
+#include <linux/io_uring.h>  // IORING_OP_READ, IORING_OP_WRITE, io_uring_sqe, io_uring_cqe
+#include <sys/stat.h>        // struct stat, mode_t
+
+#include <algorithm>        // std::min()
+#include <cerrno>           // EINVAL, EIO, ENOBUFS, EOPNOTSUPP
+#include <cstddef>          // size_t, std::byte
+#include <cstdint>          // uint8_t, uint32_t, uint64_t
+#include <cstring>          // std::memcpy(), std::memset()
+#include <expected>         // std::expected<>
+#include <source_location>  // std::source_location
+#include <span>             // std::span<>
+#include <system_error>     // std::system_error
+#include <utility>          // std::exchange()
+#include <vector>           // std::vector<>
+
+export module guardfw.direct_file;
+
+import guardfw.exceptions;
+import guardfw.file_desciptor;
+import guardfw.io_uring;
+import guardfw.wrapper;
+import guardfw.wrapped_fcntl;
+import guardfw.wrapped_mman;
+import guardfw.wrapped_stat;
+import guardfw.wrapped_unistd;
+
+namespace GuardFW
+{
+
+/**
+ * Pool of page-aligned buffers of equal size, as needed for O_DIRECT transfers.
+ *
+ * The pool can be shared by several streams of the same thread, it is not thread-safe.
+ */
+export class AlignedBufferPool
+{
+public:
+    static constexpr size_t alignment {4096};  ///< page size, satisfies the O_DIRECT alignment of all block devices
+
+    /**
+     * Maps the memory of all buffers.
+     *
+     * @param buffer_size     Size of a buffer, rounded up to alignment.
+     * @param buffer_count    Number of buffers, at least 1.
+     * @param source_location Holds information about caller/calling position.
+     */
+    AlignedBufferPool(
+        size_t buffer_size,
+        size_t buffer_count,
+        const std::source_location& source_location = std::source_location::current()
+    )
+        : size((std::max(buffer_size, size_t {1}) + alignment - 1) & ~(alignment - 1))
+        , count(std::max(buffer_count, size_t {1}))
+        , location(source_location)
+    {
+        memory = static_cast<std::byte*>(GuardFW::mmap(
+            nullptr,
+            size * count,
+            constants::prot_read | constants::prot_write,
+            constants::map_private | constants::map_anonymous,
+            file_descriptor_invalid,
+            0,
+            source_location
+        ));
+        free_buffers.reserve(count);
+        for (size_t index = count; index-- > 0;)
+            free_buffers.push_back(memory + index * size);
+    }
+
+    AlignedBufferPool(const AlignedBufferPool&)            = delete;
+    AlignedBufferPool(AlignedBufferPool&&)                 = delete;
+    AlignedBufferPool& operator=(const AlignedBufferPool&) = delete;
+    AlignedBufferPool& operator=(AlignedBufferPool&&)      = delete;
+
+    ~AlignedBufferPool()
+    {
+        GuardFW::munmap(memory, size * count, location);
+    }
+
+    /// @return free buffer of buffer_size() bytes, or nullptr if all buffers are in use
+    [[nodiscard]] std::byte* acquire() noexcept
+    {
+        if (free_buffers.empty())
+            return nullptr;
+        std::byte* const buffer = free_buffers.back();
+        free_buffers.pop_back();
+        return buffer;
+    }
+
+    /// Returns a buffer, which has been acquired before.
+    void release(std::byte* buffer) noexcept
+    {
+        free_buffers.push_back(buffer);
+    }
+
+    /// @return size of each buffer, a multiple of alignment
+    [[nodiscard]] size_t buffer_size() const noexcept
+    {
+        return size;
+    }
+
+    /// @return number of buffers
+    [[nodiscard]] size_t buffer_count() const noexcept
+    {
+        return count;
+    }
+
+    /// @return number of free buffers
+    [[nodiscard]] size_t available() const noexcept
+    {
+        return free_buffers.size();
+    }
+
+private:
+    size_t size;
+    size_t count;
+    std::byte* memory {nullptr};
+    std::vector<std::byte*> free_buffers;
+    std::source_location location;  ///< location of construction, reported by errors during destruction
+};
+
+/// Selects between O_DIRECT and the page cache.
+export enum class FileCaching : uint8_t {
+    direct,    ///< O_DIRECT, falls back to buffered I/O if the file system does not support it
+    buffered,  ///< page cache, ranges are dropped from the page cache after they have been transferred
+};
+
+/**
+ * Common part of the streams: file, pool, ring and the transfers in flight.
+ */
+class DirectFile
+{
+public:
+    DirectFile(const DirectFile&)            = delete;
+    DirectFile(DirectFile&&)                 = delete;
+    DirectFile& operator=(const DirectFile&) = delete;
+    DirectFile& operator=(DirectFile&&)      = delete;
+
+    /// @return file descriptor
+    [[nodiscard]] FileDescriptor fd() const noexcept
+    {
+        return file;
+    }
+
+    /// @return true if the page cache is bypassed with O_DIRECT
+    [[nodiscard]] bool direct() const noexcept
+    {
+        return direct_io;
+    }
+
+protected:
+    /// Transfer of a buffer, user_data of its SQE is the index of the transfer.
+    struct Transfer
+    {
+        std::byte* buffer {nullptr};  ///< nullptr if the transfer slot is unused
+        uint64_t offset {0};          ///< file offset of the buffer
+        size_t length {0};            ///< number of bytes to be transferred
+        size_t expected {0};          ///< number of bytes, which complete the transfer, less at the end of a file
+        size_t done {0};              ///< number of transferred bytes
+        bool completed {false};
+    };
+
+    DirectFile(
+        const char* pathname,
+        int flags,
+        mode_t mode,
+        FileCaching caching,
+        AlignedBufferPool& buffer_pool,
+        const std::source_location& source_location
+    )
+        : pool(buffer_pool)
+        , ring(static_cast<unsigned int>(buffer_pool.buffer_count()), 0, 0, source_location)
+        , transfers(buffer_pool.buffer_count())
+        , location(source_location)
+    {
+        if (caching == FileCaching::direct)
+        {
+            try
+            {
+                file      = GuardFW::open(pathname, flags | O_DIRECT, mode, source_location);
+                direct_io = true;
+                return;
+            }
+            catch (const std::system_error& error)
+            {
+                if (error.code().value() != EINVAL)  // file system does not support O_DIRECT
+                    throw;
+            }
+        }
+        file = GuardFW::open(pathname, flags, mode, source_location);
+    }
+
+    ~DirectFile() = default;
+
+    /**
+     * Submits the transfer of a buffer.
+     *
+     * @param opcode          IORING_OP_READ or IORING_OP_WRITE.
+     * @param buffer          Buffer from the pool.
+     * @param offset          File offset.
+     * @param length          Number of bytes.
+     * @param expected        Number of bytes, which complete the transfer.
+     * @param source_location Holds information about caller/calling position.
+     */
+    void submit(
+        uint8_t opcode,
+        std::byte* buffer,
+        uint64_t offset,
+        size_t length,
+        size_t expected,
+        const std::source_location& source_location
+    )
+    {
+        size_t index = 0;
+        while (transfers[index].buffer != nullptr)  // there are as many slots as buffers in the pool
+            index++;
+        transfers[index] = {.buffer = buffer, .offset = offset, .length = length, .expected = expected};
+        in_flight++;
+        enqueue(opcode, index);
+        // soft errors leave the entries in the submission queue, they are submitted again by reap()
+        (void) ring.submit(source_location);
+    }
+
+    /**
+     * Waits for the next completion and resubmits short transfers.
+     *
+     * With O_DIRECT, the rest of a short transfer is resubmitted from the last aligned offset. A short transfer,
+     * which does not reach the next aligned offset, fails with EIO.
+     *
+     * @param opcode          IORING_OP_READ or IORING_OP_WRITE.
+     * @param function        Name of the calling function, reported by errors.
+     * @param source_location Holds information about caller/calling position.
+     * @return                index of a completed transfer
+     */
+    size_t reap(uint8_t opcode, const char* function, const std::source_location& source_location)
+    {
+        for (;;)
+        {
+            std::expected<struct io_uring_cqe*, Error> waited = ring.wait_cqe(source_location);
+            if (!waited.has_value())  // EAGAIN or EBUSY, completions must be reaped first or resources are short
+                continue;
+
+            const auto index  = static_cast<size_t>((*waited)->user_data);
+            const int32_t res = (*waited)->res;
+            ring.cqe_seen();
+
+            Transfer& transfer = transfers[index];
+            const bool end     = (res == 0) && (opcode == IORING_OP_READ);  // a read of 0 bytes is the end of file
+            size_t done        = transfer.done + static_cast<size_t>(std::max(res, 0));
+            if (direct_io && !end && done < transfer.expected)  // the rest needs an aligned offset
+                done &= ~(AlignedBufferPool::alignment - 1);      // the unaligned end is transferred again
+            const bool stalled = !end && (done < transfer.expected) && (done <= transfer.done);
+            if (res < 0 || stalled)  // a transfer without progress would be resubmitted forever
+            {
+                in_flight--;
+                pool.release(std::exchange(transfer.buffer, nullptr));
+                throw_system_error(stalled ? EIO : -res, function, source_location);
+            }
+            transfer.done = done;
+            if (!end && transfer.done < transfer.expected)  // short transfer
+            {
+                enqueue(opcode, index);
+                continue;
+            }
+            transfer.completed = true;
+            in_flight--;
+            return index;
+        }
+    }
+
+    AlignedBufferPool& pool;
+    IoUring ring;
+    std::vector<Transfer> transfers;  ///< indexed by user_data
+    size_t in_flight {0};
+    FileDescriptor file {file_descriptor_invalid};
+    bool direct_io {false};
+    std::source_location location;  ///< location of construction, reported by errors during destruction
+
+private:
+    /// Prepares the SQE for the remaining part of a transfer.
+    void enqueue(uint8_t opcode, size_t index)
+    {
+        struct io_uring_sqe* sqe = ring.get_sqe();  // the ring has as many entries as there are buffers
+        const Transfer& transfer = transfers[index];
+        IoUring::prep(
+            *sqe,
+            opcode,
+            file,
+            transfer.buffer + transfer.done,
+            static_cast<uint32_t>(transfer.length - transfer.done),
+            transfer.offset + transfer.done,
+            index
+        );
+    }
+};
+
+/**
+ * Appends a stream of data to a new file.
+ *
+ * Data is copied into pool buffers, full buffers are written in the background, while the next buffer is filled.
+ * close() writes the last partial buffer, truncates the file to the written size and flushes it with fdatasync().
+ * Call close() explicitly to get write errors, the destructor closes the file as well, but ignores errors.
+ */
+export class DirectFileWriter : public DirectFile
+{
+public:
+    /**
+     * Creates or truncates a file and preallocates its disk space.
+     *
+     * @param pathname        Path of the file.
+     * @param buffer_pool     Pool for buffers, must outlive the writer.
+     * @param preallocate     Expected file size, preallocated with fallocate() if the file system supports it.
+     * @param caching         O_DIRECT or page cache.
+     * @param mode            Permissions of a created file.
+     * @param source_location Holds information about caller/calling position.
+     */
+    DirectFileWriter(
+        const char* pathname,
+        AlignedBufferPool& buffer_pool,
+        size_t preallocate                          = 0,
+        FileCaching caching                         = FileCaching::direct,
+        mode_t mode                                 = 0644,
+        const std::source_location& source_location = std::source_location::current()
+    )
+        : DirectFile(pathname, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode, caching, buffer_pool, source_location)
+    {
+        if (preallocate == 0)
+            return;
+        try
+        {
+            GuardFW::fallocate(
+                file, constants::falloc_fl_keep_size, 0, static_cast<off_t>(preallocate), source_location
+            );
+        }
+        catch (const std::system_error& error)
+        {
+            if (error.code().value() != EOPNOTSUPP)  // preallocation is only an optimization
+            {
+                GuardFW::close(file, source_location);
+                throw;
+            }
+        }
+    }
+
+    DirectFileWriter(const DirectFileWriter&)            = delete;
+    DirectFileWriter(DirectFileWriter&&)                 = delete;
+    DirectFileWriter& operator=(const DirectFileWriter&) = delete;
+    DirectFileWriter& operator=(DirectFileWriter&&)      = delete;
+
+    /// Closes the file, if close() has not been called. Errors are ignored, call close() to handle them.
+    ~DirectFileWriter()
+    {
+        try
+        {
+            close(location);
+        }
+        catch (const std::system_error&)  // destructors must not throw
+        {}
+    }
+
+    /**
+     * Appends data, waits only if all buffers of the pool are in flight.
+     *
+     * @param data            Data.
+     * @param source_location Holds information about caller/calling position.
+     */
+    void write(
+        std::span<const std::byte> data, const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        while (!data.empty())
+        {
+            if (current == nullptr)
+                current = acquire_buffer(source_location);
+            const size_t length = std::min(data.size(), pool.buffer_size() - filled);
+            std::memcpy(current + filled, data.data(), length);
+            filled += length;
+            written += length;
+            data = data.subspan(length);
+            if (filled == pool.buffer_size())
+                submit_current(filled, source_location);
+        }
+    }
+
+    /**
+     * Writes all buffered data, sets the file size, flushes and closes the file. Later calls do nothing.
+     *
+     * @param source_location Holds information about caller/calling position.
+     */
+    void close(const std::source_location& source_location = std::source_location::current())
+    {
+        if (file == file_descriptor_invalid)
+            return;
+
+        if (filled > 0)  // O_DIRECT needs aligned lengths, the padding is truncated below
+        {
+            const size_t length = (filled + AlignedBufferPool::alignment - 1) & ~(AlignedBufferPool::alignment - 1);
+            std::memset(current + filled, 0, length - filled);
+            submit_current(length, source_location);
+        }
+        if (current != nullptr)
+            pool.release(std::exchange(current, nullptr));
+        while (in_flight > 0)
+            complete(reap(IORING_OP_WRITE, "DirectFileWriter::close", source_location), source_location);
+        if (!direct_io)
+            drop_written(written, source_location);
+
+        GuardFW::ftruncate(file, static_cast<off_t>(written), source_location);  // also frees preallocated space
+        GuardFW::fdatasync(file, source_location);
+        GuardFW::close(std::exchange(file, file_descriptor_invalid), source_location);
+    }
+
+    /// @return number of bytes written so far
+    [[nodiscard]] uint64_t size() const noexcept
+    {
+        return written;
+    }
+
+private:
+    /// Takes a free buffer from the pool, waits for a write to complete if there is none.
+    std::byte* acquire_buffer(const std::source_location& source_location)
+    {
+        std::byte* buffer = pool.acquire();
+        while (buffer == nullptr)
+        {
+            if (in_flight == 0)  // all buffers are used by other streams
+                throw_system_error(ENOBUFS, "DirectFileWriter::write", source_location);
+            complete(reap(IORING_OP_WRITE, "DirectFileWriter::write", source_location), source_location);
+            buffer = pool.acquire();
+        }
+        return buffer;
+    }
+
+    /// Writes the current buffer at the end of the file.
+    void submit_current(size_t length, const std::source_location& source_location)
+    {
+        submit(IORING_OP_WRITE, std::exchange(current, nullptr), next_offset, length, length, source_location);
+        next_offset += filled;
+        filled = 0;
+    }
+
+    /**
+     * Returns the buffer of a completed write to the pool.
+     *
+     * With the page cache, the writeback of the buffer is started and the data before the buffer, whose writeback
+     * has been started by previous completions, is dropped from the page cache.
+     */
+    void complete(size_t index, const std::source_location& source_location)
+    {
+        Transfer& transfer = transfers[index];
+        if (!direct_io)
+        {
+            drop_written(transfer.offset, source_location);
+            GuardFW::sync_file_range(
+                file,
+                static_cast<off64_t>(transfer.offset),
+                static_cast<off64_t>(transfer.length),
+                constants::sync_file_range_write,
+                source_location
+            );
+        }
+        pool.release(std::exchange(transfer.buffer, nullptr));
+    }
+
+    /// Waits for the writeback of buffered data up to a file offset and drops it from the page cache.
+    void drop_written(uint64_t end, const std::source_location& source_location)
+    {
+        if (end <= dropped)
+            return;
+        const auto offset = static_cast<off64_t>(dropped);
+        const auto length = static_cast<off64_t>(end - dropped);
+        GuardFW::sync_file_range(
+            file,
+            offset,
+            length,
+            constants::sync_file_range_wait_before | constants::sync_file_range_write
+                | constants::sync_file_range_wait_after,
+            source_location
+        );
+        GuardFW::posix_fadvise(file, offset, length, constants::posix_fadv_dontneed, source_location);
+        dropped = end;
+    }
+
+    std::byte* current {nullptr};  ///< buffer, which is filled
+    size_t filled {0};             ///< number of bytes in the current buffer
+    uint64_t next_offset {0};      ///< file offset of the current buffer
+    uint64_t written {0};          ///< number of written bytes
+    uint64_t dropped {0};          ///< end of the range, which has been dropped from the page cache
+};
+
+/**
+ * Reads a file sequentially.
+ *
+ * All buffers of the pool are kept in flight for reading ahead, each buffer is resubmitted for a later part
+ * of the file as soon as its data has been consumed.
+ */
+export class DirectFileReader : public DirectFile
+{
+public:
+    /**
+     * Opens a file and starts reading.
+     *
+     * @param pathname        Path of the file.
+     * @param buffer_pool     Pool for buffers, must outlive the reader.
+     * @param caching         O_DIRECT or page cache.
+     * @param source_location Holds information about caller/calling position.
+     */
+    DirectFileReader(
+        const char* pathname,
+        AlignedBufferPool& buffer_pool,
+        FileCaching caching                         = FileCaching::direct,
+        const std::source_location& source_location = std::source_location::current()
+    )
+        : DirectFile(pathname, O_RDONLY | O_CLOEXEC, 0, caching, buffer_pool, source_location)
+    {
+        try
+        {
+            struct stat status {};
+            GuardFW::fstat(file, &status, source_location);
+            file_size = static_cast<uint64_t>(status.st_size);
+            if (!direct_io)
+                GuardFW::posix_fadvise(file, 0, 0, constants::posix_fadv_sequential, source_location);
+
+            while (next_offset < file_size)
+            {
+                std::byte* const buffer = pool.acquire();
+                if (buffer == nullptr)
+                    break;
+                submit_next(buffer, source_location);
+            }
+            if (in_flight == 0 && file_size > 0)  // all buffers are used by other streams
+                throw_system_error(ENOBUFS, "DirectFileReader::DirectFileReader", source_location);
+        }
+        catch (...)
+        {
+            close(source_location);
+            throw;
+        }
+    }
+
+    DirectFileReader(const DirectFileReader&)            = delete;
+    DirectFileReader(DirectFileReader&&)                 = delete;
+    DirectFileReader& operator=(const DirectFileReader&) = delete;
+    DirectFileReader& operator=(DirectFileReader&&)      = delete;
+
+    /// Closes the file, if close() has not been called. Errors are ignored, call close() to handle them.
+    ~DirectFileReader()
+    {
+        try
+        {
+            close(location);
+        }
+        catch (const std::system_error&)  // destructors must not throw
+        {}
+    }
+
+    /**
+     * Returns the next part of the file, valid until the next call.
+     *
+     * @param source_location Holds information about caller/calling position.
+     * @return                next data, empty at the end of the file
+     */
+    [[nodiscard]] std::span<const std::byte> read(
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        if (current != no_transfer)
+            recycle(std::exchange(current, no_transfer), source_location);
+        if (consumed >= file_size)
+            return {};
+
+        const size_t index = find(consumed);
+        if (index == no_transfer)  // the read has failed before
+            throw_system_error(EIO, "DirectFileReader::read", source_location);
+        while (!transfers[index].completed)
+            (void) reap(IORING_OP_READ, "DirectFileReader::read", source_location);
+        const Transfer& transfer = transfers[index];
+        if (transfer.done == 0)  // the file has been truncated
+        {
+            consumed = file_size;
+            recycle(index, source_location);
+            return {};
+        }
+        current = index;
+        consumed += transfer.done;
+        return {transfer.buffer, transfer.done};
+    }
+
+    /**
+     * Waits for reads in flight and closes the file. Later calls do nothing.
+     *
+     * @param source_location Holds information about caller/calling position.
+     */
+    void close(const std::source_location& source_location = std::source_location::current())
+    {
+        if (file == file_descriptor_invalid)
+            return;
+        while (in_flight > 0)
+        {
+            try
+            {
+                (void) reap(IORING_OP_READ, "DirectFileReader::close", source_location);
+            }
+            catch (const std::system_error&)  // failed reads of unconsumed data are irrelevant
+            {}
+        }
+        for (Transfer& transfer : transfers)
+            if (transfer.buffer != nullptr)
+                pool.release(std::exchange(transfer.buffer, nullptr));
+        current = no_transfer;
+        GuardFW::close(std::exchange(file, file_descriptor_invalid), source_location);
+    }
+
+    /// @return size of the file at opening
+    [[nodiscard]] uint64_t size() const noexcept
+    {
+        return file_size;
+    }
+
+private:
+    static constexpr size_t no_transfer {~size_t {0}};
+
+    /// @return index of the transfer at a file offset, or no_transfer
+    [[nodiscard]] size_t find(uint64_t offset) const noexcept
+    {
+        for (size_t index = 0; index < transfers.size(); index++)
+            if (transfers[index].buffer != nullptr && transfers[index].offset == offset)
+                return index;
+        return no_transfer;
+    }
+
+    /// Reads the next part of the file into a buffer.
+    void submit_next(std::byte* buffer, const std::source_location& source_location)
+    {
+        const size_t length   = pool.buffer_size();  // O_DIRECT reads may end behind the end of the file
+        const size_t expected = static_cast<size_t>(std::min<uint64_t>(length, file_size - next_offset));
+        submit(IORING_OP_READ, buffer, next_offset, length, expected, source_location);
+        next_offset += length;
+        if (!direct_io && next_offset < file_size)  // hint for the part after the reads in flight
+            GuardFW::readahead(file, static_cast<off64_t>(next_offset), length, source_location);
+    }
+
+    /// Reuses the buffer of consumed data for the next part of the file.
+    void recycle(size_t index, const std::source_location& source_location)
+    {
+        Transfer& transfer      = transfers[index];
+        std::byte* const buffer = std::exchange(transfer.buffer, nullptr);
+        if (!direct_io)
+        {
+            GuardFW::posix_fadvise(
+                file,
+                static_cast<off_t>(transfer.offset),
+                static_cast<off_t>(transfer.length),
+                constants::posix_fadv_dontneed,
+                source_location
+            );
+        }
+        if (next_offset < file_size)
+            submit_next(buffer, source_location);
+        else
+            pool.release(buffer);
+    }
+
+    uint64_t file_size {0};
+    uint64_t next_offset {0};      ///< file offset of the next submitted read
+    uint64_t consumed {0};         ///< file offset of the next returned data
+    size_t current {no_transfer};  ///< transfer of the returned data
+};
+
+}  // namespace GuardFW
@@ -11,36 +11,48 @@
 
 module;
 
-#include <atomic>           // std::atomic_flag
-#include <cstdio>           // ::fprintf(), ::snprintf()
+#include <array>            // std::array<>
+#include <atomic>           // std::atomic_flag, std::atomic<>
+#include <cstdint>          // uint8_t
+#include <cstdio>           // ::snprintf()
 #include <cstdlib>          // std::abort
+#include <cstring>          // ::strerror_r()
 #include <exception>        // std::exception
-#include <format>           // std::format
 #include <source_location>  // std::source_location
-#include <sstream>          // std::ostringstream
-#include <string>           // std::string
 #include <string_view>      // std::string_view
+#include <system_error>     // std::system_error, std::system_category()
+#include <thread>           // std::this_thread::yield()
 #include <typeinfo>         // std::type_info
 
 #include <cxxabi.h>  // __cxa_current_exception_type(), __cxa_demangle
+#include <unistd.h>  // ::write(), STDERR_FILENO
 
 export module guardfw.exceptions;
 
+import guardfw.flight_recorder;
+
 namespace
 {
 /**
  * Output error text to stderr, called by terminate_handler().
  * This function might redirect the output to an alternative output channel (e.g. syslog).
+ * The output is async-signal-safe, followed by the flight recorder records of the terminating thread.
  * It will also abort the application.
  * @param error_text Exception error text to output.
  */
 [[noreturn]] void error_and_abort(const char* error_text) noexcept
 {
-    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg): allow fprintf
-    (void) fprintf(stderr, "%s\n", error_text);  // using std::cerr might throw, fprintf won't!
+    size_t length = 0;
+    while (error_text[length] != '\0')
+        length++;
+    // using std::cerr might throw or allocate, write() won't!
+    (void) ::write(STDERR_FILENO, error_text, length);
+    (void) ::write(STDERR_FILENO, "\n", 1);
+    GuardFW::flight_recorder::terminate_dump();  // no output without recorded calls
     // insert additional error output code here
     std::abort();  // will create core file, if enabled
 }
+
 }  // unnamed namespace
 
 
@@ -98,24 +110,181 @@ export [[noreturn]] void terminate_handler() noexcept
     error_and_abort(&output[0]);  // [[noreturn]]
 }
 
-export [[noreturn]] void throw_system_error(
+/// Error numbers with cached std::system_error prototypes, Linux error numbers are below 134.
+constexpr int prototype_errors {256};
+
+/**
+ * Returns a std::system_error of std::system_category() for an error number, whose copies do not allocate.
+ *
+ * The std::system_error constructor fetches the error message and copies it into a heap-allocated string. The
+ * message string of std::runtime_error is reference-counted (libstdc++ and libc++), so a copy of a prototype, which
+ * has been created for the first error with the same number, shares its message. The prototypes are never freed.
+ *
+ * @param  error POSIX error number.
+ * @return       base for a WrapperError
+ */
+std::system_error system_error_of(int error)
+{
+    if (error < 0 || error >= prototype_errors)  // not cached
+        return std::system_error(error, std::system_category());
+
+    static std::array<std::atomic<const std::system_error*>, prototype_errors> prototypes {};
+    std::atomic<const std::system_error*>& slot = prototypes[static_cast<size_t>(error)];
+    const std::system_error* prototype          = slot.load(std::memory_order_acquire);
+    if (prototype == nullptr) [[unlikely]]  // first error with this number
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-owning-memory): never freed
+        const auto* created = new std::system_error(error, std::system_category());
+        if (slot.compare_exchange_strong(prototype, created, std::memory_order_acq_rel))
+            prototype = created;
+        else  // created by another thread in the meantime
+            delete created;  // NOLINT(cppcoreguidelines-owning-memory)
+    }
+    return *prototype;  // copy shares the message
+}
+
+/// Kind of a failed call, selects the wording of the WrapperError text.
+export enum class FailedCall : uint8_t {
+    function,            ///< wrapped function, reported as "wrapped call to 'read()'"
+    io_uring_operation,  ///< io_uring completion, reported as "io_uring operation 'IORING_OP_RECV'"
+};
+
+/**
+ * Exception for failed wrapped Linux API & POSIX calls.
+ *
+ * Only the error number, the name of the wrapped function and the source location are stored, the error code
+ * uses std::system_category(). Apart from the first error with the same error number, throwing does not allocate
+ * memory (except for the exception object itself). The what() text is built on demand in the exception object.
+ */
+export class WrapperError : public std::system_error
+{
+public:
+    /**
+     * Creates exception for failed wrapped call.
+     * @param error                 POSIX error number.
+     * @param wrapped_function_name Name of failed wrapped function, must refer to a static string.
+     * @param source_location       Position of the failed wrapper call.
+     * @param failed_call           Wrapped function or io_uring operation, selects the wording of the error text.
+     */
+    WrapperError(
+        int error,
+        std::string_view wrapped_function_name,
+        const std::source_location& source_location,
+        FailedCall failed_call = FailedCall::function
+    )
+        : std::system_error(system_error_of(error))
+        , function_name(wrapped_function_name)
+        , location(source_location)
+        , call(failed_call)
+    {}
+
+    /// Copies the exception (also used instead of moving), the what() text is built again on demand.
+    WrapperError(const WrapperError& other) noexcept
+        : std::system_error(other)
+        , function_name(other.function_name)
+        , location(other.location)
+        , call(other.call)
+    {}
+
+    WrapperError& operator=(const WrapperError&) = delete;
+
+    ~WrapperError() override = default;
+
+    /**
+     * Builds the error text on the first call.
+     *
+     * The returned text is valid for the lifetime of the exception.
+     *
+     * @return Error text with caller position, wrapped function name, error number and error message.
+     */
+    [[nodiscard]] const char* what() const noexcept override
+    {
+        uint8_t state = what_state.load(std::memory_order_acquire);
+        if (state == what_built) [[likely]]
+            return what_buffer.data();
+
+        if (state == what_empty && what_state.compare_exchange_strong(state, what_building, std::memory_order_acquire))
+        {
+            build_what();
+            what_state.store(what_built, std::memory_order_release);
+            return what_buffer.data();
+        }
+        while (what_state.load(std::memory_order_acquire) != what_built)  // built by another thread
+            std::this_thread::yield();
+        return what_buffer.data();
+    }
+
+    /// @return Name of the failed wrapped function.
+    [[nodiscard]] std::string_view wrapped_function_name() const noexcept
+    {
+        return function_name;
+    }
+
+    /// @return Position of the failed wrapper call.
+    [[nodiscard]] const std::source_location& source_location() const noexcept
+    {
+        return location;
+    }
+
+private:
+    static constexpr size_t what_size {1024};
+    static constexpr uint8_t what_empty {0};
+    static constexpr uint8_t what_building {1};
+    static constexpr uint8_t what_built {2};
+
+    /// Formats the what() text into the buffer.
+    void build_what() const noexcept
+    {
+        constexpr size_t message_size {256};
+        // NOLINTNEXTLINE(*-avoid-c-arrays): C-array granted here
+        char message_buffer[message_size];
+        const char* message = strerror_r(code().value(), &message_buffer[0], message_size);  // GNU version
+
+        const bool operation = (call == FailedCall::io_uring_operation);
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg): allow snprintf
+        int result = snprintf(
+            what_buffer.data(),
+            what_buffer.size(),
+            "in function '%s' in file '%s' at line %u: %s '%.*s%s' failed with error %d: %s",
+            location.function_name(),
+            location.file_name(),
+            static_cast<unsigned int>(location.line()),
+            operation ? "io_uring operation" : "wrapped call to",
+            static_cast<int>(function_name.size()),
+            function_name.data(),
+            operation ? "" : "()",
+            code().value(),
+            message
+        );
+        if (result < 0)  // error in snprintf
+            (void) snprintf(what_buffer.data(), what_buffer.size(), "wrapped call failed");
+    }  // snprintf truncates, if necessary
+
+    std::string_view function_name;
+    std::source_location location;
+    FailedCall call;
+    mutable std::atomic<uint8_t> what_state {what_empty};
+    mutable std::array<char, what_size> what_buffer;  ///< written once by build_what(), before what_built is set
+};
+
+/**
+ * Throws a WrapperError, used by Context::wrapper() and Context::complete() for errors, which shall be thrown.
+ *
+ * The function is kept out of line and marked cold, so inlined wrappers only contain a call in their error path.
+ *
+ * @param error                 POSIX error number.
+ * @param wrapped_function_name Name of failed wrapped function, must refer to a static string.
+ * @param source_location       Position of the failed wrapper call.
+ * @param failed_call           Wrapped function or io_uring operation.
+ */
+export [[noreturn, gnu::cold, gnu::noinline]] void throw_system_error(
     int error,
     const std::string_view& wrapped_function_name,
-    const std::source_location& source_location = std::source_location::current()
+    const std::source_location& source_location = std::source_location::current(),
+    FailedCall failed_call                      = FailedCall::function
 )
 {
-    throw std::system_error(
-        error,
-        std::system_category(),
-        std::format(
-            "in function '{}' in file '{}' at line {}: wrapped call to '{}()' failed with error {}",
-            source_location.function_name(),
-            source_location.file_name(),
-            source_location.line(),
-            wrapped_function_name,
-            error
-        )
-    );
+    throw WrapperError(error, wrapped_function_name, source_location, failed_call);
 }
 
 }  // namespace GuardFW
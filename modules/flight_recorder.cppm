@@ -0,0 +1,547 @@
+/**
+ * Opt-in per-thread flight recorder for wrapped Linux API & POSIX calls.
+ *
+ * Contexts with the flag ErrorSpecial::flight_recorder write a compact record of each call into a ring buffer of
+ * the calling thread: function id, result, error number, EINTR repetitions and a timestamp (TSC on x86-64).
+ * A record costs a timestamp read and a few stores, without locks or allocations. Where reading the timestamp is
+ * expensive, e.g. in VMs, which trap the time stamp counter, timestamps can be disabled. The terminate_handler()
+ * dumps the last records of the terminating thread, and a binary dump can be decoded offline with the
+ * flight-decoder tool, see src/flight_decoder.cpp.
+ *
+ * The output functions only use write(2) and stack buffers, so they are async-signal-safe and may also be called
+ * from signal handlers.
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+module;
+
+#if defined(__x86_64__)
+#include <x86intrin.h>  // __rdtsc()
+#endif
+#include <string.h>  // ::strerrorname_np()
+#include <time.h>    // ::clock_gettime(), CLOCK_MONOTONIC
+#include <unistd.h>  // ::write()
+
+#include <array>        // std::array<>
+#include <atomic>       // std::atomic<>
+#include <cerrno>       // EINTR
+#include <cstddef>      // size_t, std::byte
+#include <cstdint>      // uint16_t, uint32_t, int32_t, int64_t, uint64_t
+#include <cstring>      // ::memcpy()
+#include <optional>     // std::optional<>
+#include <span>         // std::span<>
+#include <string>       // std::string
+#include <string_view>  // std::string_view
+#include <thread>       // std::this_thread::yield()
+#include <type_traits>  // std::is_pointer_v<>
+#include <vector>       // std::vector<>
+
+export module guardfw.flight_recorder;
+
+import guardfw.traits;
+
+namespace GuardFW::flight_recorder
+{
+
+export constexpr size_t capacity {256};          ///< records per thread, older records are overwritten
+export constexpr size_t max_functions {1024};    ///< distinct function names, further names share the last id
+export constexpr uint16_t unknown_function {0};  ///< id of calls before the registration of their function
+export constexpr size_t dump_records {32};       ///< default number of records dumped by terminate_handler()
+
+/// Compact record of a single wrapped call.
+export struct Record
+{
+    uint64_t timestamp;  ///< end of call, see TimestampUnit, 0 if timestamps are disabled
+    int64_t result;      ///< raw result of the wrapped function, pointers as addresses
+    uint16_t function;   ///< function id, see function_name()
+    uint16_t retries;    ///< repetitions caused by EINTR
+    int32_t error;       ///< error number, 0 on success
+};
+static_assert(sizeof(Record) == 24);
+
+/// Unit of Record::timestamp.
+export enum class TimestampUnit : uint32_t {
+    tsc_ticks,    ///< time stamp counter (x86-64) or virtual counter (aarch64)
+    nanoseconds,  ///< CLOCK_MONOTONIC
+};
+
+#if defined(__x86_64__) || defined(__aarch64__)
+export constexpr TimestampUnit timestamp_unit {TimestampUnit::tsc_ticks};
+#else
+export constexpr TimestampUnit timestamp_unit {TimestampUnit::nanoseconds};
+#endif
+
+/// @return current timestamp, see timestamp_unit
+export [[gnu::always_inline]] inline uint64_t read_timestamp() noexcept
+{
+#if defined(__x86_64__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks = 0;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    struct timespec now {};
+    (void) ::clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1'000'000'000U + static_cast<uint64_t>(now.tv_nsec);
+#endif
+}
+
+/// Ring buffer of a thread, only written and read by its own thread.
+struct ThreadRing
+{
+    std::array<Record, capacity> records;
+    uint64_t count;  ///< number of all recorded calls, the next record is written at count % capacity
+};
+
+/// Zero-initialized without a TLS guard, so recording does not need to check for initialization.
+constinit thread_local ThreadRing thread_ring {};
+
+/// Registered function names, the names of ids below function_count are complete.
+std::array<std::string_view, max_functions> function_names {};
+std::atomic<size_t> function_slots {unknown_function + 1};  ///< number of reserved ids
+std::atomic<size_t> function_count {unknown_function + 1};  ///< number of published ids
+std::atomic<bool> timestamps {true};
+std::atomic<int> binary_dump_fd {-1};
+std::atomic<size_t> terminate_dump_records {dump_records};
+
+/**
+ * Adds a function name, called once per wrapped function during static initialization.
+ *
+ * The name is stored before the id is published, ids are published in order.
+ *
+ * @param  name Function name, must be a static string.
+ * @return      Function id, always < max_functions.
+ */
+uint16_t register_function(std::string_view name) noexcept
+{
+    const size_t id = function_slots.fetch_add(1, std::memory_order_relaxed);
+    if (id >= max_functions - 1)  // last id is shared by all further names
+        return static_cast<uint16_t>(max_functions - 1);
+    function_names[id] = name;
+    for (size_t published = id;
+         !function_count.compare_exchange_weak(published, id + 1, std::memory_order_release, std::memory_order_relaxed);
+         published = id)
+        std::this_thread::yield();  // a previous id is not yet published
+    return static_cast<uint16_t>(id);
+}
+
+/**
+ * Id of a wrapped function, registered during static initialization, so recording needs no initialization guard.
+ *
+ * Calls before the initialization are recorded with unknown_function.
+ *
+ * @tparam WRAPPED_FUNCTION Function pointer of wrapped function.
+ */
+export template<auto WRAPPED_FUNCTION>
+inline const uint16_t function_id = register_function(name_of<WRAPPED_FUNCTION>());
+
+/**
+ * Returns the name of a function id.
+ *
+ * @param  id Function id of a record.
+ * @return    function name, "(other)" for the shared last id, empty for unknown ids
+ */
+export std::string_view function_name(uint16_t id) noexcept
+{
+    if (id == max_functions - 1)
+        return "(other)";
+    if (id >= function_count.load(std::memory_order_acquire))
+        return {};
+    return function_names[id];
+}
+
+/**
+ * Enables or disables the timestamps of records, they are enabled by default.
+ *
+ * Without timestamps, a record costs only a few stores. Records without timestamp are dumped without their age.
+ *
+ * @param enabled Records are timestamped, if set.
+ */
+export void enable_timestamps(bool enabled) noexcept
+{
+    timestamps.store(enabled, std::memory_order_relaxed);
+}
+
+/**
+ * Records a single wrapped call, used by Context::wrapper().
+ *
+ * The disabled primary template is empty, so all calls compile to nothing.
+ *
+ * @tparam ENABLED          Records calls, if set.
+ * @tparam WRAPPED_FUNCTION Function pointer of wrapped function.
+ */
+export template<bool ENABLED, auto WRAPPED_FUNCTION>
+class CallRecord
+{
+public:
+    template<typename RESULT>
+    [[gnu::always_inline]] inline void result(RESULT) const noexcept
+    {}
+    [[gnu::always_inline]] inline void eintr_repeat() const noexcept {}
+    [[gnu::always_inline]] inline void error(int) const noexcept {}
+    [[gnu::always_inline]] inline void record() const noexcept {}
+};
+
+/**
+ * Records a single wrapped call, used by Context::wrapper(); here: specialization for an enabled flight recorder.
+ *
+ * The record is written on destruction, or before an error is thrown, because an uncaught exception may terminate
+ * without unwinding the stack.
+ *
+ * @tparam WRAPPED_FUNCTION Function pointer of wrapped function.
+ */
+export template<auto WRAPPED_FUNCTION>
+class CallRecord<true, WRAPPED_FUNCTION>
+{
+public:
+    CallRecord() = default;
+
+    CallRecord(const CallRecord&)            = delete;
+    CallRecord(CallRecord&&)                 = delete;
+    CallRecord& operator=(const CallRecord&) = delete;
+    CallRecord& operator=(CallRecord&&)      = delete;
+
+    [[gnu::always_inline]] inline ~CallRecord()
+    {
+        if (!recorded)
+            record();
+    }
+
+    /// Writes the record into the ring buffer of the calling thread.
+    [[gnu::always_inline]] inline void record() noexcept
+    {
+        ThreadRing& ring                    = thread_ring;
+        ring.records[ring.count % capacity] = {
+            .timestamp = timestamps.load(std::memory_order_relaxed) ? read_timestamp() : 0,
+            .result    = result_value,
+            .function  = function_id<WRAPPED_FUNCTION>,
+            .retries   = retries,
+            .error     = error_number,
+        };
+        ring.count++;
+        recorded = true;
+    }
+
+    /// Stores the result of a (repeated) call and discards the error of a previous EINTR repetition.
+    template<typename RESULT>
+    [[gnu::always_inline]] inline void result(RESULT value) noexcept
+    {
+        error_number = 0;
+        if constexpr (std::is_pointer_v<RESULT>)
+            result_value = reinterpret_cast<intptr_t>(value);
+        else  // constexpr
+            result_value = static_cast<int64_t>(value);
+    }
+
+    [[gnu::always_inline]] inline void eintr_repeat() noexcept
+    {
+        retries++;
+    }
+
+    [[gnu::always_inline]] inline void error(int error) noexcept
+    {
+        error_number = error;
+    }
+
+private:
+    int64_t result_value {0};
+    int32_t error_number {0};
+    uint16_t retries {0};
+    bool recorded {false};
+};
+
+/**
+ * Returns the records of the calling thread.
+ *
+ * @return records in chronological order, at most capacity
+ */
+export std::vector<Record> thread_records()
+{
+    const ThreadRing& ring = thread_ring;
+    const uint64_t first   = (ring.count > capacity) ? ring.count - capacity : 0;
+    std::vector<Record> records;
+    records.reserve(static_cast<size_t>(ring.count - first));
+    for (uint64_t index = first; index < ring.count; index++)
+        records.push_back(ring.records[index % capacity]);
+    return records;
+}
+
+/// Discards the records of the calling thread.
+export void clear_thread_records() noexcept
+{
+    thread_ring.count = 0;
+}
+
+/**
+ * Configures the dump of terminate_handler().
+ *
+ * @param records   Number of records of the terminating thread, which are written as text to stderr.
+ * @param binary_fd File descriptor, to which a binary dump for the flight-decoder tool is written, -1 for none.
+ */
+export void configure_terminate_dump(size_t records, int binary_fd = -1) noexcept
+{
+    terminate_dump_records.store(records, std::memory_order_relaxed);
+    binary_dump_fd.store(binary_fd, std::memory_order_relaxed);
+}
+
+/// Fixed-size text buffer without allocations, truncates on overflow.
+class TextBuffer
+{
+public:
+    TextBuffer(char* buffer, size_t buffer_size) noexcept
+        : data(buffer)
+        , size(buffer_size)
+    {}
+
+    void append(std::string_view text) noexcept
+    {
+        for (char character : text)
+            if (length < size)
+                data[length++] = character;
+    }
+
+    void append_unsigned(uint64_t value) noexcept
+    {
+        std::array<char, 20> digits {};
+        size_t count = 0;
+        do
+        {
+            digits[count++] = static_cast<char>('0' + (value % 10));
+            value /= 10;
+        } while (value != 0);
+        while (count > 0)
+            append(std::string_view(&digits[--count], 1));
+    }
+
+    void append_signed(int64_t value) noexcept
+    {
+        if (value < 0)
+        {
+            append("-");
+            append_unsigned(0 - static_cast<uint64_t>(value));
+        }
+        else
+            append_unsigned(static_cast<uint64_t>(value));
+    }
+
+    [[nodiscard]] size_t used() const noexcept
+    {
+        return length;
+    }
+
+private:
+    char* data;
+    size_t size;
+    size_t length {0};
+};
+
+/**
+ * Formats a record like strace, async-signal-safe.
+ *
+ * Example: "-1520 ticks  close() = -1 EBADF" or "-80 ticks  read() = 8 (1 EINTR retry)", the age is omitted for
+ * records without timestamp.
+ *
+ * @param buffer Output buffer, the text is not null-terminated.
+ * @param size   Size of output buffer.
+ * @param record Record.
+ * @param name   Function name of the record.
+ * @param now    Reference timestamp, the age of the record is printed relative to it.
+ * @param unit   Unit of the timestamps.
+ * @return       length of text
+ */
+export size_t format_record(
+    char* buffer, size_t size, const Record& record, std::string_view name, uint64_t now, TimestampUnit unit
+) noexcept
+{
+    TextBuffer text(buffer, size);
+    if (record.timestamp != 0)
+    {
+        text.append_signed(static_cast<int64_t>(record.timestamp - now));
+        text.append((unit == TimestampUnit::tsc_ticks) ? " ticks  " : " ns  ");
+    }
+    text.append(name.empty() ? std::string_view("(unknown)") : name);
+    text.append("() = ");
+    text.append_signed(record.result);
+    if (record.error != 0)
+    {
+        const char* error_name = ::strerrorname_np(record.error);
+        text.append(" ");
+        if (error_name != nullptr)
+            text.append(error_name);
+        else
+        {
+            text.append("error ");
+            text.append_signed(record.error);
+        }
+    }
+    if (record.retries > 0)
+    {
+        text.append(" (");
+        text.append_unsigned(record.retries);
+        text.append((record.retries == 1) ? " EINTR retry)" : " EINTR retries)");
+    }
+    return text.used();
+}
+
+/// Writes a buffer completely, async-signal-safe.
+void write_all(int fd, const void* data, size_t size) noexcept
+{
+    const char* position = static_cast<const char*>(data);
+    while (size > 0)
+    {
+        const ssize_t written = ::write(fd, position, size);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return;
+        position += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+
+/**
+ * Writes the last records of the calling thread as text, async-signal-safe.
+ *
+ * @param fd      Output file descriptor, e.g. STDERR_FILENO.
+ * @param records Maximum number of records.
+ */
+export void dump_text(int fd, size_t records = dump_records) noexcept
+{
+    const ThreadRing& ring = thread_ring;
+    const uint64_t stored  = (ring.count < capacity) ? ring.count : capacity;
+    const uint64_t dumped  = (records < stored) ? records : stored;
+    if (dumped == 0)
+        return;
+
+    std::array<char, 160> line {};
+    TextBuffer header(line.data(), line.size());
+    header.append("flight recorder: last ");
+    header.append_unsigned(dumped);
+    header.append(" of ");
+    header.append_unsigned(ring.count);
+    header.append(" calls of this thread\n");
+    write_all(fd, line.data(), header.used());
+
+    const uint64_t now = read_timestamp();
+    for (uint64_t index = ring.count - dumped; index < ring.count; index++)
+    {
+        const Record& record = ring.records[index % capacity];
+        size_t length =
+            format_record(line.data(), line.size() - 1, record, function_name(record.function), now, timestamp_unit);
+        line[length++] = '\n';
+        write_all(fd, line.data(), length);
+    }
+}
+
+/// Header of a binary dump, followed by the function names and the records in chronological order.
+export struct DumpHeader
+{
+    std::array<char, 8> magic;  ///< "GFWFLTR1"
+    uint32_t record_size;       ///< sizeof(Record)
+    TimestampUnit unit;         ///< unit of the timestamps
+    uint64_t now;               ///< timestamp of the dump
+    uint64_t calls;             ///< number of all recorded calls of the thread
+    uint32_t records;           ///< number of dumped records
+    uint32_t functions;         ///< number of function names, each as uint16_t length and characters
+};
+
+export constexpr std::array<char, 8> dump_magic {'G', 'F', 'W', 'F', 'L', 'T', 'R', '1'};
+
+/**
+ * Writes the records of the calling thread as binary dump for the flight-decoder tool, async-signal-safe.
+ *
+ * @param fd Output file descriptor.
+ */
+export void dump_binary(int fd) noexcept
+{
+    const ThreadRing& ring  = thread_ring;
+    const uint64_t stored   = (ring.count < capacity) ? ring.count : capacity;
+    const size_t registered = function_count.load(std::memory_order_acquire);
+
+    const DumpHeader header {
+        .magic       = dump_magic,
+        .record_size = sizeof(Record),
+        .unit        = timestamp_unit,
+        .now         = read_timestamp(),
+        .calls       = ring.count,
+        .records     = static_cast<uint32_t>(stored),
+        .functions   = static_cast<uint32_t>(registered),
+    };
+    write_all(fd, &header, sizeof(header));
+    for (size_t id = 0; id < registered; id++)
+    {
+        const std::string_view name = function_name(static_cast<uint16_t>(id));
+        const auto length           = static_cast<uint16_t>(name.size());
+        write_all(fd, &length, sizeof(length));
+        write_all(fd, name.data(), length);
+    }
+    for (uint64_t index = ring.count - stored; index < ring.count; index++)
+        write_all(fd, &ring.records[index % capacity], sizeof(Record));
+}
+
+/// Decoded binary dump.
+export struct Dump
+{
+    DumpHeader header;
+    std::vector<std::string> names;  ///< indexed by function id
+    std::vector<Record> records;     ///< chronological order
+
+    /// @return function name of a record
+    [[nodiscard]] std::string_view name_of(const Record& record) const noexcept
+    {
+        if (record.function == max_functions - 1)
+            return "(other)";
+        return (record.function < names.size()) ? std::string_view(names[record.function]) : std::string_view();
+    }
+};
+
+/**
+ * Decodes a binary dump.
+ *
+ * @param  data Content of a dump file.
+ * @return      decoded dump, or std::nullopt, if the data is no complete dump
+ */
+export std::optional<Dump> parse_dump(std::span<const std::byte> data)
+{
+    Dump dump {};
+    auto read = [&data](void* target, size_t size) {
+        if (data.size() < size)
+            return false;
+        ::memcpy(target, data.data(), size);
+        data = data.subspan(size);
+        return true;
+    };
+
+    if (!read(&dump.header, sizeof(dump.header)) || dump.header.magic != dump_magic
+        || dump.header.record_size != sizeof(Record))
+        return std::nullopt;
+    for (uint32_t id = 0; id < dump.header.functions; id++)
+    {
+        uint16_t length = 0;
+        if (!read(&length, sizeof(length)) || data.size() < length)
+            return std::nullopt;
+        dump.names.emplace_back(reinterpret_cast<const char*>(data.data()), length);
+        data = data.subspan(length);
+    }
+    dump.records.resize(dump.header.records);
+    if (!read(dump.records.data(), dump.records.size() * sizeof(Record)))
+        return std::nullopt;
+    return dump;
+}
+
+/**
+ * Dumps the calling thread as configured by configure_terminate_dump(), called by terminate_handler().
+ */
+export void terminate_dump() noexcept
+{
+    dump_text(STDERR_FILENO, terminate_dump_records.load(std::memory_order_relaxed));
+    const int fd = binary_dump_fd.load(std::memory_order_relaxed);
+    if (fd >= 0)
+        dump_binary(fd);
+}
+
+}  // namespace GuardFW::flight_recorder
@@ -12,22 +12,49 @@
 export module guardfw;
 
 export import guardfw.config;  // cmake-generated module, may not be found by IDE
+export import guardfw.busy_poll;
+export import guardfw.coroutine;
+export import guardfw.direct_file;
 export import guardfw.exceptions;
 export import guardfw.file_desciptor;
+export import guardfw.flight_recorder;
+export import guardfw.huge_page_arena;
+export import guardfw.io_uring;
+export import guardfw.mapped_file;
+export import guardfw.message_batch;
+export import guardfw.mpsc_queue;
+export import guardfw.offload_pool;
+export import guardfw.reactor;
+export import guardfw.relay;
+export import guardfw.sharded_listener;
+export import guardfw.shm_queue;
+export import guardfw.statistics;
+export import guardfw.timer_wheel;
+export import guardfw.topology;
 export import guardfw.traits;
+export import guardfw.vectored_io;
 export import guardfw.wrapper;
+export import guardfw.zerocopy;
 
 export import guardfw.wrapped_epoll;
 export import guardfw.wrapped_eventfd;
 export import guardfw.wrapped_fcntl;
+export import guardfw.wrapped_futex;
 export import guardfw.wrapped_io_uring;
 export import guardfw.wrapped_ioctl;
+export import guardfw.wrapped_mempolicy;
 export import guardfw.wrapped_mman;
 export import guardfw.wrapped_mqueue;
 export import guardfw.wrapped_resource;
+export import guardfw.wrapped_sched;
+export import guardfw.wrapped_sendfile;
 export import guardfw.wrapped_signal;
 export import guardfw.wrapped_signalfd;
 export import guardfw.wrapped_socket;
+export import guardfw.wrapped_stat;
 export import guardfw.wrapped_stdio;
+export import guardfw.wrapped_syscall;
+export import guardfw.wrapped_time;
 export import guardfw.wrapped_timerfd;
+export import guardfw.wrapped_uio;
 export import guardfw.wrapped_unistd;
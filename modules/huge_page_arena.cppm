@@ -0,0 +1,305 @@
+/**
+ * Huge-page-backed arena as polymorphic memory resource.
+ *
+ * The class HugePageArena reserves large anonymous regions with explicit huge pages (MAP_HUGETLB). If no huge
+ * pages are available, it falls back to normal pages with transparent huge pages (MADV_HUGEPAGE). Allocations
+ * are served by bumping a pointer, so they need neither a lock nor a system call. Like
+ * std::pmr::monotonic_buffer_resource, memory is only released by release() or on destruction.
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+module;
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <linux/mman.h>  // MAP_HUGE_SHIFT
+#include <sys/mman.h>    // ::mmap(), ::mremap(), ::madvise()
+
+#include <algorithm>        // std::max()
+#include <bit>              // std::countr_zero(), std::has_single_bit()
+#include <cerrno>           // ENOMEM, EINVAL
+#include <cstddef>          // size_t, std::byte
+#include <cstdint>          // uintptr_t
+#include <expected>         // std::expected<>
+#include <memory_resource>  // std::pmr::memory_resource
+#include <new>              // std::bad_alloc
+#include <source_location>  // std::source_location
+#include <vector>           // std::vector<>
+
+export module guardfw.huge_page_arena;
+
+import guardfw.wrapper;
+import guardfw.file_desciptor;
+import guardfw.wrapped_mman;
+
+namespace GuardFW
+{
+
+/// Like ContextStd, but returns ENOMEM or EINVAL (older kernels for MAP_HUGETLB), if a mapping can not grow in place.
+using ContextRemapInPlace =
+    Context<ErrorIndication::eqm1_errno, ErrorReport::exception, ErrorSpecial::none, ENOMEM, EINVAL>;
+
+/// Backing of the arena memory.
+export enum class HugePageBacking : uint8_t {
+    explicit_pages,     ///< MAP_HUGETLB pages from the huge page pool, see /proc/sys/vm/nr_hugepages
+    transparent_pages,  ///< normal pages with MADV_HUGEPAGE, the kernel may use transparent huge pages
+};
+
+/// Options for HugePageArena.
+export struct HugePageArenaOptions
+{
+    size_t initial_size {size_t {2} << 20};    ///< initially reserved bytes, rounded up to huge_page_size
+    size_t huge_page_size {size_t {2} << 20};  ///< huge page size, must be a power of 2 supported by the CPU
+    bool explicit_huge_pages {true};           ///< try MAP_HUGETLB before falling back to transparent huge pages
+    bool populate {false};                     ///< pre-fault pages with MAP_POPULATE (or MADV_POPULATE_WRITE)
+    bool lock_on_fault {false};                ///< lock pages in memory with mlock2(MLOCK_ONFAULT)
+};
+
+/**
+ * Monotonic memory resource on huge-page-backed regions.
+ *
+ * If a region is exhausted, it is grown in place with mremap(), so previously allocated memory never moves.
+ * If the address space behind the region is occupied, a new region is mapped instead.
+ * The arena is not thread-safe, it is intended for request-scoped or thread-local allocations.
+ */
+export class HugePageArena : public std::pmr::memory_resource
+{
+public:
+    /**
+     * Reserves the initial region.
+     *
+     * @param options         Arena options.
+     * @param source_location Holds information about caller/calling position.
+     */
+    explicit HugePageArena(
+        const HugePageArenaOptions& options         = {},
+        const std::source_location& source_location = std::source_location::current()
+    )
+        : settings(options)
+        , location(source_location)
+    {
+        if (!std::has_single_bit(settings.huge_page_size))
+            throw std::bad_alloc();
+        map_region(settings.initial_size);
+    }
+
+    HugePageArena(const HugePageArena&)            = delete;
+    HugePageArena(HugePageArena&&)                 = delete;
+    HugePageArena& operator=(const HugePageArena&) = delete;
+    HugePageArena& operator=(HugePageArena&&)      = delete;
+
+    ~HugePageArena() override
+    {
+        for (const Region& region : regions)
+            GuardFW::munmap(region.base, region.capacity, location);
+    }
+
+    /**
+     * Releases all allocations at once, keeps the first region for further allocations.
+     */
+    void release()
+    {
+        while (regions.size() > 1)
+        {
+            GuardFW::munmap(regions.back().base, regions.back().capacity, location);
+            regions.pop_back();
+        }
+        regions.front().used = 0;
+    }
+
+    /// @return backing of the first region
+    [[nodiscard]] HugePageBacking backing() const noexcept
+    {
+        return regions.front().backing;
+    }
+
+    /// @return number of mapped regions, more than 1 if a region could not be grown in place
+    [[nodiscard]] size_t region_count() const noexcept
+    {
+        return regions.size();
+    }
+
+    /// @return number of reserved bytes of all regions
+    [[nodiscard]] size_t capacity() const noexcept
+    {
+        size_t total = 0;
+        for (const Region& region : regions)
+            total += region.capacity;
+        return total;
+    }
+
+    /// @return number of allocated bytes of all regions, including alignment padding
+    [[nodiscard]] size_t used() const noexcept
+    {
+        size_t total = 0;
+        for (const Region& region : regions)
+            total += region.used;
+        return total;
+    }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        if (void* pointer = bump(regions.back(), bytes, alignment); pointer != nullptr) [[likely]]
+            return pointer;
+
+        grow(bytes + alignment);
+        void* pointer = bump(regions.back(), bytes, alignment);
+        if (pointer == nullptr)  // alignment exceeds huge page size
+            throw std::bad_alloc();
+        return pointer;
+    }
+
+    void do_deallocate(void*, size_t, size_t) override
+    {
+        // monotonic, memory is freed by release() or destructor
+    }
+
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+private:
+    struct Region
+    {
+        std::byte* base;
+        size_t capacity;
+        size_t used;
+        HugePageBacking backing;
+    };
+
+    /// Allocates from a region, returns nullptr if the region is exhausted.
+    static void* bump(Region& region, size_t bytes, size_t alignment) noexcept
+    {
+        const uintptr_t current = reinterpret_cast<uintptr_t>(region.base) + region.used;
+        const uintptr_t aligned = (current + alignment - 1) & ~(uintptr_t {alignment} - 1);
+        const size_t end        = (aligned - reinterpret_cast<uintptr_t>(region.base)) + bytes;
+        if (end > region.capacity)
+            return nullptr;
+        region.used = end;
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    [[nodiscard]] size_t round_up(size_t size) const noexcept
+    {
+        return (std::max(size, size_t {1}) + settings.huge_page_size - 1) & ~(settings.huge_page_size - 1);
+    }
+
+    /// Maps a new region with explicit huge pages or with transparent huge pages as fallback.
+    void map_region(size_t size)
+    {
+        const size_t region_size = round_up(size);
+        const int populate_flag  = settings.populate ? constants::map_populate : 0;
+
+        if (settings.explicit_huge_pages)
+        {
+            const int huge_flags = constants::map_hugetlb
+                                 | (std::countr_zero(settings.huge_page_size) << MAP_HUGE_SHIFT);
+            // missing or exhausted huge page pools are expected, so errors are returned directly
+            std::expected<void*, Error> mapped = ContextDirectErrors::wrapper<::mmap>(
+                location,
+                static_cast<void*>(nullptr),
+                region_size,
+                constants::prot_read | constants::prot_write,
+                constants::map_private | constants::map_anonymous | huge_flags | populate_flag,
+                file_descriptor_invalid,
+                off_t {0}
+            );
+            if (mapped.has_value())
+            {
+                add_region(static_cast<std::byte*>(mapped.value()), region_size, HugePageBacking::explicit_pages);
+                return;
+            }
+        }
+
+        // over-reserve to align the region to the huge page size, which transparent huge pages require
+        const size_t reserved = region_size + settings.huge_page_size;
+        auto* const mapped    = static_cast<std::byte*>(GuardFW::mmap(
+            nullptr,
+            reserved,
+            constants::prot_read | constants::prot_write,
+            constants::map_private | constants::map_anonymous,
+            file_descriptor_invalid,
+            0,
+            location
+        ));
+        const uintptr_t address = reinterpret_cast<uintptr_t>(mapped);
+        const size_t head       = ((address + settings.huge_page_size - 1) & ~(settings.huge_page_size - 1)) - address;
+        std::byte* const base   = mapped + head;
+        if (head > 0)
+            GuardFW::munmap(mapped, head, location);
+        if (reserved - head - region_size > 0)
+            GuardFW::munmap(base + region_size, reserved - head - region_size, location);
+
+        add_region(base, region_size, HugePageBacking::transparent_pages);
+        advise(base, region_size);
+    }
+
+    void add_region(std::byte* base, size_t region_size, HugePageBacking backing)
+    {
+        try
+        {
+            regions.push_back({.base = base, .capacity = region_size, .used = 0, .backing = backing});
+        }
+        catch (...)
+        {
+            GuardFW::munmap(base, region_size, location);
+            throw;
+        }
+        if (settings.lock_on_fault)
+            GuardFW::mlock2(base, region_size, constants::mlock_onfault, location);
+    }
+
+    /// Requests transparent huge pages and pre-faulting, both are hints and failures are ignored.
+    void advise(std::byte* base, size_t length) const
+    {
+        (void) ContextDirectErrors::wrapper<::madvise, void>(location, static_cast<void*>(base), length, MADV_HUGEPAGE);
+        if (settings.populate)
+            populate(base, length);
+    }
+
+    /// Pre-faults pages of grown regions, MAP_POPULATE only applies to the initial mapping.
+    void populate(std::byte* base, size_t length) const
+    {
+        (void) ContextDirectErrors::wrapper<::madvise, void>(
+            location, static_cast<void*>(base), length, MADV_POPULATE_WRITE
+        );
+    }
+
+    /// Grows the last region in place or maps a new region, so at least the requested bytes are available.
+    void grow(size_t bytes)
+    {
+        Region& region            = regions.back();
+        const size_t new_capacity = round_up(std::max(region.capacity * 2, region.used + bytes));
+
+        std::expected<void*, Error> resized = ContextRemapInPlace::wrapper<::mremap>(
+            location, static_cast<void*>(region.base), region.capacity, new_capacity, 0
+        );
+        if (!resized.has_value())  // address space behind region is occupied
+        {
+            map_region(std::max(bytes, region.capacity));
+            return;
+        }
+
+        std::byte* const added  = region.base + region.capacity;
+        const size_t added_size = new_capacity - region.capacity;
+        region.capacity         = new_capacity;
+        if (region.backing == HugePageBacking::transparent_pages)
+            advise(added, added_size);
+        else if (settings.populate)
+            populate(added, added_size);
+        if (settings.lock_on_fault)
+            GuardFW::mlock2(added, added_size, constants::mlock_onfault, location);
+    }
+
+    HugePageArenaOptions settings;
+    std::source_location location;  ///< location of construction, reported by errors during allocation
+    std::vector<Region> regions;
+};
+
+}  // namespace GuardFW
@@ -0,0 +1,494 @@
+/**
+ * Owning io_uring ring on top of the wrapped io_uring syscalls.
+ *
+ * The class IoUring sets up an io_uring instance, maps its submission and completion rings via GuardFW::mmap()
+ * and provides batched SQE submission and syscall-free CQE reaping. GuardFW::io_uring_enter() is only called when
+ * the kernel has to be entered: for submitting new entries without SQPOLL, for waking up a sleeping SQPOLL
+ * thread, for waiting on completions and for flushing an overflown completion queue.
+ *
+ * SQEs with 128 bytes (IORING_SETUP_SQE128) and CQEs with 32 bytes (IORING_SETUP_CQE32) are not supported, their
+ * setup flags are rejected with EINVAL.
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+module;
+
+#include <algorithm>        // std::max()
+#include <atomic>           // std::atomic_ref<>, std::atomic_thread_fence()
+#include <cerrno>           // EINVAL
+#include <cstddef>          // size_t
+#include <cstdint>          // uint8_t, uint32_t, uint64_t
+#include <expected>         // std::expected<>
+#include <source_location>  // std::source_location
+#include <span>             // std::span<>
+#include <utility>          // std::forward<>()
+
+#include <sys/uio.h>         // iovec
+#include <linux/io_uring.h>  // io_uring_params, io_uring_sqe, io_uring_cqe
+
+export module guardfw.io_uring;
+
+import guardfw.exceptions;
+import guardfw.wrapper;
+import guardfw.file_desciptor;
+import guardfw.wrapped_io_uring;
+import guardfw.wrapped_mman;
+import guardfw.wrapped_unistd;
+
+namespace GuardFW
+{
+
+/**
+ * Owning io_uring instance with mapped submission and completion rings.
+ *
+ * The ring is not thread-safe: SQEs must be fetched and submitted and CQEs must be reaped by a single thread.
+ */
+export class IoUring
+{
+public:
+    /**
+     * Sets up a new io_uring instance and maps its rings.
+     *
+     * @param entries         Minimum number of submission queue entries.
+     * @param flags           IORING_SETUP_* flags, e.g. IORING_SETUP_SQPOLL.
+     * @param sq_thread_idle  Idle time of the SQPOLL kernel thread in milliseconds before it goes to sleep.
+     * @param source_location Holds information about caller/calling position.
+     */
+    explicit IoUring(
+        unsigned int entries,
+        unsigned int flags                          = 0,
+        unsigned int sq_thread_idle                 = 0,
+        const std::source_location& source_location = std::source_location::current()
+    )
+        : IoUring(entries, make_params(flags, sq_thread_idle), source_location)
+    {}
+
+    /**
+     * Sets up a new io_uring instance with fully user-defined parameters and maps its rings.
+     *
+     * @param entries         Minimum number of submission queue entries.
+     * @param params          Setup parameters, will be completed by the kernel and can be queried by params().
+     *                        IORING_SETUP_SQE128 and IORING_SETUP_CQE32 are rejected with EINVAL.
+     * @param source_location Holds information about caller/calling position.
+     */
+    IoUring(
+        unsigned int entries,
+        const struct io_uring_params& params,
+        const std::source_location& source_location = std::source_location::current()
+    )
+        : ring_params(params)
+    {
+        if ((ring_params.flags & (IORING_SETUP_SQE128 | IORING_SETUP_CQE32)) != 0)  // ring indexing uses fixed sizes
+            throw_system_error(EINVAL, "IoUring::IoUring", source_location);
+        ring_fd = GuardFW::io_uring_setup(entries, &ring_params, source_location);
+        try
+        {
+            map_rings(source_location);
+        }
+        catch (...)
+        {
+            unmap_rings();
+            GuardFW::close(ring_fd);
+            throw;
+        }
+    }
+
+    IoUring(const IoUring&)            = delete;
+    IoUring(IoUring&&)                 = delete;
+    IoUring& operator=(const IoUring&) = delete;
+    IoUring& operator=(IoUring&&)      = delete;
+
+    ~IoUring()
+    {
+        unmap_rings();
+        GuardFW::close(ring_fd);
+    }
+
+    /// @return file descriptor of the io_uring instance
+    [[gnu::always_inline, nodiscard]] inline FileDescriptor fd() const noexcept
+    {
+        return ring_fd;
+    }
+
+    /// @return setup parameters, as completed by the kernel
+    [[gnu::always_inline, nodiscard]] inline const struct io_uring_params& params() const noexcept
+    {
+        return ring_params;
+    }
+
+    /// @return true, if submission queue is polled by a kernel thread (IORING_SETUP_SQPOLL)
+    [[gnu::always_inline, nodiscard]] inline bool sqpoll() const noexcept
+    {
+        return (ring_params.flags & IORING_SETUP_SQPOLL) != 0;
+    }
+
+    /**
+     * Fetches the next free submission queue entry.
+     *
+     * The entry is zero-initialized and becomes visible to the kernel with the next submit().
+     *
+     * @return free SQE or nullptr, if the submission queue is full
+     */
+    [[gnu::always_inline, nodiscard]] inline struct io_uring_sqe* get_sqe() noexcept
+    {
+        const uint32_t head = std::atomic_ref<uint32_t>(*sq_khead).load(std::memory_order_acquire);
+        if (sqe_tail - head >= ring_params.sq_entries) [[unlikely]]
+            return nullptr;
+
+        struct io_uring_sqe* sqe = &sqes[sqe_tail & sq_mask];
+        sqe_tail++;
+        *sqe = {};
+        return sqe;
+    }
+
+    /// @return number of fetched SQEs, which have not been published to the kernel yet
+    [[gnu::always_inline, nodiscard]] inline unsigned int sq_pending() const noexcept
+    {
+        return sqe_tail - sqe_head;
+    }
+
+    /// @return number of SQEs, which can still be fetched with get_sqe()
+    [[gnu::always_inline, nodiscard]] inline unsigned int sq_space_left() const noexcept
+    {
+        const uint32_t head = std::atomic_ref<uint32_t>(*sq_khead).load(std::memory_order_acquire);
+        return ring_params.sq_entries - (sqe_tail - head);
+    }
+
+    /**
+     * Publishes all fetched SQEs to the kernel and enters the kernel only if necessary.
+     *
+     * Without SQPOLL, GuardFW::io_uring_enter() is called once for the whole batch. With SQPOLL, it is only called
+     * when the kernel thread sleeps. An overflown completion queue is flushed in both cases.
+     *
+     * @param source_location Holds information about caller/calling position.
+     * @return                number of submitted SQEs or soft errors EAGAIN/EBUSY
+     */
+    [[gnu::always_inline]] inline std::expected<unsigned int, Error> submit(
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        return submit_and_wait(0, source_location);
+    }
+
+    /**
+     * Publishes all fetched SQEs to the kernel and waits for completions.
+     *
+     * @param wait_nr         Number of completions to wait for, 0 does not wait.
+     * @param source_location Holds information about caller/calling position.
+     * @return                number of submitted SQEs or soft errors EAGAIN/EBUSY
+     */
+    [[gnu::always_inline]] inline std::expected<unsigned int, Error> submit_and_wait(
+        unsigned int wait_nr, const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        const unsigned int to_submit = flush_sq();
+        unsigned int enter_flags     = 0;
+        bool enter                   = false;
+
+        if (wait_nr > 0)
+        {
+            enter_flags |= IORING_ENTER_GETEVENTS;
+            enter = true;
+        }
+
+        if (sqpoll())
+        {
+            // the tail store must be visible before the kernel thread flags are read, see io_uring(7)
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if ((sq_flags() & IORING_SQ_NEED_WAKEUP) != 0)
+            {
+                enter_flags |= IORING_ENTER_SQ_WAKEUP;
+                enter = true;
+            }
+        }
+        else if (to_submit > 0)
+            enter = true;
+
+        if ((sq_flags() & (IORING_SQ_CQ_OVERFLOW | IORING_SQ_TASKRUN)) != 0) [[unlikely]]
+        {
+            enter_flags |= IORING_ENTER_GETEVENTS;
+            enter = true;
+        }
+
+        if (!enter)
+            return to_submit;  // SQPOLL thread is awake or there is nothing to do
+
+        return GuardFW::io_uring_enter(ring_fd, to_submit, wait_nr, enter_flags, nullptr, source_location);
+    }
+
+    /// @return number of completion queue entries, which are ready to be reaped
+    [[gnu::always_inline, nodiscard]] inline unsigned int cq_ready() const noexcept
+    {
+        return std::atomic_ref<uint32_t>(*cq_ktail).load(std::memory_order_acquire)
+               - std::atomic_ref<uint32_t>(*cq_khead).load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Returns the next completion queue entry without entering the kernel.
+     *
+     * The entry must be released with cqe_seen() after it has been processed.
+     *
+     * @return next CQE or nullptr, if the completion queue is empty
+     */
+    [[gnu::always_inline, nodiscard]] inline struct io_uring_cqe* peek_cqe() noexcept
+    {
+        const uint32_t head = std::atomic_ref<uint32_t>(*cq_khead).load(std::memory_order_relaxed);
+        const uint32_t tail = std::atomic_ref<uint32_t>(*cq_ktail).load(std::memory_order_acquire);
+        return (head != tail) ? &cqes[head & cq_mask] : nullptr;
+    }
+
+    /**
+     * Returns the next completion queue entry and enters the kernel to wait for it, if the queue is empty.
+     *
+     * @param source_location Holds information about caller/calling position.
+     * @return                next CQE or soft errors EAGAIN/EBUSY
+     */
+    [[nodiscard]] std::expected<struct io_uring_cqe*, Error> wait_cqe(
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        struct io_uring_cqe* cqe = peek_cqe();
+        while (cqe == nullptr)
+        {
+            std::expected<unsigned int, Error> entered = submit_and_wait(1, source_location);
+            if (!entered.has_value())
+                return std::unexpected<Error>(entered.error());
+            cqe = peek_cqe();
+        }
+        return cqe;
+    }
+
+    /**
+     * Releases processed completion queue entries to the kernel.
+     *
+     * @param nr Number of processed CQEs.
+     */
+    [[gnu::always_inline]] inline void cqe_seen(unsigned int nr = 1) noexcept
+    {
+        std::atomic_ref<uint32_t> head(*cq_khead);
+        head.store(head.load(std::memory_order_relaxed) + nr, std::memory_order_release);
+    }
+
+    /**
+     * Processes all ready completion queue entries without entering the kernel.
+     *
+     * The entries are released in a single step after all of them have been processed.
+     *
+     * @tparam CALLABLE Callable with signature void(const io_uring_cqe&).
+     * @param  callable Called for each ready CQE.
+     * @return          number of processed CQEs
+     */
+    template<typename CALLABLE>
+    [[gnu::always_inline]] inline unsigned int for_each_cqe(CALLABLE&& callable)
+    {
+        std::atomic_ref<uint32_t> khead(*cq_khead);
+        uint32_t head       = khead.load(std::memory_order_relaxed);
+        const uint32_t tail = std::atomic_ref<uint32_t>(*cq_ktail).load(std::memory_order_acquire);
+        const unsigned int count = tail - head;
+
+        for (; head != tail; head++)
+            std::forward<CALLABLE>(callable)(static_cast<const struct io_uring_cqe&>(cqes[head & cq_mask]));
+
+        if (count > 0)
+            khead.store(tail, std::memory_order_release);
+        return count;
+    }
+
+    /**
+     * Registers files for usage with IOSQE_FIXED_FILE, the SQE fd field is then an index into this array.
+     *
+     * @param fds             Files to be registered, -1 marks sparse entries.
+     * @param source_location Holds information about caller/calling position.
+     */
+    void register_files(
+        std::span<const FileDescriptor> fds,
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        GuardFW::io_uring_register(
+            ring_fd,
+            IORING_REGISTER_FILES,
+            const_cast<FileDescriptor*>(fds.data()),  // NOSONAR: kernel does not modify the array
+            static_cast<unsigned int>(fds.size()),
+            source_location
+        );
+    }
+
+    /// Unregisters all files, which have been registered with register_files().
+    void unregister_files(const std::source_location& source_location = std::source_location::current())
+    {
+        GuardFW::io_uring_register(ring_fd, IORING_UNREGISTER_FILES, nullptr, 0, source_location);
+    }
+
+    /**
+     * Registers buffers for usage with IORING_OP_READ_FIXED/IORING_OP_WRITE_FIXED, selected by SQE buf_index.
+     *
+     * @param buffers         Buffers to be registered (and pinned) by the kernel.
+     * @param source_location Holds information about caller/calling position.
+     */
+    void register_buffers(
+        std::span<const struct iovec> buffers,
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        GuardFW::io_uring_register(
+            ring_fd,
+            IORING_REGISTER_BUFFERS,
+            const_cast<struct iovec*>(buffers.data()),  // NOSONAR: kernel does not modify the array
+            static_cast<unsigned int>(buffers.size()),
+            source_location
+        );
+    }
+
+    /// Unregisters all buffers, which have been registered with register_buffers().
+    void unregister_buffers(const std::source_location& source_location = std::source_location::current())
+    {
+        GuardFW::io_uring_register(ring_fd, IORING_UNREGISTER_BUFFERS, nullptr, 0, source_location);
+    }
+
+    /**
+     * Fills the common fields of a submission queue entry.
+     *
+     * @param sqe       Zero-initialized SQE from get_sqe().
+     * @param opcode    IORING_OP_* operation.
+     * @param fd        File descriptor or index of registered file.
+     * @param addr      Buffer address or operation-specific pointer.
+     * @param len       Buffer length or operation-specific length.
+     * @param offset    File offset or operation-specific value.
+     * @param user_data Value which is returned unchanged in the CQE.
+     */
+    [[gnu::always_inline]] static inline void prep(
+        struct io_uring_sqe& sqe,
+        uint8_t opcode,
+        FileDescriptor fd,
+        const void* addr,  // NOSONAR: allow void*
+        uint32_t len,
+        uint64_t offset,
+        uint64_t user_data
+    ) noexcept
+    {
+        sqe.opcode    = opcode;
+        sqe.fd        = fd;
+        sqe.addr      = reinterpret_cast<uint64_t>(addr);
+        sqe.len       = len;
+        sqe.off       = offset;
+        sqe.user_data = user_data;
+    }
+
+private:
+    /// Creates setup parameters for the simple constructor.
+    static struct io_uring_params make_params(unsigned int flags, unsigned int sq_thread_idle) noexcept
+    {
+        struct io_uring_params params {};
+        params.flags          = flags;
+        params.sq_thread_idle = sq_thread_idle;
+        return params;
+    }
+
+    /// Returns pointer to a ring field at a kernel-provided byte offset.
+    template<typename T>
+    static T* ring_field(void* ring, uint32_t offset) noexcept  // NOSONAR: allow void*
+    {
+        return reinterpret_cast<T*>(static_cast<uint8_t*>(ring) + offset);
+    }
+
+    /// Reads the kernel-written submission ring flags (IORING_SQ_*).
+    [[gnu::always_inline]] inline uint32_t sq_flags() const noexcept
+    {
+        return std::atomic_ref<uint32_t>(*sq_kflags).load(std::memory_order_relaxed);
+    }
+
+    /// Publishes all fetched SQEs and returns the number of SQEs not yet consumed by the kernel.
+    [[gnu::always_inline]] inline unsigned int flush_sq() noexcept
+    {
+        if (sqe_head != sqe_tail)
+        {
+            sqe_head = sqe_tail;
+            std::atomic_ref<uint32_t>(*sq_ktail).store(sqe_tail, std::memory_order_release);
+        }
+        return sqe_tail - std::atomic_ref<uint32_t>(*sq_khead).load(std::memory_order_acquire);
+    }
+
+    /// Maps submission ring, completion ring and SQE array and resolves the ring field offsets.
+    void map_rings(const std::source_location& source_location)
+    {
+        constexpr int prot  = constants::prot_read | constants::prot_write;
+        constexpr int flags = constants::map_shared | constants::map_populate;
+
+        sq_ring_size = ring_params.sq_off.array + ring_params.sq_entries * sizeof(uint32_t);
+        cq_ring_size = ring_params.cq_off.cqes + ring_params.cq_entries * sizeof(struct io_uring_cqe);
+        sqes_size    = ring_params.sq_entries * sizeof(struct io_uring_sqe);
+
+        const bool single_mmap = (ring_params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap)
+            sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+
+        sq_ring_ptr = GuardFW::mmap(nullptr, sq_ring_size, prot, flags, ring_fd, IORING_OFF_SQ_RING, source_location);
+        if (single_mmap)
+            cq_ring_ptr = sq_ring_ptr;
+        else
+            cq_ring_ptr =
+                GuardFW::mmap(nullptr, cq_ring_size, prot, flags, ring_fd, IORING_OFF_CQ_RING, source_location);
+        sqes = static_cast<struct io_uring_sqe*>(
+            GuardFW::mmap(nullptr, sqes_size, prot, flags, ring_fd, IORING_OFF_SQES, source_location)
+        );
+
+        sq_khead  = ring_field<uint32_t>(sq_ring_ptr, ring_params.sq_off.head);
+        sq_ktail  = ring_field<uint32_t>(sq_ring_ptr, ring_params.sq_off.tail);
+        sq_kflags = ring_field<uint32_t>(sq_ring_ptr, ring_params.sq_off.flags);
+        sq_mask   = *ring_field<uint32_t>(sq_ring_ptr, ring_params.sq_off.ring_mask);
+
+        cq_khead = ring_field<uint32_t>(cq_ring_ptr, ring_params.cq_off.head);
+        cq_ktail = ring_field<uint32_t>(cq_ring_ptr, ring_params.cq_off.tail);
+        cq_mask  = *ring_field<uint32_t>(cq_ring_ptr, ring_params.cq_off.ring_mask);
+        cqes     = ring_field<struct io_uring_cqe>(cq_ring_ptr, ring_params.cq_off.cqes);
+
+        // SQE indices are mapped 1:1 once, so submission only has to move the tail
+        uint32_t* sq_array = ring_field<uint32_t>(sq_ring_ptr, ring_params.sq_off.array);
+        for (uint32_t index = 0; index < ring_params.sq_entries; index++)
+            sq_array[index] = index;
+
+        sqe_head = sqe_tail = std::atomic_ref<uint32_t>(*sq_ktail).load(std::memory_order_relaxed);
+    }
+
+    /// Unmaps all mapped rings, also used for cleanup of partially mapped rings.
+    void unmap_rings()
+    {
+        if (sqes != nullptr)
+            GuardFW::munmap(sqes, sqes_size);
+        if (cq_ring_ptr != nullptr && cq_ring_ptr != sq_ring_ptr)
+            GuardFW::munmap(cq_ring_ptr, cq_ring_size);
+        if (sq_ring_ptr != nullptr)
+            GuardFW::munmap(sq_ring_ptr, sq_ring_size);
+        sqes        = nullptr;
+        cq_ring_ptr = nullptr;
+        sq_ring_ptr = nullptr;
+    }
+
+    struct io_uring_params ring_params {};
+    FileDescriptor ring_fd {file_descriptor_invalid};
+
+    void* sq_ring_ptr {nullptr};  // NOSONAR: allow void*
+    void* cq_ring_ptr {nullptr};  // NOSONAR: allow void*
+    struct io_uring_sqe* sqes {nullptr};
+    size_t sq_ring_size {0};
+    size_t cq_ring_size {0};
+    size_t sqes_size {0};
+
+    uint32_t* sq_khead {nullptr};   ///< kernel-owned submission queue head
+    uint32_t* sq_ktail {nullptr};   ///< user-owned submission queue tail
+    uint32_t* sq_kflags {nullptr};  ///< kernel-owned IORING_SQ_* flags
+    uint32_t sq_mask {0};
+    uint32_t sqe_head {0};  ///< first fetched, but unpublished SQE
+    uint32_t sqe_tail {0};  ///< next SQE to be fetched
+
+    uint32_t* cq_khead {nullptr};  ///< user-owned completion queue head
+    uint32_t* cq_ktail {nullptr};  ///< kernel-owned completion queue tail
+    uint32_t cq_mask {0};
+    struct io_uring_cqe* cqes {nullptr};
+};
+
+}  // namespace GuardFW
@@ -0,0 +1,313 @@
+/**
+ * Read-only memory-mapped file views.
+ *
+ * MappedFile maps a whole file, MappedFileWindow maps a fixed-size window, which slides over files larger than
+ * the address space budget. Both expose the mapped data as std::span<const std::byte> for zero-copy parsing
+ * and pass access pattern hints to the kernel with madvise().
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+module;
+
+#include <fcntl.h>     // O_RDONLY, O_CLOEXEC
+#include <sys/mman.h>  // MADV_*
+#include <sys/stat.h>  // struct stat
+#include <unistd.h>    // ::sysconf()
+
+#include <algorithm>        // std::min()
+#include <cstddef>          // size_t, std::byte
+#include <cstdint>          // uint8_t
+#include <source_location>  // std::source_location
+#include <span>             // std::span<>
+
+export module guardfw.mapped_file;
+
+import guardfw.file_desciptor;
+import guardfw.wrapped_fcntl;
+import guardfw.wrapped_mman;
+import guardfw.wrapped_stat;
+import guardfw.wrapped_unistd;
+
+namespace GuardFW
+{
+
+/// Expected access pattern, passed to madvise().
+export enum class AccessPattern : uint8_t {
+    normal     = MADV_NORMAL,      ///< default readahead
+    sequential = MADV_SEQUENTIAL,  ///< aggressive readahead, pages may be freed soon after access
+    random     = MADV_RANDOM,      ///< no readahead
+};
+
+/// @return size of a file in bytes
+size_t size_of_file(FileDescriptor fd, const std::source_location& source_location)
+{
+    struct stat status {};
+    GuardFW::fstat(fd, &status, source_location);
+    return static_cast<size_t>(status.st_size);
+}
+
+/// @return page size, which is the granularity of mapping offsets
+size_t page_size() noexcept
+{
+    static const size_t size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+/// Maps a read-only range of a file, optionally replacing an existing mapping at a fixed address.
+std::byte* map_range(
+    void* address, size_t length, FileDescriptor fd, off_t offset, const std::source_location& source_location
+)
+{
+    const int fixed = (address != nullptr) ? constants::map_fixed : 0;
+    return static_cast<std::byte*>(
+        GuardFW::mmap(address, length, constants::prot_read, constants::map_shared | fixed, fd, offset, source_location)
+    );
+}
+
+/**
+ * Read-only mapping of a whole file.
+ */
+export class MappedFile
+{
+public:
+    /**
+     * Maps a file, the file descriptor is not needed afterwards and remains owned by the caller.
+     *
+     * @param fd              File descriptor opened for reading.
+     * @param pattern         Expected access pattern.
+     * @param source_location Holds information about caller/calling position.
+     */
+    explicit MappedFile(
+        FileDescriptor fd,
+        AccessPattern pattern                       = AccessPattern::sequential,
+        const std::source_location& source_location = std::source_location::current()
+    )
+        : location(source_location)
+    {
+        map(fd, pattern);
+    }
+
+    /**
+     * Opens and maps a file, the file is closed immediately after mapping.
+     *
+     * @param pathname        Path of file.
+     * @param pattern         Expected access pattern.
+     * @param source_location Holds information about caller/calling position.
+     */
+    explicit MappedFile(
+        const char* pathname,
+        AccessPattern pattern                       = AccessPattern::sequential,
+        const std::source_location& source_location = std::source_location::current()
+    )
+        : location(source_location)
+    {
+        const FileDescriptor fd = GuardFW::open(pathname, O_RDONLY | O_CLOEXEC, source_location);
+        try
+        {
+            map(fd, pattern);
+        }
+        catch (...)
+        {
+            GuardFW::close(fd, source_location);
+            throw;
+        }
+        GuardFW::close(fd, source_location);
+    }
+
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile(MappedFile&&)                 = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&&)      = delete;
+
+    ~MappedFile()
+    {
+        if (mapping != nullptr)
+            GuardFW::munmap(mapping, length, location);
+    }
+
+    /// @return whole file content
+    [[nodiscard]] std::span<const std::byte> data() const noexcept
+    {
+        return {mapping, length};
+    }
+
+    /// @return file size in bytes
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return length;
+    }
+
+    /**
+     * Starts asynchronous readahead for a range, which will be accessed soon.
+     *
+     * @param offset          Offset in file.
+     * @param range_length    Length of range.
+     * @param source_location Holds information about caller/calling position.
+     */
+    void will_need(
+        size_t offset,
+        size_t range_length,
+        const std::source_location& source_location = std::source_location::current()
+    ) const
+    {
+        advise(offset, range_length, MADV_WILLNEED, source_location);
+    }
+
+    /**
+     * Releases the pages of an already processed range from the resident set, the data remains accessible.
+     *
+     * @param offset          Offset in file.
+     * @param range_length    Length of range.
+     * @param source_location Holds information about caller/calling position.
+     */
+    void dont_need(
+        size_t offset,
+        size_t range_length,
+        const std::source_location& source_location = std::source_location::current()
+    ) const
+    {
+        advise(offset, range_length, MADV_DONTNEED, source_location);
+    }
+
+private:
+    void map(FileDescriptor fd, AccessPattern pattern)
+    {
+        length = size_of_file(fd, location);
+        if (length == 0)  // empty files can not be mapped
+            return;
+        mapping = map_range(nullptr, length, fd, 0, location);
+        GuardFW::madvise(mapping, length, static_cast<int>(pattern), location);
+    }
+
+    /// Applies advice to all pages, which overlap with a range.
+    void advise(size_t offset, size_t range_length, int advice, const std::source_location& source_location) const
+    {
+        if (offset >= length || range_length == 0)
+            return;
+        const size_t begin = offset & ~(page_size() - 1);
+        const size_t end   = std::min(offset + range_length, length);
+        GuardFW::madvise(mapping + begin, end - begin, advice, source_location);
+    }
+
+    std::source_location location;  ///< location of construction, reported by errors during destruction
+    std::byte* mapping {nullptr};
+    size_t length {0};
+};
+
+/**
+ * Read-only mapping of a sliding window over a file.
+ *
+ * The window is remapped in place with MAP_FIXED, so sliding costs a single mmap() call. Data of a previous
+ * window is unmapped and no longer counts to the resident set.
+ */
+export class MappedFileWindow
+{
+public:
+    /**
+     * Prepares a window, the first window is mapped by slide_to().
+     *
+     * @param fd              File descriptor opened for reading, must stay open during the lifetime of the window.
+     * @param window_size     Size of window in bytes, rounded up to page size.
+     * @param pattern         Expected access pattern within a window.
+     * @param source_location Holds information about caller/calling position.
+     */
+    MappedFileWindow(
+        FileDescriptor fd,
+        size_t window_size,
+        AccessPattern pattern                       = AccessPattern::sequential,
+        const std::source_location& source_location = std::source_location::current()
+    )
+        : file(fd)
+        , capacity((std::max(window_size, size_t {1}) + page_size() - 1) & ~(page_size() - 1))
+        , file_length(size_of_file(fd, source_location))
+        , advice(static_cast<int>(pattern))
+        , location(source_location)
+    {}
+
+    MappedFileWindow(const MappedFileWindow&)            = delete;
+    MappedFileWindow(MappedFileWindow&&)                 = delete;
+    MappedFileWindow& operator=(const MappedFileWindow&) = delete;
+    MappedFileWindow& operator=(MappedFileWindow&&)      = delete;
+
+    ~MappedFileWindow()
+    {
+        if (mapping != nullptr)
+            GuardFW::munmap(mapping, capacity, location);
+    }
+
+    /**
+     * Maps the window, which starts at a file offset.
+     *
+     * The window begins exactly at the offset, so records crossing the end of the previous window can be
+     * parsed completely by sliding to their start. Because mappings start at page boundaries, the usable
+     * window may be up to one page shorter than the window size.
+     *
+     * @param offset          Offset in file.
+     * @param source_location Holds information about caller/calling position.
+     * @return                mapped data from offset, empty at end of file
+     */
+    std::span<const std::byte> slide_to(
+        size_t offset, const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        if (offset >= file_length)
+        {
+            current = {};
+            return current;
+        }
+
+        const size_t begin       = offset & ~(page_size() - 1);
+        const size_t map_length  = std::min(capacity, file_length - begin);
+        std::byte* const address = map_range(mapping, capacity, file, static_cast<off_t>(begin), source_location);
+        mapping                  = address;  // first mapping reserves the address range for all windows
+        GuardFW::madvise(address, map_length, advice, source_location);
+
+        window_offset = offset;
+        current       = {address + (offset - begin), map_length - (offset - begin)};
+        return current;
+    }
+
+    /**
+     * Slides the window behind the end of the current window.
+     *
+     * @param source_location Holds information about caller/calling position.
+     * @return                mapped data of next window, empty at end of file
+     */
+    std::span<const std::byte> next(const std::source_location& source_location = std::source_location::current())
+    {
+        return slide_to(window_offset + current.size(), source_location);
+    }
+
+    /// @return currently mapped data
+    [[nodiscard]] std::span<const std::byte> window() const noexcept
+    {
+        return current;
+    }
+
+    /// @return file offset of currently mapped data
+    [[nodiscard]] size_t offset() const noexcept
+    {
+        return window_offset;
+    }
+
+    /// @return file size in bytes
+    [[nodiscard]] size_t file_size() const noexcept
+    {
+        return file_length;
+    }
+
+private:
+    FileDescriptor file;
+    size_t capacity;     ///< size of mapped address range
+    size_t file_length;  ///< file size at construction
+    int advice;
+    std::source_location location;  ///< location of construction, reported by errors during destruction
+    std::byte* mapping {nullptr};
+    size_t window_offset {0};
+    std::span<const std::byte> current;
+};
+
+}  // namespace GuardFW
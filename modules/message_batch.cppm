@@ -0,0 +1,340 @@
+/**
+ * Preallocated message batch for recvmmsg() and sendmmsg().
+ *
+ * The class MessageBatch owns the mmsghdr, iovec and address arrays and the message buffers in a single
+ * cache-line-aligned memory block, so batched datagram I/O does not allocate and message buffers of
+ * different messages never share a cache line.
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+module;
+
+#include <sys/socket.h>  // mmsghdr, sockaddr_storage, MSG_TRUNC
+#include <sys/uio.h>     // iovec
+
+#include <algorithm>        // std::min()
+#include <cerrno>           // EINVAL
+#include <cstddef>          // size_t, std::byte
+#include <cstring>          // ::memcpy(), ::memset()
+#include <ctime>            // timespec
+#include <memory>           // std::unique_ptr<>
+#include <new>              // ::operator new(), std::align_val_t
+#include <optional>         // std::optional<>
+#include <source_location>  // std::source_location
+#include <span>             // std::span<>
+
+export module guardfw.message_batch;
+
+import guardfw.exceptions;
+import guardfw.file_desciptor;
+import guardfw.wrapped_socket;
+
+namespace GuardFW
+{
+
+/**
+ * Preallocated batch of datagram messages for recvmmsg() and sendmmsg().
+ *
+ * Receiving: receive() or receive_nonblock() fill the batch and return a span of the received headers, the
+ * payloads and source addresses are accessible by payload() and address(), truncated() reports datagrams, which
+ * were larger than the buffer.
+ * Sending: fill buffer(index), describe the message with set_message() and send the first messages with send()
+ * or send_nonblock().
+ * Message indices are checked, invalid indices and counts are rejected with EINVAL.
+ */
+export class MessageBatch
+{
+public:
+    static constexpr size_t cache_line_size {64};
+
+    /**
+     * Allocates a message batch.
+     *
+     * @param messages    Maximum number of messages per batch.
+     * @param buffer_size Capacity of each message buffer in bytes.
+     */
+    MessageBatch(size_t messages, size_t buffer_size)
+        : batch_size(messages)
+        , buffer_capacity(buffer_size)
+        , buffer_stride(align(buffer_size))
+    {
+        const size_t headers_size   = align(messages * sizeof(struct mmsghdr));
+        const size_t iovecs_size    = align(messages * sizeof(struct iovec));
+        const size_t addresses_size = align(messages * sizeof(struct sockaddr_storage));
+        const size_t total_size     = headers_size + iovecs_size + addresses_size + (messages * buffer_stride);
+
+        memory.reset(static_cast<std::byte*>(::operator new(total_size, std::align_val_t {cache_line_size})));
+        memset(memory.get(), 0, headers_size + iovecs_size + addresses_size);
+
+        headers   = reinterpret_cast<struct mmsghdr*>(memory.get());
+        iovecs    = reinterpret_cast<struct iovec*>(memory.get() + headers_size);
+        addresses = reinterpret_cast<struct sockaddr_storage*>(memory.get() + headers_size + iovecs_size);
+        buffers   = memory.get() + headers_size + iovecs_size + addresses_size;
+
+        for (size_t index = 0; index < batch_size; index++)
+        {
+            iovecs[index].iov_base            = buffers + (index * buffer_stride);
+            headers[index].msg_hdr.msg_iov    = &iovecs[index];
+            headers[index].msg_hdr.msg_iovlen = 1;
+        }
+    }
+
+    /// @return maximum number of messages per batch
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return batch_size;
+    }
+
+    /// @return capacity of each message buffer in bytes
+    [[nodiscard]] size_t capacity() const noexcept
+    {
+        return buffer_capacity;
+    }
+
+    /**
+     * Receives up to size() messages, blocks until at least one message has been received.
+     *
+     * @param fd              Datagram socket.
+     * @param flags           recvmmsg() flags, MSG_WAITFORONE returns after the first message, if no more are queued.
+     * @param timeout         Optional recvmmsg() timeout, see recvmmsg(2) for its limitations.
+     * @param source_location Holds information about caller/calling position.
+     * @return                headers of received messages, msg_len contains the payload length
+     */
+    [[nodiscard]] std::span<const struct mmsghdr> receive(
+        FileDescriptor fd,
+        int flags                                   = MSG_WAITFORONE,
+        struct timespec* timeout                    = nullptr,
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        prepare_receive();
+        const unsigned int received = recvmmsg(fd, headers, batch_count(), flags, timeout, source_location);
+        received_count              = received;
+        return {headers, received};
+    }
+
+    /**
+     * Receives up to size() messages without blocking.
+     *
+     * @param fd              Nonblocking datagram socket or any socket with flag MSG_DONTWAIT.
+     * @param flags           recvmmsg() flags.
+     * @param source_location Holds information about caller/calling position.
+     * @return                headers of received messages or std::nullopt, if no message was available
+     */
+    [[nodiscard]] std::optional<std::span<const struct mmsghdr>> receive_nonblock(
+        FileDescriptor fd,
+        int flags                                   = 0,
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        prepare_receive();
+        std::optional<unsigned int> received =
+            recvmmsg_nonblock(fd, headers, batch_count(), flags, nullptr, source_location);
+        if (!received.has_value())
+            return std::nullopt;
+        received_count = received.value();
+        return std::span<const struct mmsghdr> {headers, received.value()};
+    }
+
+    /**
+     * Payload of a received message.
+     *
+     * @param index           Message index, must be less than the number of received messages.
+     * @param source_location Holds information about caller/calling position.
+     * @return                received payload, at most capacity() bytes
+     */
+    [[nodiscard]] std::span<const std::byte> payload(
+        size_t index, const std::source_location& source_location = std::source_location::current()
+    ) const
+    {
+        check_index(index, received_count, "MessageBatch::payload", source_location);
+        return {buffers + (index * buffer_stride), std::min<size_t>(headers[index].msg_len, buffer_capacity)};
+    }
+
+    /**
+     * Reports a received message, which did not fit into its buffer and has been truncated (MSG_TRUNC).
+     *
+     * @param index           Message index, must be less than the number of received messages.
+     * @param source_location Holds information about caller/calling position.
+     * @return                true, if the payload is only the first part of the datagram
+     */
+    [[nodiscard]] bool truncated(
+        size_t index, const std::source_location& source_location = std::source_location::current()
+    ) const
+    {
+        check_index(index, received_count, "MessageBatch::truncated", source_location);
+        return (headers[index].msg_hdr.msg_flags & MSG_TRUNC) != 0;
+    }
+
+    /**
+     * Source address of a received message or destination address of a message to be sent.
+     *
+     * @param index           Message index, must be less than size().
+     * @param source_location Holds information about caller/calling position.
+     * @return                address, msg_hdr.msg_namelen of the message header contains its length
+     */
+    [[nodiscard]] const struct sockaddr_storage& address(
+        size_t index, const std::source_location& source_location = std::source_location::current()
+    ) const
+    {
+        check_index(index, batch_size, "MessageBatch::address", source_location);
+        return addresses[index];
+    }
+
+    /**
+     * Buffer of a message to be sent.
+     *
+     * @param index           Message index, must be less than size().
+     * @param source_location Holds information about caller/calling position.
+     * @return                whole message buffer with capacity() bytes
+     */
+    [[nodiscard]] std::span<std::byte> buffer(
+        size_t index, const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        check_index(index, batch_size, "MessageBatch::buffer", source_location);
+        return {buffers + (index * buffer_stride), buffer_capacity};
+    }
+
+    /**
+     * Describes a message to be sent, its payload must already be stored in buffer(index).
+     *
+     * @param index           Message index, must be less than size().
+     * @param length          Payload length, must not exceed capacity().
+     * @param destination     Destination address for unconnected sockets or nullptr for connected sockets.
+     * @param address_len     Length of destination address, must not exceed sizeof(sockaddr_storage).
+     * @param source_location Holds information about caller/calling position.
+     */
+    void set_message(
+        size_t index,
+        size_t length,
+        const struct sockaddr* destination          = nullptr,
+        socklen_t address_len                       = 0,
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        check_index(index, batch_size, "MessageBatch::set_message", source_location);
+        if (length > buffer_capacity || (destination != nullptr && address_len > sizeof(struct sockaddr_storage)))
+            throw_system_error(EINVAL, "MessageBatch::set_message", source_location);
+
+        struct msghdr& header = headers[index].msg_hdr;
+        iovecs[index].iov_len = length;
+        if (destination != nullptr)
+        {
+            memcpy(&addresses[index], destination, address_len);
+            header.msg_name    = &addresses[index];
+            header.msg_namelen = address_len;
+        }
+        else
+        {
+            header.msg_name    = nullptr;
+            header.msg_namelen = 0;
+        }
+    }
+
+    /**
+     * Sends the first messages of the batch, blocks until at least one message has been sent.
+     *
+     * @param fd              Datagram socket.
+     * @param count           Number of messages to be sent, must not exceed size().
+     * @param flags           sendmmsg() flags.
+     * @param source_location Holds information about caller/calling position.
+     * @return                number of sent messages
+     */
+    [[nodiscard]] unsigned int send(
+        FileDescriptor fd,
+        size_t count,
+        int flags                                   = 0,
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        check_count(count, "MessageBatch::send", source_location);
+        return sendmmsg(fd, headers, static_cast<unsigned int>(count), flags, source_location);
+    }
+
+    /**
+     * Sends the first messages of the batch without blocking.
+     *
+     * @param fd              Nonblocking datagram socket or any socket with flag MSG_DONTWAIT.
+     * @param count           Number of messages to be sent, must not exceed size().
+     * @param flags           sendmmsg() flags.
+     * @param source_location Holds information about caller/calling position.
+     * @return                number of sent messages or std::nullopt, if no message could be sent
+     */
+    [[nodiscard]] std::optional<unsigned int> send_nonblock(
+        FileDescriptor fd,
+        size_t count,
+        int flags                                   = 0,
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        check_count(count, "MessageBatch::send_nonblock", source_location);
+        return sendmmsg_nonblock(fd, headers, static_cast<unsigned int>(count), flags, source_location);
+    }
+
+private:
+    /// Frees memory allocated with cache line alignment.
+    struct AlignedDelete
+    {
+        void operator()(std::byte* pointer) const noexcept
+        {
+            ::operator delete(pointer, std::align_val_t {cache_line_size});
+        }
+    };
+
+    /// Rounds up to a multiple of the cache line size.
+    static constexpr size_t align(size_t size) noexcept
+    {
+        return (size + cache_line_size - 1) & ~(cache_line_size - 1);
+    }
+
+    [[nodiscard]] unsigned int batch_count() const noexcept
+    {
+        return static_cast<unsigned int>(batch_size);
+    }
+
+    /// Rejects a message index, which is not less than limit, with EINVAL.
+    static void check_index(
+        size_t index, size_t limit, const char* function, const std::source_location& source_location
+    )
+    {
+        if (index >= limit) [[unlikely]]
+            throw_system_error(EINVAL, function, source_location);
+    }
+
+    /// Rejects a number of messages to be sent, which exceeds the batch size, with EINVAL.
+    void check_count(size_t count, const char* function, const std::source_location& source_location) const
+    {
+        if (count > batch_size) [[unlikely]]
+            throw_system_error(EINVAL, function, source_location);
+    }
+
+    /// Restores buffer lengths and address lengths, which have been changed by previous calls.
+    void prepare_receive() noexcept
+    {
+        received_count = 0;
+        for (size_t index = 0; index < batch_size; index++)
+        {
+            struct msghdr& header = headers[index].msg_hdr;
+            iovecs[index].iov_len = buffer_capacity;
+            header.msg_name       = &addresses[index];
+            header.msg_namelen    = sizeof(struct sockaddr_storage);
+        }
+    }
+
+    size_t batch_size;
+    size_t buffer_capacity;
+    size_t buffer_stride;
+    size_t received_count {0};  ///< number of messages received by the last receive call
+
+    std::unique_ptr<std::byte, AlignedDelete> memory;
+    struct mmsghdr* headers {nullptr};
+    struct iovec* iovecs {nullptr};
+    struct sockaddr_storage* addresses {nullptr};
+    std::byte* buffers {nullptr};
+};
+
+}  // namespace GuardFW
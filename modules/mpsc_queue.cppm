@@ -0,0 +1,247 @@
+/**
+ * Bounded lock-free multi-producer/single-consumer queue with eventfd doorbell.
+ *
+ * Producers enqueue into a ring of sequenced cells without locks. The eventfd doorbell is only written when the
+ * consumer has armed itself before sleeping, so a busy consumer does not cause any syscalls. The eventfd can be
+ * waited for with epoll, e.g. by registering it at a Reactor.
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+module;
+
+#include <sys/eventfd.h>  // EFD_NONBLOCK, EFD_CLOEXEC
+
+#include <algorithm>        // std::max()
+#include <atomic>           // std::atomic<>, std::atomic_thread_fence()
+#include <bit>              // std::bit_ceil()
+#include <concepts>         // std::movable<>, std::default_initializable<>, std::assignable_from<>
+#include <cstddef>          // size_t, ptrdiff_t
+#include <cstdint>          // uint64_t
+#include <limits>           // std::numeric_limits<>
+#include <memory>           // std::unique_ptr<>
+#include <optional>         // std::optional<>
+#include <source_location>  // std::source_location
+#include <type_traits>      // std::is_nothrow_move_constructible_v<>
+#include <utility>          // std::forward(), std::move()
+
+export module guardfw.mpsc_queue;
+
+import guardfw.file_desciptor;
+import guardfw.wrapped_eventfd;
+import guardfw.wrapped_unistd;
+
+namespace GuardFW
+{
+
+/**
+ * Bounded lock-free queue for multiple producer threads and a single consumer thread.
+ *
+ * The consumer either polls with try_pop() and drain(), or sleeps on the doorbell: it calls arm() and only waits
+ * for the doorbell file descriptor to become readable, if arm() returned true. consume() combines draining and
+ * arming for an edge-triggered epoll loop.
+ *
+ * @tparam T Type of elements.
+ */
+export template<typename T>
+    requires std::movable<T> && std::default_initializable<T>
+class MpscQueue
+{
+public:
+    /**
+     * Allocates the ring and creates the doorbell eventfd.
+     *
+     * @param capacity        Maximum number of queued elements, rounded up to a power of 2.
+     * @param source_location Holds information about caller/calling position.
+     */
+    explicit MpscQueue(size_t capacity, const std::source_location& source_location = std::source_location::current())
+        : mask(std::bit_ceil(std::max(capacity, size_t {2})) - 1)
+        , cells(std::make_unique<Cell[]>(mask + 1))
+        , location(source_location)
+    {
+        for (size_t index = 0; index <= mask; index++)
+            cells[index].sequence.store(index, std::memory_order_relaxed);
+        doorbell_fd = GuardFW::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC, source_location);
+    }
+
+    MpscQueue(const MpscQueue&)            = delete;
+    MpscQueue(MpscQueue&&)                 = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+    MpscQueue& operator=(MpscQueue&&)      = delete;
+
+    ~MpscQueue()
+    {
+        GuardFW::close(doorbell_fd, location);
+    }
+
+    /**
+     * Enqueues an element, thread-safe. Rings the doorbell, if the consumer is armed.
+     *
+     * @param value           Element, only moved from if the queue is not full.
+     * @param source_location Holds information about caller/calling position.
+     * @return                false if the queue is full
+     */
+    template<typename U>
+        requires std::assignable_from<T&, U&&>
+    bool try_push(U&& value, const std::source_location& source_location = std::source_location::current())
+    {
+        size_t position = tail.load(std::memory_order_relaxed);
+        Cell* cell      = nullptr;
+        while (true)
+        {
+            cell                     = &cells[position & mask];
+            const size_t sequence    = cell->sequence.load(std::memory_order_acquire);
+            const ptrdiff_t distance = static_cast<ptrdiff_t>(sequence - position);
+            if (distance == 0)
+            {
+                if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (distance < 0)  // cell still holds an element of the previous round
+                return false;
+            else  // another producer has claimed the cell
+                position = tail.load(std::memory_order_relaxed);
+        }
+        cell->value = std::forward<U>(value);
+        cell->sequence.store(position + 1, std::memory_order_release);
+
+        // pairs with the fence in arm(): either the consumer sees the element or the producer sees the armed flag
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (armed.load(std::memory_order_relaxed) && armed.exchange(false, std::memory_order_acq_rel))
+            ring(source_location);
+        return true;
+    }
+
+    /**
+     * Dequeues an element, only for the consumer thread.
+     *
+     * @return element or std::nullopt if the queue is empty
+     */
+    std::optional<T> try_pop() noexcept(std::is_nothrow_move_constructible_v<T>)
+    {
+        Cell& cell = cells[head & mask];
+        if (cell.sequence.load(std::memory_order_acquire) != head + 1)
+            return std::nullopt;
+        std::optional<T> value {std::move(cell.value)};
+        cell.sequence.store(head + mask + 1, std::memory_order_release);
+        head++;
+        return value;
+    }
+
+    /**
+     * Dequeues a batch of elements, only for the consumer thread.
+     *
+     * @tparam CALLBACK  Callable with a T&& argument.
+     * @param  callback  Called for each element.
+     * @param  max_batch Maximum number of dequeued elements.
+     * @return           number of dequeued elements
+     */
+    template<typename CALLBACK>
+    size_t drain(CALLBACK&& callback, size_t max_batch = std::numeric_limits<size_t>::max())
+    {
+        size_t count = 0;
+        while (count < max_batch)
+        {
+            std::optional<T> value = try_pop();
+            if (!value.has_value())
+                break;
+            count++;
+            callback(std::move(value.value()));
+        }
+        return count;
+    }
+
+    /**
+     * Arms the doorbell before the consumer waits for it, only for the consumer thread.
+     *
+     * @return true if the consumer may wait, false if elements have been queued meanwhile
+     */
+    bool arm() noexcept
+    {
+        armed.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (cells[head & mask].sequence.load(std::memory_order_acquire) != head + 1)
+            return true;
+        armed.store(false, std::memory_order_relaxed);
+        return false;
+    }
+
+    /**
+     * Resets the doorbell after it became readable, only for the consumer thread.
+     *
+     * @param source_location Holds information about caller/calling position.
+     */
+    void acknowledge(const std::source_location& source_location = std::source_location::current())
+    {
+        uint64_t counter = 0;
+        (void) GuardFW::read_nonblock_ignore_result(doorbell_fd, &counter, sizeof(counter), source_location);
+    }
+
+    /**
+     * Acknowledges the doorbell and drains the queue until the consumer could be armed, only for the consumer thread.
+     *
+     * Intended for the handler of an edge-triggered registration of fd(), the doorbell is armed on return.
+     *
+     * @tparam CALLBACK        Callable with a T&& argument.
+     * @param  callback        Called for each element.
+     * @param  source_location Holds information about caller/calling position.
+     * @return                 number of dequeued elements
+     */
+    template<typename CALLBACK>
+    size_t consume(CALLBACK&& callback, const std::source_location& source_location = std::source_location::current())
+    {
+        acknowledge(source_location);
+        size_t count = 0;
+        do
+            count += drain(callback);
+        while (!arm());
+        return count;
+    }
+
+    /// @return doorbell eventfd, readable after the armed consumer has been notified
+    [[nodiscard]] FileDescriptor fd() const noexcept
+    {
+        return doorbell_fd;
+    }
+
+    /// @return maximum number of queued elements
+    [[nodiscard]] size_t capacity() const noexcept
+    {
+        return mask + 1;
+    }
+
+    /// @return number of doorbell writes, for monitoring the coalescing of wakeups
+    [[nodiscard]] uint64_t doorbells() const noexcept
+    {
+        return doorbell_count.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr size_t cache_line_size {64};
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence {0};  ///< position + 1 if filled, position if free for this round
+        T value {};
+    };
+
+    void ring(const std::source_location& source_location)
+    {
+        doorbell_count.fetch_add(1, std::memory_order_relaxed);
+        const uint64_t increment = 1;
+        (void) GuardFW::write_nonblock_ignore_result(doorbell_fd, &increment, sizeof(increment), source_location);
+    }
+
+    const size_t mask;
+    std::unique_ptr<Cell[]> cells;
+    std::source_location location;  ///< location of construction, reported by errors during destruction
+    FileDescriptor doorbell_fd {file_descriptor_invalid};
+    alignas(cache_line_size) std::atomic<size_t> tail {0};   ///< written by producers
+    alignas(cache_line_size) std::atomic<bool> armed {false};  ///< consumer waits for the doorbell
+    std::atomic<uint64_t> doorbell_count {0};
+    alignas(cache_line_size) size_t head {0};  ///< written by consumer
+};
+
+}  // namespace GuardFW
@@ -0,0 +1,434 @@
+/**
+ * Work-stealing thread pool for blocking system calls.
+ *
+ * Calls like open(), fsync() or syncfs() may block for milliseconds, which stalls an event loop. The class
+ * OffloadPool runs such calls on worker threads. Each submitting thread has a home queue, each worker thread owns
+ * one queue and steals from the other queues, if its own queue is empty. The queues are bounded and lock-free.
+ * Results, including exceptions thrown by the wrappers, are returned with a std::future or by a callback, which
+ * is executed by the event loop after the completion eventfd became readable.
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+module;
+
+#include <algorithm>        // std::max()
+#include <atomic>           // std::atomic<>
+#include <bit>              // std::bit_ceil()
+#include <cerrno>           // EAGAIN, EINVAL
+#include <cstddef>          // size_t, ptrdiff_t
+#include <cstdint>          // uint32_t, uint64_t
+#include <exception>        // std::exception_ptr, std::current_exception()
+#include <expected>         // std::expected<>, std::unexpected<>
+#include <functional>       // std::move_only_function<>
+#include <future>           // std::future<>, std::promise<>
+#include <memory>           // std::unique_ptr<>
+#include <optional>         // std::optional<>
+#include <source_location>  // std::source_location
+#include <thread>           // std::thread
+#include <type_traits>      // std::invoke_result_t<>, std::is_void_v<>
+#include <utility>          // std::forward(), std::move()
+#include <vector>           // std::vector<>
+
+export module guardfw.offload_pool;
+
+import guardfw.exceptions;
+import guardfw.file_desciptor;
+import guardfw.mpsc_queue;
+
+namespace GuardFW
+{
+
+/// Job of the pool.
+using OffloadJob = std::move_only_function<void()>;
+
+/**
+ * Bounded lock-free queue for multiple producers and multiple consumers, with sequenced cells like MpscQueue.
+ */
+class OffloadQueue
+{
+public:
+    explicit OffloadQueue(size_t capacity)
+        : mask(std::bit_ceil(std::max(capacity, size_t {2})) - 1)
+        , cells(std::make_unique<Cell[]>(mask + 1))
+    {
+        for (size_t index = 0; index <= mask; index++)
+            cells[index].sequence.store(index, std::memory_order_relaxed);
+    }
+
+    /// @return false if the queue is full, the job is only moved from if it was queued
+    bool try_push(OffloadJob& job)
+    {
+        size_t position = tail.load(std::memory_order_relaxed);
+        Cell* cell      = nullptr;
+        while (true)
+        {
+            cell                     = &cells[position & mask];
+            const size_t sequence    = cell->sequence.load(std::memory_order_acquire);
+            const ptrdiff_t distance = static_cast<ptrdiff_t>(sequence - position);
+            if (distance == 0)
+            {
+                if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (distance < 0)  // cell still holds a job of the previous round
+                return false;
+            else  // another producer has claimed the cell
+                position = tail.load(std::memory_order_relaxed);
+        }
+        cell->job = std::move(job);
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @return job or std::nullopt if the queue is empty
+    std::optional<OffloadJob> try_pop()
+    {
+        size_t position = head.load(std::memory_order_relaxed);
+        Cell* cell      = nullptr;
+        while (true)
+        {
+            cell                     = &cells[position & mask];
+            const size_t sequence    = cell->sequence.load(std::memory_order_acquire);
+            const ptrdiff_t distance = static_cast<ptrdiff_t>(sequence - (position + 1));
+            if (distance == 0)
+            {
+                if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (distance < 0)  // cell is empty
+                return std::nullopt;
+            else  // another consumer has taken the cell
+                position = head.load(std::memory_order_relaxed);
+        }
+        std::optional<OffloadJob> job {std::move(cell->job)};
+        cell->job = nullptr;
+        cell->sequence.store(position + mask + 1, std::memory_order_release);
+        return job;
+    }
+
+    /// @return number of queued jobs, approximated while producers or consumers are active
+    [[nodiscard]] size_t depth() const noexcept
+    {
+        const size_t consumed = head.load(std::memory_order_relaxed);
+        const size_t produced = tail.load(std::memory_order_relaxed);
+        return (produced > consumed) ? produced - consumed : 0;
+    }
+
+private:
+    static constexpr size_t cache_line_size {64};
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence {0};  ///< position + 1 if filled, position if free for this round
+        OffloadJob job {};
+    };
+
+    const size_t mask;
+    std::unique_ptr<Cell[]> cells;
+    alignas(cache_line_size) std::atomic<size_t> tail {0};  ///< written by producers
+    alignas(cache_line_size) std::atomic<size_t> head {0};  ///< written by consumers
+};
+
+/// Result of an offloaded call, as passed to completion callbacks.
+export template<typename RESULT>
+using OffloadResult = std::expected<RESULT, std::exception_ptr>;
+
+/// Queue depth metrics of an OffloadPool.
+export struct OffloadPoolMetrics
+{
+    uint64_t submitted {0};            ///< accepted jobs
+    uint64_t rejected {0};             ///< jobs rejected because all queues were full
+    uint64_t executed {0};             ///< finished jobs
+    uint64_t stolen {0};               ///< jobs executed by a worker, which does not own their queue
+    size_t queued {0};                 ///< currently queued jobs of all queues
+    size_t peak_queued {0};            ///< maximum depth of a single queue since construction
+    std::vector<size_t> queue_depths;  ///< currently queued jobs of each queue
+};
+
+/**
+ * Thread pool for offloading blocking calls from event loop threads.
+ *
+ * submit() and its callback variant are thread-safe. Callbacks are executed by complete(), which must only be
+ * called by a single thread at a time, usually the event loop, which waits for fd() to become readable.
+ * Callback jobs, whose callbacks have not been executed yet, are limited to the capacity of the completion queue,
+ * so workers never wait for the event loop. The destructor executes all queued jobs before it joins the workers,
+ * callbacks, which have not been executed by complete(), are dropped.
+ */
+export class OffloadPool
+{
+public:
+    /**
+     * Starts the worker threads.
+     *
+     * @param workers         Number of worker threads and queues, must not be 0.
+     * @param queue_capacity  Maximum number of queued jobs per queue, rounded up to a power of 2.
+     * @param source_location Holds information about caller/calling position.
+     */
+    explicit OffloadPool(
+        size_t workers,
+        size_t queue_capacity                       = 1024,
+        const std::source_location& source_location = std::source_location::current()
+    )
+        : completions(queue_capacity * std::max(workers, size_t {1}), source_location)
+    {
+        if (workers == 0)
+            throw_system_error(EINVAL, "OffloadPool::OffloadPool", source_location);
+        queues.reserve(workers);
+        for (size_t index = 0; index < workers; index++)
+            queues.push_back(std::make_unique<OffloadQueue>(queue_capacity));
+        (void) completions.arm();  // the completion queue is empty
+        threads.reserve(workers);
+        for (size_t index = 0; index < workers; index++)
+            threads.emplace_back([this, index] { work(index); });
+    }
+
+    OffloadPool(const OffloadPool&)            = delete;
+    OffloadPool(OffloadPool&&)                 = delete;
+    OffloadPool& operator=(const OffloadPool&) = delete;
+    OffloadPool& operator=(OffloadPool&&)      = delete;
+
+    ~OffloadPool()
+    {
+        stopping.store(true, std::memory_order_seq_cst);
+        work_epoch.fetch_add(1, std::memory_order_seq_cst);
+        work_epoch.notify_all();
+        for (std::thread& thread : threads)
+            thread.join();
+    }
+
+    /**
+     * Runs a call on a worker thread and returns its result with a future.
+     *
+     * @tparam CALL            Callable without arguments, e.g. a lambda calling a wrapper.
+     * @param  call            Call to be executed, exceptions are rethrown by std::future::get().
+     * @param  source_location Holds information about caller/calling position.
+     * @return                 future of the result of the call
+     */
+    template<typename CALL>
+    [[nodiscard]] std::future<std::invoke_result_t<CALL>> submit(
+        CALL&& call, const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        using Result = std::invoke_result_t<CALL>;
+        std::promise<Result> promise;
+        std::future<Result> future = promise.get_future();
+        enqueue(
+            [call = std::forward<CALL>(call), promise = std::move(promise)]() mutable {
+                try
+                {
+                    if constexpr (std::is_void_v<Result>)
+                    {
+                        call();
+                        promise.set_value();
+                    }
+                    else  // constexpr
+                        promise.set_value(call());
+                }
+                catch (...)
+                {
+                    promise.set_exception(std::current_exception());
+                }
+            },
+            source_location
+        );
+        return future;
+    }
+
+    /**
+     * Runs a call on a worker thread, complete() passes its result to a callback.
+     *
+     * Throws EAGAIN, if all queues are full, or if the completion queue could not take the result, because
+     * complete() is behind.
+     *
+     * @tparam CALL            Callable without arguments, e.g. a lambda calling a wrapper.
+     * @tparam CALLBACK        Callable with an OffloadResult<> argument.
+     * @param  call            Call to be executed, exceptions are passed as std::exception_ptr to the callback.
+     * @param  callback        Called by complete() with the result of the call.
+     * @param  source_location Holds information about caller/calling position.
+     */
+    template<typename CALL, typename CALLBACK>
+    void submit(
+        CALL&& call, CALLBACK&& callback, const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        using Result = std::invoke_result_t<CALL>;
+        // reserves a cell in the completion queue, so the worker can always push the completion
+        if (pending_callbacks.fetch_add(1, std::memory_order_relaxed) >= completions.capacity())
+        {
+            pending_callbacks.fetch_sub(1, std::memory_order_relaxed);
+            rejected_count.fetch_add(1, std::memory_order_relaxed);
+            throw_system_error(EAGAIN, "OffloadPool::submit", source_location);
+        }
+        try
+        {
+            enqueue(
+                [this, call = std::forward<CALL>(call), callback = std::forward<CALLBACK>(callback)]() mutable {
+                    OffloadResult<Result> result = invoke(call);
+                    OffloadJob completion = [callback = std::move(callback), result = std::move(result)]() mutable {
+                        callback(std::move(result));
+                    };
+                    (void) completions.try_push(std::move(completion));  // reserved by submit()
+                },
+                source_location
+            );
+        }
+        catch (...)
+        {
+            pending_callbacks.fetch_sub(1, std::memory_order_relaxed);
+            throw;
+        }
+    }
+
+    /**
+     * Executes the callbacks of completed calls and re-arms the completion eventfd.
+     *
+     * @param source_location Holds information about caller/calling position.
+     * @return                number of executed callbacks
+     */
+    size_t complete(const std::source_location& source_location = std::source_location::current())
+    {
+        return completions.consume(
+            [this](OffloadJob&& completion) {
+                pending_callbacks.fetch_sub(1, std::memory_order_relaxed);  // frees the reserved cell first
+                completion();
+            },
+            source_location
+        );
+    }
+
+    /// @return completion eventfd, readable after callbacks became ready for complete()
+    [[nodiscard]] FileDescriptor fd() const noexcept
+    {
+        return completions.fd();
+    }
+
+    /// @return number of worker threads
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return threads.size();
+    }
+
+    /// @return queue depth and job counters
+    [[nodiscard]] OffloadPoolMetrics metrics() const
+    {
+        OffloadPoolMetrics result {
+            .submitted    = submitted_count.load(std::memory_order_relaxed),
+            .rejected     = rejected_count.load(std::memory_order_relaxed),
+            .executed     = executed_count.load(std::memory_order_relaxed),
+            .stolen       = stolen_count.load(std::memory_order_relaxed),
+            .queued       = 0,
+            .peak_queued  = peak_depth.load(std::memory_order_relaxed),
+            .queue_depths = {},
+        };
+        for (const std::unique_ptr<OffloadQueue>& queue : queues)
+        {
+            result.queue_depths.push_back(queue->depth());
+            result.queued += result.queue_depths.back();
+        }
+        return result;
+    }
+
+private:
+    /// @return result of a call or its exception
+    template<typename CALL>
+    static OffloadResult<std::invoke_result_t<CALL>> invoke(CALL& call) noexcept
+    {
+        try
+        {
+            if constexpr (std::is_void_v<std::invoke_result_t<CALL>>)
+            {
+                call();
+                return {};
+            }
+            else  // constexpr
+                return call();
+        }
+        catch (...)
+        {
+            return std::unexpected(std::current_exception());
+        }
+    }
+
+    /// Queues a job at the home queue of the calling thread, or at the next queue with free cells.
+    void enqueue(OffloadJob&& job, const std::source_location& source_location)
+    {
+        thread_local const size_t submitter = next_submitter.fetch_add(1, std::memory_order_relaxed);
+        const size_t home                   = submitter % queues.size();
+        for (size_t offset = 0; offset < queues.size(); offset++)
+        {
+            OffloadQueue& queue = *queues[(home + offset) % queues.size()];
+            if (!queue.try_push(job))
+                continue;
+
+            submitted_count.fetch_add(1, std::memory_order_relaxed);
+            const size_t depth = queue.depth();
+            size_t peak        = peak_depth.load(std::memory_order_relaxed);
+            while (depth > peak && !peak_depth.compare_exchange_weak(peak, depth, std::memory_order_relaxed))
+            {
+            }
+
+            // pairs with the sleepers increment in work(): either the worker sees the new epoch or we see a sleeper
+            work_epoch.fetch_add(1, std::memory_order_seq_cst);
+            if (sleepers.load(std::memory_order_seq_cst) > 0)
+                work_epoch.notify_one();
+            return;
+        }
+        rejected_count.fetch_add(1, std::memory_order_relaxed);
+        throw_system_error(EAGAIN, "OffloadPool::submit", source_location);
+    }
+
+    /// @return true if a job has been executed, the own queue is preferred to the queues of other workers
+    bool run_one(size_t own)
+    {
+        for (size_t offset = 0; offset < queues.size(); offset++)
+        {
+            std::optional<OffloadJob> job = queues[(own + offset) % queues.size()]->try_pop();
+            if (!job.has_value())
+                continue;
+            if (offset != 0)
+                stolen_count.fetch_add(1, std::memory_order_relaxed);
+            (*job)();
+            executed_count.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    /// Worker thread, executes jobs until the pool is destructed and all queues are empty.
+    void work(size_t own)
+    {
+        while (true)
+        {
+            const uint32_t epoch = work_epoch.load(std::memory_order_seq_cst);
+            if (run_one(own))
+                continue;
+            if (stopping.load(std::memory_order_seq_cst))
+                return;
+            sleepers.fetch_add(1, std::memory_order_seq_cst);
+            work_epoch.wait(epoch, std::memory_order_seq_cst);
+            sleepers.fetch_sub(1, std::memory_order_seq_cst);
+        }
+    }
+
+    static constexpr size_t cache_line_size {64};
+
+    static inline std::atomic<size_t> next_submitter {0};
+
+    std::vector<std::unique_ptr<OffloadQueue>> queues;  ///< indexed like threads
+    MpscQueue<OffloadJob> completions;
+    std::vector<std::thread> threads;
+    alignas(cache_line_size) std::atomic<uint32_t> work_epoch {0};  ///< incremented for each job, waited for
+    std::atomic<uint32_t> sleepers {0};
+    std::atomic<bool> stopping {false};
+    alignas(cache_line_size) std::atomic<uint64_t> submitted_count {0};
+    std::atomic<uint64_t> rejected_count {0};
+    std::atomic<size_t> pending_callbacks {0};  ///< callback jobs, whose callbacks have not been executed yet
+    std::atomic<size_t> peak_depth {0};
+    alignas(cache_line_size) std::atomic<uint64_t> executed_count {0};  ///< written by workers
+    std::atomic<uint64_t> stolen_count {0};
+};
+
+}  // namespace GuardFW
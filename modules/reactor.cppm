@@ -0,0 +1,314 @@
+/**
+ * Edge-triggered epoll reactor.
+ *
+ * The class Reactor waits for batches of events with epoll_pwait2() and dispatches them to handlers in a table
+ * indexed by file descriptor. File descriptors are registered once edge-triggered for input and output, so the
+ * interest set never has to be modified with additional epoll_ctl() calls. Handlers must drain their file
+ * descriptor until it would block, e.g. with drain_read() or drain_recv().
+ * Each thread should run its own reactor, only wake() and stop() may be called from other threads.
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+module;
+
+#include <sys/epoll.h>    // EPOLL*, epoll_event
+#include <sys/eventfd.h>  // EFD_NONBLOCK, EFD_CLOEXEC
+#include <sys/socket.h>   // MSG_DONTWAIT
+
+#include <atomic>           // std::atomic<>
+#include <cstddef>          // size_t, std::byte
+#include <cstdint>          // uint8_t, uint32_t, uint64_t
+#include <ctime>            // timespec
+#include <optional>         // std::optional<>
+#include <source_location>  // std::source_location
+#include <span>             // std::span<>
+#include <vector>           // std::vector<>
+
+export module guardfw.reactor;
+
+import guardfw.file_desciptor;
+import guardfw.wrapped_epoll;
+import guardfw.wrapped_eventfd;
+import guardfw.wrapped_socket;
+import guardfw.wrapped_unistd;
+
+namespace GuardFW
+{
+
+export class Reactor;
+
+/**
+ * Interface for handlers of file descriptor events.
+ */
+export class EventHandler
+{
+public:
+    EventHandler()                               = default;
+    EventHandler(const EventHandler&)            = default;
+    EventHandler(EventHandler&&)                 = default;
+    EventHandler& operator=(const EventHandler&) = default;
+    EventHandler& operator=(EventHandler&&)      = default;
+    virtual ~EventHandler()                      = default;
+
+    /**
+     * Handles events of a file descriptor.
+     *
+     * As events are edge-triggered, the handler must read or write until the file descriptor would block,
+     * otherwise it will not be notified again.
+     *
+     * @param reactor Reactor, which dispatched the events.
+     * @param fd      File descriptor.
+     * @param events  Occurred events, e.g. EPOLLIN, EPOLLOUT, EPOLLRDHUP, EPOLLERR or EPOLLHUP.
+     */
+    virtual void on_events(Reactor& reactor, FileDescriptor fd, uint32_t events) = 0;
+};
+
+/**
+ * Single-threaded edge-triggered epoll event loop.
+ */
+export class Reactor
+{
+public:
+    static constexpr uint32_t default_events {EPOLLIN | EPOLLOUT | EPOLLRDHUP};
+
+    /**
+     * Creates the epoll instance and the wakeup eventfd.
+     *
+     * @param batch_size      Maximum number of events per epoll_pwait2() call.
+     * @param source_location Holds information about caller/calling position.
+     */
+    explicit Reactor(
+        size_t batch_size = 256, const std::source_location& source_location = std::source_location::current()
+    )
+        : events(batch_size)
+        , location(source_location)
+    {
+        epoll_fd = GuardFW::epoll_create1(EPOLL_CLOEXEC, source_location);
+        try
+        {
+            wake_fd = GuardFW::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC, source_location);
+            struct epoll_event event {.events = EPOLLIN | EPOLLET, .data {.fd = wake_fd}};
+            GuardFW::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event, source_location);
+        }
+        catch (...)
+        {
+            if (wake_fd != file_descriptor_invalid)
+                GuardFW::close(wake_fd, source_location);
+            GuardFW::close(epoll_fd, source_location);
+            throw;
+        }
+    }
+
+    Reactor(const Reactor&)            = delete;
+    Reactor(Reactor&&)                 = delete;
+    Reactor& operator=(const Reactor&) = delete;
+    Reactor& operator=(Reactor&&)      = delete;
+
+    ~Reactor()
+    {
+        GuardFW::close(wake_fd, location);
+        GuardFW::close(epoll_fd, location);
+    }
+
+    /**
+     * Registers a file descriptor edge-triggered, the registration is not modified until remove().
+     *
+     * @param fd              Nonblocking file descriptor.
+     * @param handler         Handler for events, must stay valid until the file descriptor is removed.
+     * @param interest        Events of interest, EPOLLET is added.
+     * @param source_location Holds information about caller/calling position.
+     */
+    void add(
+        FileDescriptor fd,
+        EventHandler& handler,
+        uint32_t interest                           = default_events,
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        const auto index = static_cast<size_t>(fd);
+        if (index >= handlers.size())
+            handlers.resize(index + 1, nullptr);
+
+        struct epoll_event event {.events = interest | EPOLLET, .data {.fd = fd}};
+        GuardFW::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event, source_location);
+        handlers[index] = &handler;
+    }
+
+    /**
+     * Unregisters a file descriptor, must be called before the file descriptor is closed.
+     *
+     * Pending events of the current batch are no longer dispatched for this file descriptor.
+     *
+     * @param fd              Registered file descriptor.
+     * @param source_location Holds information about caller/calling position.
+     */
+    void remove(FileDescriptor fd, const std::source_location& source_location = std::source_location::current())
+    {
+        GuardFW::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, no_event, source_location);
+        handlers[static_cast<size_t>(fd)] = nullptr;
+    }
+
+    /**
+     * Waits for one batch of events and dispatches them.
+     *
+     * @param timeout         Maximum waiting time or nullptr to wait infinitely.
+     * @param source_location Holds information about caller/calling position.
+     * @return                number of dispatched events, including wakeups
+     */
+    size_t run_once(
+        const struct timespec* timeout              = nullptr,
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        const unsigned int ready = GuardFW::epoll_pwait2(
+            epoll_fd, events.data(), static_cast<int>(events.size()), timeout, nullptr, source_location
+        );
+
+        for (unsigned int index = 0; index < ready; index++)
+        {
+            const FileDescriptor fd = events[index].data.fd;
+            if (fd == wake_fd)
+            {
+                acknowledge_wakeup(source_location);
+                continue;
+            }
+            EventHandler* const handler = handlers[static_cast<size_t>(fd)];
+            if (handler != nullptr)  // may have been removed by a previous handler of this batch
+                handler->on_events(*this, fd, events[index].events);
+        }
+        return ready;
+    }
+
+    /**
+     * Dispatches events until stop() is called.
+     *
+     * @param source_location Holds information about caller/calling position.
+     */
+    void run(const std::source_location& source_location = std::source_location::current())
+    {
+        while (!stopping.load(std::memory_order_acquire))
+            (void) run_once(nullptr, source_location);
+        stopping.store(false, std::memory_order_relaxed);
+    }
+
+    /**
+     * Interrupts a waiting run_once(), thread-safe. Multiple wakeups before the reactor wakes up are coalesced.
+     *
+     * @param source_location Holds information about caller/calling position.
+     */
+    void wake(const std::source_location& source_location = std::source_location::current())
+    {
+        if (!wake_pending.exchange(true, std::memory_order_acq_rel))
+        {
+            const uint64_t increment = 1;
+            (void) GuardFW::write_nonblock_ignore_result(wake_fd, &increment, sizeof(increment), source_location);
+        }
+    }
+
+    /**
+     * Lets run() return after the current batch, thread-safe.
+     *
+     * @param source_location Holds information about caller/calling position.
+     */
+    void stop(const std::source_location& source_location = std::source_location::current())
+    {
+        stopping.store(true, std::memory_order_release);
+        wake(source_location);
+    }
+
+    /// @return epoll file descriptor, e.g. for nesting into another event loop
+    [[nodiscard]] FileDescriptor fd() const noexcept
+    {
+        return epoll_fd;
+    }
+
+private:
+    static constexpr struct epoll_event* no_event {nullptr};
+
+    void acknowledge_wakeup(const std::source_location& source_location)
+    {
+        wake_pending.store(false, std::memory_order_release);
+        uint64_t counter = 0;
+        (void) GuardFW::read_nonblock_ignore_result(wake_fd, &counter, sizeof(counter), source_location);
+    }
+
+    FileDescriptor epoll_fd {file_descriptor_invalid};
+    FileDescriptor wake_fd {file_descriptor_invalid};
+    std::vector<EventHandler*> handlers;  ///< indexed by file descriptor
+    std::vector<struct epoll_event> events;
+    std::atomic<bool> wake_pending {false};
+    std::atomic<bool> stopping {false};
+    std::source_location location;  ///< location of construction, reported by errors during destruction
+};
+
+/// Result of draining a file descriptor.
+export enum class DrainResult : uint8_t {
+    would_block,  ///< all available data has been read
+    eof,          ///< peer closed the connection or end of file reached
+};
+
+/**
+ * Reads from a nonblocking file descriptor until it would block.
+ *
+ * @tparam CALLBACK        Callable with a std::span<const std::byte> argument.
+ * @param  fd              Nonblocking file descriptor.
+ * @param  buffer          Buffer for each read.
+ * @param  callback        Called with the data of each read.
+ * @param  source_location Holds information about caller/calling position.
+ * @return                 reason, why draining has been stopped
+ */
+export template<typename CALLBACK>
+DrainResult drain_read(
+    FileDescriptor fd,
+    std::span<std::byte> buffer,
+    CALLBACK&& callback,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    while (true)
+    {
+        std::optional<size_t> bytes = GuardFW::read_nonblock(fd, buffer.data(), buffer.size(), source_location);
+        if (!bytes.has_value())
+            return DrainResult::would_block;
+        if (bytes.value() == 0)
+            return DrainResult::eof;
+        callback(std::span<const std::byte> {buffer.data(), bytes.value()});
+    }
+}
+
+/**
+ * Receives from a socket until it would block, MSG_DONTWAIT is added to the flags.
+ *
+ * @tparam CALLBACK        Callable with a std::span<const std::byte> argument.
+ * @param  sockfd          Socket.
+ * @param  buffer          Buffer for each receive.
+ * @param  flags           Additional recv() flags.
+ * @param  callback        Called with the data of each receive.
+ * @param  source_location Holds information about caller/calling position.
+ * @return                 reason, why draining has been stopped
+ */
+export template<typename CALLBACK>
+DrainResult drain_recv(
+    FileDescriptor sockfd,
+    std::span<std::byte> buffer,
+    int flags,
+    CALLBACK&& callback,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    while (true)
+    {
+        std::optional<size_t> bytes =
+            GuardFW::recv_nonblock(sockfd, buffer.data(), buffer.size(), flags | MSG_DONTWAIT, source_location);
+        if (!bytes.has_value())
+            return DrainResult::would_block;
+        if (bytes.value() == 0)
+            return DrainResult::eof;
+        callback(std::span<const std::byte> {buffer.data(), bytes.value()});
+    }
+}
+
+}  // namespace GuardFW
@@ -0,0 +1,294 @@
+/**
+ * Kernel-side relaying of data between two file descriptors.
+ *
+ * The class Relay moves data with splice() through a pipe from a PipePool, so the data is not copied to user
+ * space. Splice support is tracked per side: if the input does not support splicing, the relay copies with read()
+ * and write(). If only the output does not support splicing, the input is still spliced and the pipe is copied to the
+ * output.
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+module;
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <fcntl.h>  // ::splice(), SPLICE_F_*, F_SETPIPE_SZ, O_CLOEXEC
+
+#include <algorithm>        // std::min()
+#include <cerrno>           // EINVAL
+#include <cstddef>          // size_t, std::byte
+#include <expected>         // std::expected<>
+#include <source_location>  // std::source_location
+#include <vector>           // std::vector<>
+
+export module guardfw.relay;
+
+import guardfw.wrapper;
+import guardfw.file_desciptor;
+import guardfw.wrapped_fcntl;
+import guardfw.wrapped_unistd;
+
+namespace GuardFW
+{
+
+/// Like ContextRepeatEINTR, but returns EINVAL for file descriptors, which do not support splicing.
+using ContextSpliceProbe =
+    Context<ErrorIndication::eqm1_errno, ErrorReport::exception, ErrorSpecial::eintr_repeats, EINVAL>;
+
+/// Offset argument of splice() for streaming without offsets (nullptr_t is no valid wrapper argument).
+constexpr off64_t* no_offset {nullptr};
+
+/// Both ends of a pipe.
+export struct Pipe
+{
+    FileDescriptor read_end {file_descriptor_invalid};
+    FileDescriptor write_end {file_descriptor_invalid};
+};
+
+/**
+ * Pool of pipes, which avoids creating and closing a pipe for each relay.
+ *
+ * The pool is not thread-safe, each thread should use its own pool.
+ */
+export class PipePool
+{
+public:
+    /**
+     * Creates an empty pool, pipes are created on demand.
+     *
+     * @param max_pipes Maximum number of pooled pipes, additional released pipes are closed.
+     * @param pipe_size Pipe capacity set with F_SETPIPE_SZ or 0 for the default capacity.
+     */
+    explicit PipePool(size_t max_pipes = 16, int pipe_size = 0)
+        : pool_size(max_pipes)
+        , capacity(pipe_size)
+    {
+        pipes.reserve(max_pipes);
+    }
+
+    PipePool(const PipePool&)            = delete;
+    PipePool(PipePool&&)                 = delete;
+    PipePool& operator=(const PipePool&) = delete;
+    PipePool& operator=(PipePool&&)      = delete;
+
+    ~PipePool()
+    {
+        for (const Pipe& pipe : pipes)
+            close_pipe(pipe);
+    }
+
+    /**
+     * Takes an empty pipe from the pool or creates a new pipe.
+     *
+     * @param source_location Holds information about caller/calling position.
+     * @return                empty pipe
+     */
+    [[nodiscard]] Pipe acquire(const std::source_location& source_location = std::source_location::current())
+    {
+        if (!pipes.empty())
+        {
+            const Pipe pipe = pipes.back();
+            pipes.pop_back();
+            return pipe;
+        }
+
+        int fds[2] {file_descriptor_invalid, file_descriptor_invalid};
+        GuardFW::pipe2(fds, O_CLOEXEC, source_location);
+        const Pipe pipe {.read_end = fds[0], .write_end = fds[1]};
+        if (capacity > 0)
+        {
+            try
+            {
+                (void) GuardFW::fcntl_retval(pipe.write_end, F_SETPIPE_SZ, capacity, source_location);
+            }
+            catch (...)
+            {
+                close_pipe(pipe);
+                throw;
+            }
+        }
+        return pipe;
+    }
+
+    /**
+     * Returns a pipe to the pool.
+     *
+     * @param pipe  Pipe, which has been acquired from this pool.
+     * @param empty Pipe contains no data, otherwise it is closed instead of being pooled.
+     */
+    void release(const Pipe& pipe, bool empty = true)
+    {
+        if (empty && pipes.size() < pool_size)
+            pipes.push_back(pipe);
+        else
+            close_pipe(pipe);
+    }
+
+    /// @return number of pooled pipes
+    [[nodiscard]] size_t pooled() const noexcept
+    {
+        return pipes.size();
+    }
+
+private:
+    static void close_pipe(const Pipe& pipe)
+    {
+        GuardFW::close(pipe.read_end);
+        GuardFW::close(pipe.write_end);
+    }
+
+    size_t pool_size;
+    int capacity;
+    std::vector<Pipe> pipes;
+};
+
+/**
+ * Relays data between two file descriptors within the kernel.
+ *
+ * A relay holds a pipe of the pool during its lifetime. Both file descriptors should be blocking, as the
+ * relay does not handle EAGAIN.
+ */
+export class Relay
+{
+public:
+    /**
+     * Acquires a pipe from a pool.
+     *
+     * @param pool            Pipe pool, must outlive the relay.
+     * @param chunk_size      Maximum number of bytes moved per splice() or read().
+     * @param source_location Holds information about caller/calling position.
+     */
+    explicit Relay(
+        PipePool& pool,
+        size_t chunk_size                           = 65536,
+        const std::source_location& source_location = std::source_location::current()
+    )
+        : pipe_pool(pool)
+        , pipe(pool.acquire(source_location))
+        , chunk(chunk_size)
+    {}
+
+    Relay(const Relay&)            = delete;
+    Relay(Relay&&)                 = delete;
+    Relay& operator=(const Relay&) = delete;
+    Relay& operator=(Relay&&)      = delete;
+
+    ~Relay()
+    {
+        pipe_pool.release(pipe, buffered == 0);
+    }
+
+    /**
+     * Relays data, partial transfers are continued until all data has been relayed or the input reaches EOF.
+     *
+     * @param fd_in           Input file descriptor.
+     * @param fd_out          Output file descriptor.
+     * @param count           Number of bytes to be relayed.
+     * @param source_location Holds information about caller/calling position.
+     * @return                number of relayed bytes, less than count only at EOF
+     */
+    size_t transfer(
+        FileDescriptor fd_in,
+        FileDescriptor fd_out,
+        size_t count,
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        size_t transferred = 0;
+        splice_input       = true;  // probed anew for each pair of file descriptors
+        splice_output      = true;
+
+        while (transferred < count)
+        {
+            const size_t remaining = count - transferred;
+            const size_t length    = std::min(remaining, chunk);
+            size_t moved           = 0;
+
+            if (splice_input)
+            {
+                const unsigned int more = (remaining > length) ? SPLICE_F_MORE : 0U;
+                std::expected<size_t, Error> spliced = ContextSpliceProbe::wrapper<::splice, size_t>(
+                    source_location, fd_in, no_offset, pipe.write_end, no_offset, length, SPLICE_F_MOVE | more
+                );
+                if (!spliced.has_value())  // input does not support splicing
+                {
+                    splice_input = false;
+                    continue;
+                }
+                moved    = spliced.value();
+                buffered = moved;
+                drain(fd_out, more, source_location);
+            }
+            else  // writing the buffer to the pipe would be an additional copy, so the output is not spliced
+                moved = copy(fd_in, fd_out, length, source_location);
+
+            if (moved == 0)  // EOF
+                break;
+            transferred += moved;
+        }
+        return transferred;
+    }
+
+    /// @return true, if the last transfer had to use read() and write() for at least a part of the data
+    [[nodiscard]] bool used_fallback() const noexcept
+    {
+        return !splice_input || !splice_output;
+    }
+
+    /// @return true, if the input of the last transfer did not support splicing and was read with read()
+    [[nodiscard]] bool input_fallback() const noexcept
+    {
+        return !splice_input;
+    }
+
+    /// @return true, if the output of the last transfer did not support splicing and was written with write()
+    [[nodiscard]] bool output_fallback() const noexcept
+    {
+        return !splice_output;
+    }
+
+private:
+    /// Moves all data from the pipe to the output, copies it, if the output does not support splicing.
+    void drain(FileDescriptor fd_out, unsigned int more, const std::source_location& source_location)
+    {
+        while (buffered > 0 && splice_output)
+        {
+            std::expected<size_t, Error> spliced = ContextSpliceProbe::wrapper<::splice, size_t>(
+                source_location, pipe.read_end, no_offset, fd_out, no_offset, buffered, SPLICE_F_MOVE | more
+            );
+            if (!spliced.has_value())  // output does not support splicing
+                splice_output = false;
+            else
+                buffered -= spliced.value();
+        }
+        while (buffered > 0)
+            buffered -= copy(pipe.read_end, fd_out, buffered, source_location);
+    }
+
+    /// Copies up to length bytes with read() and write(), returns 0 at EOF.
+    size_t copy(FileDescriptor fd_in, FileDescriptor fd_out, size_t length, const std::source_location& source_location)
+    {
+        if (buffer.size() < chunk)
+            buffer.resize(chunk);
+
+        const size_t received = GuardFW::read(fd_in, buffer.data(), std::min(length, buffer.size()), source_location);
+        size_t written        = 0;
+        while (written < received)
+            written += GuardFW::write(fd_out, buffer.data() + written, received - written, source_location);
+        return received;
+    }
+
+    PipePool& pipe_pool;
+    Pipe pipe;
+    size_t chunk;
+    size_t buffered {0};  ///< bytes in pipe
+    bool splice_input {true};   ///< input of the last transfer supports splicing
+    bool splice_output {true};  ///< output of the last transfer supports splicing
+    std::vector<std::byte> buffer;  ///< allocated on first fallback
+};
+
+}  // namespace GuardFW
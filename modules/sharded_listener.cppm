@@ -0,0 +1,236 @@
+/**
+ * Per-core listener sharding with SO_REUSEPORT.
+ *
+ * The class ShardedListener creates one listening socket per worker CPU in a SO_REUSEPORT group, instead of one
+ * socket, which is accepted from by all workers. Each shard sets SO_INCOMING_CPU, and a classic BPF program can
+ * be attached to the group, which steers each connection to the shard of the CPU, which received it. A worker
+ * pinned to the CPU of its shard then accepts and serves its connections without cross-core cache traffic and
+ * without thundering herds.
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+module;
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <linux/filter.h>  // sock_filter, sock_fprog, BPF_*, SKF_AD_*
+#include <sched.h>         // cpu_set_t, CPU_ZERO(), CPU_SET()
+#include <sys/socket.h>    // SOL_SOCKET, SO_*, SOCK_*, SOMAXCONN, sockaddr_storage
+
+#include <cerrno>           // EINVAL
+#include <cstddef>          // size_t
+#include <cstdint>          // uint16_t, uint32_t
+#include <cstring>          // ::memcpy()
+#include <optional>         // std::optional<>
+#include <source_location>  // std::source_location
+#include <span>             // std::span<>
+#include <vector>           // std::vector<>
+
+export module guardfw.sharded_listener;
+
+import guardfw.exceptions;
+import guardfw.file_desciptor;
+import guardfw.wrapped_sched;
+import guardfw.wrapped_socket;
+import guardfw.wrapped_unistd;
+
+namespace GuardFW
+{
+
+/// Options for ShardedListener.
+export struct ShardedListenerOptions
+{
+    int backlog {SOMAXCONN};    ///< backlog of each shard
+    bool steer_by_cpu {true};   ///< attach a BPF program, which selects the shard of the receiving CPU
+    bool incoming_cpu {true};   ///< set SO_INCOMING_CPU of each shard to its CPU
+    bool reuse_address {true};  ///< set SO_REUSEADDR, e.g. for restarts with connections in TIME_WAIT
+};
+
+/**
+ * Group of nonblocking SO_REUSEPORT listening sockets, one per worker CPU.
+ *
+ * Connections received on a CPU, which has no shard, are distributed by the kernel's connection hash.
+ * All shards are listening after construction, they are closed by the destructor.
+ */
+export class ShardedListener
+{
+public:
+    /**
+     * Creates, binds and listens on one socket per CPU.
+     *
+     * @param addr            Local address, a port 0 selects an ephemeral port, which is shared by all shards.
+     * @param addrlen         Length of address.
+     * @param cpus            CPU of each shard, must not be empty.
+     * @param options         Listener options.
+     * @param source_location Holds information about caller/calling position.
+     */
+    ShardedListener(
+        const struct sockaddr* addr,
+        socklen_t addrlen,
+        std::span<const unsigned int> cpus,
+        const ShardedListenerOptions& options       = {},
+        const std::source_location& source_location = std::source_location::current()
+    )
+        : shard_cpus(cpus.begin(), cpus.end())
+        , location(source_location)
+    {
+        if (cpus.empty() || cpus.size() > max_shards || addrlen > sizeof(address))
+            throw_system_error(EINVAL, "ShardedListener::ShardedListener", source_location);
+        ::memcpy(&address, addr, addrlen);
+        address_length = addrlen;
+
+        shard_fds.reserve(cpus.size());
+        try
+        {
+            for (unsigned int cpu : shard_cpus)
+            {
+                shard_fds.push_back(GuardFW::socket(
+                    address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, source_location
+                ));
+                const FileDescriptor fd = shard_fds.back();
+                if (options.reuse_address)
+                    GuardFW::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, 1, source_location);
+                GuardFW::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, 1, source_location);
+                if (options.incoming_cpu)
+                    GuardFW::setsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, static_cast<int>(cpu), source_location);
+                GuardFW::bind(fd, reinterpret_cast<const struct sockaddr*>(&address), address_length, source_location);
+                if (shard_fds.size() == 1)  // further shards join the group on the same (ephemeral) port
+                    GuardFW::getsockname(
+                        fd, reinterpret_cast<struct sockaddr*>(&address), &address_length, source_location
+                    );
+                GuardFW::listen(fd, options.backlog, source_location);  // joins the group at the next index
+            }
+            if (options.steer_by_cpu)
+                attach_steering(source_location);
+        }
+        catch (...)
+        {
+            close_shards();
+            throw;
+        }
+    }
+
+    ShardedListener(const ShardedListener&)            = delete;
+    ShardedListener(ShardedListener&&)                 = delete;
+    ShardedListener& operator=(const ShardedListener&) = delete;
+    ShardedListener& operator=(ShardedListener&&)      = delete;
+
+    ~ShardedListener()
+    {
+        close_shards();
+    }
+
+    /// @return number of shards
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return shard_fds.size();
+    }
+
+    /// @return listening socket of a shard
+    [[nodiscard]] FileDescriptor socket(size_t shard) const noexcept
+    {
+        return shard_fds[shard];
+    }
+
+    /// @return CPU of a shard
+    [[nodiscard]] unsigned int cpu(size_t shard) const noexcept
+    {
+        return shard_cpus[shard];
+    }
+
+    /// @return first shard of a CPU, or std::nullopt, if the CPU has no shard
+    [[nodiscard]] std::optional<size_t> shard_of_cpu(unsigned int cpu) const noexcept
+    {
+        for (size_t shard = 0; shard < shard_cpus.size(); shard++)
+            if (shard_cpus[shard] == cpu)
+                return shard;
+        return std::nullopt;
+    }
+
+    /// @return bound local address, with the port selected by the kernel
+    [[nodiscard]] const struct sockaddr* local_address() const noexcept
+    {
+        return reinterpret_cast<const struct sockaddr*>(&address);
+    }
+
+    /// @return length of bound local address
+    [[nodiscard]] socklen_t local_address_length() const noexcept
+    {
+        return address_length;
+    }
+
+    /**
+     * Pins the calling thread to the CPU of a shard, so it serves the connections of this shard on their CPU.
+     *
+     * @param shard           Shard index.
+     * @param source_location Holds information about caller/calling position.
+     */
+    void pin(size_t shard, const std::source_location& source_location = std::source_location::current()) const
+    {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(shard_cpus[shard], &cpu_set);
+        GuardFW::sched_setaffinity(0, sizeof(cpu_set), &cpu_set, source_location);
+    }
+
+    /**
+     * Accepts a connection of a shard without blocking.
+     *
+     * @param shard           Shard index.
+     * @param flags           accept4() flags for the connected socket.
+     * @param source_location Holds information about caller/calling position.
+     * @return                connected socket, or std::nullopt, if no connection is pending
+     */
+    [[nodiscard]] std::optional<FileDescriptor> accept(
+        size_t shard,
+        int flags                                   = SOCK_NONBLOCK | SOCK_CLOEXEC,
+        const std::source_location& source_location = std::source_location::current()
+    ) const
+    {
+        return GuardFW::accept4_nonblock(shard_fds[shard], nullptr, nullptr, flags, source_location);
+    }
+
+private:
+    static constexpr size_t max_shards {(BPF_MAXINSNS - 2) / 2};  ///< limit of the steering program
+
+    /**
+     * Attaches a classic BPF program to the group, which returns the shard index of the receiving CPU.
+     * The kernel falls back to the connection hash for out-of-range indexes, i.e. for CPUs without shard.
+     */
+    void attach_steering(const std::source_location& source_location)
+    {
+        std::vector<struct sock_filter> program;
+        program.reserve(2 * shard_cpus.size() + 2);
+        program.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU)));
+        for (size_t shard = 0; shard < shard_cpus.size(); shard++)
+        {
+            program.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, shard_cpus[shard], 0, 1));
+            program.push_back(BPF_STMT(BPF_RET | BPF_K, static_cast<uint32_t>(shard)));
+        }
+        program.push_back(BPF_STMT(BPF_RET | BPF_K, UINT32_MAX));
+
+        const struct sock_fprog filter {
+            .len = static_cast<uint16_t>(program.size()), .filter = program.data(),
+        };
+        GuardFW::setsockopt(shard_fds.front(), SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, filter, source_location);
+    }
+
+    void close_shards()
+    {
+        for (FileDescriptor fd : shard_fds)
+            GuardFW::close(fd, location);
+        shard_fds.clear();
+    }
+
+    std::vector<unsigned int> shard_cpus;
+    std::vector<FileDescriptor> shard_fds;  ///< indexed like shard_cpus, also the index in the reuseport group
+    struct sockaddr_storage address {};
+    socklen_t address_length {0};
+    std::source_location location;  ///< location of construction, reported by errors during destruction
+};
+
+}  // namespace GuardFW
@@ -0,0 +1,591 @@
+/**
+ * Shared-memory message queue with the API of the POSIX message queue wrappers.
+ *
+ * The class ShmQueue transfers messages between threads or co-located processes through a shared mapping of a
+ * memfd or a shm_open() object. Senders claim slots of a lock-free ring and copy their message directly into the
+ * shared memory, the receiver copies it out again. Syscalls are only needed for blocking: waiting and waking up
+ * uses futexes, and waiters are only woken up if they announced to wait. Like POSIX message queues, messages are
+ * received in order of their priority, and messages of the same priority in FIFO order.
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+module;
+
+#include <fcntl.h>      // O_CREAT, O_RDWR
+#include <sys/mman.h>   // MFD_CLOEXEC
+#include <sys/stat.h>   // struct stat
+#include <sys/types.h>  // mode_t
+
+#include <atomic>           // std::atomic_ref<>
+#include <bit>              // std::bit_ceil(), std::has_single_bit()
+#include <cerrno>           // EMSGSIZE, EINVAL, ETIMEDOUT
+#include <climits>          // INT_MAX
+#include <cstddef>          // size_t, std::byte
+#include <cstdint>          // uint32_t, uint64_t
+#include <cstring>          // std::memcpy()
+#include <ctime>            // timespec
+#include <optional>         // std::optional<>
+#include <source_location>  // std::source_location
+
+export module guardfw.shm_queue;
+
+import guardfw.exceptions;
+import guardfw.file_desciptor;
+import guardfw.wrapper;
+import guardfw.wrapped_futex;
+import guardfw.wrapped_mman;
+import guardfw.wrapped_stat;
+import guardfw.wrapped_unistd;
+
+namespace GuardFW
+{
+
+/// Attributes of a ShmQueue, the counterpart of struct mq_attr.
+export struct ShmQueueAttributes
+{
+    size_t max_messages {10};     ///< maximum number of messages per priority, rounded up to a power of 2
+    size_t message_size {8192};   ///< maximum message size in bytes
+    unsigned int priorities {1};  ///< number of priorities, valid priorities are 0 to priorities - 1
+};
+
+/**
+ * Multi-producer/single-consumer message queue in shared memory.
+ *
+ * Any number of threads or processes may send, but only one thread at a time may receive. Each priority has its
+ * own ring, so a full ring of one priority does not block messages of other priorities.
+ */
+export class ShmQueue
+{
+public:
+    /**
+     * Creates an anonymous queue in a memfd, which can be inherited by child processes or passed with SCM_RIGHTS.
+     *
+     * @param attributes      Queue attributes.
+     * @param source_location Holds information about caller/calling position.
+     */
+    explicit ShmQueue(
+        const ShmQueueAttributes& attributes        = {},
+        const std::source_location& source_location = std::source_location::current()
+    )
+        : location(source_location)
+    {
+        segment_fd = GuardFW::memfd_create("guardfw-shm-queue", MFD_CLOEXEC, source_location);
+        initialize_or_attach(&attributes);
+    }
+
+    /**
+     * Attaches to the queue in a file descriptor, e.g. a memfd received from another process.
+     *
+     * @param fd              File descriptor of an initialized queue, remains owned by the caller.
+     * @param source_location Holds information about caller/calling position.
+     */
+    explicit ShmQueue(FileDescriptor fd, const std::source_location& source_location = std::source_location::current())
+        : location(source_location)
+        , segment_fd(fd)
+        , owns_fd(false)
+    {
+        initialize_or_attach(nullptr);
+    }
+
+    /**
+     * Opens an existing named queue, like mq_open().
+     *
+     * @param name            Name of the shared memory object, e.g. "/queue".
+     * @param oflag           Flags for shm_open(), O_RDWR is added.
+     * @param source_location Holds information about caller/calling position.
+     */
+    ShmQueue(const char* name, int oflag, const std::source_location& source_location = std::source_location::current())
+        : location(source_location)
+    {
+        segment_fd = GuardFW::shm_open(name, oflag | O_RDWR, 0, source_location);
+        initialize_or_attach(nullptr);
+    }
+
+    /**
+     * Opens or creates a named queue, like mq_open() with O_CREAT.
+     *
+     * An empty shared memory object is initialized with the attributes. If several processes may create the
+     * queue concurrently, O_EXCL should be used, as opening processes might see an incompletely initialized queue.
+     *
+     * @param name            Name of the shared memory object, e.g. "/queue".
+     * @param oflag           Flags for shm_open(), O_RDWR is added.
+     * @param mode            Permissions of a created shared memory object.
+     * @param attributes      Queue attributes, only used if the queue is created.
+     * @param source_location Holds information about caller/calling position.
+     */
+    ShmQueue(
+        const char* name,
+        int oflag,
+        mode_t mode,
+        const ShmQueueAttributes& attributes,
+        const std::source_location& source_location = std::source_location::current()
+    )
+        : location(source_location)
+    {
+        segment_fd = GuardFW::shm_open(name, oflag | O_RDWR, mode, source_location);
+        initialize_or_attach(&attributes);
+    }
+
+    ShmQueue(const ShmQueue&)            = delete;
+    ShmQueue(ShmQueue&&)                 = delete;
+    ShmQueue& operator=(const ShmQueue&) = delete;
+    ShmQueue& operator=(ShmQueue&&)      = delete;
+
+    ~ShmQueue()
+    {
+        if (segment != nullptr)
+            GuardFW::munmap(segment, segment_size, location);
+        if (owns_fd)
+            GuardFW::close(segment_fd, location);
+    }
+
+    /**
+     * Removes a named queue, like mq_unlink().
+     *
+     * @param name            Name of the shared memory object.
+     * @param source_location Holds information about caller/calling position.
+     */
+    static void unlink(const char* name, const std::source_location& source_location = std::source_location::current())
+    {
+        GuardFW::shm_unlink(name, source_location);
+    }
+
+    /**
+     * Sends a message, blocks while the ring of the priority is full.
+     *
+     * @param msg_ptr         Message.
+     * @param msg_len         Message length, must not exceed the message size.
+     * @param msg_prio        Message priority.
+     * @param source_location Holds information about caller/calling position.
+     */
+    void send(
+        const char* msg_ptr,
+        size_t msg_len,
+        unsigned int msg_prio,
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        (void) send_waiting(msg_ptr, msg_len, msg_prio, Wait::infinite, no_timeout, source_location);
+    }
+
+    /**
+     * Sends a message without blocking.
+     *
+     * @param msg_ptr         Message.
+     * @param msg_len         Message length, must not exceed the message size.
+     * @param msg_prio        Message priority.
+     * @param source_location Holds information about caller/calling position.
+     * @return                false if the ring of the priority is full
+     */
+    [[nodiscard]] bool send_nonblock(
+        const char* msg_ptr,
+        size_t msg_len,
+        unsigned int msg_prio,
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        return send_waiting(msg_ptr, msg_len, msg_prio, Wait::none, no_timeout, source_location);
+    }
+
+    /**
+     * Sends a message, blocks until the ring of the priority has space or the timeout has been reached.
+     *
+     * @param msg_ptr         Message.
+     * @param msg_len         Message length, must not exceed the message size.
+     * @param msg_prio        Message priority.
+     * @param abs_timeout     Absolute timeout based on CLOCK_REALTIME, like mq_timedsend().
+     * @param source_location Holds information about caller/calling position.
+     * @return                false on timeout
+     */
+    [[nodiscard]] bool timedsend(
+        const char* msg_ptr,
+        size_t msg_len,
+        unsigned int msg_prio,
+        const struct timespec* abs_timeout,
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        return send_waiting(msg_ptr, msg_len, msg_prio, Wait::timed, abs_timeout, source_location);
+    }
+
+    /**
+     * Receives the oldest message of the highest priority, blocks while the queue is empty.
+     *
+     * @param msg_ptr         Buffer for message.
+     * @param msg_len         Buffer size, must not be less than the message size.
+     * @param msg_prio        Receives the message priority, may be nullptr.
+     * @param source_location Holds information about caller/calling position.
+     * @return                message length
+     */
+    [[nodiscard]] size_t receive(
+        char* msg_ptr,
+        size_t msg_len,
+        unsigned int* msg_prio,
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        return receive_waiting(msg_ptr, msg_len, msg_prio, Wait::infinite, no_timeout, source_location).value();
+    }
+
+    /**
+     * Receives the oldest message of the highest priority without blocking.
+     *
+     * @param msg_ptr         Buffer for message.
+     * @param msg_len         Buffer size, must not be less than the message size.
+     * @param msg_prio        Receives the message priority, may be nullptr.
+     * @param source_location Holds information about caller/calling position.
+     * @return                message length or std::nullopt if the queue is empty
+     */
+    [[nodiscard]] std::optional<size_t> receive_nonblock(
+        char* msg_ptr,
+        size_t msg_len,
+        unsigned int* msg_prio,
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        return receive_waiting(msg_ptr, msg_len, msg_prio, Wait::none, no_timeout, source_location);
+    }
+
+    /**
+     * Receives the oldest message of the highest priority, blocks until a message arrives or the timeout has been
+     * reached.
+     *
+     * @param msg_ptr         Buffer for message.
+     * @param msg_len         Buffer size, must not be less than the message size.
+     * @param msg_prio        Receives the message priority, may be nullptr.
+     * @param abs_timeout     Absolute timeout based on CLOCK_REALTIME, like mq_timedreceive().
+     * @param source_location Holds information about caller/calling position.
+     * @return                message length or std::nullopt on timeout
+     */
+    [[nodiscard]] std::optional<size_t> timedreceive(
+        char* msg_ptr,
+        size_t msg_len,
+        unsigned int* msg_prio,
+        const struct timespec* abs_timeout,
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        return receive_waiting(msg_ptr, msg_len, msg_prio, Wait::timed, abs_timeout, source_location);
+    }
+
+    /// @return attributes of the queue, like mq_getattr(), max_messages is rounded up to a power of 2
+    [[nodiscard]] ShmQueueAttributes attributes() const noexcept
+    {
+        return {
+            .max_messages = header->capacity,
+            .message_size = header->message_size,
+            .priorities   = header->priorities,
+        };
+    }
+
+    /// @return file descriptor of the shared memory segment, e.g. for passing it to another process
+    [[nodiscard]] FileDescriptor fd() const noexcept
+    {
+        return segment_fd;
+    }
+
+private:
+    static constexpr size_t cache_line_size {64};
+    static constexpr uint64_t magic_value {0x4755'4152'4451'5545};  // "GUARDQUE"
+    static constexpr const struct timespec* no_timeout {nullptr};
+
+    enum class Wait : uint8_t { none, timed, infinite };
+
+    /// Shared header at the start of the segment.
+    struct alignas(cache_line_size) Header
+    {
+        uint64_t magic;  ///< set last during initialization
+        uint64_t capacity;
+        uint64_t message_size;
+        uint32_t priorities;
+        uint32_t slot_size;
+        alignas(cache_line_size) uint32_t posted;  ///< futex, incremented for each sent message
+        uint32_t receiver_waiting;
+        alignas(cache_line_size) uint32_t released;  ///< futex, incremented for each received message
+        uint32_t senders_waiting;
+    };
+
+    /// Shared ring control of a priority, followed by the slots.
+    struct alignas(cache_line_size) RingControl
+    {
+        uint64_t tail;                           ///< next position of senders
+        alignas(cache_line_size) uint64_t head;  ///< next position of receiver
+    };
+
+    /// Shared slot header, followed by the message.
+    struct SlotHeader
+    {
+        uint64_t sequence;  ///< position + 1 if filled, position if free for this round
+        uint64_t length;
+    };
+
+    template<typename T>
+    static std::atomic_ref<T> atomic(T& value) noexcept
+    {
+        return std::atomic_ref<T>(value);
+    }
+
+    static size_t round_up(size_t size) noexcept
+    {
+        return (size + cache_line_size - 1) & ~(cache_line_size - 1);
+    }
+
+    [[nodiscard]] size_t ring_size() const noexcept
+    {
+        return sizeof(RingControl) + header->capacity * header->slot_size;
+    }
+
+    [[nodiscard]] RingControl& ring(unsigned int priority) const noexcept
+    {
+        return *reinterpret_cast<RingControl*>(segment + sizeof(Header) + priority * ring_size());
+    }
+
+    [[nodiscard]] SlotHeader& slot(RingControl& control, uint64_t position) const noexcept
+    {
+        std::byte* const slots = reinterpret_cast<std::byte*>(&control) + sizeof(RingControl);
+        return *reinterpret_cast<SlotHeader*>(slots + (position & (header->capacity - 1)) * header->slot_size);
+    }
+
+    /// Maps the segment, initializes it if it is empty and attributes are given.
+    void initialize_or_attach(const ShmQueueAttributes* attributes)
+    {
+        try
+        {
+            struct stat status {};
+            GuardFW::fstat(segment_fd, &status, location);
+            segment_size = static_cast<size_t>(status.st_size);
+
+            if (segment_size == 0 && attributes != nullptr)
+                initialize(*attributes);
+            else
+                attach();
+        }
+        catch (...)
+        {
+            if (segment != nullptr)
+                GuardFW::munmap(segment, segment_size, location);
+            if (owns_fd)
+                GuardFW::close(segment_fd, location);
+            throw;
+        }
+    }
+
+    void initialize(const ShmQueueAttributes& attributes)
+    {
+        if (attributes.max_messages == 0 || attributes.message_size == 0 || attributes.priorities == 0)
+            throw_system_error(EINVAL, "ShmQueue", location);
+
+        const uint64_t capacity = std::bit_ceil(attributes.max_messages);
+        const size_t slot_size  = round_up(sizeof(SlotHeader) + attributes.message_size);
+        segment_size = sizeof(Header) + attributes.priorities * (sizeof(RingControl) + capacity * slot_size);
+        GuardFW::ftruncate(segment_fd, static_cast<off_t>(segment_size), location);
+        map();
+
+        header->capacity     = capacity;
+        header->message_size = attributes.message_size;
+        header->priorities   = attributes.priorities;
+        header->slot_size    = static_cast<uint32_t>(slot_size);
+        for (unsigned int priority = 0; priority < attributes.priorities; priority++)
+            for (uint64_t position = 0; position < capacity; position++)
+                slot(ring(priority), position).sequence = position;
+        atomic(header->magic).store(magic_value, std::memory_order_release);
+    }
+
+    void attach()
+    {
+        if (segment_size < sizeof(Header))
+            throw_system_error(EINVAL, "ShmQueue", location);
+        map();
+        if (atomic(header->magic).load(std::memory_order_acquire) != magic_value || !valid_header())
+            throw_system_error(EINVAL, "ShmQueue", location);
+    }
+
+    /// @return true, if the header of an attached segment describes rings, which fit into the segment
+    [[nodiscard]] bool valid_header() const noexcept
+    {
+        const uint64_t capacity = header->capacity;
+        const uint64_t slot     = header->slot_size;
+        if (!std::has_single_bit(capacity)  // slot() masks positions with capacity - 1
+            || slot < sizeof(SlotHeader) || slot % alignof(SlotHeader) != 0 || header->message_size == 0
+            || header->message_size > slot - sizeof(SlotHeader) || header->priorities == 0)
+            return false;
+
+        const size_t available = segment_size - sizeof(Header);  // checked against the header size before mapping
+        if (available < sizeof(RingControl) || capacity > (available - sizeof(RingControl)) / slot)
+            return false;  // also prevents an overflow of the ring size
+        return header->priorities <= available / ring_size();
+    }
+
+    void map()
+    {
+        segment = static_cast<std::byte*>(GuardFW::mmap(
+            nullptr,
+            segment_size,
+            constants::prot_read | constants::prot_write,
+            constants::map_shared,
+            segment_fd,
+            0,
+            location
+        ));
+        header = reinterpret_cast<Header*>(segment);
+    }
+
+    /// Copies a message into a free slot of the ring of its priority, fails if the ring is full.
+    bool try_send(const char* msg_ptr, size_t msg_len, unsigned int msg_prio) noexcept
+    {
+        RingControl& control = ring(msg_prio);
+        uint64_t position    = atomic(control.tail).load(std::memory_order_relaxed);
+        SlotHeader* target   = nullptr;
+        while (true)
+        {
+            target                  = &slot(control, position);
+            const uint64_t sequence = atomic(target->sequence).load(std::memory_order_acquire);
+            const int64_t distance  = static_cast<int64_t>(sequence - position);
+            if (distance == 0)
+            {
+                if (atomic(control.tail).compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (distance < 0)  // slot still holds a message of the previous round
+                return false;
+            else  // another sender has claimed the slot
+                position = atomic(control.tail).load(std::memory_order_relaxed);
+        }
+        std::memcpy(target + 1, msg_ptr, msg_len);
+        target->length = msg_len;
+        atomic(target->sequence).store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Copies the oldest message of the highest priority out of its slot, fails if all rings are empty.
+    std::optional<size_t> try_receive(char* msg_ptr, unsigned int* msg_prio) noexcept
+    {
+        for (unsigned int priority = header->priorities; priority-- > 0;)
+        {
+            RingControl& control    = ring(priority);
+            const uint64_t position = atomic(control.head).load(std::memory_order_relaxed);
+            SlotHeader& source      = slot(control, position);
+            if (atomic(source.sequence).load(std::memory_order_acquire) != position + 1)
+                continue;
+
+            const size_t length = source.length;
+            std::memcpy(msg_ptr, &source + 1, length);
+            atomic(source.sequence).store(position + header->capacity, std::memory_order_release);
+            atomic(control.head).store(position + 1, std::memory_order_relaxed);
+            if (msg_prio != nullptr)
+                *msg_prio = priority;
+            return length;
+        }
+        return std::nullopt;
+    }
+
+    /// Wakes up waiters of a futex, if any waiter announced itself.
+    void notify(uint32_t& futex, uint32_t& waiting, int count, const std::source_location& source_location) const
+    {
+        atomic(futex).fetch_add(1, std::memory_order_seq_cst);
+        if (atomic(waiting).load(std::memory_order_seq_cst) > 0)
+            (void) GuardFW::futex_wake(&futex, count, 0, source_location);
+    }
+
+    /**
+     * Repeats an operation and waits on a futex between the attempts.
+     *
+     * @return result of the operation or std::nullopt on timeout or if waiting is not allowed
+     */
+    template<typename OPERATION>
+    auto attempt(
+        OPERATION&& operation,
+        uint32_t& futex,
+        uint32_t& waiting,
+        Wait wait,
+        const struct timespec* abs_timeout,
+        const std::source_location& source_location
+    ) -> decltype(operation())
+    {
+        while (true)
+        {
+            if (auto result = operation(); result)
+                return result;
+            if (wait == Wait::none)
+                return {};
+
+            // announce waiting before the last attempt, so a concurrent notify() can not be missed
+            atomic(waiting).fetch_add(1, std::memory_order_seq_cst);
+            const uint32_t value = atomic(futex).load(std::memory_order_seq_cst);
+            auto result          = operation();
+            Error error          = no_error;
+            if (!result)
+                error =
+                    GuardFW::futex_wait(&futex, value, abs_timeout, constants::futex_clock_realtime, source_location);
+            atomic(waiting).fetch_sub(1, std::memory_order_seq_cst);
+            if (result)
+                return result;
+            if (error == ETIMEDOUT)
+                return {};
+        }
+    }
+
+    bool send_waiting(
+        const char* msg_ptr,
+        size_t msg_len,
+        unsigned int msg_prio,
+        Wait wait,
+        const struct timespec* abs_timeout,
+        const std::source_location& source_location
+    )
+    {
+        if (msg_len > header->message_size)
+            throw_system_error(EMSGSIZE, "ShmQueue::send", source_location);
+        if (msg_prio >= header->priorities)
+            throw_system_error(EINVAL, "ShmQueue::send", source_location);
+
+        const bool sent = attempt(
+            [this, msg_ptr, msg_len, msg_prio]() { return try_send(msg_ptr, msg_len, msg_prio); },
+            header->released,
+            header->senders_waiting,
+            wait,
+            abs_timeout,
+            source_location
+        );
+        if (sent)
+            notify(header->posted, header->receiver_waiting, 1, source_location);
+        return sent;
+    }
+
+    std::optional<size_t> receive_waiting(
+        char* msg_ptr,
+        size_t msg_len,
+        unsigned int* msg_prio,
+        Wait wait,
+        const struct timespec* abs_timeout,
+        const std::source_location& source_location
+    )
+    {
+        if (msg_len < header->message_size)
+            throw_system_error(EMSGSIZE, "ShmQueue::receive", source_location);
+
+        std::optional<size_t> received = attempt(
+            [this, msg_ptr, msg_prio]() { return try_receive(msg_ptr, msg_prio); },
+            header->posted,
+            header->receiver_waiting,
+            wait,
+            abs_timeout,
+            source_location
+        );
+        if (received.has_value())
+            notify(header->released, header->senders_waiting, INT_MAX, source_location);
+        return received;
+    }
+
+    std::source_location location;  ///< location of construction, reported by errors during destruction
+    FileDescriptor segment_fd {file_descriptor_invalid};
+    bool owns_fd {true};
+    std::byte* segment {nullptr};
+    size_t segment_size {0};
+    Header* header {nullptr};
+};
+
+}  // namespace GuardFW
@@ -0,0 +1,393 @@
+/**
+ * Opt-in per-function call statistics for wrapped Linux API & POSIX calls.
+ *
+ * Contexts with the flag ErrorSpecial::statistics count calls, errors by error number, EINTR repetitions and
+ * EAGAIN blockings and record a log-linear latency histogram for each wrapped function, keyed by its name.
+ * Counters are owned and written by a single thread each, so recording is lock-free. Readers aggregate all
+ * threads with statistics_snapshot(). Counters of terminated threads are preserved.
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+module;
+
+#include <algorithm>    // std::find(), std::ranges::find()
+#include <array>        // std::array<>
+#include <atomic>       // std::atomic<>
+#include <bit>          // std::bit_width()
+#include <chrono>       // std::chrono::steady_clock
+#include <cstddef>      // size_t
+#include <cstdint>      // uint64_t
+#include <memory>       // std::unique_ptr<>
+#include <mutex>        // std::mutex, std::lock_guard<>
+#include <string_view>  // std::string_view
+#include <utility>      // std::pair<>
+#include <vector>       // std::vector<>
+
+export module guardfw.statistics;
+
+import guardfw.traits;
+
+namespace GuardFW::statistics
+{
+
+export constexpr size_t max_functions {512};      ///< distinct function names, further names share the last slot
+export constexpr int max_error {256};             ///< error numbers >= max_error are counted as max_error - 1
+export constexpr unsigned int sub_bucket_bits {2};  ///< 4 linear sub-buckets per power of two
+export constexpr size_t histogram_buckets {(64 - sub_bucket_bits + 1) << sub_bucket_bits};
+
+/**
+ * Maps a latency to its log-linear histogram bucket.
+ *
+ * Values below 4 have their own bucket, larger values are split into 4 buckets per power of two.
+ *
+ * @param  nanoseconds Latency.
+ * @return             Bucket index, always < histogram_buckets.
+ */
+export constexpr size_t histogram_bucket(uint64_t nanoseconds) noexcept
+{
+    constexpr uint64_t sub_buckets {1U << sub_bucket_bits};
+    if (nanoseconds < sub_buckets)
+        return static_cast<size_t>(nanoseconds);
+    const unsigned int exponent = static_cast<unsigned int>(std::bit_width(nanoseconds)) - 1;
+    const uint64_t sub_bucket   = (nanoseconds >> (exponent - sub_bucket_bits)) & (sub_buckets - 1);
+    return static_cast<size_t>(((exponent - sub_bucket_bits + 1) << sub_bucket_bits) + sub_bucket);
+}
+
+/**
+ * Returns the lowest latency, which is mapped to a histogram bucket.
+ *
+ * @param  bucket Bucket index.
+ * @return        Lower bound of bucket in nanoseconds.
+ */
+export constexpr uint64_t histogram_lower_bound(size_t bucket) noexcept
+{
+    constexpr size_t sub_buckets {1U << sub_bucket_bits};
+    if (bucket < sub_buckets)
+        return bucket;
+    const size_t exponent   = (bucket >> sub_bucket_bits) + sub_bucket_bits - 1;
+    const size_t sub_bucket = bucket & (sub_buckets - 1);
+    return static_cast<uint64_t>(sub_buckets + sub_bucket) << (exponent - sub_bucket_bits);
+}
+
+/**
+ * Counters of a single function in a single thread.
+ *
+ * Only the owning thread writes, so increments are relaxed load/store pairs without locked instructions.
+ */
+struct FunctionCounters
+{
+    std::atomic<uint64_t> calls {0};
+    std::atomic<uint64_t> eintr_repeats {0};
+    std::atomic<uint64_t> eagain_blockings {0};
+    std::atomic<uint64_t> latency_sum_ns {0};
+    std::array<std::atomic<uint64_t>, max_error> errors {};
+    std::array<std::atomic<uint64_t>, histogram_buckets> latency {};
+};
+
+/// Single-writer increment, readers in other threads see either the old or the new value.
+[[gnu::always_inline]] inline void increment(std::atomic<uint64_t>& counter, uint64_t value = 1) noexcept
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+/**
+ * Statistics of all functions of a single thread.
+ */
+class ThreadStatistics
+{
+public:
+    ThreadStatistics();
+    ThreadStatistics(const ThreadStatistics&)            = delete;
+    ThreadStatistics(ThreadStatistics&&)                 = delete;
+    ThreadStatistics& operator=(const ThreadStatistics&) = delete;
+    ThreadStatistics& operator=(ThreadStatistics&&)      = delete;
+    ~ThreadStatistics();
+
+    /// Returns counters of a function, allocated on first use of the function in this thread.
+    [[gnu::always_inline]] inline FunctionCounters& counters(size_t function_id)
+    {
+        FunctionCounters* function_counters = slots[function_id].load(std::memory_order_acquire);
+        if (function_counters == nullptr) [[unlikely]]
+            function_counters = allocate(function_id);
+        return *function_counters;
+    }
+
+    /// Returns counters of a function, if they have been allocated, used by readers.
+    [[nodiscard]] const FunctionCounters* find(size_t function_id) const noexcept
+    {
+        return slots[function_id].load(std::memory_order_acquire);
+    }
+
+private:
+    FunctionCounters* allocate(size_t function_id);
+
+    std::array<std::atomic<FunctionCounters*>, max_functions> slots {};
+    std::vector<std::unique_ptr<FunctionCounters>> owned;
+};
+
+/// Global registry of function names, threads and counters of terminated threads.
+struct Registry
+{
+    std::mutex mutex;
+    std::vector<std::string_view> names;
+    std::vector<const ThreadStatistics*> threads;
+    std::array<std::unique_ptr<FunctionCounters>, max_functions> retired;
+};
+
+/// Function-local static, is constructed before and destroyed after all thread_local ThreadStatistics.
+Registry& registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+/// Adds counters of a terminated thread to the retired counters, registry must be locked.
+void retire(FunctionCounters& retired, const FunctionCounters& counters) noexcept
+{
+    auto add = [](std::atomic<uint64_t>& target, const std::atomic<uint64_t>& source) {
+        target.fetch_add(source.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    };
+    add(retired.calls, counters.calls);
+    add(retired.eintr_repeats, counters.eintr_repeats);
+    add(retired.eagain_blockings, counters.eagain_blockings);
+    add(retired.latency_sum_ns, counters.latency_sum_ns);
+    for (size_t index = 0; index < retired.errors.size(); index++)
+        add(retired.errors[index], counters.errors[index]);
+    for (size_t index = 0; index < retired.latency.size(); index++)
+        add(retired.latency[index], counters.latency[index]);
+}
+
+ThreadStatistics::ThreadStatistics()
+{
+    Registry& global = registry();
+    const std::lock_guard<std::mutex> lock(global.mutex);
+    global.threads.push_back(this);
+}
+
+ThreadStatistics::~ThreadStatistics()
+{
+    Registry& global = registry();
+    const std::lock_guard<std::mutex> lock(global.mutex);
+    for (size_t function_id = 0; function_id < max_functions; function_id++)
+    {
+        const FunctionCounters* function_counters = find(function_id);
+        if (function_counters == nullptr)
+            continue;
+        if (global.retired[function_id] == nullptr)
+            global.retired[function_id] = std::make_unique<FunctionCounters>();
+        retire(*global.retired[function_id], *function_counters);
+    }
+    std::erase(global.threads, this);
+}
+
+FunctionCounters* ThreadStatistics::allocate(size_t function_id)
+{
+    auto function_counters = std::make_unique<FunctionCounters>();
+    FunctionCounters* raw  = function_counters.get();
+
+    const std::lock_guard<std::mutex> lock(registry().mutex);  // owned is read by no one else, but keeps it simple
+    owned.push_back(std::move(function_counters));
+    slots[function_id].store(raw, std::memory_order_release);
+    return raw;
+}
+
+/// Counters of the calling thread.
+ThreadStatistics& thread_statistics()
+{
+    thread_local ThreadStatistics instance;
+    return instance;
+}
+
+/**
+ * Returns the unique id of a function name, adds the name on first use.
+ *
+ * @param  name Function name.
+ * @return      Function id, always < max_functions.
+ */
+size_t register_function(std::string_view name)
+{
+    Registry& global = registry();
+    const std::lock_guard<std::mutex> lock(global.mutex);
+
+    auto found = std::ranges::find(global.names, name);
+    if (found != global.names.end())
+        return static_cast<size_t>(found - global.names.begin());
+    if (global.names.size() == max_functions - 1)
+        global.names.emplace_back("(other)");  // last slot is shared by all further names
+    if (global.names.size() == max_functions)
+        return max_functions - 1;
+    global.names.push_back(name);
+    return global.names.size() - 1;
+}
+
+/**
+ * Returns the counters of a wrapped function for the calling thread.
+ *
+ * @tparam WRAPPED_FUNCTION Function pointer of wrapped function.
+ * @return                  Counters of calling thread.
+ */
+export template<auto WRAPPED_FUNCTION>
+[[gnu::always_inline]] inline FunctionCounters& function_counters()
+{
+    static const size_t function_id = register_function(name_of<WRAPPED_FUNCTION>());
+    return thread_statistics().counters(function_id);
+}
+
+/**
+ * Records a single wrapped call, used by Context::wrapper().
+ *
+ * The disabled primary template is empty, so all calls compile to nothing.
+ *
+ * @tparam ENABLED          Records statistics, if set.
+ * @tparam WRAPPED_FUNCTION Function pointer of wrapped function.
+ */
+export template<bool ENABLED, auto WRAPPED_FUNCTION>
+class CallStatistics
+{
+public:
+    [[gnu::always_inline]] inline void eintr_repeat() const noexcept {}
+    [[gnu::always_inline]] inline void eagain_blocking() const noexcept {}
+    [[gnu::always_inline]] inline void error(int) const noexcept {}
+};
+
+/**
+ * Records a single wrapped call, used by Context::wrapper(); here: specialization for enabled statistics.
+ *
+ * The call and its latency are recorded on destruction, which also covers thrown errors.
+ *
+ * @tparam WRAPPED_FUNCTION Function pointer of wrapped function.
+ */
+export template<auto WRAPPED_FUNCTION>
+class CallStatistics<true, WRAPPED_FUNCTION>
+{
+public:
+    CallStatistics()
+        : counters(function_counters<WRAPPED_FUNCTION>())
+        , start(std::chrono::steady_clock::now())
+    {}
+
+    CallStatistics(const CallStatistics&)            = delete;
+    CallStatistics(CallStatistics&&)                 = delete;
+    CallStatistics& operator=(const CallStatistics&) = delete;
+    CallStatistics& operator=(CallStatistics&&)      = delete;
+
+    ~CallStatistics()
+    {
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        const auto nanoseconds =
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        increment(counters.calls);
+        increment(counters.latency_sum_ns, nanoseconds);
+        increment(counters.latency[histogram_bucket(nanoseconds)]);
+    }
+
+    void eintr_repeat() noexcept
+    {
+        increment(counters.eintr_repeats);
+    }
+
+    void eagain_blocking() noexcept
+    {
+        increment(counters.eagain_blockings);
+    }
+
+    void error(int error_number) noexcept
+    {
+        const size_t index = (error_number >= 0 && error_number < max_error) ? static_cast<size_t>(error_number)
+                                                                             : static_cast<size_t>(max_error - 1);
+        increment(counters.errors[index]);
+    }
+
+private:
+    FunctionCounters& counters;
+    std::chrono::steady_clock::time_point start;
+};
+
+/**
+ * Aggregated statistics of a single function over all threads.
+ */
+export struct FunctionSnapshot
+{
+    std::string_view name;                                ///< name of wrapped function
+    uint64_t calls {0};                                   ///< completed calls, EINTR repetitions are not counted
+    uint64_t eintr_repeats {0};                           ///< repetitions caused by EINTR
+    uint64_t eagain_blockings {0};                        ///< prevented blockings (EAGAIN/EWOULDBLOCK)
+    uint64_t latency_sum_ns {0};                          ///< sum of all latencies
+    std::vector<std::pair<int, uint64_t>> errors;         ///< error number and count, only for occurred errors
+    std::array<uint64_t, histogram_buckets> latency {};  ///< latency histogram, see histogram_lower_bound()
+
+    /**
+     * Estimates a latency percentile from the histogram.
+     *
+     * @param  percentile Percentile between 0.0 and 100.0.
+     * @return            Lower bound of the bucket containing the percentile in nanoseconds.
+     */
+    [[nodiscard]] uint64_t latency_percentile(double percentile) const noexcept
+    {
+        const auto rank = static_cast<uint64_t>(static_cast<double>(calls) * percentile / 100.0);
+        uint64_t seen   = 0;
+        for (size_t bucket = 0; bucket < latency.size(); bucket++)
+        {
+            seen += latency[bucket];
+            if (seen > rank)
+                return histogram_lower_bound(bucket);
+        }
+        return 0;
+    }
+};
+
+/// Adds counters to a snapshot.
+void accumulate(FunctionSnapshot& snapshot, const FunctionCounters& counters)
+{
+    snapshot.calls += counters.calls.load(std::memory_order_relaxed);
+    snapshot.eintr_repeats += counters.eintr_repeats.load(std::memory_order_relaxed);
+    snapshot.eagain_blockings += counters.eagain_blockings.load(std::memory_order_relaxed);
+    snapshot.latency_sum_ns += counters.latency_sum_ns.load(std::memory_order_relaxed);
+    for (size_t bucket = 0; bucket < histogram_buckets; bucket++)
+        snapshot.latency[bucket] += counters.latency[bucket].load(std::memory_order_relaxed);
+    for (int error = 0; error < max_error; error++)
+    {
+        const uint64_t count = counters.errors[static_cast<size_t>(error)].load(std::memory_order_relaxed);
+        if (count == 0)
+            continue;
+        auto found = std::ranges::find(snapshot.errors, error, &std::pair<int, uint64_t>::first);
+        if (found != snapshot.errors.end())
+            found->second += count;
+        else
+            snapshot.errors.emplace_back(error, count);
+    }
+}
+
+/**
+ * Aggregates the statistics of all running and terminated threads.
+ *
+ * Counters of running threads are read without stopping them, so the snapshot is not an atomic cut.
+ *
+ * @return Statistics of all functions, which have been called with an instrumented context.
+ */
+export std::vector<FunctionSnapshot> statistics_snapshot()
+{
+    Registry& global = registry();
+    const std::lock_guard<std::mutex> lock(global.mutex);
+
+    std::vector<FunctionSnapshot> snapshots(global.names.size());
+    for (size_t function_id = 0; function_id < global.names.size(); function_id++)
+    {
+        FunctionSnapshot& snapshot = snapshots[function_id];
+        snapshot.name              = global.names[function_id];
+        if (global.retired[function_id] != nullptr)
+            accumulate(snapshot, *global.retired[function_id]);
+        for (const ThreadStatistics* thread : global.threads)
+        {
+            const FunctionCounters* counters = thread->find(function_id);
+            if (counters != nullptr)
+                accumulate(snapshot, *counters);
+        }
+    }
+    return snapshots;
+}
+
+}  // namespace GuardFW::statistics
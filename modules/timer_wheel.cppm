@@ -0,0 +1,430 @@
+/**
+ * Hierarchical timing wheel on a single timerfd.
+ *
+ * The class TimerWheel sorts timers into 4 levels of 256 slots each, so scheduling and cancelling a timer are O(1)
+ * operations on intrusive lists without any allocation. All timers share one timerfd, which is only reprogrammed
+ * with timerfd_settime() when the earliest occupied slot changes. The timerfd can be waited for with epoll, a
+ * TimerWheel can be registered directly at a Reactor.
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+module;
+
+#include <time.h>  // timespec, itimerspec
+
+#include <algorithm>        // std::min(), std::max()
+#include <array>            // std::array<>
+#include <bit>              // std::countr_zero()
+#include <chrono>           // std::chrono::nanoseconds
+#include <cstddef>          // size_t
+#include <cstdint>          // uint16_t, uint32_t, uint64_t
+#include <limits>           // std::numeric_limits<>
+#include <source_location>  // std::source_location
+
+export module guardfw.timer_wheel;
+
+import guardfw.file_desciptor;
+import guardfw.reactor;
+import guardfw.wrapped_time;
+import guardfw.wrapped_timerfd;
+import guardfw.wrapped_unistd;
+
+namespace GuardFW
+{
+
+export class TimerWheel;
+
+/// Links of an intrusive circular list, also used as list head of a wheel slot.
+struct TimerLink
+{
+    TimerLink* prev {nullptr};
+    TimerLink* next {nullptr};
+};
+
+/**
+ * Intrusive timer, derived classes implement the expiration.
+ *
+ * A timer is armed at most once, scheduling an armed timer again reschedules it. Destroying an armed timer cancels it.
+ */
+export class Timer : private TimerLink
+{
+public:
+    Timer()                        = default;
+    Timer(const Timer&)            = delete;
+    Timer(Timer&&)                 = delete;
+    Timer& operator=(const Timer&) = delete;
+    Timer& operator=(Timer&&)      = delete;
+    virtual ~Timer();
+
+    /**
+     * Handles the expiration, the timer is already disarmed and may be scheduled again.
+     *
+     * @param wheel Timing wheel, at which the timer was scheduled.
+     */
+    virtual void on_expired(TimerWheel& wheel) = 0;
+
+    /// @return true if the timer is scheduled and not yet expired
+    [[nodiscard]] bool armed() const noexcept
+    {
+        return wheel != nullptr;
+    }
+
+private:
+    friend class TimerWheel;
+
+    TimerWheel* wheel {nullptr};
+    uint64_t expiry {0};  ///< tick of expiration
+    uint16_t slot {0};    ///< index of list head in TimerWheel::heads
+};
+
+/**
+ * Timing wheel with 4 levels of 256 slots, which covers 2^32 ticks before timers have to be cascaded once more.
+ *
+ * Timers are fired from expire(), after the timerfd became readable. Slots of higher levels are cascaded into
+ * lower levels when their time range is reached, so the timerfd also expires at these cascading points.
+ * The wheel is not thread-safe, it is intended to be used by the thread of a Reactor.
+ */
+export class TimerWheel : public EventHandler
+{
+public:
+    static constexpr size_t levels    = 4;
+    static constexpr size_t slot_bits = 8;
+    static constexpr size_t slots     = size_t {1} << slot_bits;  ///< slots per level
+
+    /**
+     * Creates the timerfd.
+     *
+     * @param resolution      Duration of a tick, timers expire at tick boundaries.
+     * @param clock           Clock of timerfd and deadlines, e.g. constants::clock_monotonic or clock_boottime.
+     * @param source_location Holds information about caller/calling position.
+     */
+    explicit TimerWheel(
+        std::chrono::nanoseconds resolution         = std::chrono::milliseconds(1),
+        constants::Clock clock                      = constants::clock_monotonic,
+        const std::source_location& source_location = std::source_location::current()
+    )
+        : tick_ns(static_cast<uint64_t>(std::max(resolution.count(), std::chrono::nanoseconds::rep {1})))
+        , clockid(clock)
+        , location(source_location)
+    {
+        for (TimerLink& head : heads)
+            head.prev = head.next = &head;
+        origin_ns = clock_ns(source_location);
+        timer_fd  = GuardFW::timerfd_create(clockid, constants::tfd_nonblock | constants::tfd_cloexec, source_location);
+    }
+
+    TimerWheel(const TimerWheel&)            = delete;
+    TimerWheel(TimerWheel&&)                 = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+    TimerWheel& operator=(TimerWheel&&)      = delete;
+
+    /// Disarms all remaining timers and closes the timerfd.
+    ~TimerWheel() override
+    {
+        for (TimerLink& head : heads)
+        {
+            while (head.next != &head)
+            {
+                Timer& timer = *static_cast<Timer*>(head.next);
+                head.next    = timer.next;
+                timer.prev = timer.next = nullptr;
+                timer.wheel             = nullptr;
+            }
+        }
+        GuardFW::close(timer_fd, location);
+    }
+
+    /**
+     * Schedules or reschedules a timer.
+     *
+     * @param timer           Timer, must stay valid until it expires, is cancelled or destroyed.
+     * @param timeout         Minimum time until expiration, rounded up to the next tick.
+     * @param source_location Holds information about caller/calling position.
+     */
+    void schedule(
+        Timer& timer,
+        std::chrono::nanoseconds timeout,
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        cancel(timer);
+        const uint64_t delay    = static_cast<uint64_t>(std::max(timeout.count(), std::chrono::nanoseconds::rep {0}));
+        const uint64_t deadline = clock_ns(source_location) - origin_ns + delay;
+        timer.expiry            = std::max((deadline + tick_ns - 1) / tick_ns, current + 1);
+        insert(timer);
+        reprogram(source_location);
+    }
+
+    /**
+     * Cancels a timer, nothing happens if the timer is not armed.
+     *
+     * The timerfd is not reprogrammed, so cancelling the earliest timer may cause one spurious expiration.
+     *
+     * @param timer Timer.
+     */
+    void cancel(Timer& timer) noexcept
+    {
+        if (timer.wheel != this)
+            return;
+        unlink(timer);
+        if (heads[timer.slot].next == &heads[timer.slot])
+            bitmaps[timer.slot / slots][(timer.slot % slots) / 64] &= ~(uint64_t {1} << (timer.slot % 64));
+    }
+
+    /**
+     * Fires all expired timers and reprograms the timerfd, to be called when the timerfd is readable.
+     *
+     * If a timer handler throws, the exception is propagated and the remaining expired timers are fired by the
+     * next call.
+     *
+     * @param source_location Holds information about caller/calling position.
+     * @return                number of fired timers
+     */
+    size_t expire(const std::source_location& source_location = std::source_location::current())
+    {
+        uint64_t expirations = 0;
+        (void) GuardFW::read_nonblock(timer_fd, &expirations, sizeof(expirations), source_location);
+
+        const uint64_t now = (clock_ns(source_location) - origin_ns) / tick_ns;
+        if (programmed <= now)  // timerfd has expired
+            programmed = no_tick;
+
+        size_t fired = 0;
+        while (current < now)
+        {
+            const uint64_t next = next_tick();
+            if (next > now)
+            {
+                current = now;
+                break;
+            }
+            current = next;  // nothing happens between the current and the next tick
+            if ((current & slot_mask) == 0)
+                cascade(1);
+            fired += fire(current & slot_mask, source_location);
+        }
+        reprogram(source_location);
+        return fired;
+    }
+
+    /// Calls expire() for a registration at a Reactor with EPOLLIN.
+    void on_events(Reactor&, FileDescriptor, uint32_t) override
+    {
+        (void) expire(location);
+    }
+
+    /// @return timerfd, e.g. for registration at a Reactor
+    [[nodiscard]] FileDescriptor fd() const noexcept
+    {
+        return timer_fd;
+    }
+
+    /// @return number of armed timers
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return armed_count;
+    }
+
+    /// @return duration of a tick
+    [[nodiscard]] std::chrono::nanoseconds resolution() const noexcept
+    {
+        return std::chrono::nanoseconds(tick_ns);
+    }
+
+private:
+    static constexpr uint64_t slot_mask {slots - 1};
+    static constexpr uint64_t no_tick {std::numeric_limits<uint64_t>::max()};
+    static constexpr uint64_t nanoseconds_per_second {1'000'000'000};
+    static constexpr struct itimerspec* no_old_value {nullptr};
+
+    using Bitmap = std::array<uint64_t, slots / 64>;
+
+    [[nodiscard]] uint64_t clock_ns(const std::source_location& source_location) const
+    {
+        struct timespec now {};
+        GuardFW::clock_gettime(clockid, &now, source_location);
+        return static_cast<uint64_t>(now.tv_sec) * nanoseconds_per_second + static_cast<uint64_t>(now.tv_nsec);
+    }
+
+    void unlink(Timer& timer) noexcept
+    {
+        timer.prev->next = timer.next;
+        timer.next->prev = timer.prev;
+        timer.prev = timer.next = nullptr;
+        timer.wheel             = nullptr;
+        armed_count--;
+    }
+
+    /// Adds a timer to the slot, which matches its distance to the current tick.
+    void insert(Timer& timer) noexcept
+    {
+        const uint64_t delta = timer.expiry - current;
+        size_t level         = 0;
+        while (level < levels - 1 && delta >= (uint64_t {1} << (slot_bits * (level + 1))))
+            level++;
+        const size_t index = (timer.expiry >> (slot_bits * level)) & slot_mask;
+
+        TimerLink& head = heads[level * slots + index];
+        timer.prev      = head.prev;
+        timer.next      = &head;
+        head.prev->next = &timer;
+        head.prev       = &timer;
+        timer.wheel     = this;
+        timer.slot      = static_cast<uint16_t>(level * slots + index);
+        armed_count++;
+        bitmaps[level][index / 64] |= uint64_t {1} << (index % 64);
+    }
+
+    /// Moves all timers of a slot into a local list head, which must not be moved until it is empty.
+    void take(size_t slot, TimerLink& list) noexcept
+    {
+        TimerLink& head = heads[slot];
+        if (head.next == &head)
+        {
+            list.prev = list.next = &list;
+            return;
+        }
+        list.next       = head.next;
+        list.prev       = head.prev;
+        list.next->prev = &list;
+        list.prev->next = &list;
+        head.prev = head.next = &head;
+        bitmaps[slot / slots][(slot % slots) / 64] &= ~(uint64_t {1} << (slot % 64));
+    }
+
+    /// Re-inserts the timers of the slot of a level, which starts at the current tick. Higher levels go first.
+    void cascade(size_t level) noexcept
+    {
+        const size_t index = (current >> (slot_bits * level)) & slot_mask;
+        if (index == 0 && level < levels - 1)
+            cascade(level + 1);
+
+        TimerLink list;
+        take(level * slots + index, list);
+        while (list.next != &list)
+        {
+            Timer& timer = *static_cast<Timer*>(list.next);
+            unlink(timer);
+            insert(timer);
+        }
+    }
+
+    /// Fires the timers of a slot of level 0, expiration handlers may schedule and cancel any timer.
+    size_t fire(size_t index, const std::source_location& source_location)
+    {
+        TimerLink list;
+        take(index, list);
+        size_t fired = 0;
+        try
+        {
+            while (list.next != &list)
+            {
+                Timer& timer = *static_cast<Timer*>(list.next);
+                unlink(timer);
+                if (timer.expiry > current)  // not expected, level 0 only holds timers of the next 256 ticks
+                {
+                    insert(timer);
+                    continue;
+                }
+                fired++;
+                timer.on_expired(*this);
+            }
+        }
+        catch (...)
+        {
+            current--;  // next expire() fires this slot again
+            while (list.next != &list)
+            {
+                Timer& timer = *static_cast<Timer*>(list.next);
+                unlink(timer);
+                insert(timer);
+            }
+            programmed = no_tick;
+            reprogram(source_location);
+            throw;
+        }
+        return fired;
+    }
+
+    /// @return index of first set bit at or after a start index with wrap-around, slots if no bit is set
+    static size_t find_slot(const Bitmap& bitmap, size_t start) noexcept
+    {
+        for (size_t offset = 0; offset <= bitmap.size(); offset++)
+        {
+            const size_t word = (start / 64 + offset) % bitmap.size();
+            uint64_t bits     = bitmap[word];
+            if (offset == 0)
+                bits &= ~uint64_t {0} << (start % 64);
+            else if (offset == bitmap.size())
+                bits &= ~(~uint64_t {0} << (start % 64));
+            if (bits != 0)
+                return word * 64 + static_cast<size_t>(std::countr_zero(bits));
+        }
+        return slots;
+    }
+
+    /**
+     * Determines the next tick, at which a slot of level 0 expires or a slot of a higher level is cascaded.
+     *
+     * @return next tick or no_tick if no timer is armed
+     */
+    [[nodiscard]] uint64_t next_tick() const noexcept
+    {
+        uint64_t next = no_tick;
+        for (size_t level = 0; level < levels; level++)
+        {
+            const size_t shift   = slot_bits * level;
+            const uint64_t index = (current >> shift) & slot_mask;
+            const size_t found   = find_slot(bitmaps[level], (index + 1) & slot_mask);
+            if (found == slots)
+                continue;
+
+            const uint64_t cycle = uint64_t {1} << (shift + slot_bits);
+            uint64_t tick        = (current & ~(cycle - 1)) + (uint64_t {found} << shift);
+            if (found <= index)
+                tick += cycle;
+            next = std::min(next, tick);
+        }
+        return next;
+    }
+
+    /// Programs the timerfd to the next tick, if it has changed.
+    void reprogram(const std::source_location& source_location)
+    {
+        const uint64_t next = next_tick();
+        if (next == programmed)
+            return;
+
+        struct itimerspec value {};  // zero disarms the timerfd
+        if (next != no_tick)
+        {
+            const uint64_t deadline = origin_ns + next * tick_ns;
+            value.it_value.tv_sec   = static_cast<time_t>(deadline / nanoseconds_per_second);
+            value.it_value.tv_nsec  = static_cast<long>(deadline % nanoseconds_per_second);
+        }
+        GuardFW::timerfd_settime(timer_fd, constants::tfd_timer_abstime, &value, no_old_value, source_location);
+        programmed = next;
+    }
+
+    uint64_t tick_ns;
+    constants::Clock clockid;
+    std::source_location location;  ///< location of construction, reported by errors during destruction
+    FileDescriptor timer_fd {file_descriptor_invalid};
+    uint64_t origin_ns {0};         ///< clock time of tick 0
+    uint64_t current {0};           ///< last processed tick
+    uint64_t programmed {no_tick};  ///< tick, to which the timerfd is programmed
+    size_t armed_count {0};
+    std::array<TimerLink, levels * slots> heads;
+    std::array<Bitmap, levels> bitmaps {};  ///< occupied slots per level
+};
+
+Timer::~Timer()
+{
+    if (wheel != nullptr)
+        wheel->cancel(*this);
+}
+
+}  // namespace GuardFW
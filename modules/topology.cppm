@@ -0,0 +1,318 @@
+/**
+ * CPU and NUMA topology for node-local thread placement.
+ *
+ * Topology parses /sys/devices/system/node and /sys/devices/system/cpu once. pin_thread() pins the calling thread
+ * to a CPU of a NUMA node and makes the node the preferred node for its memory, so memory, which is faulted in
+ * afterwards by this thread (e.g. a HugePageArena constructed by it), is node-local. bind() binds existing
+ * mappings like shared buffers to a node.
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+module;
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <fcntl.h>  // O_RDONLY, O_CLOEXEC
+#include <sched.h>  // cpu_set_t, CPU_ZERO(), CPU_SET(), CPU_SETSIZE
+
+#include <algorithm>        // std::sort(), std::find(), std::count_if()
+#include <cerrno>           // EINVAL, ENOENT
+#include <climits>          // CHAR_BIT
+#include <cstddef>          // size_t
+#include <source_location>  // std::source_location
+#include <span>             // std::span<>
+#include <string>           // std::string, std::to_string()
+#include <string_view>      // std::string_view
+#include <system_error>     // std::system_error
+#include <tuple>            // std::tie()
+#include <utility>          // std::pair<>
+#include <vector>           // std::vector<>
+
+export module guardfw.topology;
+
+import guardfw.exceptions;
+import guardfw.file_desciptor;
+import guardfw.wrapped_fcntl;
+import guardfw.wrapped_mempolicy;
+import guardfw.wrapped_sched;
+import guardfw.wrapped_unistd;
+
+namespace GuardFW
+{
+
+/// Location of an online CPU.
+export struct Cpu
+{
+    unsigned int id {0};       ///< CPU number, as used by sched_setaffinity()
+    unsigned int node {0};     ///< NUMA node
+    unsigned int package {0};  ///< physical package (socket)
+    unsigned int core {0};     ///< core within the package, shared by SMT siblings
+};
+
+/**
+ * Parsed CPU and NUMA topology.
+ */
+export class Topology
+{
+public:
+    /**
+     * Parses the topology.
+     *
+     * Without NUMA support in the kernel, all online CPUs are assigned to node 0.
+     *
+     * @param sysfs_root      Directory with the node and cpu subdirectories.
+     * @param source_location Holds information about caller/calling position.
+     */
+    explicit Topology(
+        const std::string& sysfs_root               = "/sys/devices/system",
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        for (unsigned int id : parse_list(read_file(sysfs_root + "/cpu/online", source_location)))
+        {
+            const std::string topology = sysfs_root + "/cpu/cpu" + std::to_string(id) + "/topology/";
+            cpu_list.push_back({
+                .id      = id,
+                .node    = 0,
+                .package = read_number(topology + "physical_package_id", source_location),
+                .core    = read_number(topology + "core_id", source_location),
+            });
+        }
+
+        try
+        {
+            node_ids = parse_list(read_file(sysfs_root + "/node/online", source_location));
+        }
+        catch (const std::system_error& error)
+        {
+            if (error.code().value() != ENOENT)
+                throw;
+            node_ids = {0};
+        }
+
+        node_cpus.resize(node_ids.size());
+        for (size_t index = 0; index < node_ids.size(); index++)
+        {
+            const std::string cpulist = sysfs_root + "/node/node" + std::to_string(node_ids[index]) + "/cpulist";
+            if (node_ids.size() > 1)
+            {
+                for (unsigned int id : parse_list(read_file(cpulist, source_location)))
+                    for (Cpu& cpu : cpu_list)
+                        if (cpu.id == id)
+                            cpu.node = node_ids[index];
+            }
+            for (const Cpu& cpu : cpu_list)
+                if (cpu.node == node_ids[index])
+                    node_cpus[index].push_back(cpu);
+            order_cores_first(node_cpus[index]);
+        }
+    }
+
+    /**
+     * Returns the topology of the system, which is parsed on the first call.
+     *
+     * @param source_location Holds information about caller/calling position.
+     * @return                topology of the system
+     */
+    [[nodiscard]] static const Topology& system(
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        static const Topology topology("/sys/devices/system", source_location);
+        return topology;
+    }
+
+    /// @return online CPUs, ordered by number
+    [[nodiscard]] std::span<const Cpu> cpus() const noexcept
+    {
+        return cpu_list;
+    }
+
+    /// @return online NUMA nodes, including nodes with memory only
+    [[nodiscard]] std::span<const unsigned int> nodes() const noexcept
+    {
+        return node_ids;
+    }
+
+    /**
+     * Returns the CPUs of a node, one CPU of each core first, then their SMT siblings.
+     *
+     * @param node NUMA node.
+     * @return     CPUs of the node, empty for unknown nodes and nodes without CPUs
+     */
+    [[nodiscard]] std::span<const Cpu> cpus_of_node(unsigned int node) const noexcept
+    {
+        const auto found = std::find(node_ids.begin(), node_ids.end(), node);
+        if (found == node_ids.end())
+            return {};
+        return node_cpus[static_cast<size_t>(found - node_ids.begin())];
+    }
+
+    /**
+     * Pins the calling thread to a CPU of a node and prefers the node for its memory allocations.
+     *
+     * Threads with consecutive indexes are distributed over the cores before SMT siblings are used.
+     *
+     * @param node            NUMA node.
+     * @param index           Index of the thread, e.g. of a worker, selects the CPU.
+     * @param source_location Holds information about caller/calling position.
+     * @return                CPU, to which the thread has been pinned
+     */
+    unsigned int pin_thread(
+        unsigned int node,
+        size_t index,
+        const std::source_location& source_location = std::source_location::current()
+    ) const
+    {
+        const std::span<const Cpu> candidates = cpus_of_node(node);
+        if (candidates.empty())
+            throw_system_error(EINVAL, "Topology::pin_thread", source_location);
+        const unsigned int cpu = candidates[index % candidates.size()].id;
+        if (cpu >= CPU_SETSIZE)  // not representable in cpu_set_t
+            throw_system_error(EINVAL, "Topology::pin_thread", source_location);
+
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(cpu, &cpu_set);
+        GuardFW::sched_setaffinity(0, sizeof(cpu_set), &cpu_set, source_location);
+
+        const std::vector<unsigned long> mask = node_mask(node);
+        GuardFW::set_mempolicy(constants::mpol_preferred, mask.data(), max_node(mask), source_location);
+        return cpu;
+    }
+
+    /**
+     * Binds a memory range to a node and migrates its existing pages there.
+     *
+     * @param addr            Page-aligned start of the range.
+     * @param length          Length of the range.
+     * @param node            NUMA node.
+     * @param source_location Holds information about caller/calling position.
+     */
+    void bind(
+        void* addr,
+        size_t length,
+        unsigned int node,
+        const std::source_location& source_location = std::source_location::current()
+    ) const
+    {
+        const std::vector<unsigned long> mask = node_mask(node);
+        GuardFW::mbind(
+            addr, length, constants::mpol_bind, mask.data(), max_node(mask), constants::mpol_mf_move, source_location
+        );
+    }
+
+private:
+    static constexpr size_t mask_bits {sizeof(unsigned long) * CHAR_BIT};
+
+    /// @return node mask with a single node
+    static std::vector<unsigned long> node_mask(unsigned int node)
+    {
+        std::vector<unsigned long> mask(node / mask_bits + 1, 0);
+        mask[node / mask_bits] = 1UL << (node % mask_bits);
+        return mask;
+    }
+
+    /// @return maxnode argument for a node mask
+    static unsigned long max_node(const std::vector<unsigned long>& mask) noexcept
+    {
+        return mask.size() * mask_bits + 1;
+    }
+
+    /// @return content of a sysfs file
+    static std::string read_file(const std::string& path, const std::source_location& source_location)
+    {
+        const FileDescriptor fd = GuardFW::open(path.c_str(), O_RDONLY | O_CLOEXEC, source_location);
+        std::string content;
+        // NOLINTNEXTLINE(*-avoid-c-arrays): C-array granted here
+        char buffer[4096];
+        try
+        {
+            for (size_t length = GuardFW::read(fd, buffer, sizeof(buffer), source_location); length > 0;
+                 length        = GuardFW::read(fd, buffer, sizeof(buffer), source_location))
+                content.append(buffer, length);
+        }
+        catch (...)
+        {
+            GuardFW::close(fd, source_location);
+            throw;
+        }
+        GuardFW::close(fd, source_location);
+        return content;
+    }
+
+    /// @return number in a sysfs file, 0 if the file does not exist
+    static unsigned int read_number(const std::string& path, const std::source_location& source_location)
+    {
+        try
+        {
+            const std::vector<unsigned int> numbers = parse_list(read_file(path, source_location));
+            return numbers.empty() ? 0 : numbers.front();
+        }
+        catch (const std::system_error& error)
+        {
+            if (error.code().value() != ENOENT)
+                throw;
+            return 0;
+        }
+    }
+
+    /// @return numbers of a list like "0-3,8,10-11"
+    static std::vector<unsigned int> parse_list(std::string_view list)
+    {
+        std::vector<unsigned int> numbers;
+        size_t position = 0;
+        auto parse_number = [&list, &position]() {
+            unsigned int number = 0;
+            while (position < list.size() && list[position] >= '0' && list[position] <= '9')
+                number = number * 10 + static_cast<unsigned int>(list[position++] - '0');
+            return number;
+        };
+        while (position < list.size() && list[position] >= '0' && list[position] <= '9')
+        {
+            const unsigned int first = parse_number();
+            unsigned int last        = first;
+            if (position < list.size() && list[position] == '-')
+            {
+                position++;
+                last = parse_number();
+            }
+            for (unsigned int number = first; number <= last; number++)
+                numbers.push_back(number);
+            if (position < list.size() && list[position] == ',')
+                position++;
+        }
+        return numbers;
+    }
+
+    /// Orders CPUs by their SMT rank within their core, then by package, core and number.
+    static void order_cores_first(std::vector<Cpu>& cpus)
+    {
+        // the rank is computed before sorting, as the sort moves the elements, which a rank would be counted from
+        std::vector<std::pair<size_t, Cpu>> ranked;
+        ranked.reserve(cpus.size());
+        for (const Cpu& cpu : cpus)
+        {
+            const auto rank = std::count_if(cpus.begin(), cpus.end(), [&cpu](const Cpu& other) {
+                return other.package == cpu.package && other.core == cpu.core && other.id < cpu.id;
+            });
+            ranked.emplace_back(static_cast<size_t>(rank), cpu);
+        }
+        std::sort(ranked.begin(), ranked.end(), [](const auto& left, const auto& right) {
+            return std::tie(left.first, left.second.package, left.second.core, left.second.id)
+                 < std::tie(right.first, right.second.package, right.second.core, right.second.id);
+        });
+        for (size_t index = 0; index < cpus.size(); index++)
+            cpus[index] = ranked[index].second;
+    }
+
+    std::vector<Cpu> cpu_list;
+    std::vector<unsigned int> node_ids;
+    std::vector<std::vector<Cpu>> node_cpus;  ///< indexed like node_ids
+};
+
+}  // namespace GuardFW
@@ -0,0 +1,190 @@
+/**
+ * Full-transfer loops for vectored I/O.
+ *
+ * Vectored reads and writes may transfer less data than requested. The helpers in this module repeat the wrapped
+ * calls and advance the caller's iovec array in place across partial transfers, so no data is copied.
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+module;
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <limits.h>   // IOV_MAX
+#include <sys/uio.h>  // iovec
+
+#include <algorithm>        // std::min()
+#include <cerrno>           // EIO
+#include <cstddef>          // size_t, std::byte
+#include <source_location>  // std::source_location
+#include <span>             // std::span<>
+
+export module guardfw.vectored_io;
+
+import guardfw.exceptions;
+import guardfw.file_desciptor;
+import guardfw.wrapped_uio;
+
+namespace GuardFW
+{
+
+/// Number of iovec entries per call, limited by IOV_MAX.
+int iovec_count(std::span<struct iovec> iovecs) noexcept
+{
+    return static_cast<int>(std::min<size_t>(iovecs.size(), IOV_MAX));
+}
+
+/// @return file offset after a number of transferred bytes, an offset of -1 keeps using the current file position
+off_t offset_after(off_t offset, size_t bytes) noexcept
+{
+    return (offset == -1) ? offset : offset + static_cast<off_t>(bytes);
+}
+
+/**
+ * Advances an iovec array by a number of transferred bytes.
+ *
+ * Completely transferred entries are removed from the span, a partially transferred entry is adjusted in place.
+ *
+ * @param iovecs Remaining iovec entries, will be updated.
+ * @param bytes  Number of transferred bytes.
+ */
+export void advance_iovecs(std::span<struct iovec>& iovecs, size_t bytes) noexcept
+{
+    while (!iovecs.empty() && bytes >= iovecs.front().iov_len)
+    {
+        bytes -= iovecs.front().iov_len;
+        iovecs = iovecs.subspan(1);  // also skips empty entries
+    }
+    if (bytes > 0)
+    {
+        iovecs.front().iov_base = static_cast<std::byte*>(iovecs.front().iov_base) + bytes;
+        iovecs.front().iov_len -= bytes;
+    }
+}
+
+/**
+ * Writes all buffers of an iovec array, repeating writev() after partial writes. A write of 0 bytes fails with EIO.
+ *
+ * @param fd              Blocking file descriptor.
+ * @param iovecs          Buffers to be written, the iovec entries are modified.
+ * @param source_location Holds information about caller/calling position.
+ * @return                number of written bytes
+ */
+export size_t write_all(
+    FileDescriptor fd,
+    std::span<struct iovec> iovecs,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    size_t written = 0;
+    advance_iovecs(iovecs, 0);
+    while (!iovecs.empty())
+    {
+        const size_t bytes = GuardFW::writev(fd, iovecs.data(), iovec_count(iovecs), source_location);
+        if (bytes == 0)  // no progress, would be repeated forever
+            throw_system_error(EIO, "write_all", source_location);
+        advance_iovecs(iovecs, bytes);
+        written += bytes;
+    }
+    return written;
+}
+
+/**
+ * Fills all buffers of an iovec array, repeating readv() after partial reads.
+ *
+ * @param fd              Blocking file descriptor.
+ * @param iovecs          Buffers to be filled, the iovec entries are modified.
+ * @param source_location Holds information about caller/calling position.
+ * @return                number of read bytes, less than the size of all buffers only at EOF
+ */
+export [[nodiscard]] size_t read_exact(
+    FileDescriptor fd,
+    std::span<struct iovec> iovecs,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    size_t received = 0;
+    advance_iovecs(iovecs, 0);
+    while (!iovecs.empty())
+    {
+        const size_t bytes = GuardFW::readv(fd, iovecs.data(), iovec_count(iovecs), source_location);
+        if (bytes == 0)  // EOF
+            break;
+        advance_iovecs(iovecs, bytes);
+        received += bytes;
+    }
+    return received;
+}
+
+/**
+ * Writes all buffers of an iovec array at a file offset, repeating pwritev2() after partial writes. A write of 0 bytes
+ * fails with EIO.
+ *
+ * @param fd              File descriptor of a seekable file.
+ * @param iovecs          Buffers to be written, the iovec entries are modified.
+ * @param offset          File offset, or -1 to write at the current file position, which is advanced.
+ * @param flags           pwritev2() flags, e.g. RWF_DSYNC or RWF_HIPRI.
+ * @param source_location Holds information about caller/calling position.
+ * @return                number of written bytes
+ */
+export size_t pwrite_all(
+    FileDescriptor fd,
+    std::span<struct iovec> iovecs,
+    off_t offset,
+    int flags                                   = 0,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    size_t written = 0;
+    advance_iovecs(iovecs, 0);
+    while (!iovecs.empty())
+    {
+        const off_t position = offset_after(offset, written);
+        const size_t bytes   =
+            GuardFW::pwritev2(fd, iovecs.data(), iovec_count(iovecs), position, flags, source_location);
+        if (bytes == 0)  // no progress, would be repeated forever
+            throw_system_error(EIO, "pwrite_all", source_location);
+        advance_iovecs(iovecs, bytes);
+        written += bytes;
+    }
+    return written;
+}
+
+/**
+ * Fills all buffers of an iovec array from a file offset, repeating preadv2() after partial reads.
+ *
+ * @param fd              File descriptor of a seekable file.
+ * @param iovecs          Buffers to be filled, the iovec entries are modified.
+ * @param offset          File offset, or -1 to read from the current file position, which is advanced.
+ * @param flags           preadv2() flags, e.g. RWF_HIPRI.
+ * @param source_location Holds information about caller/calling position.
+ * @return                number of read bytes, less than the size of all buffers only at EOF
+ */
+export [[nodiscard]] size_t pread_exact(
+    FileDescriptor fd,
+    std::span<struct iovec> iovecs,
+    off_t offset,
+    int flags                                   = 0,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    size_t received = 0;
+    advance_iovecs(iovecs, 0);
+    while (!iovecs.empty())
+    {
+        const off_t position = offset_after(offset, received);
+        const size_t bytes   =
+            GuardFW::preadv2(fd, iovecs.data(), iovec_count(iovecs), position, flags, source_location);
+        if (bytes == 0)  // EOF
+            break;
+        advance_iovecs(iovecs, bytes);
+        received += bytes;
+    }
+    return received;
+}
+
+}  // namespace GuardFW
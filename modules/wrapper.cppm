@@ -8,10 +8,15 @@
  * - if errors ahall be thrown as exceptions or returned in std::expected<> as unexpected error,
  * - if success results shall be casted to other types (e.g. ssize_t -> size_t),
  * - if blockings (e.g. EAGAIN) shall be detected,
- * - if repetitions (caused by EINTR) shall be done.
+ * - if repetitions (caused by EINTR) shall be done,
+ * - if calls, errors and latencies shall be recorded in per-function statistics,
+ * - if calls shall be recorded in a per-thread flight recorder.
  * The configuration is done in template parameters, either in a reusable context helper class or
  * in the wrapper itself.
  *
+ * The same error handling can be applied to io_uring completions with 'complete()', whose results indicate errors
+ * as negative error numbers like direct system calls.
+ *
  * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
  * @copyright MIT license, see file LICENSE
  * @file
@@ -19,19 +24,23 @@
 
 module;
 
-#include <errno.h>  // EAGAIN/EWOULDBLOCK
+#include <errno.h>           // EAGAIN/EWOULDBLOCK
+#include <linux/io_uring.h>  // io_uring_op, io_uring_cqe
 
 #include <bit>
 #include <cstdint>
 #include <expected>
 #include <optional>
 #include <source_location>
+#include <string_view>
 #include <system_error>  // std::system_error, std::system_category
 #include <type_traits>
 
 export module guardfw.wrapper;
 
 import guardfw.exceptions;
+import guardfw.flight_recorder;
+import guardfw.statistics;
 import guardfw.traits;
 
 static_assert(EAGAIN == EWOULDBLOCK, "Linux ensures that EAGAIN==EWOULDBLOCK, but this is not the case here");
@@ -69,6 +78,8 @@ export enum class ErrorSpecial : uint8_t {
     eintr_repeats     = (1 << 0),  ///< if interrupted by signal
     nonblock          = (1 << 1),  ///< returns optional<> for value or bool for no value
     ignore_softerrors = (1 << 2),  ///< soft errors shall be ignored, not returned
+    statistics        = (1 << 3),  ///< calls are counted and timed per function, see guardfw.statistics
+    flight_recorder   = (1 << 4),  ///< calls are recorded per thread, see guardfw.flight_recorder
 };
 
 /**
@@ -97,6 +108,119 @@ export constexpr ErrorSpecial operator&(ErrorSpecial lv, ErrorSpecial rv)
     return static_cast<ErrorSpecial>(static_cast<UnderlyingType>(lv) & static_cast<UnderlyingType>(rv));
 }
 
+/**
+ * Returns the name of an io_uring opcode, e.g. "IORING_OP_RECV".
+ *
+ * @param  opcode io_uring opcode.
+ * @return        name of opcode, reported by errors of Context::complete()
+ */
+consteval std::string_view name_of_opcode(io_uring_op opcode)
+{
+    switch (opcode)
+    {
+        case IORING_OP_NOP:
+            return "IORING_OP_NOP";
+        case IORING_OP_READV:
+            return "IORING_OP_READV";
+        case IORING_OP_WRITEV:
+            return "IORING_OP_WRITEV";
+        case IORING_OP_FSYNC:
+            return "IORING_OP_FSYNC";
+        case IORING_OP_READ_FIXED:
+            return "IORING_OP_READ_FIXED";
+        case IORING_OP_WRITE_FIXED:
+            return "IORING_OP_WRITE_FIXED";
+        case IORING_OP_POLL_ADD:
+            return "IORING_OP_POLL_ADD";
+        case IORING_OP_POLL_REMOVE:
+            return "IORING_OP_POLL_REMOVE";
+        case IORING_OP_SYNC_FILE_RANGE:
+            return "IORING_OP_SYNC_FILE_RANGE";
+        case IORING_OP_SENDMSG:
+            return "IORING_OP_SENDMSG";
+        case IORING_OP_RECVMSG:
+            return "IORING_OP_RECVMSG";
+        case IORING_OP_TIMEOUT:
+            return "IORING_OP_TIMEOUT";
+        case IORING_OP_TIMEOUT_REMOVE:
+            return "IORING_OP_TIMEOUT_REMOVE";
+        case IORING_OP_ACCEPT:
+            return "IORING_OP_ACCEPT";
+        case IORING_OP_ASYNC_CANCEL:
+            return "IORING_OP_ASYNC_CANCEL";
+        case IORING_OP_LINK_TIMEOUT:
+            return "IORING_OP_LINK_TIMEOUT";
+        case IORING_OP_CONNECT:
+            return "IORING_OP_CONNECT";
+        case IORING_OP_FALLOCATE:
+            return "IORING_OP_FALLOCATE";
+        case IORING_OP_OPENAT:
+            return "IORING_OP_OPENAT";
+        case IORING_OP_CLOSE:
+            return "IORING_OP_CLOSE";
+        case IORING_OP_FILES_UPDATE:
+            return "IORING_OP_FILES_UPDATE";
+        case IORING_OP_STATX:
+            return "IORING_OP_STATX";
+        case IORING_OP_READ:
+            return "IORING_OP_READ";
+        case IORING_OP_WRITE:
+            return "IORING_OP_WRITE";
+        case IORING_OP_FADVISE:
+            return "IORING_OP_FADVISE";
+        case IORING_OP_MADVISE:
+            return "IORING_OP_MADVISE";
+        case IORING_OP_SEND:
+            return "IORING_OP_SEND";
+        case IORING_OP_RECV:
+            return "IORING_OP_RECV";
+        case IORING_OP_OPENAT2:
+            return "IORING_OP_OPENAT2";
+        case IORING_OP_EPOLL_CTL:
+            return "IORING_OP_EPOLL_CTL";
+        case IORING_OP_SPLICE:
+            return "IORING_OP_SPLICE";
+        case IORING_OP_PROVIDE_BUFFERS:
+            return "IORING_OP_PROVIDE_BUFFERS";
+        case IORING_OP_REMOVE_BUFFERS:
+            return "IORING_OP_REMOVE_BUFFERS";
+        case IORING_OP_TEE:
+            return "IORING_OP_TEE";
+        case IORING_OP_SHUTDOWN:
+            return "IORING_OP_SHUTDOWN";
+        case IORING_OP_RENAMEAT:
+            return "IORING_OP_RENAMEAT";
+        case IORING_OP_UNLINKAT:
+            return "IORING_OP_UNLINKAT";
+        case IORING_OP_MKDIRAT:
+            return "IORING_OP_MKDIRAT";
+        case IORING_OP_SYMLINKAT:
+            return "IORING_OP_SYMLINKAT";
+        case IORING_OP_LINKAT:
+            return "IORING_OP_LINKAT";
+        case IORING_OP_MSG_RING:
+            return "IORING_OP_MSG_RING";
+        case IORING_OP_FSETXATTR:
+            return "IORING_OP_FSETXATTR";
+        case IORING_OP_SETXATTR:
+            return "IORING_OP_SETXATTR";
+        case IORING_OP_FGETXATTR:
+            return "IORING_OP_FGETXATTR";
+        case IORING_OP_GETXATTR:
+            return "IORING_OP_GETXATTR";
+        case IORING_OP_SOCKET:
+            return "IORING_OP_SOCKET";
+        case IORING_OP_URING_CMD:
+            return "IORING_OP_URING_CMD";
+        case IORING_OP_SEND_ZC:
+            return "IORING_OP_SEND_ZC";
+        case IORING_OP_SENDMSG_ZC:
+            return "IORING_OP_SENDMSG_ZC";
+        default:
+            return "IORING_OP_UNKNOWN";
+    }
+}
+
 /**
  * Concept for allowed return types of functions to be wrappers or wrappers functions after errors have been excluded.
  *
@@ -187,6 +311,20 @@ private:
         "necessary repetitions are not possible, because errors can not be not detected"
     );
 
+    /// Flag indicates, that calls of the wrappers function shall be recorded in per-function statistics.
+    constexpr static bool enable_statistics {(ERROR_SPECIAL & ErrorSpecial::statistics) != ErrorSpecial::none};
+
+    /// Flag indicates, that calls of the wrappers function shall be recorded in the per-thread flight recorder.
+    constexpr static bool enable_flight_recorder {
+        (ERROR_SPECIAL & ErrorSpecial::flight_recorder) != ErrorSpecial::none
+    };
+
+    /// Special error handling flags without the statistics and flight recorder flags, which do not influence error
+    /// handling.
+    constexpr static ErrorSpecial error_handling_special {
+        ERROR_SPECIAL & (ErrorSpecial::eintr_repeats | ErrorSpecial::nonblock | ErrorSpecial::ignore_softerrors)
+    };
+
     /// Flag indicates, that the result may contain a success value.
     template<ResultConcept SUCCESS_RESULT>
     constexpr static bool result_contains_value {!std::is_void_v<SUCCESS_RESULT>};
@@ -259,6 +397,33 @@ public:
                 bool,                                                 // NO ERROR, NO VALUE, BLOCKING (checked)
                 void>>>;                                              // NO ERROR, NO VALUE, NO BLOCKING (checked)
 
+private:
+    /**
+     * Handles an error of wrapper() or complete(), which has not been repeated.
+     *
+     * Result processing priority:
+     * - report blockings in case of EAGAIN/EWOULDBLOCK
+     * - return successful in case of ignored errors
+     * - throw non-soft/non-direct errors
+     * - return soft/direct errors
+     *
+     * @tparam SUCCESS_RESULT  Desired success result type.
+     * @param  error           POSIX error number.
+     * @param  name            Name of the failed function or io_uring opcode, reported by exceptions.
+     * @param  failed_call     Wrapped function or io_uring operation, reported by exceptions.
+     * @param  source_location Holds information about caller/calling position.
+     * @return                 Returns blocking information (std::optional) or (soft) errors (std::(un)expected)
+     *                         (type depends on template parameters above).
+     */
+    template<ResultConcept SUCCESS_RESULT>
+    [[gnu::always_inline]] static inline WrapperResult<SUCCESS_RESULT> handle_error(
+        Error error,
+        std::string_view name,
+        [[maybe_unused]] FailedCall failed_call,
+        [[maybe_unused]] const std::source_location& source_location
+    );
+
+public:
     /**
      * Wrapper for POSIX and other Linux API calls.
      *
@@ -293,6 +458,34 @@ public:
     [[nodiscard, gnu::always_inline]] static WrapperResult<SUCCESS_RESULT> wrapper(
         [[maybe_unused]] const std::source_location& source_location, ARGS... args
     );
+
+    /**
+     * Applies the error handling of wrapper() to the result of a completed io_uring operation.
+     *
+     * The result of a completion queue entry contains a negative error number in case of an error, so the context
+     * must use ErrorIndication::lt0_direct. As the operation has already been completed, an EINTR error can not be
+     * repeated, so contexts with ErrorSpecial::eintr_repeats are rejected; a resubmission is up to the caller.
+     * Errors are reported with the name of the opcode. Completions are neither recorded in statistics nor in the
+     * flight recorder.
+     *
+     * Result processing priority:
+     * - return successful values
+     * - report blockings in case of EAGAIN/EWOULDBLOCK
+     * - return successful in case of ignored errors
+     * - throw non-soft/non-direct errors
+     * - return soft/direct errors
+     *
+     * @tparam OPCODE         io_uring opcode of the submitted operation, e.g. IORING_OP_RECV.
+     * @tparam SUCCESS_RESULT Type to which the success result shall be casted to, standard is the CQE result type.
+     * @param cqe             Completion queue entry of the operation.
+     * @param source_location Holds information about caller/calling position.
+     * @return                Returns success value (SUCCESS_RESULT) and eventually (soft) errors (std::(un)expected)
+     *                        or blocking information (std::optional) (type depends on template parameters above).
+     */
+    template<io_uring_op OPCODE, ResultConcept SUCCESS_RESULT = decltype(io_uring_cqe::res)>
+    [[nodiscard, gnu::always_inline]] static WrapperResult<SUCCESS_RESULT> complete(
+        const struct io_uring_cqe& cqe, [[maybe_unused]] const std::source_location& source_location
+    );
 };
 
 
@@ -404,7 +597,7 @@ template<auto WRAPPED_FUNCTION, ResultConcept SUCCESS_RESULT, ArgumentConcept...
     static_assert(
         !wrapped_function_returns_void
             || (((ERROR_INDICATION == ErrorIndication::none) || (ERROR_INDICATION == ErrorIndication::ignore))
-                && (ERROR_REPORT == ErrorReport::none) && (ERROR_SPECIAL == ErrorSpecial::none)
+                && (ERROR_REPORT == ErrorReport::none) && (error_handling_special == ErrorSpecial::none)
                 && (sizeof...(SOFT_ERRORS) == 0)),
         "wrappers void functions can not have any error handling"
     );
@@ -423,6 +616,10 @@ template<auto WRAPPED_FUNCTION, ResultConcept SUCCESS_RESULT, ArgumentConcept...
         "Soft errors can only be ignored, if wrapper returns void in success case"
     );
 
+    // records call, latency and errors on request, compiles to nothing otherwise
+    [[maybe_unused]] statistics::CallStatistics<enable_statistics, WRAPPED_FUNCTION> call_statistics;
+    [[maybe_unused]] flight_recorder::CallRecord<enable_flight_recorder, WRAPPED_FUNCTION> call_record;
+
     if constexpr (wrapped_function_returns_void)  // wrappers function returns void, there is no return value to handle
     {
         WRAPPED_FUNCTION(args...);
@@ -431,6 +628,7 @@ template<auto WRAPPED_FUNCTION, ResultConcept SUCCESS_RESULT, ArgumentConcept...
     else if constexpr (!errors_detectable)  // wrappers function is always successful
     {
         [[maybe_unused]] WrappedFunctionResult wrapped_function_result = WRAPPED_FUNCTION(args...);
+        call_record.result(wrapped_function_result);
         if constexpr (result_contains_value<SUCCESS_RESULT>)
             return static_cast<SUCCESS_RESULT>(wrapped_function_result);
         else         // constexpr
@@ -445,6 +643,7 @@ template<auto WRAPPED_FUNCTION, ResultConcept SUCCESS_RESULT, ArgumentConcept...
             errno = no_error;  // reset errno to a default no error value
 
         WrappedFunctionResult wrapped_function_result = WRAPPED_FUNCTION(args...);
+        call_record.result(wrapped_function_result);
 
         bool error_flag = is_error(wrapped_function_result);  // test error condition
 
@@ -461,55 +660,124 @@ template<auto WRAPPED_FUNCTION, ResultConcept SUCCESS_RESULT, ArgumentConcept...
         }  // won't leave scope, but will return
 
         Error error = get_error(wrapped_function_result);  // identify error
+        call_record.error(error);
 
         if constexpr (enable_repeat)  // do-while-loops can not be disabled by constexpr
-            if (error == EINTR)       // test for interrupts by signal handlers
-                goto repeat_eintr;    // error EINTR will repeat the wrappers call
-
-        if constexpr (result_contains_blocking)  // handle prevented blockings
-        {
-            if (error == EAGAIN)  // or EWOULDBLOCK, see static_assert above, NOT constexpr
-            {
-                if constexpr (result_contains_value<SUCCESS_RESULT>)
-                    return std::nullopt;  // returns std::optional<> or std::expected<std::optional<>>
-                else                      // constexpr
-                    return false;         // returns bool or std::expected<bool>
-            }  // won't leave scope, but will return
-        }  // may leave scope and continue
-
-        if constexpr (enable_soft_errors)  // detect soft errors, handle ignored soft errors and error exceptions
         {
-            if (is_soft_error(error))  // NOT constexpr
+            if (error == EINTR)  // test for interrupts by signal handlers
             {
-                if constexpr (ignore_soft_errors)  // handle ignored soft errors
-                {  // result contains no success value brcause of ignore_soft_errors, guaranteed by static_assert above
-                    if constexpr (result_contains_blocking)
-                        return true;
-                    else if constexpr (result_contains_error)
-                        return no_error;
-                    else  // constexpr
-                        return;
-                }  // won't leave scope
-            }  // will leave scope, if soft errors are not ignored
-            else  // NOT constexpr
-            {
-                if constexpr (enable_exception_errors)
-                    throw_system_error(error, name_of<WRAPPED_FUNCTION>(), source_location);
-            }  // may leave scope for direct errors
-        }  // mey leave scope for soft or direct errors
-        else if constexpr (enable_exception_errors)  // handle instant error exceptions
-            throw_system_error(error, name_of<WRAPPED_FUNCTION>(), source_location);
-
-        if constexpr (result_contains_error)  // handle soft or direct errors
-        {
-            if constexpr (result_contains_value<SUCCESS_RESULT> || result_contains_blocking)
-                return std::unexpected<Error>(error);  // returns std::expected<>
-            else                                       // constexpr
-                return error;                          // returns Error
-        }  // won't leave scope
+                call_statistics.eintr_repeat();
+                call_record.eintr_repeat();
+                goto repeat_eintr;  // error EINTR will repeat the wrappers call
+            }
+        }
+
+        if (result_contains_blocking && error == EAGAIN)  // or EWOULDBLOCK, see static_assert above
+            call_statistics.eagain_blocking();
+        else
+            call_statistics.error(error);
+        call_record.record();  // uncaught exceptions may terminate without unwinding
+
+        return handle_error<SUCCESS_RESULT>(error, name_of<WRAPPED_FUNCTION>(), FailedCall::function, source_location);
     }  // we rely on the compiler that all return paths are checked due to constexpr if.
 }  // may reach end of wrapper if constexpr (result_is_void) for void return
 
+// the description is in the struct above
+template<ErrorIndication ERROR_INDICATION, ErrorReport ERROR_REPORT, ErrorSpecial ERROR_SPECIAL, Error... SOFT_ERRORS>
+template<io_uring_op OPCODE, ResultConcept SUCCESS_RESULT>
+[[nodiscard, gnu::always_inline]] inline  // nodiscard is ignored for 'void'
+    Context<ERROR_INDICATION, ERROR_REPORT, ERROR_SPECIAL, SOFT_ERRORS...>::WrapperResult<SUCCESS_RESULT>
+    Context<ERROR_INDICATION, ERROR_REPORT, ERROR_SPECIAL, SOFT_ERRORS...>::complete(
+        const struct io_uring_cqe& cqe, [[maybe_unused]] const std::source_location& source_location
+    )
+{
+    using CompletionResult = decltype(io_uring_cqe::res);
+    static_assert(
+        ERROR_INDICATION == ErrorIndication::lt0_direct, "completion results indicate errors as negative error numbers"
+    );
+    static_assert(!enable_repeat, "EINTR of a completed io_uring operation can not be repeated");
+    static_assert(
+        std::is_void_v<SUCCESS_RESULT> || std::is_nothrow_convertible_v<CompletionResult, SUCCESS_RESULT>,
+        "incompatible override return type."
+    );
+    static_assert(
+        std::is_void_v<SUCCESS_RESULT> || !ignore_soft_errors,
+        "Soft errors can only be ignored, if wrapper returns void in success case"
+    );
+
+    const CompletionResult completion_result = cqe.res;
+    if (!is_error(completion_result)) [[likely]]  // handle success
+    {
+        if constexpr (result_contains_value<SUCCESS_RESULT>)
+            return static_cast<SUCCESS_RESULT>(completion_result);
+        else if constexpr (result_contains_blocking)
+            return true;
+        else if constexpr (result_contains_error)
+            return no_error;
+        else  // constexpr
+            return;
+    }  // won't leave scope, but will return
+
+    return handle_error<SUCCESS_RESULT>(
+        get_error(completion_result), name_of_opcode(OPCODE), FailedCall::io_uring_operation, source_location
+    );
+}
+
+// the description is in the struct above
+template<ErrorIndication ERROR_INDICATION, ErrorReport ERROR_REPORT, ErrorSpecial ERROR_SPECIAL, Error... SOFT_ERRORS>
+template<ResultConcept SUCCESS_RESULT>
+[[gnu::always_inline]] inline
+    Context<ERROR_INDICATION, ERROR_REPORT, ERROR_SPECIAL, SOFT_ERRORS...>::WrapperResult<SUCCESS_RESULT>
+    Context<ERROR_INDICATION, ERROR_REPORT, ERROR_SPECIAL, SOFT_ERRORS...>::handle_error(
+        Error error,
+        std::string_view name,
+        [[maybe_unused]] FailedCall failed_call,
+        [[maybe_unused]] const std::source_location& source_location
+    )
+{
+    if constexpr (result_contains_blocking)  // handle prevented blockings
+    {
+        if (error == EAGAIN)  // or EWOULDBLOCK, see static_assert above, NOT constexpr
+        {
+            if constexpr (result_contains_value<SUCCESS_RESULT>)
+                return std::nullopt;  // returns std::optional<> or std::expected<std::optional<>>
+            else                      // constexpr
+                return false;         // returns bool or std::expected<bool>
+        }  // won't leave scope, but will return
+    }  // may leave scope and continue
+
+    if constexpr (enable_soft_errors)  // detect soft errors, handle ignored soft errors and error exceptions
+    {
+        if (is_soft_error(error))  // NOT constexpr
+        {
+            if constexpr (ignore_soft_errors)  // handle ignored soft errors
+            {  // result contains no success value brcause of ignore_soft_errors, guaranteed by static_assert above
+                if constexpr (result_contains_blocking)
+                    return true;
+                else if constexpr (result_contains_error)
+                    return no_error;
+                else  // constexpr
+                    return;
+            }  // won't leave scope
+        }  // will leave scope, if soft errors are not ignored
+        else  // NOT constexpr
+        {
+            if constexpr (enable_exception_errors)
+                throw_system_error(error, name, source_location, failed_call);
+        }  // may leave scope for direct errors
+    }  // mey leave scope for soft or direct errors
+    else if constexpr (enable_exception_errors)  // handle instant error exceptions
+        throw_system_error(error, name, source_location, failed_call);
+
+    if constexpr (result_contains_error)  // handle soft or direct errors
+    {
+        if constexpr (result_contains_value<SUCCESS_RESULT> || result_contains_blocking)
+            return std::unexpected<Error>(error);  // returns std::expected<>
+        else                                       // constexpr
+            return error;                          // returns Error
+    }  // won't leave scope
+}  // we rely on the compiler that all return paths are checked due to constexpr if.
+
 
 /// Pre-defined Context<> used for most POSIX functions as standard context
 export using ContextStd = Context<ErrorIndication::eqm1_errno>;
@@ -534,6 +802,28 @@ export using ContextNonblockRepeatEINTR =
 export using ContextRepeatEINTRSoftTimeout =
     Context<ErrorIndication::eqm1_errno, ErrorReport::exception, ErrorSpecial::eintr_repeats, ETIMEDOUT>;
 
+/// Pre-defined Context<> used for direct system calls, which return negative error codes instead of using errno
+export using ContextSyscall = Context<ErrorIndication::lt0_direct>;
+
+/// Pre-defined Context<> used for direct system calls, which may return EINTR after signals
+export using ContextSyscallRepeatEINTR =
+    Context<ErrorIndication::lt0_direct, ErrorReport::exception, ErrorSpecial::eintr_repeats>;
+
+/// Pre-defined Context<> used for io_uring completions of nonblocking operations, which may return EWOULDBLOCK/EAGAIN
+export using ContextSyscallNonblock =
+    Context<ErrorIndication::lt0_direct, ErrorReport::exception, ErrorSpecial::nonblock>;
+
+/// Pre-defined Context<> used for direct system calls, which may return EINTR or EWOULDBLOCK/EAGAIN
+export using ContextSyscallNonblockRepeatEINTR =
+    Context<ErrorIndication::lt0_direct, ErrorReport::exception, ErrorSpecial::eintr_repeats | ErrorSpecial::nonblock>;
+
+/// Pre-defined Context<> used for the direct io_uring_enter() system call, like ContextRepeatEINTRSoftEAGAINSoftEBUSY
+export using ContextSyscallRepeatEINTRSoftEAGAINSoftEBUSY =
+    Context<ErrorIndication::lt0_direct, ErrorReport::exception, ErrorSpecial::eintr_repeats, EAGAIN, EBUSY>;
+
+/// Pre-defined Context<> used for functions, which return the error code instead of setting errno, e.g. posix_fadvise()
+export using ContextReturnedError = Context<ErrorIndication::bt0_direct>;
+
 /// Pre-defined Context<> used for getpriority(), like ContextStd, but with special errno handling
 export using ContextMinus1ErrnoChanged = Context<ErrorIndication::eqm1_errno_changed>;
 
@@ -16,11 +16,28 @@ module;
 #include <source_location>  // std::source_location
 
 #include <sys/epoll.h>  // epoll_create1(), epoll_ctl(), epoll_wait(), epoll_pwait(), epoll_pwait2(), epoll_event
+#include <sys/ioctl.h>  // _IOW(), _IOR()
+
+#include <cstdint>  // uint8_t, uint16_t, uint32_t
+
+#ifndef EPIOCSPARAMS  // added with Linux 6.9 and glibc 2.40, the ioctls are used if the kernel supports them
+struct epoll_params
+{
+    uint32_t busy_poll_usecs;
+    uint16_t busy_poll_budget;
+    uint8_t prefer_busy_poll;
+    uint8_t __pad;  // NOLINT(bugprone-reserved-identifier): kernel name
+};
+#define EPOLL_IOC_TYPE 0x8A
+#define EPIOCSPARAMS   _IOW(EPOLL_IOC_TYPE, 0x01, struct epoll_params)
+#define EPIOCGPARAMS   _IOR(EPOLL_IOC_TYPE, 0x02, struct epoll_params)
+#endif
 
 export module guardfw.wrapped_epoll;
 
 import guardfw.wrapper;
 import guardfw.file_desciptor;
+import guardfw.wrapped_ioctl;
 
 namespace GuardFW
 {
@@ -82,4 +99,26 @@ export [[gnu::always_inline, nodiscard]] inline unsigned int epoll_pwait2(
     );
 }
 
+export using EpollParams = struct epoll_params;
+
+// busy polling of the epoll instance, see EPIOCSPARAMS in ioctl_eventpoll(2), needs Linux 6.9
+export [[gnu::always_inline]] inline void epoll_set_params(
+    FileDescriptor epfd,
+    const EpollParams& params,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    EpollParams copy = params;  // the ioctl only reads the parameters
+    GuardFW::ioctl_noretval(epfd, EPIOCSPARAMS, &copy, source_location);
+}
+
+export [[gnu::always_inline, nodiscard]] inline EpollParams epoll_get_params(
+    FileDescriptor epfd, const std::source_location& source_location = std::source_location::current()
+)
+{
+    EpollParams params {};
+    GuardFW::ioctl_noretval(epfd, EPIOCGPARAMS, &params, source_location);
+    return params;
+}
+
 }  // namespace GuardFW
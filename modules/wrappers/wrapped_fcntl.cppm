@@ -11,10 +11,18 @@
 
 module;
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <cstddef>
 #include <type_traits>
 #include <source_location>
+#include <optional>
 
 #include <fcntl.h>
+#include <linux/falloc.h>  // FALLOC_FL_*
+#include <sys/uio.h>       // iovec
 
 export module guardfw.wrapped_fcntl;
 
@@ -24,6 +32,33 @@ import guardfw.file_desciptor;
 namespace GuardFW
 {
 
+namespace constants
+{
+
+export enum FallocateMode : int {
+    falloc_fl_keep_size      = FALLOC_FL_KEEP_SIZE,       // allocate without changing the file size
+    falloc_fl_punch_hole     = FALLOC_FL_PUNCH_HOLE,      // deallocate, needs falloc_fl_keep_size
+    falloc_fl_collapse_range = FALLOC_FL_COLLAPSE_RANGE,  // remove range without leaving a hole
+    falloc_fl_zero_range     = FALLOC_FL_ZERO_RANGE,      // zero range, preferably by unwritten extents
+    falloc_fl_insert_range   = FALLOC_FL_INSERT_RANGE,    // insert hole without overwriting data
+};
+
+export enum Fadvice : int {
+    posix_fadv_normal     = POSIX_FADV_NORMAL,      // default readahead
+    posix_fadv_sequential = POSIX_FADV_SEQUENTIAL,  // doubled readahead
+    posix_fadv_random     = POSIX_FADV_RANDOM,      // no readahead
+    posix_fadv_noreuse    = POSIX_FADV_NOREUSE,     // data is accessed only once
+    posix_fadv_willneed   = POSIX_FADV_WILLNEED,    // starts reading into the page cache
+    posix_fadv_dontneed   = POSIX_FADV_DONTNEED,    // drops clean pages from the page cache
+};
+
+export enum SyncFileRangeFlags : unsigned int {
+    sync_file_range_wait_before = SYNC_FILE_RANGE_WAIT_BEFORE,  // wait for writeback, which is already in progress
+    sync_file_range_write       = SYNC_FILE_RANGE_WRITE,        // start writeback of dirty pages
+    sync_file_range_wait_after  = SYNC_FILE_RANGE_WAIT_AFTER,   // wait for completion of the writeback
+};
+}
+
 export template<typename T>
 concept FcntlResultConcept = std::is_void_v<T> || std::is_same_v<T, int> || std::is_same_v<T, unsigned int>;
 
@@ -125,4 +160,129 @@ export template<FcntlArgConcept ARG>
     return ContextRepeatEINTR::wrapper<::fcntl, unsigned int>(source_location, fd, cmd, arg);
 }
 
+// fallocate, posix_fadvise, readahead, sync_file_range
+
+export [[gnu::always_inline]] inline void fallocate(
+    FileDescriptor fd,
+    int mode,
+    off_t offset,
+    off_t len,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    ContextRepeatEINTR::wrapper<::fallocate, void>(source_location, fd, mode, offset, len);
+}
+
+// returns the error directly instead of setting errno
+export [[gnu::always_inline]] inline void posix_fadvise(
+    FileDescriptor fd,
+    off_t offset,
+    off_t len,
+    int advice,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    ContextReturnedError::wrapper<::posix_fadvise, void>(source_location, fd, offset, len, advice);
+}
+
+// starts reading into the page cache, returns without waiting for the data
+export [[gnu::always_inline]] inline void readahead(
+    FileDescriptor fd,
+    off64_t offset,
+    size_t count,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    ContextStd::wrapper<::readahead, void>(source_location, fd, offset, count);
+}
+
+// flushes no metadata and gives no durability guarantee, see fdatasync()
+export [[gnu::always_inline]] inline void sync_file_range(
+    FileDescriptor fd,
+    off64_t offset,
+    off64_t nbytes,
+    unsigned int flags,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    ContextStd::wrapper<::sync_file_range, void>(source_location, fd, offset, nbytes, flags);
+}
+
+// splice, tee, vmsplice
+
+export [[gnu::always_inline, nodiscard]] inline size_t splice(
+    FileDescriptor fd_in,
+    off64_t* off_in,
+    FileDescriptor fd_out,
+    off64_t* off_out,
+    size_t len,
+    unsigned int flags,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextRepeatEINTR::wrapper<::splice, size_t>(source_location, fd_in, off_in, fd_out, off_out, len, flags);
+}
+
+// needs nonblocking file descriptors or flag SPLICE_F_NONBLOCK
+export [[gnu::always_inline, nodiscard]] inline std::optional<size_t> splice_nonblock(
+    FileDescriptor fd_in,
+    off64_t* off_in,
+    FileDescriptor fd_out,
+    off64_t* off_out,
+    size_t len,
+    unsigned int flags,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextNonblockRepeatEINTR::wrapper<::splice, size_t>(
+        source_location, fd_in, off_in, fd_out, off_out, len, flags
+    );
+}
+
+export [[gnu::always_inline, nodiscard]] inline size_t tee(
+    FileDescriptor fd_in,
+    FileDescriptor fd_out,
+    size_t len,
+    unsigned int flags,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextRepeatEINTR::wrapper<::tee, size_t>(source_location, fd_in, fd_out, len, flags);
+}
+
+// needs nonblocking file descriptors or flag SPLICE_F_NONBLOCK
+export [[gnu::always_inline, nodiscard]] inline std::optional<size_t> tee_nonblock(
+    FileDescriptor fd_in,
+    FileDescriptor fd_out,
+    size_t len,
+    unsigned int flags,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextNonblockRepeatEINTR::wrapper<::tee, size_t>(source_location, fd_in, fd_out, len, flags);
+}
+
+export [[gnu::always_inline, nodiscard]] inline size_t vmsplice(
+    FileDescriptor fd,
+    const struct iovec* iov,
+    size_t nr_segs,
+    unsigned int flags,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextRepeatEINTR::wrapper<::vmsplice, size_t>(source_location, fd, iov, nr_segs, flags);
+}
+
+// needs a nonblocking pipe or flag SPLICE_F_NONBLOCK
+export [[gnu::always_inline, nodiscard]] inline std::optional<size_t> vmsplice_nonblock(
+    FileDescriptor fd,
+    const struct iovec* iov,
+    size_t nr_segs,
+    unsigned int flags,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextNonblockRepeatEINTR::wrapper<::vmsplice, size_t>(source_location, fd, iov, nr_segs, flags);
+}
+
 }  // namespace GuardFW
@@ -0,0 +1,100 @@
+/**
+ * Wrappers for system header linux/futex.h
+ *
+ * This is a convenience header for encapsulating ugly wrapper<>() calls to Linux API and POSIX functions
+ * to nice looking calls with the same or similar name & API, but separate error handling.
+ * As glibc provides no futex() function, the system call is issued with syscall().
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+module;
+
+#include <linux/futex.h>  // FUTEX_*
+#include <sys/syscall.h>  // SYS_futex
+#include <unistd.h>       // ::syscall()
+
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <ctime>
+#include <source_location>
+
+export module guardfw.wrapped_futex;
+
+import guardfw.wrapper;
+
+namespace GuardFW
+{
+
+namespace constants
+{
+
+export enum FutexFlags : int {
+    futex_private_flag   = FUTEX_PRIVATE_FLAG,    // only for futexes of the same process
+    futex_clock_realtime = FUTEX_CLOCK_REALTIME,  // absolute timeouts refer to CLOCK_REALTIME, like mq_timedreceive()
+};
+}
+
+/// Repeats EINTR, returns EAGAIN (value has changed) and ETIMEDOUT.
+using ContextFutexWait =
+    Context<ErrorIndication::eqm1_errno, ErrorReport::exception, ErrorSpecial::eintr_repeats, EAGAIN, ETIMEDOUT>;
+
+/// Issues the futex system call.
+long futex(uint32_t* uaddr, int futex_op, uint32_t val, const struct timespec* timeout, uint32_t val3) noexcept
+{
+    constexpr uint32_t* no_uaddr2 {nullptr};
+    return ::syscall(SYS_futex, uaddr, futex_op, val, timeout, no_uaddr2, val3);
+}
+
+/**
+ * Waits until the futex word is woken up, if it still contains the expected value.
+ *
+ * @param uaddr           Futex word.
+ * @param val             Expected value.
+ * @param abs_timeout     Absolute timeout (CLOCK_MONOTONIC, or CLOCK_REALTIME with futex_clock_realtime) or nullptr.
+ * @param flags           Combination of futex_private_flag and futex_clock_realtime.
+ * @param source_location Holds information about caller/calling position.
+ * @return                no_error if woken up, EAGAIN if the value differs or ETIMEDOUT
+ */
+export [[gnu::always_inline]] inline Error futex_wait(
+    uint32_t* uaddr,
+    uint32_t val,
+    const struct timespec* abs_timeout,
+    int flags                                   = 0,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextFutexWait::wrapper<futex, void>(
+        source_location, uaddr, FUTEX_WAIT_BITSET | flags, val, abs_timeout, uint32_t {FUTEX_BITSET_MATCH_ANY}
+    );
+}
+
+/**
+ * Wakes up waiters of the futex word.
+ *
+ * @param uaddr           Futex word.
+ * @param count           Maximum number of woken up waiters, INT_MAX for all.
+ * @param flags           futex_private_flag or 0.
+ * @param source_location Holds information about caller/calling position.
+ * @return                number of woken up waiters
+ */
+export [[gnu::always_inline]] inline unsigned int futex_wake(
+    uint32_t* uaddr,
+    int count,
+    int flags                                   = 0,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    constexpr const struct timespec* no_timeout {nullptr};
+    return ContextStd::wrapper<futex, unsigned int>(
+        source_location, uaddr, FUTEX_WAKE | flags, static_cast<uint32_t>(count), no_timeout, uint32_t {0}
+    );
+}
+
+// missing:
+// FUTEX_REQUEUE, FUTEX_CMP_REQUEUE, FUTEX_WAKE_OP, priority inheritance operations, futex_waitv()
+
+}  // namespace GuardFW
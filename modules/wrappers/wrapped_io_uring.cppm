@@ -15,10 +15,11 @@ module;
 #include <cstddef>          // size_t
 #include <source_location>  // std::source_location
 #include <expected>         // std::expected
+#include <optional>         // std::optional
 
 #include <sys/syscall.h>     // SYS_*
 #include <unistd.h>          // ::syscall()
-#include <linux/io_uring.h>  // io_uring_params
+#include <linux/io_uring.h>  // io_uring_params, io_uring_cqe, IORING_OP_*
 
 export module guardfw.wrapped_io_uring;
 
@@ -77,4 +78,78 @@ export [[gnu::always_inline, nodiscard]] inline std::expected<unsigned int, Erro
     );
 }
 
+// Completions of io_uring operations, with the error handling of the synchronous wrappers of the same name.
+// EINTR can not be repeated after completion and is thrown, the _nonblock variants report EAGAIN of operations
+// with MSG_DONTWAIT or nonblocking sockets.
+
+export [[gnu::always_inline, nodiscard]] inline size_t recv_completion(
+    const struct io_uring_cqe& cqe, const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextSyscall::complete<IORING_OP_RECV, size_t>(cqe, source_location);
+}
+
+export [[gnu::always_inline, nodiscard]] inline std::optional<size_t> recv_completion_nonblock(
+    const struct io_uring_cqe& cqe, const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextSyscallNonblock::complete<IORING_OP_RECV, size_t>(cqe, source_location);
+}
+
+export [[gnu::always_inline, nodiscard]] inline size_t recvmsg_completion(
+    const struct io_uring_cqe& cqe, const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextSyscall::complete<IORING_OP_RECVMSG, size_t>(cqe, source_location);
+}
+
+export [[gnu::always_inline, nodiscard]] inline std::optional<size_t> recvmsg_completion_nonblock(
+    const struct io_uring_cqe& cqe, const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextSyscallNonblock::complete<IORING_OP_RECVMSG, size_t>(cqe, source_location);
+}
+
+export [[gnu::always_inline, nodiscard]] inline size_t send_completion(
+    const struct io_uring_cqe& cqe, const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextSyscall::complete<IORING_OP_SEND, size_t>(cqe, source_location);
+}
+
+export [[gnu::always_inline, nodiscard]] inline std::optional<size_t> send_completion_nonblock(
+    const struct io_uring_cqe& cqe, const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextSyscallNonblock::complete<IORING_OP_SEND, size_t>(cqe, source_location);
+}
+
+export [[gnu::always_inline, nodiscard]] inline size_t sendmsg_completion(
+    const struct io_uring_cqe& cqe, const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextSyscall::complete<IORING_OP_SENDMSG, size_t>(cqe, source_location);
+}
+
+export [[gnu::always_inline, nodiscard]] inline std::optional<size_t> sendmsg_completion_nonblock(
+    const struct io_uring_cqe& cqe, const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextSyscallNonblock::complete<IORING_OP_SENDMSG, size_t>(cqe, source_location);
+}
+
+export [[gnu::always_inline, nodiscard]] inline FileDescriptor accept_completion(
+    const struct io_uring_cqe& cqe, const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextSyscall::complete<IORING_OP_ACCEPT, FileDescriptor>(cqe, source_location);
+}
+
+export [[gnu::always_inline, nodiscard]] inline std::optional<FileDescriptor> accept_completion_nonblock(
+    const struct io_uring_cqe& cqe, const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextSyscallNonblock::complete<IORING_OP_ACCEPT, FileDescriptor>(cqe, source_location);
+}
+
 }  // namespace GuardFW
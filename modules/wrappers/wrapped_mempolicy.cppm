@@ -0,0 +1,190 @@
+/**
+ * Wrappers for system header linux/mempolicy.h
+ *
+ * This is a convenience header for encapsulating ugly wrapper<>() calls to Linux API and POSIX functions
+ * to nice looking calls with the same or similar name & API, but separate error handling.
+ * As only libnuma provides mbind(), set_mempolicy(), get_mempolicy() and move_pages(), the system calls
+ * are issued with direct_syscall() and report negative error codes.
+ * Node masks are arrays of unsigned long, maxnode is the number of bits plus 1 (like libnuma passes it).
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+module;
+
+#include <linux/mempolicy.h>  // MPOL_*
+#include <sys/syscall.h>      // SYS_*
+
+#include <cstddef>
+#include <source_location>
+
+export module guardfw.wrapped_mempolicy;
+
+import guardfw.wrapper;
+import guardfw.wrapped_syscall;
+
+namespace GuardFW
+{
+
+namespace constants
+{
+
+export enum MempolicyMode : int {
+    mpol_default        = MPOL_DEFAULT,         // policy of the process, or local allocation
+    mpol_preferred      = MPOL_PREFERRED,       // prefer a single node, fall back to others
+    mpol_bind           = MPOL_BIND,            // restrict allocations to the nodes
+    mpol_interleave     = MPOL_INTERLEAVE,      // interleave pages over the nodes
+    mpol_local          = MPOL_LOCAL,           // allocate on the node of the allocating CPU
+    mpol_preferred_many = MPOL_PREFERRED_MANY,  // prefer several nodes, fall back to others
+};
+
+export enum MempolicyModeFlags : int {
+    mpol_f_static_nodes   = MPOL_F_STATIC_NODES,    // node mask is not remapped, if the allowed nodes change
+    mpol_f_relative_nodes = MPOL_F_RELATIVE_NODES,  // node mask is relative to the allowed nodes
+};
+
+export enum MbindFlags : unsigned int {
+    mpol_mf_strict   = MPOL_MF_STRICT,    // fail with EIO, if existing pages do not follow the policy
+    mpol_mf_move     = MPOL_MF_MOVE,      // migrate existing pages, which are only mapped by this process
+    mpol_mf_move_all = MPOL_MF_MOVE_ALL,  // migrate all existing pages, needs CAP_SYS_NICE
+};
+
+export enum GetMempolicyFlags : unsigned long {
+    mpol_f_node         = MPOL_F_NODE,          // return a node instead of the policy mode
+    mpol_f_addr         = MPOL_F_ADDR,          // return the policy of an address
+    mpol_f_mems_allowed = MPOL_F_MEMS_ALLOWED,  // return the allowed nodes in nodemask
+};
+}
+
+[[gnu::always_inline]] inline long sys_mbind(
+    void* addr,
+    unsigned long len,
+    int mode,
+    const unsigned long* nodemask,
+    unsigned long maxnode,
+    unsigned int flags
+) noexcept
+{
+    return direct_syscall(SYS_mbind, addr, len, mode, nodemask, maxnode, flags);
+}
+
+[[gnu::always_inline]] inline long sys_set_mempolicy(
+    int mode, const unsigned long* nodemask, unsigned long maxnode
+) noexcept
+{
+    return direct_syscall(SYS_set_mempolicy, mode, nodemask, maxnode);
+}
+
+[[gnu::always_inline]] inline long sys_get_mempolicy(
+    int* mode, unsigned long* nodemask, unsigned long maxnode, void* addr, unsigned long flags
+) noexcept
+{
+    return direct_syscall(SYS_get_mempolicy, mode, nodemask, maxnode, addr, flags);
+}
+
+[[gnu::always_inline]] inline long sys_move_pages(
+    int pid, unsigned long count, void** pages, const int* nodes, int* status, int flags
+) noexcept
+{
+    return direct_syscall(SYS_move_pages, pid, count, pages, nodes, status, flags);
+}
+
+/**
+ * Sets the memory policy of an address range.
+ *
+ * @param addr            Page-aligned start of the range.
+ * @param len             Length of the range.
+ * @param mode            Policy mode, optionally combined with mode flags.
+ * @param nodemask        Node mask, nullptr for mpol_default and mpol_local.
+ * @param maxnode         Number of bits in the node mask plus 1.
+ * @param flags           Combination of mpol_mf_strict, mpol_mf_move and mpol_mf_move_all.
+ * @param source_location Holds information about caller/calling position.
+ */
+export [[gnu::always_inline]] inline void mbind(
+    void* addr,
+    size_t len,
+    int mode,
+    const unsigned long* nodemask,
+    unsigned long maxnode,
+    unsigned int flags,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    ContextSyscall::wrapper<sys_mbind, void>(
+        source_location, addr, static_cast<unsigned long>(len), mode, nodemask, maxnode, flags
+    );
+}
+
+/**
+ * Sets the memory policy of the calling thread.
+ *
+ * @param mode            Policy mode, optionally combined with mode flags.
+ * @param nodemask        Node mask, nullptr for mpol_default and mpol_local.
+ * @param maxnode         Number of bits in the node mask plus 1.
+ * @param source_location Holds information about caller/calling position.
+ */
+export [[gnu::always_inline]] inline void set_mempolicy(
+    int mode,
+    const unsigned long* nodemask,
+    unsigned long maxnode,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    ContextSyscall::wrapper<sys_set_mempolicy, void>(source_location, mode, nodemask, maxnode);
+}
+
+/**
+ * Returns the memory policy of the calling thread or of an address.
+ *
+ * @param mode            Receives the policy mode, or the node with mpol_f_node.
+ * @param nodemask        Receives the node mask, may be nullptr.
+ * @param maxnode         Number of bits in the node mask plus 1.
+ * @param addr            Address for mpol_f_addr, otherwise nullptr.
+ * @param flags           Combination of mpol_f_node, mpol_f_addr and mpol_f_mems_allowed.
+ * @param source_location Holds information about caller/calling position.
+ */
+export [[gnu::always_inline]] inline void get_mempolicy(
+    int* mode,
+    unsigned long* nodemask,
+    unsigned long maxnode,
+    void* addr,
+    unsigned long flags,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    ContextSyscall::wrapper<sys_get_mempolicy, void>(source_location, mode, nodemask, maxnode, addr, flags);
+}
+
+/**
+ * Moves pages to nodes, or queries their nodes.
+ *
+ * @param pid             Process, 0 for the calling process.
+ * @param count           Number of pages.
+ * @param pages           Addresses of the pages.
+ * @param nodes           Target node per page, nullptr to query the nodes in status.
+ * @param status          Receives the node or a negative error code per page.
+ * @param flags           mpol_mf_move or mpol_mf_move_all.
+ * @param source_location Holds information about caller/calling position.
+ * @return                number of pages, which have not been moved because of non-fatal errors
+ */
+export [[gnu::always_inline, nodiscard]] inline size_t move_pages(
+    int pid,
+    size_t count,
+    void** pages,
+    const int* nodes,
+    int* status,
+    int flags,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextSyscall::wrapper<sys_move_pages, size_t>(
+        source_location, pid, static_cast<unsigned long>(count), pages, nodes, status, flags
+    );
+}
+
+// missing:
+// migrate_pages(), set_mempolicy_home_node()
+
+}  // namespace GuardFW
@@ -11,6 +11,10 @@
 
 module;
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE  // mremap(), memfd_create()
+#endif
+
 #include <source_location>
 #include <cstddef>
 
@@ -73,6 +77,38 @@ export enum Flags : int {
     mcl_future  = MCL_FUTURE,
     mcl_onfault = MCL_ONFAULT,
 };
+
+export enum Advice : int {
+    madv_normal         = MADV_NORMAL,
+    madv_random         = MADV_RANDOM,
+    madv_sequential     = MADV_SEQUENTIAL,
+    madv_willneed       = MADV_WILLNEED,
+    madv_dontneed       = MADV_DONTNEED,
+    madv_free           = MADV_FREE,
+    madv_remove         = MADV_REMOVE,
+    madv_dontfork       = MADV_DONTFORK,
+    madv_dofork         = MADV_DOFORK,
+    madv_hugepage       = MADV_HUGEPAGE,
+    madv_nohugepage     = MADV_NOHUGEPAGE,
+    madv_dontdump       = MADV_DONTDUMP,
+    madv_dodump         = MADV_DODUMP,
+    madv_cold           = MADV_COLD,
+    madv_pageout        = MADV_PAGEOUT,
+    madv_populate_read  = MADV_POPULATE_READ,
+    madv_populate_write = MADV_POPULATE_WRITE,
+};
+
+export enum RemapFlags : int {
+    mremap_maymove   = MREMAP_MAYMOVE,
+    mremap_fixed     = MREMAP_FIXED,
+    mremap_dontunmap = MREMAP_DONTUNMAP,
+};
+
+export enum MemfdFlags : unsigned int {
+    mfd_cloexec       = MFD_CLOEXEC,
+    mfd_allow_sealing = MFD_ALLOW_SEALING,
+    mfd_hugetlb       = MFD_HUGETLB,
+};
 }
 
 export [[gnu::always_inline, nodiscard]] inline void* mmap(
@@ -134,10 +170,65 @@ export [[gnu::always_inline]] inline void munlockall(
     ContextStd::wrapper<::munlockall, void>(source_location);
 }
 
+export [[gnu::always_inline]] inline void madvise(
+    void* addr, size_t length, int advice, const std::source_location& source_location = std::source_location::current()
+)
+{
+    ContextStd::wrapper<::madvise, void>(source_location, addr, length, advice);
+}
+
+// without mremap_maymove, the mapping is only resized in place
+export [[gnu::always_inline, nodiscard]] inline void* mremap(
+    void* old_address,
+    size_t old_size,
+    size_t new_size,
+    int flags,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    // mremap indicates an error by ((void*)-1), like mmap
+    return ContextStd::wrapper<::mremap>(source_location, old_address, old_size, new_size, flags);
+}
+
+// with mremap_fixed, the mapping is moved to new_address
+export [[gnu::always_inline, nodiscard]] inline void* mremap(
+    void* old_address,
+    size_t old_size,
+    size_t new_size,
+    int flags,
+    void* new_address,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextStd::wrapper<::mremap>(source_location, old_address, old_size, new_size, flags, new_address);
+}
+
+export [[gnu::always_inline, nodiscard]] inline FileDescriptor memfd_create(
+    const char* name, unsigned int flags, const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextStd::wrapper<::memfd_create>(source_location, name, flags);
+}
+
+export [[gnu::always_inline, nodiscard]] inline FileDescriptor shm_open(
+    const char* name,
+    int oflag,
+    mode_t mode,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextStd::wrapper<::shm_open>(source_location, name, oflag, mode);
+}
+
+export [[gnu::always_inline]] inline void shm_unlink(
+    const char* name, const std::source_location& source_location = std::source_location::current()
+)
+{
+    ContextStd::wrapper<::shm_unlink, void>(source_location, name);
+}
+
 // missing:
-// mprotect(),  msync(), madvice(), mincore(), mremap()
-// shm_open(), shm_unlink()
-// memfd_create()
+// mprotect(),  msync(), mincore()
 // pkey_alloc(), pkey_set(), pkey_get(), pkey_free(), pkey_mprotect()
 
 }  // namespace GuardFW
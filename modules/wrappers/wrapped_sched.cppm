@@ -0,0 +1,75 @@
+/**
+ * Wrappers for system header sched.h
+ *
+ * This is a convenience header for encapsulating ugly wrapper<>() calls to Linux API and POSIX functions
+ * to nice looking calls with the same or similar name & API, but separate error handling.
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+module;
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <sched.h>  // cpu_set_t, ::sched_*affinity(), ::sched_yield(), ::sched_getcpu(), ::getcpu()
+
+#include <cstddef>
+#include <source_location>
+
+export module guardfw.wrapped_sched;
+
+import guardfw.wrapper;
+
+namespace GuardFW
+{
+
+// pid 0 is the calling thread
+export [[gnu::always_inline]] inline void sched_setaffinity(
+    pid_t pid,
+    size_t cpusetsize,
+    const cpu_set_t* mask,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    ContextStd::wrapper<::sched_setaffinity, void>(source_location, pid, cpusetsize, mask);
+}
+
+export [[gnu::always_inline]] inline void sched_getaffinity(
+    pid_t pid,
+    size_t cpusetsize,
+    cpu_set_t* mask,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    ContextStd::wrapper<::sched_getaffinity, void>(source_location, pid, cpusetsize, mask);
+}
+
+export [[gnu::always_inline]] inline void sched_yield(
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    ContextStd::wrapper<::sched_yield, void>(source_location);
+}
+
+// the result may be outdated on return, unless the thread is pinned to a single CPU
+export [[gnu::always_inline, nodiscard]] inline unsigned int sched_getcpu(
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextStd::wrapper<::sched_getcpu, unsigned int>(source_location);
+}
+
+export [[gnu::always_inline]] inline void getcpu(
+    unsigned int* cpu, unsigned int* node, const std::source_location& source_location = std::source_location::current()
+)
+{
+    ContextStd::wrapper<::getcpu, void>(source_location, cpu, node);
+}
+
+// missing:
+// sched_setscheduler(), sched_getscheduler(), sched_setparam(), sched_getparam(), sched_setattr()
+
+}  // namespace GuardFW
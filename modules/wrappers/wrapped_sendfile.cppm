@@ -0,0 +1,52 @@
+/**
+ * Wrappers for system header sys/sendfile.h
+ *
+ * This is a convenience header for encapsulating ugly wrapper<>() calls to Linux API and POSIX functions
+ * to nice looking calls with the same or similar name & API, but separate error handling.
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+module;
+
+#include <sys/sendfile.h>
+#include <sys/types.h>
+
+#include <cstddef>
+#include <source_location>
+#include <optional>
+
+export module guardfw.wrapped_sendfile;
+
+import guardfw.wrapper;
+import guardfw.file_desciptor;
+
+namespace GuardFW
+{
+
+export [[gnu::always_inline, nodiscard]] inline size_t sendfile(
+    FileDescriptor out_fd,
+    FileDescriptor in_fd,
+    off_t* offset,
+    size_t count,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextRepeatEINTR::wrapper<::sendfile, size_t>(source_location, out_fd, in_fd, offset, count);
+}
+
+// needs a nonblocking out_fd
+export [[gnu::always_inline, nodiscard]] inline std::optional<size_t> sendfile_nonblock(
+    FileDescriptor out_fd,
+    FileDescriptor in_fd,
+    off_t* offset,
+    size_t count,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextNonblockRepeatEINTR::wrapper<::sendfile, size_t>(source_location, out_fd, in_fd, offset, count);
+}
+
+}  // namespace GuardFW
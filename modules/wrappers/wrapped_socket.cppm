@@ -17,8 +17,10 @@ module;
 #include <sys/socket.h>
 
 #include <cstddef>
+#include <ctime>  // timespec
 #include <source_location>
 #include <optional>
+#include <type_traits>
 
 export module guardfw.wrapped_socket;
 
@@ -111,6 +113,90 @@ export [[gnu::always_inline]] inline void listen(
     ContextStd::wrapper<::listen, void>(source_location, sockfd, backlog);
 }
 
+export [[gnu::always_inline]] inline void setsockopt(
+    FileDescriptor sockfd,
+    int level,
+    int optname,
+    const void* optval,
+    socklen_t optlen,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    ContextStd::wrapper<::setsockopt, void>(source_location, sockfd, level, optname, optval, optlen);
+}
+
+export [[gnu::always_inline]] inline void getsockopt(
+    FileDescriptor sockfd,
+    int level,
+    int optname,
+    void* __restrict__ optval,
+    socklen_t* __restrict__ optlen,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    ContextStd::wrapper<::getsockopt, void>(source_location, sockfd, level, optname, optval, optlen);
+}
+
+/**
+ * Sets a socket option of a fixed-size type, e.g. int for SO_REUSEPORT or sock_fprog for SO_ATTACH_REUSEPORT_CBPF.
+ *
+ * @tparam VALUE           Option type.
+ * @param  sockfd          Socket.
+ * @param  level           Protocol level, e.g. SOL_SOCKET.
+ * @param  optname         Option name.
+ * @param  optval          Option value.
+ * @param  source_location Holds information about caller/calling position.
+ */
+export template<typename VALUE>
+requires(std::is_trivially_copyable_v<VALUE> && !std::is_pointer_v<VALUE>)
+[[gnu::always_inline]] inline void setsockopt(
+    FileDescriptor sockfd,
+    int level,
+    int optname,
+    const VALUE& optval,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    const void* const value = &optval;
+    ContextStd::wrapper<::setsockopt, void>(source_location, sockfd, level, optname, value, socklen_t {sizeof(VALUE)});
+}
+
+/**
+ * Gets a socket option of a fixed-size type, e.g. getsockopt<int>(fd, SOL_SOCKET, SO_INCOMING_CPU).
+ *
+ * @tparam VALUE           Option type.
+ * @param  sockfd          Socket.
+ * @param  level           Protocol level, e.g. SOL_SOCKET.
+ * @param  optname         Option name.
+ * @param  source_location Holds information about caller/calling position.
+ * @return                 option value, zero-initialized beyond the length returned by the kernel
+ */
+export template<typename VALUE>
+requires(std::is_trivially_copyable_v<VALUE> && !std::is_pointer_v<VALUE>)
+[[gnu::always_inline, nodiscard]] inline VALUE getsockopt(
+    FileDescriptor sockfd,
+    int level,
+    int optname,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    VALUE optval {};
+    void* const value = &optval;
+    socklen_t optlen {sizeof(VALUE)};
+    ContextStd::wrapper<::getsockopt, void>(source_location, sockfd, level, optname, value, &optlen);
+    return optval;
+}
+
+export [[gnu::always_inline]] inline void getsockname(
+    FileDescriptor sockfd,
+    struct sockaddr* __restrict__ addr,
+    socklen_t* __restrict__ addrlen,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    ContextStd::wrapper<::getsockname, void>(source_location, sockfd, addr, addrlen);
+}
+
 export [[gnu::always_inline, nodiscard]] inline size_t send(
     FileDescriptor sockfd,
     const void* buf,
@@ -181,6 +267,28 @@ export [[gnu::always_inline, nodiscard]] inline std::optional<size_t> sendmsg_no
     return ContextNonblockRepeatEINTR::wrapper<::sendmsg, size_t>(source_location, sockfd, msg, flag);
 }
 
+export [[gnu::always_inline, nodiscard]] inline unsigned int sendmmsg(
+    FileDescriptor sockfd,
+    struct mmsghdr* msgvec,
+    unsigned int vlen,
+    int flags,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextRepeatEINTR::wrapper<::sendmmsg, unsigned int>(source_location, sockfd, msgvec, vlen, flags);
+}
+
+export [[gnu::always_inline, nodiscard]] inline std::optional<unsigned int> sendmmsg_nonblock(
+    FileDescriptor sockfd,
+    struct mmsghdr* msgvec,
+    unsigned int vlen,
+    int flags,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextNonblockRepeatEINTR::wrapper<::sendmmsg, unsigned int>(source_location, sockfd, msgvec, vlen, flags);
+}
+
 export [[gnu::always_inline, nodiscard]] inline size_t recv(
     FileDescriptor sockfd,
     void* buf,
@@ -251,4 +359,30 @@ export [[gnu::always_inline, nodiscard]] inline std::optional<size_t> recvmsg_no
     return ContextNonblockRepeatEINTR::wrapper<::recvmsg, size_t>(source_location, sockfd, msg, flags);
 }
 
+export [[gnu::always_inline, nodiscard]] inline unsigned int recvmmsg(
+    FileDescriptor sockfd,
+    struct mmsghdr* msgvec,
+    unsigned int vlen,
+    int flags,
+    struct timespec* timeout,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextRepeatEINTR::wrapper<::recvmmsg, unsigned int>(source_location, sockfd, msgvec, vlen, flags, timeout);
+}
+
+export [[gnu::always_inline, nodiscard]] inline std::optional<unsigned int> recvmmsg_nonblock(
+    FileDescriptor sockfd,
+    struct mmsghdr* msgvec,
+    unsigned int vlen,
+    int flags,
+    struct timespec* timeout,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextNonblockRepeatEINTR::wrapper<::recvmmsg, unsigned int>(
+        source_location, sockfd, msgvec, vlen, flags, timeout
+    );
+}
+
 }  // namespace GuardFW
@@ -0,0 +1,44 @@
+/**
+ * Wrappers for system header sys/stat.h
+ *
+ * This is a convenience header for encapsulating ugly wrapper<>() calls to Linux API and POSIX functions
+ * to nice looking calls with the same or similar name & API, but separate error handling.
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+module;
+
+#include <sys/stat.h>
+
+#include <source_location>
+
+export module guardfw.wrapped_stat;
+
+import guardfw.wrapper;
+import guardfw.file_desciptor;
+
+namespace GuardFW
+{
+
+export [[gnu::always_inline]] inline void stat(
+    const char* __restrict__ pathname,
+    struct stat* __restrict__ statbuf,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    ContextStd::wrapper<::stat, void>(source_location, pathname, statbuf);
+}
+
+export [[gnu::always_inline]] inline void fstat(
+    FileDescriptor fd,
+    struct stat* statbuf,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    ContextStd::wrapper<::fstat, void>(source_location, fd, statbuf);
+}
+
+}  // namespace GuardFW
@@ -0,0 +1,46 @@
+/**
+ * Wrappers for system header time.h
+ *
+ * This is a convenience header for encapsulating ugly wrapper<>() calls to Linux API and POSIX functions
+ * to nice looking calls with the same or similar name & API, but separate error handling.
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+module;
+
+#include <time.h>
+
+#include <source_location>
+
+export module guardfw.wrapped_time;
+
+import guardfw.wrapper;
+
+namespace GuardFW
+{
+
+export [[gnu::always_inline]] inline void clock_gettime(
+    clockid_t clockid,
+    struct timespec* tp,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    ContextStd::wrapper<::clock_gettime, void>(source_location, clockid, tp);
+}
+
+export [[gnu::always_inline]] inline void clock_getres(
+    clockid_t clockid,
+    struct timespec* res,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    ContextStd::wrapper<::clock_getres, void>(source_location, clockid, res);
+}
+
+// missing:
+// clock_settime(), clock_nanosleep(), nanosleep()
+
+}  // namespace GuardFW
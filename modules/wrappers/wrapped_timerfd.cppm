@@ -12,6 +12,7 @@
 module;
 
 #include <sys/timerfd.h>
+#include <ctime>  // CLOCK_*
 
 #include <source_location>
 
@@ -29,6 +30,25 @@ import guardfw.file_desciptor;
 namespace GuardFW
 {
 
+namespace constants
+{
+
+export enum Clock : int {
+    clock_realtime       = CLOCK_REALTIME,
+    clock_monotonic      = CLOCK_MONOTONIC,
+    clock_boottime       = CLOCK_BOOTTIME,
+    clock_realtime_alarm = CLOCK_REALTIME_ALARM,
+    clock_boottime_alarm = CLOCK_BOOTTIME_ALARM,
+};
+
+export enum TimerfdFlags : int {
+    tfd_nonblock            = TFD_NONBLOCK,
+    tfd_cloexec             = TFD_CLOEXEC,
+    tfd_timer_abstime       = TFD_TIMER_ABSTIME,
+    tfd_timer_cancel_on_set = TFD_TIMER_CANCEL_ON_SET,
+};
+}
+
 export [[gnu::always_inline, nodiscard]] inline FileDescriptor timerfd_create(
     int clockid, int flags, const std::source_location& source_location = std::source_location::current()
 )
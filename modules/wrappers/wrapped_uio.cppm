@@ -0,0 +1,129 @@
+/**
+ * Wrappers for system header sys/uio.h
+ *
+ * This is a convenience header for encapsulating ugly wrapper<>() calls to Linux API and POSIX functions
+ * to nice looking calls with the same or similar name & API, but separate error handling.
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+module;
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE  // preadv2(), pwritev2(), RWF_*
+#endif
+
+#include <sys/uio.h>
+#include <sys/types.h>
+
+#include <cstddef>
+#include <source_location>
+#include <optional>
+
+export module guardfw.wrapped_uio;
+
+import guardfw.wrapper;
+import guardfw.file_desciptor;
+
+namespace GuardFW
+{
+
+// readv, writev
+
+export [[gnu::always_inline, nodiscard]] inline size_t readv(
+    FileDescriptor fd,
+    const struct iovec* iov,
+    int iovcnt,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextRepeatEINTR::wrapper<::readv, size_t>(source_location, fd, iov, iovcnt);
+}
+
+export [[gnu::always_inline, nodiscard]] inline std::optional<size_t> readv_nonblock(
+    FileDescriptor fd,
+    const struct iovec* iov,
+    int iovcnt,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextNonblockRepeatEINTR::wrapper<::readv, size_t>(source_location, fd, iov, iovcnt);
+}
+
+export [[gnu::always_inline, nodiscard]] inline size_t writev(
+    FileDescriptor fd,
+    const struct iovec* iov,
+    int iovcnt,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextRepeatEINTR::wrapper<::writev, size_t>(source_location, fd, iov, iovcnt);
+}
+
+export [[gnu::always_inline, nodiscard]] inline std::optional<size_t> writev_nonblock(
+    FileDescriptor fd,
+    const struct iovec* iov,
+    int iovcnt,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextNonblockRepeatEINTR::wrapper<::writev, size_t>(source_location, fd, iov, iovcnt);
+}
+
+// preadv2, pwritev2
+
+// flags may contain RWF_HIPRI, RWF_DSYNC, RWF_SYNC or RWF_APPEND, offset -1 uses the current file offset
+export [[gnu::always_inline, nodiscard]] inline size_t preadv2(
+    FileDescriptor fd,
+    const struct iovec* iov,
+    int iovcnt,
+    off_t offset,
+    int flags,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextRepeatEINTR::wrapper<::preadv2, size_t>(source_location, fd, iov, iovcnt, offset, flags);
+}
+
+// with RWF_NOWAIT, std::nullopt is returned if the data is not available without blocking (e.g. not cached)
+export [[gnu::always_inline, nodiscard]] inline std::optional<size_t> preadv2_nonblock(
+    FileDescriptor fd,
+    const struct iovec* iov,
+    int iovcnt,
+    off_t offset,
+    int flags,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextNonblockRepeatEINTR::wrapper<::preadv2, size_t>(source_location, fd, iov, iovcnt, offset, flags);
+}
+
+// flags may contain RWF_HIPRI, RWF_DSYNC, RWF_SYNC or RWF_APPEND, offset -1 uses the current file offset
+export [[gnu::always_inline, nodiscard]] inline size_t pwritev2(
+    FileDescriptor fd,
+    const struct iovec* iov,
+    int iovcnt,
+    off_t offset,
+    int flags,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextRepeatEINTR::wrapper<::pwritev2, size_t>(source_location, fd, iov, iovcnt, offset, flags);
+}
+
+// with RWF_NOWAIT, std::nullopt is returned if the write would block
+export [[gnu::always_inline, nodiscard]] inline std::optional<size_t> pwritev2_nonblock(
+    FileDescriptor fd,
+    const struct iovec* iov,
+    int iovcnt,
+    off_t offset,
+    int flags,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextNonblockRepeatEINTR::wrapper<::pwritev2, size_t>(source_location, fd, iov, iovcnt, offset, flags);
+}
+
+}  // namespace GuardFW
@@ -11,6 +11,9 @@
 
 module;
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE  // pipe2(), copy_file_range()
+#endif
 #ifndef _LARGEFILE64_SOURCE
 #define _LARGEFILE64_SOURCE
 #endif
@@ -78,7 +81,7 @@ export [[gnu::always_inline, nodiscard]] inline bool read_nonblock_ignore_result
 
 export [[gnu::always_inline, nodiscard]] inline size_t write(
     FileDescriptor fd,
-    void* buf,  // NOSONAR: allow void*
+    const void* buf,  // NOSONAR: allow void*
     size_t count,
     const std::source_location& source_location = std::source_location::current()
 )
@@ -88,7 +91,7 @@ export [[gnu::always_inline, nodiscard]] inline size_t write(
 
 export [[gnu::always_inline, nodiscard]] inline std::optional<size_t> write_nonblock(
     FileDescriptor fd,
-    void* buf,  // NOSONAR: allow void*
+    const void* buf,  // NOSONAR: allow void*
     size_t count,
     const std::source_location& source_location = std::source_location::current()
 )
@@ -99,7 +102,7 @@ export [[gnu::always_inline, nodiscard]] inline std::optional<size_t> write_nonb
 // used for eventfd
 export [[gnu::always_inline]] inline void write_ignore_result(
     FileDescriptor fd,
-    void* buf,  // NOSONAR: allow void*
+    const void* buf,  // NOSONAR: allow void*
     size_t count,
     const std::source_location& source_location = std::source_location::current()
 )
@@ -110,7 +113,7 @@ export [[gnu::always_inline]] inline void write_ignore_result(
 // used for eventfd
 export [[gnu::always_inline, nodiscard]] inline bool write_nonblock_ignore_result(
     FileDescriptor fd,
-    void* buf,  // NOSONAR: allow void*
+    const void* buf,  // NOSONAR: allow void*
     size_t count,
     const std::source_location& source_location = std::source_location::current()
 )
@@ -118,6 +121,30 @@ export [[gnu::always_inline, nodiscard]] inline bool write_nonblock_ignore_resul
     return ContextNonblockRepeatEINTR::wrapper<::write, void>(source_location, fd, buf, count);
 }
 
+// pread, pwrite
+
+export [[gnu::always_inline, nodiscard]] inline size_t pread(
+    FileDescriptor fd,
+    void* buf,  // NOSONAR: allow void*
+    size_t count,
+    off_t offset,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextRepeatEINTR::wrapper<::pread, size_t>(source_location, fd, buf, count, offset);
+}
+
+export [[gnu::always_inline, nodiscard]] inline size_t pwrite(
+    FileDescriptor fd,
+    const void* buf,  // NOSONAR: allow void*
+    size_t count,
+    off_t offset,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextRepeatEINTR::wrapper<::pwrite, size_t>(source_location, fd, buf, count, offset);
+}
+
 // close
 
 // Ignores EINTR, throws all other errors
@@ -128,6 +155,22 @@ export [[gnu::always_inline]] inline void close(
     ContextIgnoreEINTR::wrapper<::close, void>(source_location, fd);
 }
 
+// pipe
+
+export [[gnu::always_inline]] inline void pipe(
+    int pipefd[2], const std::source_location& source_location = std::source_location::current()
+)
+{
+    ContextStd::wrapper<::pipe, void>(source_location, pipefd);
+}
+
+export [[gnu::always_inline]] inline void pipe2(
+    int pipefd[2], int flags, const std::source_location& source_location = std::source_location::current()
+)
+{
+    ContextStd::wrapper<::pipe2, void>(source_location, pipefd, flags);
+}
+
 // sync
 
 // void ::sync() currently not handled, as it needs no wrapper
@@ -139,6 +182,21 @@ export [[gnu::always_inline]] inline void syncfs(
     ContextStd::wrapper<::syncfs, void>(source_location, fd);
 }
 
+export [[gnu::always_inline]] inline void fsync(
+    FileDescriptor fd, const std::source_location& source_location = std::source_location::current()
+)
+{
+    ContextStd::wrapper<::fsync, void>(source_location, fd);
+}
+
+// like fsync(), but flushes metadata only if needed for reading the data, e.g. the file size
+export [[gnu::always_inline]] inline void fdatasync(
+    FileDescriptor fd, const std::source_location& source_location = std::source_location::current()
+)
+{
+    ContextStd::wrapper<::fdatasync, void>(source_location, fd);
+}
+
 // lseek
 
 export [[gnu::always_inline, nodiscard]] inline off_t lseek(
@@ -155,4 +213,31 @@ export [[gnu::always_inline, nodiscard]] inline off64_t lseek64(
     return ContextStd::wrapper<::lseek64>(source_location, fd, offset, whence);
 }
 
+// ftruncate
+
+export [[gnu::always_inline]] inline void ftruncate(
+    FileDescriptor fd, off_t length, const std::source_location& source_location = std::source_location::current()
+)
+{
+    ContextRepeatEINTR::wrapper<::ftruncate, void>(source_location, fd, length);
+}
+
+// copy_file_range
+
+// copies within the kernel, there is no nonblocking variant, as regular files do not block
+export [[gnu::always_inline, nodiscard]] inline size_t copy_file_range(
+    FileDescriptor fd_in,
+    off64_t* off_in,
+    FileDescriptor fd_out,
+    off64_t* off_out,
+    size_t len,
+    unsigned int flags,
+    const std::source_location& source_location = std::source_location::current()
+)
+{
+    return ContextRepeatEINTR::wrapper<::copy_file_range, size_t>(
+        source_location, fd_in, off_in, fd_out, off_out, len, flags
+    );
+}
+
 }  // namespace GuardFW
@@ -0,0 +1,268 @@
+/**
+ * Zero-copy transmission with MSG_ZEROCOPY.
+ *
+ * The class ZeroCopySender enables SO_ZEROCOPY on a socket, sends with MSG_ZEROCOPY and reaps the completion
+ * notifications from the socket error queue. Until a send has been completed, the kernel may still read from the
+ * sent buffer, so the caller must not reuse or free it before.
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+module;
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <linux/errqueue.h>  // sock_extended_err, SO_EE_*
+#include <netinet/in.h>      // SOL_IP, SOL_IPV6, IP_RECVERR, IPV6_RECVERR
+#include <sys/socket.h>      // SO_ZEROCOPY, MSG_ZEROCOPY, MSG_ERRQUEUE, CMSG_*
+
+#include <cstddef>          // size_t
+#include <cstdint>          // uint32_t, uint64_t
+#include <cstring>          // ::memcpy()
+#include <optional>         // std::optional<>
+#include <source_location>  // std::source_location
+
+export module guardfw.zerocopy;
+
+import guardfw.exceptions;
+import guardfw.file_desciptor;
+import guardfw.wrapped_socket;
+
+namespace GuardFW
+{
+
+/// Result of a zero-copy send.
+export struct ZeroCopySend
+{
+    size_t bytes;  ///< number of sent bytes
+    uint32_t id;   ///< send id, which will be reported by a ZeroCopyCompletion
+};
+
+/// Completion of a range of zero-copy sends, the buffers of these sends may be reused.
+export struct ZeroCopyCompletion
+{
+    uint32_t first;  ///< first completed send id
+    uint32_t last;   ///< last completed send id, inclusive
+    bool copied;     ///< kernel fell back to copying the data, e.g. for loopback or missing NIC support
+
+    /// @return number of completed sends
+    [[nodiscard]] uint32_t count() const noexcept
+    {
+        return last - first + 1;  // wraps like the kernel counter
+    }
+};
+
+/**
+ * Zero-copy sender for connected stream sockets (TCP over IPv4 or IPv6).
+ *
+ * Each successful send() gets the next id of a per-socket 32 bit counter, starting with 0. Completions are
+ * reported as ranges of ids by reap(). If the kernel had to copy the data, zero-copy does not pay off and
+ * the caller may fall back to normal sends, see copy_fallback().
+ * The socket remains owned by the caller.
+ */
+export class ZeroCopySender
+{
+public:
+    /**
+     * Enables SO_ZEROCOPY on a socket.
+     *
+     * @param sockfd          Connected stream socket.
+     * @param source_location Holds information about caller/calling position.
+     */
+    explicit ZeroCopySender(
+        FileDescriptor sockfd, const std::source_location& source_location = std::source_location::current()
+    )
+        : fd(sockfd)
+    {
+        const int enable = 1;
+        GuardFW::setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &enable, sizeof(enable), source_location);
+    }
+
+    /// @return socket file descriptor
+    [[nodiscard]] FileDescriptor socket() const noexcept
+    {
+        return fd;
+    }
+
+    /**
+     * Sends a buffer with MSG_ZEROCOPY, the buffer must stay unchanged until the send has been completed.
+     *
+     * @param buf             Buffer to be sent.
+     * @param len             Length of buffer, must not be 0.
+     * @param flags           Additional send() flags.
+     * @param source_location Holds information about caller/calling position.
+     * @return                number of sent bytes and send id
+     */
+    [[nodiscard]] ZeroCopySend send(
+        const void* buf,
+        size_t len,
+        int flags                                   = 0,
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        const size_t bytes = GuardFW::send(fd, buf, len, flags | MSG_ZEROCOPY, source_location);
+        return {bytes, next_id++};
+    }
+
+    /**
+     * Sends a buffer with MSG_ZEROCOPY without blocking.
+     *
+     * @param buf             Buffer to be sent.
+     * @param len             Length of buffer, must not be 0.
+     * @param flags           Additional send() flags.
+     * @param source_location Holds information about caller/calling position.
+     * @return                number of sent bytes and send id or std::nullopt, if the socket would block
+     */
+    [[nodiscard]] std::optional<ZeroCopySend> send_nonblock(
+        const void* buf,
+        size_t len,
+        int flags                                   = 0,
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        std::optional<size_t> bytes =
+            GuardFW::send_nonblock(fd, buf, len, flags | MSG_ZEROCOPY | MSG_DONTWAIT, source_location);
+        if (!bytes.has_value())
+            return std::nullopt;
+        return ZeroCopySend {bytes.value(), next_id++};
+    }
+
+    /**
+     * Sends a message with MSG_ZEROCOPY, the buffers must stay unchanged until the send has been completed.
+     *
+     * @param msg             Message to be sent, must not be empty.
+     * @param flags           Additional sendmsg() flags.
+     * @param source_location Holds information about caller/calling position.
+     * @return                number of sent bytes and send id
+     */
+    [[nodiscard]] ZeroCopySend sendmsg(
+        const struct msghdr* msg,
+        int flags                                   = 0,
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        const size_t bytes = GuardFW::sendmsg(fd, msg, flags | MSG_ZEROCOPY, source_location);
+        return {bytes, next_id++};
+    }
+
+    /**
+     * Sends a message with MSG_ZEROCOPY without blocking.
+     *
+     * @param msg             Message to be sent, must not be empty.
+     * @param flags           Additional sendmsg() flags.
+     * @param source_location Holds information about caller/calling position.
+     * @return                number of sent bytes and send id or std::nullopt, if the socket would block
+     */
+    [[nodiscard]] std::optional<ZeroCopySend> sendmsg_nonblock(
+        const struct msghdr* msg,
+        int flags                                   = 0,
+        const std::source_location& source_location = std::source_location::current()
+    )
+    {
+        std::optional<size_t> bytes =
+            GuardFW::sendmsg_nonblock(fd, msg, flags | MSG_ZEROCOPY | MSG_DONTWAIT, source_location);
+        if (!bytes.has_value())
+            return std::nullopt;
+        return ZeroCopySend {bytes.value(), next_id++};
+    }
+
+    /**
+     * Reaps all pending completion notifications from the socket error queue, never blocks.
+     *
+     * A pending notification is signalled by POLLERR/EPOLLERR. Timestamps in the error queue are skipped, other
+     * error queue entries with an error number (e.g. ICMP errors) are thrown, as they are removed by reading.
+     *
+     * @tparam CALLBACK        Callable with a ZeroCopyCompletion argument.
+     * @param  callback        Called for each completed range of sends.
+     * @param  source_location Holds information about caller/calling position.
+     * @return                 number of completed sends
+     */
+    template<typename CALLBACK>
+    size_t reap(CALLBACK&& callback, const std::source_location& source_location = std::source_location::current())
+    {
+        size_t completed = 0;
+        std::optional<ZeroCopyCompletion> completion;
+        while ((completion = reap_one(source_location)).has_value())
+        {
+            completed += completion->count();
+            callback(completion.value());
+        }
+        return completed;
+    }
+
+    /**
+     * Reaps all pending completion notifications without reporting their ranges.
+     *
+     * @param source_location Holds information about caller/calling position.
+     * @return                number of completed sends
+     */
+    size_t reap(const std::source_location& source_location = std::source_location::current())
+    {
+        return reap([](const ZeroCopyCompletion&) {}, source_location);
+    }
+
+    /// @return number of sends, which have not been completed yet
+    [[nodiscard]] uint32_t outstanding() const noexcept
+    {
+        return next_id - completed_ids;
+    }
+
+    /// @return true, if the kernel had to copy the data of any completed send
+    [[nodiscard]] bool copy_fallback() const noexcept
+    {
+        return copied;
+    }
+
+private:
+    /// Reads one entry from the error queue, returns std::nullopt if the queue is empty.
+    std::optional<ZeroCopyCompletion> reap_one(const std::source_location& source_location)
+    {
+        while (true)
+        {
+            // control message carries sock_extended_err followed by the offender address
+            alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(sockaddr_in6))];
+            struct msghdr msg {};
+            msg.msg_control    = control;
+            msg.msg_controllen = sizeof(control);
+
+            if (!GuardFW::recvmsg_nonblock(fd, &msg, MSG_ERRQUEUE, source_location).has_value())
+                return std::nullopt;
+
+            for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+            {
+                const bool is_ipv4 = (cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR);
+                const bool is_ipv6 = (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR);
+                if (!is_ipv4 && !is_ipv6)
+                    continue;
+
+                struct sock_extended_err error {};
+                memcpy(&error, CMSG_DATA(cmsg), sizeof(error));
+                if (error.ee_origin == SO_EE_ORIGIN_TIMESTAMPING)  // reported with ENOMSG, no send error
+                    continue;
+                if (error.ee_errno != 0)  // e.g. an ICMP error, which would be lost after reading it
+                    throw_system_error(static_cast<int>(error.ee_errno), "ZeroCopySender::reap", source_location);
+                if (error.ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                    continue;
+
+                const ZeroCopyCompletion completion {
+                    .first  = error.ee_info,
+                    .last   = error.ee_data,
+                    .copied = (error.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0,
+                };
+                completed_ids += completion.count();
+                copied = copied || completion.copied;
+                return completion;
+            }
+        }
+    }
+
+    FileDescriptor fd;
+    uint32_t next_id {0};
+    uint32_t completed_ids {0};
+    bool copied {false};
+};
+
+}  // namespace GuardFW
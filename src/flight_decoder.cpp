@@ -0,0 +1,65 @@
+/**
+ * Offline decoder of binary flight recorder dumps.
+ *
+ * Prints the records of a dump written by GuardFW::flight_recorder::dump_binary(), e.g. by terminate_handler()
+ * after GuardFW::flight_recorder::configure_terminate_dump(), oldest record first.
+ *
+ * Usage: flight-decoder [dump file], reads from stdin without file
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <cstddef>   // std::byte
+#include <cstdio>    // std::fopen(), std::fread(), std::printf(), std::fprintf()
+#include <optional>  // std::optional<>
+#include <vector>    // std::vector<>
+
+import guardfw.flight_recorder;
+
+int main(int argc, char* argv[])
+{
+    if (argc > 2)
+    {
+        (void) std::fprintf(stderr, "usage: %s [dump file]\n", argv[0]);
+        return 2;
+    }
+
+    std::FILE* input = (argc == 2) ? std::fopen(argv[1], "rb") : stdin;
+    if (input == nullptr)
+    {
+        std::perror(argv[1]);
+        return 1;
+    }
+    std::vector<std::byte> data;
+    std::byte buffer[4096];
+    size_t length = 0;
+    while ((length = std::fread(buffer, 1, sizeof(buffer), input)) > 0)
+        data.insert(data.end(), buffer, buffer + length);
+    if (input != stdin)
+        (void) std::fclose(input);
+
+    const std::optional<GuardFW::flight_recorder::Dump> dump = GuardFW::flight_recorder::parse_dump(data);
+    if (!dump)
+    {
+        (void) std::fprintf(stderr, "no valid flight recorder dump\n");
+        return 1;
+    }
+
+    (void) std::printf(
+        "%u of %llu calls, %u functions, ages relative to dump\n",
+        dump->header.records,
+        static_cast<unsigned long long>(dump->header.calls),
+        dump->header.functions
+    );
+    char line[256];
+    for (const GuardFW::flight_recorder::Record& record : dump->records)
+    {
+        length = GuardFW::flight_recorder::format_record(
+            line, sizeof(line), record, dump->name_of(record), dump->header.now, dump->header.unit
+        );
+        (void) std::printf("%.*s\n", static_cast<int>(length), line);
+    }
+    return 0;
+}
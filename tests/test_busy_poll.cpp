@@ -0,0 +1,166 @@
+/**
+ * Catch2 unit tests for modules/busy_poll.cppm and the epoll busy poll wrappers
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>        // std::chrono::milliseconds, std::chrono::microseconds
+#include <cstddef>       // size_t
+#include <optional>      // std::optional<>
+#include <sys/socket.h>  // ::socketpair(), AF_UNIX, SOCK_*, SOL_SOCKET, SO_BUSY_POLL, msghdr
+#include <sys/uio.h>     // iovec
+#include <system_error>  // std::system_error
+#include <thread>        // std::thread, std::this_thread::sleep_for()
+
+#include "test_helpers.hpp"
+
+import guardfw.busy_poll;
+import guardfw.wrapped_epoll;
+import guardfw.wrapped_socket;
+import guardfw.wrapped_unistd;
+
+using namespace std::chrono_literals;
+
+TEST_CASE("busy poll: receive phases", "[busy_poll]")
+{
+    int fds[2] {};
+    REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) == 0);
+    char buffer[16] {};
+
+    {
+        GuardFW::BusyPollReceiver receiver(fds[0], {.min_spin = 0ns, .max_spin = 0ns, .yields = 0});
+        CHECK(GuardFW::write(fds[1], "a", 1) == 1);
+        CHECK(receiver.receive(buffer, sizeof(buffer)) == 1);
+        CHECK(receiver.statistics().immediate == 1);
+
+        CHECK(!receiver.receive(buffer, sizeof(buffer), 0, 1).has_value());
+        CHECK(receiver.statistics().timeouts == 1);
+
+        std::thread sender([fd = fds[1]] {
+            std::this_thread::sleep_for(5ms);
+            (void) GuardFW::write(fd, "bc", 2);
+        });
+        CHECK(receiver.receive(buffer, sizeof(buffer), 0, 1000) == 2);  // no spin budget and no yields
+        sender.join();
+        CHECK(receiver.statistics().slept == 1);
+        CHECK(receiver.statistics().spun == 0);
+    }
+
+    {
+        const std::chrono::nanoseconds budget = 2s;
+        GuardFW::BusyPollReceiver receiver(fds[0], {.min_spin = budget, .max_spin = budget, .initial_spin = budget});
+        std::thread sender([fd = fds[1]] {
+            std::this_thread::sleep_for(1ms);
+            (void) GuardFW::write(fd, "d", 1);
+        });
+        CHECK(receiver.receive(buffer, sizeof(buffer), 0, 1000) == 1);
+        sender.join();
+        const GuardFW::BusyPollStatistics& statistics = receiver.statistics();
+        CHECK(statistics.spun + statistics.yielded == 1);  // the sender preempts a spinning receiver on a single CPU
+        CHECK(statistics.slept == 0);
+        CHECK(statistics.spin_time >= 1ms);
+    }
+
+    GuardFW::close(fds[0]);
+    GuardFW::close(fds[1]);
+}
+
+TEST_CASE("busy poll: adapt spin budget to inter-arrival time", "[busy_poll]")
+{
+    int fds[2] {};
+    REQUIRE(::socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) == 0);
+    char buffer[16] {};
+    struct iovec vector {.iov_base = buffer, .iov_len = sizeof(buffer)};
+    struct msghdr message {};
+    message.msg_iov    = &vector;
+    message.msg_iovlen = 1;
+
+    const GuardFW::BusyPollOptions options {.min_spin = 1us, .max_spin = 200us, .initial_spin = 50us};
+    GuardFW::BusyPollReceiver receiver(fds[0], options);
+    CHECK(receiver.spin_budget() == 50us);
+
+    for (size_t count = 0; count < 16; count++)  // back-to-back messages
+        CHECK(GuardFW::write(fds[1], "x", 1) == 1);
+    for (size_t count = 0; count < 16; count++)
+        CHECK(receiver.receive_message(&message, 0, 1000) == 1);
+    CHECK(receiver.inter_arrival_time() < options.max_spin);
+    CHECK(receiver.spin_budget() >= options.min_spin);
+    CHECK(receiver.spin_budget() <= options.max_spin);
+    CHECK(receiver.statistics().immediate == 16);
+
+    for (size_t count = 0; count < 4; count++)  // sparse messages, spinning does not pay off
+    {
+        std::this_thread::sleep_for(2ms);
+        CHECK(GuardFW::write(fds[1], "y", 1) == 1);
+        CHECK(receiver.receive(buffer, sizeof(buffer), 0, 1000) == 1);
+    }
+    CHECK(receiver.inter_arrival_time() > options.max_spin);
+    CHECK(receiver.spin_budget() == options.min_spin);
+
+    GuardFW::close(fds[0]);
+    GuardFW::close(fds[1]);
+}
+
+TEST_CASE("busy poll: kernel busy polling", "[busy_poll]")
+{
+    int fds[2] {};
+    REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) == 0);
+
+    const GuardFW::BusyPollOptions options {.kernel_busy_poll_usecs = 20, .kernel_prefer_busy_poll = true};
+    std::optional<GuardFW::BusyPollReceiver> receiver;
+    const int error = error_of([&receiver, &fds, &options] { receiver.emplace(fds[0], options); });
+    if (error != 0)  // needs CAP_NET_ADMIN above net.core.busy_poll
+        WARN("kernel busy polling is not available, error " << error);
+    else
+    {
+        CHECK(GuardFW::getsockopt<int>(fds[0], SOL_SOCKET, SO_BUSY_POLL) == 20);
+        CHECK(GuardFW::getsockopt<int>(fds[0], SOL_SOCKET, SO_PREFER_BUSY_POLL) == 1);
+        if (receiver->kernel_epoll_busy_poll())
+        {
+            const GuardFW::EpollParams params = GuardFW::epoll_get_params(receiver->epoll());
+            CHECK(params.busy_poll_usecs == 20);
+            CHECK(params.prefer_busy_poll == 1);
+        }
+        else  // before Linux 6.9, only the socket options are set
+            WARN("epoll busy polling is not supported by the kernel");
+    }
+    receiver.reset();
+
+    GuardFW::close(fds[0]);
+    GuardFW::close(fds[1]);
+}
+
+TEST_CASE("busy poll: kernel busy polling without the epoll ioctl", "[busy_poll]")
+{
+    int fds[2] {};
+    REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) == 0);
+    char buffer[16] {};
+
+    // like a kernel before Linux 6.9, which does not support EPIOCSPARAMS
+    const GuardFW::BusyPollOptions options {.kernel_busy_poll_usecs = 20, .kernel_epoll_busy_poll = false};
+    std::optional<GuardFW::BusyPollReceiver> receiver;
+    const int error = error_of([&receiver, &fds, &options] { receiver.emplace(fds[0], options); });
+    if (error != 0)  // needs CAP_NET_ADMIN above net.core.busy_poll
+        WARN("kernel busy polling is not available, error " << error);
+    else
+    {
+        CHECK_FALSE(receiver->kernel_epoll_busy_poll());
+        CHECK(GuardFW::getsockopt<int>(fds[0], SOL_SOCKET, SO_BUSY_POLL) == 20);
+        std::thread sender([fd = fds[1]] {
+            std::this_thread::sleep_for(5ms);
+            (void) GuardFW::write(fd, "abc", 3);
+        });
+        CHECK(receiver->receive(buffer, sizeof(buffer), 0, 1000) == 3);
+        sender.join();
+        CHECK(!receiver->receive(buffer, sizeof(buffer), 0, 10).has_value());
+        CHECK(receiver->statistics().timeouts == 1);
+    }
+    receiver.reset();
+
+    GuardFW::close(fds[0]);
+    GuardFW::close(fds[1]);
+}
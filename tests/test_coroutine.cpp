@@ -0,0 +1,173 @@
+/**
+ * Catch2 unit tests for modules/coroutine.cppm
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstddef>       // size_t, std::byte
+#include <netinet/in.h>  // sockaddr_in, INADDR_LOOPBACK
+#include <span>          // std::span<>
+#include <stdexcept>     // std::runtime_error
+#include <string_view>   // std::string_view
+#include <sys/socket.h>  // ::socketpair(), ::shutdown(), ::getsockname()
+#include <system_error>  // std::system_error
+#include <vector>        // std::vector<>
+
+import guardfw.coroutine;
+import guardfw.wrapped_socket;
+import guardfw.wrapped_unistd;
+
+/// Sends the whole buffer.
+static GuardFW::Task<void> send_all(int fd, std::span<const std::byte> data)
+{
+    while (!data.empty())
+        data = data.subspan(co_await GuardFW::async_send(fd, data, MSG_NOSIGNAL));
+}
+
+/// Receives until the peer shuts down.
+static GuardFW::Task<size_t> receive_all(int fd, std::vector<std::byte>& received)
+{
+    std::byte buffer[4096] {};
+    for (;;)
+    {
+        const size_t length = co_await GuardFW::async_recv(fd, buffer);
+        if (length == 0)
+            co_return received.size();
+        received.insert(received.end(), buffer, buffer + length);
+    }
+}
+
+TEST_CASE("coroutine: transfer over a socket pair", "[coroutine]")
+{
+    int fds[2] {};
+    REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == 0);
+
+    std::vector<std::byte> data(1'000'000);
+    for (size_t index = 0; index < data.size(); index++)
+        data[index] = static_cast<std::byte>(index * 7);
+    std::vector<std::byte> received;
+    size_t total = 0;
+
+    GuardFW::Scheduler scheduler;
+    scheduler.spawn([](int fd, const std::vector<std::byte>& source) -> GuardFW::Task<void> {
+        co_await send_all(fd, source);
+        (void) ::shutdown(fd, SHUT_WR);
+    }(fds[0], data));
+    scheduler.spawn([](int fd, std::vector<std::byte>& sink, size_t& result) -> GuardFW::Task<void> {
+        result = co_await receive_all(fd, sink);
+    }(fds[1], received, total));
+    scheduler.run();
+
+    CHECK(total == data.size());
+    CHECK(received == data);
+
+    scheduler.forget(fds[0]);
+    scheduler.forget(fds[1]);
+    GuardFW::close(fds[0]);
+    GuardFW::close(fds[1]);
+}
+
+TEST_CASE("coroutine: accept and echo over loopback", "[coroutine]")
+{
+    const int listener = GuardFW::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    struct sockaddr_in address {};
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    GuardFW::bind(listener, reinterpret_cast<struct sockaddr*>(&address), sizeof(address));
+    GuardFW::listen(listener, 1);
+    socklen_t address_length = sizeof(address);
+    REQUIRE(::getsockname(listener, reinterpret_cast<struct sockaddr*>(&address), &address_length) == 0);
+
+    GuardFW::Scheduler scheduler;
+    scheduler.spawn([](GuardFW::Scheduler& owner, int fd) -> GuardFW::Task<void> {
+        const int connection = co_await GuardFW::async_accept4(fd, nullptr, nullptr, SOCK_NONBLOCK);
+        std::byte buffer[16] {};
+        const size_t length = co_await GuardFW::async_read(connection, buffer);
+        co_await GuardFW::async_write(connection, std::span<const std::byte>(buffer, length));
+        owner.forget(connection);
+        GuardFW::close(connection);
+    }(scheduler, listener));
+
+    // blocking client, the connection is completed by the backlog before it is accepted
+    const int client = GuardFW::socket(AF_INET, SOCK_STREAM, 0);
+    GuardFW::connect(client, reinterpret_cast<struct sockaddr*>(&address), sizeof(address));
+    const char request[] = "ping";
+    CHECK(GuardFW::write(client, request, sizeof(request)) == sizeof(request));
+
+    scheduler.run();
+
+    char response[16] {};
+    CHECK(GuardFW::read(client, response, sizeof(response)) == sizeof(request));
+    CHECK(std::string_view(response) == "ping");
+
+    GuardFW::close(client);
+    scheduler.forget(listener);
+    GuardFW::close(listener);
+}
+
+TEST_CASE("coroutine: errors are thrown at co_await and from run()", "[coroutine]")
+{
+    GuardFW::Scheduler scheduler;
+    bool caught = false;
+    scheduler.spawn([](bool& flag) -> GuardFW::Task<void> {
+        std::byte buffer[1] {};
+        try
+        {
+            (void) co_await GuardFW::async_recv(-1, buffer);
+        }
+        catch (const std::system_error&)
+        {
+            flag = true;
+        }
+    }(caught));
+    scheduler.run();
+    CHECK(caught);
+
+    scheduler.spawn([]() -> GuardFW::Task<void> {
+        co_await []() -> GuardFW::Task<int> {
+            throw std::runtime_error("failed");
+            co_return 0;
+        }();
+    }());
+    CHECK_THROWS_AS(scheduler.run(), std::runtime_error);
+}
+
+TEST_CASE("coroutine: the scheduler destroys suspended tasks", "[coroutine]")
+{
+    int fds[2] {};
+    REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == 0);
+
+    /// Sets a flag on destruction, like a RAII object within a coroutine frame.
+    struct Guard
+    {
+        bool& destroyed;
+        ~Guard()
+        {
+            destroyed = true;
+        }
+    };
+
+    bool destroyed = false;
+    {
+        GuardFW::Scheduler scheduler;
+        scheduler.spawn([](int fd, bool& flag) -> GuardFW::Task<void> {
+            const Guard guard {flag};
+            std::byte buffer[1] {};
+            (void) co_await GuardFW::async_recv(fd, buffer);  // no data is sent
+        }(fds[0], destroyed));
+        scheduler.spawn([]() -> GuardFW::Task<void> {
+            throw std::runtime_error("stop");
+            co_return;
+        }());
+        CHECK_THROWS_AS(scheduler.run(), std::runtime_error);
+        CHECK_FALSE(destroyed);  // still waiting for data
+    }
+    CHECK(destroyed);
+
+    CHECK_NOTHROW(GuardFW::close(fds[0]));
+    CHECK_NOTHROW(GuardFW::close(fds[1]));
+}
@@ -0,0 +1,139 @@
+/**
+ * Catch2 unit tests for modules/direct_file.cppm and the file hint wrappers
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>     // std::min()
+#include <cerrno>        // EBADF, EINVAL, ENOBUFS
+#include <cstddef>       // size_t, std::byte
+#include <cstdint>       // uintptr_t
+#include <fcntl.h>       // O_*
+#include <span>          // std::span<>
+#include <string>        // std::string, std::to_string()
+#include <sys/stat.h>    // struct stat
+#include <system_error>  // std::system_error
+#include <unistd.h>      // ::getpid(), ::unlink()
+#include <vector>        // std::vector<>
+
+#include "test_helpers.hpp"
+
+import guardfw.direct_file;
+import guardfw.wrapped_fcntl;
+import guardfw.wrapped_stat;
+import guardfw.wrapped_unistd;
+
+/// @return path of a temporary file in a file system, which usually supports O_DIRECT
+static std::string temporary_path(const char* name)
+{
+    return std::string("/var/tmp/guardfw-test-") + name + "-" + std::to_string(::getpid());
+}
+
+TEST_CASE("direct file: file hint wrappers", "[direct_file]")
+{
+    const std::string path = temporary_path("hints");
+    const int fd           = GuardFW::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+
+    CHECK_NOTHROW(GuardFW::fallocate(fd, GuardFW::constants::falloc_fl_keep_size, 0, 1 << 20));
+    struct stat status {};
+    GuardFW::fstat(fd, &status);
+    CHECK(status.st_size == 0);  // space is allocated without changing the size
+
+    CHECK(GuardFW::write(fd, "journal", 7) == 7);
+    CHECK_NOTHROW(GuardFW::sync_file_range(fd, 0, 0, GuardFW::constants::sync_file_range_write));
+    CHECK_NOTHROW(GuardFW::fdatasync(fd));
+    CHECK_NOTHROW(GuardFW::posix_fadvise(fd, 0, 0, GuardFW::constants::posix_fadv_dontneed));
+    CHECK_NOTHROW(GuardFW::readahead(fd, 0, 4096));
+
+    CHECK(error_of([fd] { GuardFW::posix_fadvise(fd, 0, 0, 12345); }) == EINVAL);  // returned, not in errno
+    CHECK(error_of([] { GuardFW::posix_fadvise(-1, 0, 0, GuardFW::constants::posix_fadv_normal); }) == EBADF);
+    CHECK(error_of([] { GuardFW::fdatasync(-1); }) == EBADF);
+
+    GuardFW::close(fd);
+    ::unlink(path.c_str());
+}
+
+TEST_CASE("direct file: aligned buffer pool", "[direct_file]")
+{
+    GuardFW::AlignedBufferPool pool(5000, 2);
+    CHECK(pool.buffer_size() == 8192);
+    CHECK(pool.buffer_count() == 2);
+
+    std::byte* const first  = pool.acquire();
+    std::byte* const second = pool.acquire();
+    REQUIRE(first != nullptr);
+    REQUIRE(second != nullptr);
+    CHECK(reinterpret_cast<uintptr_t>(first) % GuardFW::AlignedBufferPool::alignment == 0);
+    CHECK(reinterpret_cast<uintptr_t>(second) % GuardFW::AlignedBufferPool::alignment == 0);
+    CHECK(pool.acquire() == nullptr);
+    pool.release(first);
+    CHECK(pool.available() == 1);
+    CHECK(pool.acquire() == first);
+    pool.release(first);
+    pool.release(second);
+}
+
+/// Writes a file with DirectFileWriter and reads it back with DirectFileReader.
+static void check_stream(GuardFW::FileCaching caching)
+{
+    const std::string path = temporary_path("stream");
+    GuardFW::AlignedBufferPool pool(16384, 2);
+
+    std::vector<std::byte> data(300'001);  // not aligned
+    for (size_t index = 0; index < data.size(); index++)
+        data[index] = static_cast<std::byte>(index * 13 + index / 256);
+
+    {
+        GuardFW::DirectFileWriter writer(path.c_str(), pool, data.size(), caching);
+        CHECK(writer.direct() == (caching == GuardFW::FileCaching::direct));
+        std::span<const std::byte> remaining(data);
+        for (size_t chunk = 1; !remaining.empty(); chunk = chunk * 3 + 1)  // uneven chunks
+        {
+            const size_t length = std::min(chunk, remaining.size());
+            writer.write(remaining.first(length));
+            remaining = remaining.subspan(length);
+        }
+        CHECK(writer.size() == data.size());
+        writer.close();
+    }
+    CHECK(pool.available() == 2);
+
+    struct stat status {};
+    GuardFW::stat(path.c_str(), &status);
+    CHECK(static_cast<size_t>(status.st_size) == data.size());
+
+    std::vector<std::byte> read_back;
+    {
+        GuardFW::DirectFileReader reader(path.c_str(), pool, caching);
+        CHECK(reader.size() == data.size());
+        for (std::span<const std::byte> chunk = reader.read(); !chunk.empty(); chunk = reader.read())
+            read_back.insert(read_back.end(), chunk.begin(), chunk.end());
+        CHECK(reader.read().empty());
+    }
+    CHECK(pool.available() == 2);
+    CHECK(read_back == data);
+
+    {
+        GuardFW::DirectFileReader early_closed(path.c_str(), pool, caching);  // reads in flight are discarded
+        CHECK(early_closed.read().size() == pool.buffer_size());
+    }
+    CHECK(pool.available() == 2);
+
+    std::byte* const borrowed_first  = pool.acquire();
+    std::byte* const borrowed_second = pool.acquire();
+    CHECK(error_of([&path, &pool] { GuardFW::DirectFileReader reader(path.c_str(), pool); }) == ENOBUFS);
+    pool.release(borrowed_first);
+    pool.release(borrowed_second);
+
+    ::unlink(path.c_str());
+}
+
+TEST_CASE("direct file: stream through the pipeline", "[direct_file]")
+{
+    check_stream(GuardFW::FileCaching::direct);
+    check_stream(GuardFW::FileCaching::buffered);
+}
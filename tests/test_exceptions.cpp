@@ -0,0 +1,84 @@
+/**
+ * Catch2 unit tests for modules/exceptions.cppm
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cerrno>           // EBADF
+#include <cstring>          // ::strstr()
+#include <source_location>  // std::source_location
+#include <sstream>          // std::ostringstream
+#include <string>           // std::string
+#include <system_error>     // std::system_error, std::errc
+
+import guardfw.exceptions;
+
+namespace
+{
+
+consteval std::source_location fixed_location()
+{
+    return std::source_location::current();
+}
+
+}  // namespace
+
+constexpr static std::source_location fixloc = fixed_location();
+
+TEST_CASE("exceptions: WrapperError content", "[exceptions]")
+{
+    const GuardFW::WrapperError error(EBADF, "close", fixloc);
+
+    CHECK(error.code().value() == EBADF);
+    CHECK(error.code() == std::errc::bad_file_descriptor);
+    CHECK(error.code() == std::error_code(EBADF, std::system_category()));
+    CHECK(&error.code().category() == &std::system_category());
+    CHECK(error.code().message() == std::system_category().message(EBADF));
+    CHECK(error.wrapped_function_name() == "close");
+    CHECK(error.source_location().line() == fixloc.line());
+
+    std::ostringstream what;
+    what << "in function '" << fixloc.function_name() << "' in file '" << fixloc.file_name() << "' at line "
+         << fixloc.line() << ": wrapped call to 'close()' failed with error 9: Bad file descriptor";
+    CHECK(std::string(error.what()) == what.str());
+    CHECK(error.what() == error.what());  // built once
+}
+
+TEST_CASE("exceptions: what() texts of WrapperErrors are independent", "[exceptions]")
+{
+    const GuardFW::WrapperError first(EBADF, "close", fixloc);
+    const GuardFW::WrapperError second(EINVAL, "open", fixloc);
+    const char* first_what = first.what();
+    const char* second_what = second.what();
+    CHECK(std::strstr(first_what, "'close()' failed with error 9: Bad file descriptor") != nullptr);
+    CHECK(std::strstr(second_what, "'open()' failed with error 22: Invalid argument") != nullptr);
+
+    const GuardFW::WrapperError copy(first);  // NOLINT(performance-unnecessary-copy-initialization)
+    CHECK(std::string(copy.what()) == first_what);
+    CHECK(copy.code() == first.code());
+
+    const GuardFW::WrapperError uncached(100'000, "ioctl", fixloc);  // outside of the prototype cache
+    CHECK(uncached.code().value() == 100'000);
+    CHECK(&uncached.code().category() == &std::system_category());
+}
+
+TEST_CASE("exceptions: throw_system_error throws WrapperError", "[exceptions]")
+{
+    CHECK_THROWS_AS(GuardFW::throw_system_error(EINVAL, "open", fixloc), GuardFW::WrapperError);
+    CHECK_THROWS_AS(GuardFW::throw_system_error(EINVAL, "open", fixloc), std::system_error);
+
+    try
+    {
+        GuardFW::throw_system_error(EINVAL, "open", fixloc);
+    }
+    catch (const std::system_error& error)
+    {
+        CHECK(error.code() == std::errc::invalid_argument);
+        const char* expected = ": wrapped call to 'open()' failed with error 22: Invalid argument";
+        CHECK(std::strstr(error.what(), expected) != nullptr);
+    }
+}
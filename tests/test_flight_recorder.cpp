@@ -0,0 +1,182 @@
+/**
+ * Catch2 unit tests for modules/flight_recorder.cppm
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstddef>          // size_t, std::byte
+#include <optional>         // std::optional<>
+#include <source_location>  // std::source_location
+#include <span>             // std::span<>
+#include <string>           // std::string
+#include <thread>           // std::thread
+#include <unistd.h>         // ::pipe(), ::read(), ::close()
+#include <vector>           // std::vector<>
+
+#include <errno.h>
+
+import guardfw.flight_recorder;
+import guardfw.wrapper;
+
+namespace
+{
+
+using ContextFlightRecorder = GuardFW::Context<
+    GuardFW::ErrorIndication::eqm1_errno,
+    GuardFW::ErrorReport::exception,
+    GuardFW::ErrorSpecial::eintr_repeats | GuardFW::ErrorSpecial::nonblock | GuardFW::ErrorSpecial::flight_recorder>;
+
+/// @return output of a dump function, written into a pipe
+template<typename DUMP>
+std::vector<std::byte> dump_of(DUMP&& dump)
+{
+    int fds[2] {};
+    REQUIRE(::pipe(fds) == 0);
+    dump(fds[1]);
+    ::close(fds[1]);
+    std::vector<std::byte> output;
+    std::byte buffer[4096];
+    ssize_t length = 0;
+    while ((length = ::read(fds[0], buffer, sizeof(buffer))) > 0)
+        output.insert(output.end(), buffer, buffer + length);
+    ::close(fds[0]);
+    return output;
+}
+
+}  // namespace
+
+static int flight_tester(int return_value, int error)
+{
+    static bool interrupted = false;
+    if (error == EINTR)
+    {
+        interrupted = !interrupted;
+        if (!interrupted)
+            return return_value;  // second call succeeds
+    }
+    if (error != 0)
+    {
+        errno = error;
+        return -1;
+    }
+    return return_value;
+}
+
+TEST_CASE("flight recorder: calls, errors and repeats are recorded per thread", "[flight_recorder]")
+{
+    const std::source_location location = std::source_location::current();
+    GuardFW::flight_recorder::clear_thread_records();
+
+    CHECK(5 == ContextFlightRecorder::wrapper<flight_tester>(location, 5, 0).value());
+    CHECK(6 == ContextFlightRecorder::wrapper<flight_tester>(location, 6, EINTR).value());
+    CHECK_FALSE(ContextFlightRecorder::wrapper<flight_tester>(location, 7, EAGAIN).has_value());
+    CHECK_THROWS(ContextFlightRecorder::wrapper<flight_tester>(location, 8, EINVAL));
+
+    size_t other_records = 0;
+    std::thread other([location, &other_records] {
+        (void) ContextFlightRecorder::wrapper<flight_tester>(location, 9, 0);
+        other_records = GuardFW::flight_recorder::thread_records().size();
+    });
+    other.join();
+    CHECK(other_records == 1);
+
+    const std::vector<GuardFW::flight_recorder::Record> records = GuardFW::flight_recorder::thread_records();
+    REQUIRE(records.size() == 4);
+    CHECK(GuardFW::flight_recorder::function_name(records[0].function) == "flight_tester");
+    CHECK(records[0].result == 5);
+    CHECK(records[0].error == 0);
+    CHECK(records[1].result == 6);
+    CHECK(records[1].error == 0);  // error of the interrupted call is discarded
+    CHECK(records[1].retries == 1);
+    CHECK(records[2].result == -1);
+    CHECK(records[2].error == EAGAIN);
+    CHECK(records[3].error == EINVAL);  // recorded, although thrown
+    for (size_t index = 1; index < records.size(); index++)
+        CHECK(records[index].timestamp >= records[index - 1].timestamp);
+
+    for (size_t count = 0; count < GuardFW::flight_recorder::capacity + 10; count++)
+        (void) ContextFlightRecorder::wrapper<flight_tester>(location, static_cast<int>(count), 0);
+    const std::vector<GuardFW::flight_recorder::Record> wrapped = GuardFW::flight_recorder::thread_records();
+    REQUIRE(wrapped.size() == GuardFW::flight_recorder::capacity);
+    CHECK(wrapped.front().result == 10);  // oldest records are overwritten
+    CHECK(wrapped.back().result == static_cast<int64_t>(GuardFW::flight_recorder::capacity + 9));
+}
+
+TEST_CASE("flight recorder: text and binary dumps", "[flight_recorder]")
+{
+    const std::source_location location = std::source_location::current();
+    GuardFW::flight_recorder::clear_thread_records();
+    CHECK(dump_of([](int fd) { GuardFW::flight_recorder::dump_text(fd); }).empty());
+
+    CHECK(3 == ContextFlightRecorder::wrapper<flight_tester>(location, 3, EINTR).value());
+    CHECK_THROWS(ContextFlightRecorder::wrapper<flight_tester>(location, 4, EBADF));
+
+    const std::vector<std::byte> text_bytes = dump_of([](int fd) { GuardFW::flight_recorder::dump_text(fd, 8); });
+    const std::string text(reinterpret_cast<const char*>(text_bytes.data()), text_bytes.size());
+    CHECK(text.find("last 2 of 2 calls") != std::string::npos);
+    CHECK(text.find("flight_tester() = 3 (1 EINTR retry)\n") != std::string::npos);
+    CHECK(text.find("flight_tester() = -1 EBADF\n") != std::string::npos);
+
+    const std::vector<std::byte> binary = dump_of([](int fd) { GuardFW::flight_recorder::dump_binary(fd); });
+    const std::optional<GuardFW::flight_recorder::Dump> dump = GuardFW::flight_recorder::parse_dump(binary);
+    REQUIRE(dump.has_value());
+    CHECK(dump->header.calls == 2);
+    CHECK(dump->header.unit == GuardFW::flight_recorder::timestamp_unit);
+    REQUIRE(dump->records.size() == 2);
+    CHECK(dump->name_of(dump->records[0]) == "flight_tester");
+    CHECK(dump->records[0].retries == 1);
+    CHECK(dump->records[1].error == EBADF);
+    CHECK(dump->records[1].timestamp <= dump->header.now);
+
+    CHECK_FALSE(GuardFW::flight_recorder::parse_dump(std::span(binary).first(binary.size() - 1)).has_value());
+    std::vector<std::byte> corrupted = binary;
+    corrupted[0]                     = std::byte {'X'};
+    CHECK_FALSE(GuardFW::flight_recorder::parse_dump(corrupted).has_value());
+}
+
+TEST_CASE("flight recorder: record formatting", "[flight_recorder]")
+{
+    char buffer[128] {};
+    const GuardFW::flight_recorder::Record record {
+        .timestamp = 900, .result = -1, .function = 0, .retries = 2, .error = ENOENT
+    };
+    size_t length = GuardFW::flight_recorder::format_record(
+        buffer, sizeof(buffer), record, "open", 1000, GuardFW::flight_recorder::TimestampUnit::nanoseconds
+    );
+    CHECK(std::string(buffer, length) == "-100 ns  open() = -1 ENOENT (2 EINTR retries)");
+
+    length = GuardFW::flight_recorder::format_record(
+        buffer, 10, record, "open", 1000, GuardFW::flight_recorder::TimestampUnit::tsc_ticks
+    );
+    CHECK(std::string(buffer, length) == "-100 ticks");  // truncated
+
+    const GuardFW::flight_recorder::Record untimed {
+        .timestamp = 0, .result = 3, .function = 0, .retries = 0, .error = 0
+    };
+    length = GuardFW::flight_recorder::format_record(
+        buffer, sizeof(buffer), untimed, "read", 1000, GuardFW::flight_recorder::TimestampUnit::tsc_ticks
+    );
+    CHECK(std::string(buffer, length) == "read() = 3");
+}
+
+TEST_CASE("flight recorder: disabled timestamps", "[flight_recorder]")
+{
+    const std::source_location location = std::source_location::current();
+    GuardFW::flight_recorder::clear_thread_records();
+
+    GuardFW::flight_recorder::enable_timestamps(false);
+    CHECK(1 == ContextFlightRecorder::wrapper<flight_tester>(location, 1, 0).value());
+    GuardFW::flight_recorder::enable_timestamps(true);
+    CHECK(2 == ContextFlightRecorder::wrapper<flight_tester>(location, 2, 0).value());
+
+    const std::vector<GuardFW::flight_recorder::Record> records = GuardFW::flight_recorder::thread_records();
+    REQUIRE(records.size() == 2);
+    CHECK(records[0].timestamp == 0);
+    CHECK(records[1].timestamp != 0);
+    CHECK(GuardFW::flight_recorder::function_name(records[0].function) == "flight_tester");
+    CHECK(GuardFW::flight_recorder::function_name(GuardFW::flight_recorder::unknown_function).empty());
+}
@@ -0,0 +1,26 @@
+/**
+ * Helpers shared by the Catch2 unit tests
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#pragma once
+
+#include <system_error>  // std::system_error
+
+/// @return error code of a call, 0 if it did not throw
+template<typename CALL>
+inline int error_of(CALL&& call)
+{
+    try
+    {
+        call();
+    }
+    catch (const std::system_error& error)
+    {
+        return error.code().value();
+    }
+    return 0;
+}
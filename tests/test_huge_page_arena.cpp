@@ -0,0 +1,85 @@
+/**
+ * Catch2 unit tests for modules/huge_page_arena.cppm
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstddef>          // size_t, std::byte
+#include <cstdint>          // uintptr_t
+#include <memory_resource>  // std::pmr::vector<>
+#include <string>           // std::string
+#include <sys/mman.h>       // MFD_CLOEXEC, MADV_*, MREMAP_MAYMOVE
+#include <vector>           // std::vector<>
+
+import guardfw.huge_page_arena;
+import guardfw.wrapped_mman;    // GuardFW::mmap(), ...
+import guardfw.wrapped_unistd;  // GuardFW::close(), ...
+
+constexpr size_t huge_page_size {size_t {2} << 20};
+
+TEST_CASE("huge page arena: aligned allocations and release", "[huge_page_arena]")
+{
+    GuardFW::HugePageArena arena;
+
+    CHECK(arena.capacity() == huge_page_size);
+    CHECK(arena.region_count() == 1);
+    CHECK(arena.used() == 0);
+
+    void* first  = arena.allocate(10, 1);
+    void* second = arena.allocate(64, 64);
+    CHECK(reinterpret_cast<uintptr_t>(second) % 64 == 0);
+    CHECK(static_cast<std::byte*>(second) > static_cast<std::byte*>(first));
+    CHECK(arena.used() == 128);
+
+    if (arena.backing() == GuardFW::HugePageBacking::transparent_pages)  // explicit pages depend on nr_hugepages
+        CHECK(reinterpret_cast<uintptr_t>(first) % huge_page_size == 0);
+
+    arena.release();
+    CHECK(arena.used() == 0);
+    CHECK(arena.allocate(10, 1) == first);
+}
+
+TEST_CASE("huge page arena: growth keeps allocations in place", "[huge_page_arena]")
+{
+    GuardFW::HugePageArena arena({.explicit_huge_pages = false, .populate = true});
+    CHECK(arena.backing() == GuardFW::HugePageBacking::transparent_pages);
+
+    std::pmr::vector<std::pmr::string> strings(&arena);
+    std::vector<const char*> addresses;
+    for (size_t index = 0; index < 1000; index++)
+    {
+        strings.emplace_back(std::string(3000, static_cast<char>('a' + (index % 26))));
+        addresses.push_back(strings.back().data());
+    }
+
+    CHECK(arena.capacity() > huge_page_size);
+    for (size_t index = 0; index < strings.size(); index++)
+    {
+        CHECK(strings[index].data() == addresses[index]);
+        CHECK(strings[index].front() == static_cast<char>('a' + (index % 26)));
+    }
+}
+
+TEST_CASE("mman wrappers: madvise, mremap and memfd_create", "[mman]")
+{
+    void* mapped = GuardFW::mmap(
+        nullptr,
+        huge_page_size,
+        GuardFW::constants::prot_read | GuardFW::constants::prot_write,
+        GuardFW::constants::map_private | GuardFW::constants::map_anonymous,
+        -1,
+        0
+    );
+    CHECK_NOTHROW(GuardFW::madvise(mapped, huge_page_size, GuardFW::constants::madv_willneed));
+
+    void* remapped = GuardFW::mremap(mapped, huge_page_size, 2 * huge_page_size, GuardFW::constants::mremap_maymove);
+    CHECK_NOTHROW(GuardFW::munmap(remapped, 2 * huge_page_size));
+
+    GuardFW::FileDescriptor fd = GuardFW::memfd_create("guardfw-mman", GuardFW::constants::mfd_cloexec);
+    CHECK(fd >= 0);
+    CHECK_NOTHROW(GuardFW::close(fd));
+}
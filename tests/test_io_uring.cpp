@@ -0,0 +1,139 @@
+/**
+ * Catch2 unit tests for modules/io_uring.cppm
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>             // std::array<>
+#include <cerrno>            // EINVAL
+#include <cstdint>           // uint64_t
+#include <expected>          // std::expected<>
+#include <linux/io_uring.h>  // IORING_OP_*, IORING_SETUP_*, IOSQE_FIXED_FILE
+#include <string_view>       // std::string_view
+#include <sys/eventfd.h>     // EFD_NONBLOCK
+#include <sys/socket.h>      // ::socketpair(), AF_UNIX, SOCK_*, MSG_DONTWAIT
+#include <sys/uio.h>         // iovec
+#include <system_error>      // std::system_error
+
+#include "test_helpers.hpp"
+
+import guardfw.io_uring;
+import guardfw.wrapped_eventfd;  // GuardFW::eventfd()
+import guardfw.wrapped_io_uring;  // GuardFW::recv_completion(), GuardFW::send_completion()
+import guardfw.wrapped_unistd;   // GuardFW::close()
+
+TEST_CASE("io_uring ring: batched nop submission", "[io_uring]")
+{
+    GuardFW::IoUring ring(8);
+
+    CHECK(ring.fd() >= 0);
+    CHECK(ring.sq_space_left() == ring.params().sq_entries);
+
+    constexpr uint64_t batch = 4;
+    for (uint64_t index = 0; index < batch; index++)
+    {
+        struct io_uring_sqe* sqe = ring.get_sqe();
+        REQUIRE(sqe != nullptr);
+        GuardFW::IoUring::prep(*sqe, IORING_OP_NOP, -1, nullptr, 0, 0, index);
+    }
+    CHECK(ring.sq_pending() == batch);
+
+    std::expected<unsigned int, int> submitted = ring.submit_and_wait(batch);
+    REQUIRE(submitted.has_value());
+    CHECK(submitted.value() == batch);
+    CHECK(ring.sq_pending() == 0);
+    CHECK(ring.cq_ready() == batch);
+
+    uint64_t expected_user_data = 0;
+    CHECK(batch == ring.for_each_cqe([&expected_user_data](const struct io_uring_cqe& cqe) {
+        CHECK(cqe.res == 0);
+        CHECK(cqe.user_data == expected_user_data++);
+    }));
+    CHECK(ring.cq_ready() == 0);
+    CHECK(ring.peek_cqe() == nullptr);
+}
+
+TEST_CASE("io_uring ring: full submission queue", "[io_uring]")
+{
+    GuardFW::IoUring ring(2);
+
+    for (unsigned int index = 0; index < ring.params().sq_entries; index++)
+        CHECK(ring.get_sqe() != nullptr);
+    CHECK(ring.get_sqe() == nullptr);
+    CHECK(ring.sq_space_left() == 0);
+
+    REQUIRE(ring.submit().has_value());
+    CHECK(ring.sq_space_left() == ring.params().sq_entries);
+}
+
+TEST_CASE("io_uring ring: unsupported entry sizes", "[io_uring]")
+{
+    CHECK(error_of([] { GuardFW::IoUring ring(2, IORING_SETUP_SQE128); }) == EINVAL);
+    CHECK(error_of([] { GuardFW::IoUring ring(2, IORING_SETUP_CQE32); }) == EINVAL);
+}
+
+TEST_CASE("io_uring ring: registered file and buffer", "[io_uring]")
+{
+    GuardFW::IoUring ring(4);
+
+    GuardFW::FileDescriptor event_fd = GuardFW::eventfd(42, EFD_NONBLOCK);
+    const std::array<GuardFW::FileDescriptor, 1> files {event_fd};
+    CHECK_NOTHROW(ring.register_files(files));
+
+    uint64_t value = 0;
+    const std::array<struct iovec, 1> buffers {{{.iov_base = &value, .iov_len = sizeof(value)}}};
+    CHECK_NOTHROW(ring.register_buffers(buffers));
+
+    struct io_uring_sqe* sqe = ring.get_sqe();
+    REQUIRE(sqe != nullptr);
+    GuardFW::IoUring::prep(*sqe, IORING_OP_READ_FIXED, 0, &value, sizeof(value), 0, 7);
+    sqe->flags |= IOSQE_FIXED_FILE;
+    sqe->buf_index = 0;
+
+    REQUIRE(ring.submit().has_value());
+    std::expected<struct io_uring_cqe*, int> cqe = ring.wait_cqe();
+    REQUIRE(cqe.has_value());
+    CHECK(cqe.value()->user_data == 7);
+    CHECK(cqe.value()->res == sizeof(value));
+    CHECK(value == 42);
+    ring.cqe_seen();
+
+    CHECK_NOTHROW(ring.unregister_buffers());
+    CHECK_NOTHROW(ring.unregister_files());
+    CHECK_NOTHROW(GuardFW::close(event_fd));
+}
+
+TEST_CASE("io_uring ring: recv and send completions", "[io_uring]")
+{
+    int fds[2] {};
+    REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == 0);
+    GuardFW::IoUring ring(4);
+    std::array<char, 8> buffer {};
+
+    GuardFW::IoUring::prep(*ring.get_sqe(), IORING_OP_SEND, fds[1], "ping", 4, 0, 1);
+    GuardFW::IoUring::prep(*ring.get_sqe(), IORING_OP_RECV, fds[0], buffer.data(), buffer.size(), 0, 2);
+    REQUIRE(ring.submit_and_wait(2).has_value());
+    ring.for_each_cqe([](const struct io_uring_cqe& cqe) {
+        if (cqe.user_data == 1)
+            CHECK(GuardFW::send_completion(cqe) == 4);
+        else
+            CHECK(GuardFW::recv_completion(cqe) == 4);
+    });
+    CHECK(std::string_view(buffer.data(), 4) == "ping");
+
+    struct io_uring_sqe* sqe = ring.get_sqe();  // nothing to receive
+    GuardFW::IoUring::prep(*sqe, IORING_OP_RECV, fds[0], buffer.data(), buffer.size(), 0, 3);
+    sqe->msg_flags = MSG_DONTWAIT;
+    REQUIRE(ring.submit_and_wait(1).has_value());
+    ring.for_each_cqe([](const struct io_uring_cqe& cqe) {
+        CHECK_FALSE(GuardFW::recv_completion_nonblock(cqe).has_value());
+        CHECK_THROWS_AS(GuardFW::recv_completion(cqe), std::system_error);
+    });
+
+    GuardFW::close(fds[0]);
+    GuardFW::close(fds[1]);
+}
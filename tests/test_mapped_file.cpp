@@ -0,0 +1,92 @@
+/**
+ * Catch2 unit tests for modules/mapped_file.cppm
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstddef>   // size_t, std::byte
+#include <span>      // std::span<>
+#include <string>    // std::string
+#include <unistd.h>  // ::sysconf()
+
+import guardfw.mapped_file;
+import guardfw.wrapped_mman;    // GuardFW::memfd_create()
+import guardfw.wrapped_unistd;  // GuardFW::write(), GuardFW::close()
+
+static std::string content_of(std::span<const std::byte> data)
+{
+    return {reinterpret_cast<const char*>(data.data()), data.size()};
+}
+
+static GuardFW::FileDescriptor file_with_content(const std::string& content)
+{
+    const GuardFW::FileDescriptor fd = GuardFW::memfd_create("guardfw-mapped-file", GuardFW::constants::mfd_cloexec);
+    if (!content.empty())
+        REQUIRE(GuardFW::write(fd, content.data(), content.size()) == content.size());
+    return fd;
+}
+
+static std::string pattern_content(size_t size)
+{
+    std::string content(size, '\0');
+    for (size_t index = 0; index < size; index++)
+        content[index] = static_cast<char>('a' + (index % 23));
+    return content;
+}
+
+TEST_CASE("mapped file: whole file with hints", "[mapped_file]")
+{
+    const std::string content        = pattern_content(100000);
+    const GuardFW::FileDescriptor fd = file_with_content(content);
+
+    {
+        GuardFW::MappedFile file(fd);
+        CHECK(file.size() == content.size());
+        CHECK(content_of(file.data()) == content);
+
+        CHECK_NOTHROW(file.will_need(50000, 10000));
+        CHECK_NOTHROW(file.dont_need(0, 50000));
+        CHECK(content_of(file.data()) == content);  // released pages are read again
+    }
+
+    const GuardFW::FileDescriptor empty_fd = file_with_content("");
+    GuardFW::MappedFile empty(empty_fd, GuardFW::AccessPattern::random);
+    CHECK(empty.data().empty());
+
+    CHECK_NOTHROW(GuardFW::close(empty_fd));
+    CHECK_NOTHROW(GuardFW::close(fd));
+}
+
+TEST_CASE("mapped file: sliding window", "[mapped_file]")
+{
+    const size_t page_size           = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    const std::string content        = pattern_content((3 * page_size) + 100);
+    const GuardFW::FileDescriptor fd = file_with_content(content);
+
+    GuardFW::MappedFileWindow window(fd, page_size);
+    CHECK(window.file_size() == content.size());
+
+    std::string scanned;
+    size_t windows = 0;
+    for (std::span<const std::byte> data = window.next(); !data.empty(); data = window.next())
+    {
+        CHECK(data.size() <= page_size);
+        scanned += content_of(data);
+        windows++;
+    }
+    CHECK(windows == 4);
+    CHECK(scanned == content);
+
+    std::span<const std::byte> unaligned = window.slide_to(page_size + 10);
+    CHECK(window.offset() == page_size + 10);
+    CHECK(unaligned.size() == page_size - 10);
+    CHECK(content_of(unaligned) == content.substr(page_size + 10, page_size - 10));
+
+    CHECK(window.slide_to(content.size()).empty());
+
+    CHECK_NOTHROW(GuardFW::close(fd));
+}
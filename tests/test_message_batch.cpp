@@ -0,0 +1,96 @@
+/**
+ * Catch2 unit tests for modules/message_batch.cppm
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cerrno>        // EINVAL
+#include <cstddef>       // std::byte
+#include <cstdint>       // uintptr_t
+#include <cstring>       // ::memcpy()
+#include <optional>      // std::optional<>
+#include <span>          // std::span<>
+#include <sys/socket.h>  // ::socketpair(), AF_UNIX, SOCK_DGRAM, SOCK_NONBLOCK, sockaddr_storage
+
+#include "test_helpers.hpp"
+
+import guardfw.message_batch;
+import guardfw.wrapped_unistd;  // GuardFW::close()
+
+TEST_CASE("message batch: cache line aligned buffers", "[message_batch]")
+{
+    GuardFW::MessageBatch batch(4, 100);
+
+    CHECK(batch.size() == 4);
+    CHECK(batch.capacity() == 100);
+    for (size_t index = 0; index < batch.size(); index++)
+    {
+        std::span<std::byte> buffer = batch.buffer(index);
+        CHECK(buffer.size() == 100);
+        CHECK(reinterpret_cast<uintptr_t>(buffer.data()) % GuardFW::MessageBatch::cache_line_size == 0);
+    }
+}
+
+TEST_CASE("message batch: send and receive datagrams", "[message_batch]")
+{
+    int sockets[2] {-1, -1};
+    REQUIRE(::socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0, sockets) == 0);
+
+    GuardFW::MessageBatch sender(4, 64);
+    GuardFW::MessageBatch receiver(4, 64);
+
+    constexpr size_t messages = 3;
+    for (size_t index = 0; index < messages; index++)
+    {
+        std::span<std::byte> buffer = sender.buffer(index);
+        for (size_t byte = 0; byte <= index; byte++)
+            buffer[byte] = static_cast<std::byte>('a' + index);
+        sender.set_message(index, index + 1);
+    }
+
+    std::optional<unsigned int> sent = sender.send_nonblock(sockets[0], messages);
+    REQUIRE(sent.has_value());
+    CHECK(sent.value() == messages);
+
+    std::optional<std::span<const struct mmsghdr>> received = receiver.receive_nonblock(sockets[1]);
+    REQUIRE(received.has_value());
+    REQUIRE(received.value().size() == messages);
+    for (size_t index = 0; index < messages; index++)
+    {
+        std::span<const std::byte> payload = receiver.payload(index);
+        REQUIRE(payload.size() == index + 1);
+        for (std::byte byte : payload)
+            CHECK(byte == static_cast<std::byte>('a' + index));
+        CHECK_FALSE(receiver.truncated(index));
+    }
+    CHECK(error_of([&receiver] { (void) receiver.payload(messages); }) == EINVAL);
+
+    CHECK_FALSE(receiver.receive_nonblock(sockets[1]).has_value());
+
+    struct sockaddr_storage address[2] {};
+    const auto* destination = reinterpret_cast<const struct sockaddr*>(&address);
+    CHECK(error_of([&sender, destination] {
+              sender.set_message(0, 1, destination, sizeof(struct sockaddr_storage) + 1);
+          })
+          == EINVAL);
+    CHECK(error_of([&sender] { sender.set_message(4, 1); }) == EINVAL);
+    CHECK(error_of([&sender] { sender.set_message(0, 65); }) == EINVAL);
+    CHECK(error_of([&sender] { (void) sender.buffer(4); }) == EINVAL);
+    CHECK(error_of([&sender, &sockets] { (void) sender.send_nonblock(sockets[0], 5); }) == EINVAL);
+
+    GuardFW::MessageBatch large(1, 128);
+    large.set_message(0, 100);
+    REQUIRE(large.send_nonblock(sockets[0], 1) == 1U);
+    received = receiver.receive_nonblock(sockets[1]);
+    REQUIRE(received.has_value());
+    REQUIRE(received.value().size() == 1);
+    CHECK(receiver.truncated(0));
+    CHECK(receiver.payload(0).size() == receiver.capacity());
+
+    CHECK_NOTHROW(GuardFW::close(sockets[0]));
+    CHECK_NOTHROW(GuardFW::close(sockets[1]));
+}
@@ -0,0 +1,105 @@
+/**
+ * Catch2 unit tests for modules/mpsc_queue.cppm
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstddef>      // size_t
+#include <cstdint>      // uint32_t, uint64_t
+#include <ctime>        // timespec
+#include <memory>       // std::unique_ptr<>
+#include <optional>     // std::optional<>
+#include <sys/epoll.h>  // EPOLLIN
+#include <thread>       // std::thread, std::this_thread::yield()
+#include <vector>       // std::vector<>
+
+import guardfw.mpsc_queue;
+import guardfw.reactor;
+import guardfw.wrapped_unistd;  // GuardFW::read_nonblock()
+
+TEST_CASE("mpsc queue: single-threaded push, pop and doorbell", "[mpsc_queue]")
+{
+    GuardFW::MpscQueue<std::unique_ptr<int>> queue(3);
+    CHECK(queue.capacity() == 4);
+
+    for (int value = 0; value < 4; value++)
+        CHECK(queue.try_push(std::make_unique<int>(value)));
+    auto rejected = std::make_unique<int>(4);
+    CHECK_FALSE(queue.try_push(std::move(rejected)));
+    CHECK(rejected != nullptr);  // not moved from if the queue is full
+
+    std::optional<std::unique_ptr<int>> first = queue.try_pop();
+    REQUIRE(first.has_value());
+    CHECK(*first.value() == 0);
+    CHECK(queue.drain([](std::unique_ptr<int>&&) {}, 2) == 2);
+
+    CHECK_FALSE(queue.arm());  // one element is still queued
+    CHECK(queue.drain([](std::unique_ptr<int>&& value) { CHECK(*value == 3); }) == 1);
+    CHECK(queue.doorbells() == 0);
+
+    REQUIRE(queue.arm());
+    CHECK(queue.try_push(std::make_unique<int>(5)));
+    CHECK(queue.try_push(std::make_unique<int>(6)));  // doorbell already rung
+    CHECK(queue.doorbells() == 1);
+
+    uint64_t counter = 0;
+    CHECK(GuardFW::read_nonblock(queue.fd(), &counter, sizeof(counter)) == sizeof(counter));
+    CHECK(counter == 1);
+}
+
+template<typename T>
+class QueueHandler : public GuardFW::EventHandler
+{
+public:
+    explicit QueueHandler(GuardFW::MpscQueue<T>& consumed_queue)
+        : queue(consumed_queue)
+    {}
+
+    void on_events(GuardFW::Reactor&, GuardFW::FileDescriptor, uint32_t) override
+    {
+        received += queue.consume([this](T&& value) { sum += value; });
+    }
+
+    GuardFW::MpscQueue<T>& queue;
+    uint64_t received {0};
+    uint64_t sum {0};
+};
+
+TEST_CASE("mpsc queue: multiple producers and a reactor as consumer", "[mpsc_queue]")
+{
+    constexpr uint64_t producers = 4;
+    constexpr uint64_t messages  = 25'000;  ///< per producer
+
+    GuardFW::MpscQueue<uint64_t> queue(256);
+    GuardFW::Reactor reactor(16);
+    QueueHandler<uint64_t> handler(queue);
+    reactor.add(queue.fd(), handler, EPOLLIN);
+    REQUIRE(queue.arm());
+
+    std::vector<std::thread> threads;
+    for (uint64_t producer = 0; producer < producers; producer++)
+    {
+        threads.emplace_back([&queue]() {
+            for (uint64_t value = 1; value <= messages; value++)
+                while (!queue.try_push(value))
+                    std::this_thread::yield();
+        });
+    }
+
+    const struct timespec timeout {.tv_sec = 1, .tv_nsec = 0};
+    size_t ready = 1;
+    while (handler.received < producers * messages && ready > 0)  // no event within timeout is a lost wakeup
+        ready = reactor.run_once(&timeout);
+    for (std::thread& thread : threads)
+        thread.join();
+
+    CHECK(handler.received == producers * messages);
+    CHECK(handler.sum == producers * messages * (messages + 1) / 2);
+    CHECK(queue.doorbells() < producers * messages);
+
+    reactor.remove(queue.fd());
+}
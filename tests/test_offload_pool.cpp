@@ -0,0 +1,164 @@
+/**
+ * Catch2 unit tests for modules/offload_pool.cppm
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>        // std::atomic<>
+#include <cerrno>        // EAGAIN, EINVAL, ENOENT
+#include <cstddef>       // size_t
+#include <exception>     // std::rethrow_exception()
+#include <fcntl.h>       // O_*
+#include <future>        // std::future<>
+#include <optional>      // std::optional<>
+#include <poll.h>        // ::poll(), pollfd, POLLIN
+#include <string>        // std::string, std::to_string()
+#include <system_error>  // std::system_error
+#include <thread>        // std::this_thread::yield()
+#include <unistd.h>      // ::getpid(), ::unlink()
+#include <vector>        // std::vector<>
+
+#include "test_helpers.hpp"
+
+import guardfw.offload_pool;
+import guardfw.wrapped_fcntl;
+import guardfw.wrapped_unistd;
+
+TEST_CASE("offload pool: futures", "[offload_pool]")
+{
+    const std::string path = "/var/tmp/guardfw-test-offload-" + std::to_string(::getpid());
+    GuardFW::OffloadPool pool(2);
+    CHECK(pool.size() == 2);
+
+    std::future<int> opened = pool.submit([&path] { return GuardFW::open(path.c_str(), O_RDWR | O_CREAT, 0600); });
+    const int fd            = opened.get();
+    CHECK(fd >= 0);
+    CHECK(GuardFW::write(fd, "data", 4) == 4);
+    std::future<void> synced = pool.submit([fd] { GuardFW::fsync(fd); });
+    CHECK_NOTHROW(synced.get());
+
+    std::future<int> missing = pool.submit([] { return GuardFW::open("/nonexistent/guardfw", O_RDONLY); });
+    try
+    {
+        (void) missing.get();
+        FAIL("open() did not throw");
+    }
+    catch (const std::system_error& error)  // thrown by the worker, rethrown in the submitting thread
+    {
+        CHECK(error.code().value() == ENOENT);
+        CHECK(std::string(error.what()).find("open") != std::string::npos);
+    }
+
+    GuardFW::close(fd);
+    ::unlink(path.c_str());
+    CHECK(error_of([] { GuardFW::OffloadPool empty(0); }) == EINVAL);
+}
+
+TEST_CASE("offload pool: callbacks through the completion eventfd", "[offload_pool]")
+{
+    GuardFW::OffloadPool pool(2, 32);  // the queues can take all jobs
+    constexpr size_t jobs = 40;
+    std::vector<int> results(jobs, -1);
+    size_t errors = 0;
+
+    for (size_t index = 0; index < jobs; index++)
+        if (index % 10 == 9)
+            pool.submit(
+                [] { return GuardFW::open("/nonexistent/guardfw", O_RDONLY); },
+                [&errors](GuardFW::OffloadResult<int>&& result) {
+                    REQUIRE(!result.has_value());
+                    CHECK(error_of([&result] { std::rethrow_exception(result.error()); }) == ENOENT);
+                    errors++;
+                }
+            );
+        else
+            pool.submit(
+                [index] { return static_cast<int>(index * 2); },
+                [&results, index](GuardFW::OffloadResult<int>&& result) { results[index] = result.value(); }
+            );
+
+    size_t completed = 0;
+    while (completed < jobs)  // event loop
+    {
+        struct pollfd readable {.fd = pool.fd(), .events = POLLIN, .revents = 0};
+        REQUIRE(::poll(&readable, 1, 5000) == 1);
+        completed += pool.complete();
+    }
+    CHECK(completed == jobs);
+    CHECK(errors == 4);
+    for (size_t index = 0; index < jobs; index++)
+        if (index % 10 != 9)
+            CHECK(results[index] == static_cast<int>(index * 2));
+
+    struct pollfd readable {.fd = pool.fd(), .events = POLLIN, .revents = 0};
+    CHECK(::poll(&readable, 1, 0) == 0);  // acknowledged and re-armed
+}
+
+TEST_CASE("offload pool: callback jobs are limited by the completion queue", "[offload_pool]")
+{
+    std::optional<GuardFW::OffloadPool> pool(std::in_place, 1, 2);  // completion queue with 2 cells
+    size_t callbacks = 0;
+    auto callback    = [&callbacks](GuardFW::OffloadResult<int>&&) { callbacks++; };
+    pool->submit([] { return 1; }, callback);
+    pool->submit([] { return 2; }, callback);
+    CHECK(error_of([&pool, &callback] { pool->submit([] { return 3; }, callback); }) == EAGAIN);
+    CHECK(pool->metrics().rejected == 1);
+    while (pool->metrics().executed < 2)
+        std::this_thread::yield();
+
+    struct pollfd readable {.fd = pool->fd(), .events = POLLIN, .revents = 0};
+    REQUIRE(::poll(&readable, 1, 5000) == 1);
+    CHECK(pool->complete() == 2);  // frees the completion cells
+    CHECK(callbacks == 2);
+    pool->submit([] { return 4; }, callback);
+    pool->submit([] { return 5; }, callback);
+    while (pool->metrics().executed < 4)
+        std::this_thread::yield();
+    pool.reset();  // completions are not consumed by the destructing thread
+    CHECK(callbacks == 2);
+}
+
+TEST_CASE("offload pool: work stealing and queue depth metrics", "[offload_pool]")
+{
+    GuardFW::OffloadPool pool(2, 4);
+    std::atomic<bool> release {false};
+    std::atomic<size_t> blocked {0};
+    auto block = [&release, &blocked] {
+        blocked++;
+        while (!release.load())
+            std::this_thread::yield();
+    };
+
+    std::vector<std::future<void>> futures;
+    futures.push_back(pool.submit(block));  // occupies both workers
+    futures.push_back(pool.submit(block));
+    while (blocked.load() < 2)
+        std::this_thread::yield();
+
+    for (size_t index = 0; index < 8; index++)  // fills the home queue of this thread, then the other queue
+        futures.push_back(pool.submit([] {}));
+    CHECK(error_of([&pool] { (void) pool.submit([] {}); }) == EAGAIN);
+
+    GuardFW::OffloadPoolMetrics metrics = pool.metrics();
+    CHECK(metrics.submitted == 10);
+    CHECK(metrics.rejected == 1);
+    CHECK(metrics.queued == 8);
+    CHECK(metrics.peak_queued == 4);
+    REQUIRE(metrics.queue_depths.size() == 2);
+    CHECK(metrics.queue_depths[0] == 4);
+    CHECK(metrics.queue_depths[1] == 4);
+
+    release.store(true);
+    for (std::future<void>& future : futures)
+        future.get();
+    while (pool.metrics().executed < 10)  // counted after the promise has been fulfilled
+        std::this_thread::yield();
+    metrics = pool.metrics();
+    CHECK(metrics.executed == 10);
+    CHECK(metrics.queued == 0);
+    CHECK(metrics.stolen > 0);  // the home queue of this thread was served by both workers
+}
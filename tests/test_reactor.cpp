@@ -0,0 +1,91 @@
+/**
+ * Catch2 unit tests for modules/reactor.cppm
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>         // std::array<>
+#include <cstddef>       // std::byte
+#include <cstdint>       // uint32_t
+#include <ctime>         // timespec
+#include <span>          // std::span<>
+#include <string>        // std::string
+#include <sys/epoll.h>   // EPOLLIN, EPOLLRDHUP
+#include <sys/socket.h>  // ::socketpair()
+#include <thread>        // std::thread
+
+import guardfw.reactor;
+import guardfw.wrapped_socket;  // GuardFW::send()
+import guardfw.wrapped_unistd;  // GuardFW::close()
+
+class ReceivingHandler : public GuardFW::EventHandler
+{
+public:
+    void on_events(GuardFW::Reactor& reactor, GuardFW::FileDescriptor fd, uint32_t events) override
+    {
+        calls++;
+        if ((events & EPOLLIN) == 0)
+            return;
+
+        std::array<std::byte, 4> buffer {};  // small buffer forces several receives per event
+        GuardFW::DrainResult result =
+            GuardFW::drain_recv(fd, buffer, 0, [this](std::span<const std::byte> data) {
+                received.append(reinterpret_cast<const char*>(data.data()), data.size());
+            });
+        if (result == GuardFW::DrainResult::eof)
+        {
+            closed = true;
+            reactor.remove(fd);
+        }
+    }
+
+    std::string received;
+    unsigned int calls {0};
+    bool closed {false};
+};
+
+TEST_CASE("reactor: edge-triggered receive until eof", "[reactor]")
+{
+    int sockets[2] {-1, -1};
+    REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sockets) == 0);
+
+    GuardFW::Reactor reactor(16);
+    ReceivingHandler handler;
+    reactor.add(sockets[1], handler);
+
+    const struct timespec timeout {.tv_sec = 1, .tv_nsec = 0};
+    CHECK(reactor.run_once(&timeout) == 1);  // initial EPOLLOUT edge
+    CHECK(handler.calls == 1);
+
+    const std::string message {"edge-triggered message"};
+    CHECK(GuardFW::send(sockets[0], message.data(), message.size(), 0) == message.size());
+    CHECK(reactor.run_once(&timeout) == 1);
+    CHECK(handler.received == message);
+
+    CHECK_NOTHROW(GuardFW::close(sockets[0]));
+    CHECK(reactor.run_once(&timeout) == 1);
+    CHECK(handler.closed);
+
+    const struct timespec no_wait {.tv_sec = 0, .tv_nsec = 0};
+    CHECK(reactor.run_once(&no_wait) == 0);  // removed file descriptor is not reported anymore
+    CHECK_NOTHROW(GuardFW::close(sockets[1]));
+}
+
+TEST_CASE("reactor: wakeup and stop from another thread", "[reactor]")
+{
+    GuardFW::Reactor reactor;
+
+    reactor.wake();
+    reactor.wake();  // coalesced
+    const struct timespec no_wait {.tv_sec = 0, .tv_nsec = 0};
+    CHECK(reactor.run_once(&no_wait) == 1);
+    CHECK(reactor.run_once(&no_wait) == 0);
+
+    std::thread stopper([&reactor]() { reactor.stop(); });
+    reactor.run();  // returns after stop()
+    stopper.join();
+}
@@ -0,0 +1,111 @@
+/**
+ * Catch2 unit tests for modules/relay.cppm and the splice wrappers
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstddef>       // size_t
+#include <fcntl.h>       // F_SETFL, O_APPEND
+#include <string>        // std::string
+#include <sys/mman.h>    // ::memfd_create()
+#include <sys/socket.h>  // ::socketpair()
+#include <sys/uio.h>     // iovec
+#include <unistd.h>      // SEEK_SET
+
+import guardfw.relay;
+import guardfw.wrapped_fcntl;   // GuardFW::splice(), ...
+import guardfw.wrapped_unistd;  // GuardFW::close(), ...
+
+static GuardFW::FileDescriptor memfd_with_content(std::string& content)
+{
+    const GuardFW::FileDescriptor fd = ::memfd_create("guardfw-relay", 0);
+    REQUIRE(fd >= 0);
+    REQUIRE(GuardFW::write(fd, content.data(), content.size()) == content.size());
+    REQUIRE(GuardFW::lseek(fd, 0, SEEK_SET) == 0);
+    return fd;
+}
+
+TEST_CASE("splice wrappers: vmsplice, tee and splice", "[relay]")
+{
+    int first[2] {-1, -1};
+    int second[2] {-1, -1};
+    GuardFW::pipe2(first, 0);
+    GuardFW::pipe(second);
+
+    std::string data {"spliced data"};
+    const struct iovec iov {.iov_base = data.data(), .iov_len = data.size()};
+    CHECK(GuardFW::vmsplice(first[1], &iov, 1, 0) == data.size());
+    CHECK(GuardFW::tee(first[0], second[1], data.size(), 0) == data.size());
+    CHECK(GuardFW::splice(second[0], nullptr, first[1], nullptr, data.size(), 0) == data.size());
+
+    std::string received(2 * data.size(), '\0');
+    CHECK(GuardFW::read(first[0], received.data(), received.size()) == received.size());
+    CHECK(received == data + data);
+
+    CHECK_FALSE(GuardFW::splice_nonblock(first[0], nullptr, second[1], nullptr, 1, SPLICE_F_NONBLOCK).has_value());
+
+    for (int fd : {first[0], first[1], second[0], second[1]})
+        CHECK_NOTHROW(GuardFW::close(fd));
+}
+
+TEST_CASE("relay: splice from file to socket", "[relay]")
+{
+    std::string content(200000, 'x');
+    content.back() = 'y';
+    const GuardFW::FileDescriptor file = memfd_with_content(content);
+
+    int sockets[2] {-1, -1};
+    REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == 0);
+
+    GuardFW::PipePool pool(1);
+    {
+        GuardFW::Relay relay(pool, 4096);
+        CHECK(pool.pooled() == 0);
+
+        // the socket buffer may be smaller than the content, so the first part is relayed only
+        CHECK(relay.transfer(file, sockets[0], 8192) == 8192);
+        CHECK_FALSE(relay.used_fallback());
+
+        std::string received(8192, '\0');
+        size_t received_bytes = 0;
+        while (received_bytes < received.size())
+            received_bytes +=
+                GuardFW::read(sockets[1], received.data() + received_bytes, received.size() - received_bytes);
+        CHECK(received == content.substr(0, 8192));
+    }
+    CHECK(pool.pooled() == 1);
+
+    CHECK_NOTHROW(GuardFW::close(sockets[0]));
+    CHECK_NOTHROW(GuardFW::close(sockets[1]));
+    CHECK_NOTHROW(GuardFW::close(file));
+}
+
+TEST_CASE("relay: fallback for append mode and EOF", "[relay]")
+{
+    std::string content(10000, 'a');
+    content.back() = 'b';
+    const GuardFW::FileDescriptor input = memfd_with_content(content);
+
+    std::string empty;
+    const GuardFW::FileDescriptor output = memfd_with_content(empty);
+    GuardFW::fcntl_noretval(output, F_SETFL, O_APPEND);  // splice() does not support append mode
+
+    GuardFW::PipePool pool;
+    GuardFW::Relay relay(pool, 4096);
+    CHECK(relay.transfer(input, output, 2 * content.size()) == content.size());  // stops at EOF
+    CHECK(relay.used_fallback());
+    CHECK_FALSE(relay.input_fallback());  // the input is still spliced into the pipe
+    CHECK(relay.output_fallback());
+
+    std::string received(content.size(), '\0');
+    CHECK(GuardFW::lseek(output, 0, SEEK_SET) == 0);
+    CHECK(GuardFW::read(output, received.data(), received.size()) == received.size());
+    CHECK(received == content);
+
+    CHECK_NOTHROW(GuardFW::close(output));
+    CHECK_NOTHROW(GuardFW::close(input));
+}
@@ -0,0 +1,138 @@
+/**
+ * Catch2 unit tests for modules/sharded_listener.cppm and the typed socket option wrappers
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <arpa/inet.h>   // htonl(), ntohs()
+#include <cerrno>        // EBADF, EINVAL
+#include <cstddef>       // size_t
+#include <netinet/in.h>  // sockaddr_in, INADDR_LOOPBACK
+#include <optional>      // std::optional<>
+#include <sched.h>       // cpu_set_t, CPU_*
+#include <sys/socket.h>  // SOL_SOCKET, SO_*, SOCK_*
+#include <system_error>  // std::system_error
+#include <vector>        // std::vector<>
+
+#include "test_helpers.hpp"
+
+import guardfw.sharded_listener;
+import guardfw.wrapped_sched;
+import guardfw.wrapped_socket;
+import guardfw.wrapped_unistd;
+
+/// @return loopback address with port 0
+static struct sockaddr_in loopback()
+{
+    struct sockaddr_in address {};
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return address;
+}
+
+/// Opens connections to the listener, the connections are completed by the backlogs of the shards.
+static std::vector<int> connect_clients(const GuardFW::ShardedListener& listener, size_t count)
+{
+    std::vector<int> clients;
+    for (size_t index = 0; index < count; index++)
+    {
+        clients.push_back(GuardFW::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0));
+        GuardFW::connect(clients.back(), listener.local_address(), listener.local_address_length());
+    }
+    return clients;
+}
+
+/// @return number of connections accepted from a shard, the accepted connections are closed
+static size_t accept_all(const GuardFW::ShardedListener& listener, size_t shard)
+{
+    size_t accepted = 0;
+    for (std::optional<int> connection = listener.accept(shard); connection; connection = listener.accept(shard))
+    {
+        GuardFW::close(*connection);
+        accepted++;
+    }
+    return accepted;
+}
+
+TEST_CASE("sharded listener: typed socket options", "[sharded_listener]")
+{
+    const int fd = GuardFW::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    GuardFW::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, 1);
+    CHECK(GuardFW::getsockopt<int>(fd, SOL_SOCKET, SO_REUSEPORT) == 1);
+    GuardFW::setsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, 3);
+    CHECK(GuardFW::getsockopt<int>(fd, SOL_SOCKET, SO_INCOMING_CPU) == 3);
+
+    GuardFW::setsockopt(fd, SOL_SOCKET, SO_LINGER, linger {.l_onoff = 1, .l_linger = 5});
+    const auto lingering = GuardFW::getsockopt<linger>(fd, SOL_SOCKET, SO_LINGER);
+    CHECK(lingering.l_onoff == 1);
+    CHECK(lingering.l_linger == 5);
+
+    CHECK(error_of([] { (void) GuardFW::getsockopt<int>(-1, SOL_SOCKET, SO_REUSEPORT); }) == EBADF);
+    CHECK(error_of([fd] { GuardFW::setsockopt(fd, SOL_SOCKET, SO_LINGER, char {1}); }) == EINVAL);  // too short
+
+    GuardFW::close(fd);
+}
+
+TEST_CASE("sharded listener: steer connections to the shard of the CPU", "[sharded_listener]")
+{
+    cpu_set_t original;
+    GuardFW::sched_getaffinity(0, sizeof(original), &original);
+    cpu_set_t single;
+    CPU_ZERO(&single);
+    CPU_SET(GuardFW::sched_getcpu(), &single);
+    GuardFW::sched_setaffinity(0, sizeof(single), &single);  // loopback connections are received on this CPU
+    const unsigned int cpu = GuardFW::sched_getcpu();
+
+    const struct sockaddr_in address = loopback();
+    const std::vector<unsigned int> cpus {cpu + 1, cpu, cpu + 2};  // shard 1 is the shard of this CPU
+    GuardFW::ShardedListener listener(reinterpret_cast<const struct sockaddr*>(&address), sizeof(address), cpus);
+    REQUIRE(listener.size() == 3);
+    CHECK(listener.shard_of_cpu(cpu) == 1);
+    CHECK(!listener.shard_of_cpu(cpu + 3).has_value());
+    CHECK(GuardFW::getsockopt<int>(listener.socket(2), SOL_SOCKET, SO_INCOMING_CPU) == static_cast<int>(cpu + 2));
+
+    struct sockaddr_in bound {};
+    socklen_t bound_length = sizeof(bound);
+    GuardFW::getsockname(listener.socket(2), reinterpret_cast<struct sockaddr*>(&bound), &bound_length);
+    CHECK(ntohs(bound.sin_port) != 0);
+    CHECK(bound.sin_port == reinterpret_cast<const struct sockaddr_in*>(listener.local_address())->sin_port);
+
+    const std::vector<int> clients = connect_clients(listener, 16);
+    CHECK(accept_all(listener, 0) == 0);
+    CHECK(accept_all(listener, 1) == clients.size());
+    CHECK(accept_all(listener, 2) == 0);
+    for (int client : clients)
+        GuardFW::close(client);
+
+    GuardFW::sched_setaffinity(0, sizeof(original), &original);
+}
+
+TEST_CASE("sharded listener: hash distribution and errors", "[sharded_listener]")
+{
+    const struct sockaddr_in address = loopback();
+    const std::vector<unsigned int> cpus {0, 1};
+    GuardFW::ShardedListener listener(
+        reinterpret_cast<const struct sockaddr*>(&address),
+        sizeof(address),
+        cpus,
+        {.backlog = 64, .steer_by_cpu = false, .incoming_cpu = false}
+    );
+    CHECK(GuardFW::getsockopt<int>(listener.socket(1), SOL_SOCKET, SO_INCOMING_CPU) == -1);  // not set
+
+    const std::vector<int> clients = connect_clients(listener, 32);
+    CHECK(accept_all(listener, 0) + accept_all(listener, 1) == clients.size());
+    for (int client : clients)
+        GuardFW::close(client);
+
+    CHECK(error_of([&address] {
+              GuardFW::ShardedListener empty(reinterpret_cast<const struct sockaddr*>(&address), sizeof(address), {});
+          })
+          == EINVAL);
+    GuardFW::ShardedListener restarted(listener.local_address(), listener.local_address_length(), cpus);
+    CHECK(restarted.size() == 2);  // further sockets may join the group on the same port, e.g. during a restart
+}
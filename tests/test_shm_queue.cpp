@@ -0,0 +1,178 @@
+/**
+ * Catch2 unit tests for modules/shm_queue.cppm and the futex wrappers
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cerrno>        // EAGAIN, EINVAL, ETIMEDOUT
+#include <cstddef>       // size_t
+#include <cstdint>       // uint32_t, uint64_t
+#include <ctime>         // ::clock_gettime()
+#include <fcntl.h>       // O_CREAT, O_EXCL
+#include <optional>      // std::optional<>
+#include <string>        // std::string, std::to_string()
+#include <sys/wait.h>    // ::waitpid()
+#include <system_error>  // std::system_error
+#include <thread>        // std::thread
+#include <unistd.h>      // ::fork(), ::_exit(), ::pread(), ::pwrite()
+#include <vector>        // std::vector<>
+
+#include "test_helpers.hpp"
+
+import guardfw.shm_queue;
+import guardfw.wrapped_futex;
+
+/// @return absolute CLOCK_REALTIME timeout in some milliseconds
+static struct timespec realtime_in(long milliseconds)
+{
+    struct timespec timeout {};
+    REQUIRE(::clock_gettime(CLOCK_REALTIME, &timeout) == 0);
+    timeout.tv_nsec += milliseconds * 1'000'000;
+    timeout.tv_sec += timeout.tv_nsec / 1'000'000'000;
+    timeout.tv_nsec %= 1'000'000'000;
+    return timeout;
+}
+
+TEST_CASE("shm queue: futex wait and wake", "[shm_queue]")
+{
+    uint32_t word = 0;
+    const struct timespec timeout = realtime_in(1);
+    CHECK(GuardFW::futex_wait(&word, 1, &timeout, GuardFW::constants::futex_clock_realtime) == EAGAIN);
+    CHECK(GuardFW::futex_wait(&word, 0, &timeout, GuardFW::constants::futex_clock_realtime) == ETIMEDOUT);
+    CHECK(GuardFW::futex_wake(&word, 1) == 0);
+}
+
+TEST_CASE("shm queue: priorities, limits and nonblocking calls", "[shm_queue]")
+{
+    GuardFW::ShmQueue queue({.max_messages = 3, .message_size = 16, .priorities = 2});
+    const GuardFW::ShmQueueAttributes attributes = queue.attributes();
+    CHECK(attributes.max_messages == 4);
+    CHECK(attributes.message_size == 16);
+    CHECK(attributes.priorities == 2);
+
+    char buffer[16] {};
+    unsigned int priority = 99;
+    CHECK_FALSE(queue.receive_nonblock(buffer, sizeof(buffer), &priority).has_value());
+
+    queue.send("low-1", 5, 0);
+    queue.send("low-2", 5, 0);
+    queue.send("high", 4, 1);
+    for (int index = 0; index < 2; index++)
+        CHECK(queue.send_nonblock("low", 3, 0));
+    CHECK_FALSE(queue.send_nonblock("low", 3, 0));  // ring of priority 0 is full
+    CHECK(queue.send_nonblock("high", 4, 1));
+
+    CHECK_THROWS_AS(queue.send("too long for the queue", 22, 0), std::system_error);
+    CHECK_THROWS_AS(queue.send("x", 1, 2), std::system_error);
+    CHECK_THROWS_AS(queue.receive_nonblock(buffer, 8, &priority), std::system_error);
+
+    CHECK(queue.receive(buffer, sizeof(buffer), &priority) == 4);
+    CHECK(priority == 1);
+    CHECK(queue.receive(buffer, sizeof(buffer), &priority) == 4);
+    CHECK(queue.receive(buffer, sizeof(buffer), &priority) == 5);
+    CHECK(priority == 0);
+    CHECK(std::string(buffer, 5) == "low-1");
+    CHECK(queue.receive(buffer, sizeof(buffer), nullptr) == 5);
+    CHECK(std::string(buffer, 5) == "low-2");
+
+    const struct timespec timeout = realtime_in(1);
+    CHECK(queue.timedsend("low", 3, 0, &timeout));
+    CHECK(queue.timedreceive(buffer, sizeof(buffer), &priority, &timeout) == 3);
+    CHECK(queue.timedreceive(buffer, sizeof(buffer), &priority, &timeout) == 3);
+    CHECK(queue.timedreceive(buffer, sizeof(buffer), &priority, &timeout) == 3);
+    CHECK_FALSE(queue.timedreceive(buffer, sizeof(buffer), &priority, &timeout).has_value());  // empty, times out
+}
+
+TEST_CASE("shm queue: blocking senders and receiver in threads", "[shm_queue]")
+{
+    constexpr int senders  = 3;
+    constexpr int messages = 10'000;  ///< per sender
+
+    GuardFW::ShmQueue queue({.max_messages = 8, .message_size = sizeof(int)});
+    std::vector<std::thread> threads;
+    for (int sender = 0; sender < senders; sender++)
+    {
+        threads.emplace_back([&queue]() {
+            for (int value = 1; value <= messages; value++)
+                queue.send(reinterpret_cast<const char*>(&value), sizeof(value), 0);
+        });
+    }
+
+    long sum            = 0;
+    size_t wrong_length = 0;
+    for (int count = 0; count < senders * messages; count++)
+    {
+        int value = 0;
+        if (queue.receive(reinterpret_cast<char*>(&value), sizeof(value), nullptr) != sizeof(value))
+            wrong_length++;
+        sum += value;
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+    CHECK(wrong_length == 0);
+    CHECK(sum == static_cast<long>(senders) * messages * (messages + 1) / 2);
+}
+
+TEST_CASE("shm queue: transfer to child process and named queues", "[shm_queue]")
+{
+    GuardFW::ShmQueue queue({.max_messages = 4, .message_size = 32});
+
+    const pid_t child = ::fork();
+    REQUIRE(child >= 0);
+    if (child == 0)
+    {
+        GuardFW::ShmQueue attached(queue.fd());  // inherited memfd
+        for (int index = 0; index < 100; index++)
+        {
+            const std::string message = std::to_string(index);
+            attached.send(message.data(), message.size(), 0);
+        }
+        ::_exit(0);
+    }
+
+    char buffer[32] {};
+    for (int index = 0; index < 100; index++)
+    {
+        const size_t length = queue.receive(buffer, sizeof(buffer), nullptr);
+        CHECK(std::string(buffer, length) == std::to_string(index));
+    }
+    int status = -1;
+    CHECK(::waitpid(child, &status, 0) == child);
+    CHECK(status == 0);
+
+    const char* name = "/guardfw-test-shm-queue";
+    {
+        GuardFW::ShmQueue created(name, O_CREAT | O_EXCL, 0600, {.max_messages = 2, .message_size = 8});
+        GuardFW::ShmQueue opened(name, 0);
+        opened.send("named", 5, 0);
+        CHECK(created.receive(buffer, sizeof(buffer), nullptr) == 5);
+    }
+    CHECK_NOTHROW(GuardFW::ShmQueue::unlink(name));
+    CHECK_THROWS_AS(GuardFW::ShmQueue(name, 0), std::system_error);
+}
+
+TEST_CASE("shm queue: attaching rejects inconsistent headers", "[shm_queue]")
+{
+    GuardFW::ShmQueue queue({.max_messages = 4, .message_size = 32});
+    CHECK(error_of([&queue] { GuardFW::ShmQueue attached(queue.fd()); }) == 0);
+
+    // overwrites a header field (capacity at 8, message_size at 16) and tries to attach
+    auto attach_with = [&queue](off_t offset, uint64_t value) {
+        uint64_t original = 0;
+        REQUIRE(::pread(queue.fd(), &original, sizeof(original), offset) == sizeof(original));
+        REQUIRE(::pwrite(queue.fd(), &value, sizeof(value), offset) == sizeof(value));
+        const int error = error_of([&queue] { GuardFW::ShmQueue attached(queue.fd()); });
+        REQUIRE(::pwrite(queue.fd(), &original, sizeof(original), offset) == sizeof(original));
+        return error;
+    };
+    CHECK(attach_with(8, 0) == EINVAL);
+    CHECK(attach_with(8, 3) == EINVAL);                   // not a power of two
+    CHECK(attach_with(8, 8) == EINVAL);                   // larger than the segment
+    CHECK(attach_with(8, uint64_t {1} << 62) == EINVAL);  // ring size would overflow
+    CHECK(attach_with(16, 4096) == EINVAL);               // message larger than a slot
+    CHECK(error_of([&queue] { GuardFW::ShmQueue attached(queue.fd()); }) == 0);
+}
@@ -0,0 +1,107 @@
+/**
+ * Catch2 unit tests for modules/statistics.cppm
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>        // std::ranges::find()
+#include <cstdint>          // uint64_t
+#include <source_location>  // std::source_location
+#include <thread>           // std::thread
+#include <vector>           // std::vector<>
+
+#include <errno.h>
+
+import guardfw.wrapper;
+import guardfw.statistics;
+
+namespace
+{
+
+using ContextStatistics = GuardFW::Context<
+    GuardFW::ErrorIndication::eqm1_errno,
+    GuardFW::ErrorReport::exception,
+    GuardFW::ErrorSpecial::eintr_repeats | GuardFW::ErrorSpecial::nonblock | GuardFW::ErrorSpecial::statistics>;
+
+GuardFW::statistics::FunctionSnapshot find_snapshot(std::string_view name)
+{
+    std::vector<GuardFW::statistics::FunctionSnapshot> snapshots = GuardFW::statistics::statistics_snapshot();
+    auto found = std::ranges::find(snapshots, name, &GuardFW::statistics::FunctionSnapshot::name);
+    REQUIRE(found != snapshots.end());
+    return *found;
+}
+
+uint64_t error_count(const GuardFW::statistics::FunctionSnapshot& snapshot, int error)
+{
+    for (const auto& [error_number, count] : snapshot.errors)
+        if (error_number == error)
+            return count;
+    return 0;
+}
+
+}  // namespace
+
+static int statistics_tester(int return_value, int error)
+{
+    static bool interrupted = false;
+    if (error == EINTR)
+    {
+        interrupted = !interrupted;
+        if (!interrupted)
+            return return_value;  // second call succeeds
+    }
+    if (error != 0)
+    {
+        errno = error;
+        return -1;
+    }
+    return return_value;
+}
+
+TEST_CASE("statistics: histogram buckets", "[statistics]")
+{
+    using GuardFW::statistics::histogram_bucket;
+    using GuardFW::statistics::histogram_lower_bound;
+
+    CHECK(histogram_bucket(0) == 0);
+    CHECK(histogram_bucket(3) == 3);
+    CHECK(histogram_bucket(4) == 4);
+    CHECK(histogram_bucket(7) == 7);
+    CHECK(histogram_bucket(8) == 8);
+    CHECK(histogram_bucket(9) == 8);
+    CHECK(histogram_bucket(10) == 9);
+    CHECK(histogram_bucket(UINT64_MAX) == GuardFW::statistics::histogram_buckets - 1);
+
+    for (size_t bucket = 0; bucket < GuardFW::statistics::histogram_buckets; bucket++)
+        CHECK(histogram_bucket(histogram_lower_bound(bucket)) == bucket);
+}
+
+TEST_CASE("statistics: calls, errors, repeats and blockings are counted", "[statistics]")
+{
+    const std::source_location location = std::source_location::current();
+
+    CHECK(5 == ContextStatistics::wrapper<statistics_tester>(location, 5, 0).value());
+    CHECK(6 == ContextStatistics::wrapper<statistics_tester>(location, 6, EINTR).value());
+    CHECK_FALSE(ContextStatistics::wrapper<statistics_tester>(location, 7, EAGAIN).has_value());
+    CHECK_THROWS(ContextStatistics::wrapper<statistics_tester>(location, 8, EINVAL));
+
+    std::thread other([location] { (void) ContextStatistics::wrapper<statistics_tester>(location, 9, 0); });
+    other.join();  // counters of terminated thread are retired
+
+    GuardFW::statistics::FunctionSnapshot snapshot = find_snapshot("statistics_tester");
+    CHECK(snapshot.calls == 5);
+    CHECK(snapshot.eintr_repeats == 1);
+    CHECK(snapshot.eagain_blockings == 1);
+    CHECK(error_count(snapshot, EINVAL) == 1);
+    CHECK(error_count(snapshot, EAGAIN) == 0);
+
+    uint64_t histogram_calls = 0;
+    for (uint64_t count : snapshot.latency)
+        histogram_calls += count;
+    CHECK(histogram_calls == snapshot.calls);
+    CHECK(snapshot.latency_percentile(100.0) <= snapshot.latency_sum_ns);
+}
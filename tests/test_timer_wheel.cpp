@@ -0,0 +1,143 @@
+/**
+ * Catch2 unit tests for modules/timer_wheel.cppm
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>       // std::chrono::steady_clock, std::chrono::milliseconds
+#include <ctime>        // timespec
+#include <optional>     // std::optional<>
+#include <sys/epoll.h>  // EPOLLIN
+#include <vector>       // std::vector<>
+
+import guardfw.reactor;
+import guardfw.timer_wheel;
+import guardfw.wrapped_timerfd;  // GuardFW::constants::clock_monotonic
+
+using namespace std::chrono_literals;
+
+class RecordingTimer : public GuardFW::Timer
+{
+public:
+    RecordingTimer(std::vector<int>& record, int timer_id)
+        : expirations(record)
+        , id(timer_id)
+    {}
+
+    void on_expired(GuardFW::TimerWheel&) override
+    {
+        expirations.push_back(id);
+        expired_at = std::chrono::steady_clock::now();
+    }
+
+    std::vector<int>& expirations;
+    int id;
+    std::optional<std::chrono::steady_clock::time_point> expired_at;
+};
+
+/// Runs a reactor with a registered wheel until all timers are expired or a second has passed.
+static void run_until_empty(GuardFW::Reactor& reactor, const GuardFW::TimerWheel& wheel)
+{
+    const auto end = std::chrono::steady_clock::now() + 1s;
+    const struct timespec timeout {.tv_sec = 0, .tv_nsec = 10'000'000};
+    while (wheel.size() > 0 && std::chrono::steady_clock::now() < end)
+        (void) reactor.run_once(&timeout);
+}
+
+TEST_CASE("timer wheel: expiration order and cancel", "[timer_wheel]")
+{
+    GuardFW::Reactor reactor(16);
+    GuardFW::TimerWheel wheel(1ms, GuardFW::constants::clock_monotonic);
+    reactor.add(wheel.fd(), wheel, EPOLLIN);
+
+    std::vector<int> expirations;
+    RecordingTimer first(expirations, 1);
+    RecordingTimer second(expirations, 2);
+    RecordingTimer third(expirations, 3);
+    RecordingTimer cancelled(expirations, 4);
+
+    const auto start = std::chrono::steady_clock::now();
+    wheel.schedule(third, 30ms);
+    wheel.schedule(first, 10ms);
+    wheel.schedule(cancelled, 15ms);
+    wheel.schedule(second, 50ms);
+    wheel.schedule(second, 20ms);  // reschedules
+    CHECK(wheel.size() == 4);
+    CHECK(cancelled.armed());
+
+    wheel.cancel(cancelled);
+    CHECK_FALSE(cancelled.armed());
+    CHECK(wheel.size() == 3);
+
+    run_until_empty(reactor, wheel);
+    CHECK(expirations == std::vector<int> {1, 2, 3});
+    REQUIRE(third.expired_at.has_value());
+    CHECK(third.expired_at.value() - start >= 30ms);
+    CHECK_FALSE(third.armed());
+
+    reactor.remove(wheel.fd());
+}
+
+TEST_CASE("timer wheel: cascading of higher levels", "[timer_wheel]")
+{
+    GuardFW::Reactor reactor(16);
+    GuardFW::TimerWheel wheel(1us);  // level 0 covers 256 us, level 1 covers 65 ms
+    reactor.add(wheel.fd(), wheel, EPOLLIN);
+
+    std::vector<int> expirations;
+    RecordingTimer level_0(expirations, 0);
+    RecordingTimer level_1(expirations, 1);
+    RecordingTimer level_2(expirations, 2);
+
+    const auto start = std::chrono::steady_clock::now();
+    wheel.schedule(level_2, 80ms);
+    wheel.schedule(level_1, 5ms);
+    wheel.schedule(level_0, 100us);
+
+    run_until_empty(reactor, wheel);
+    CHECK(expirations == std::vector<int> {0, 1, 2});
+    REQUIRE(level_1.expired_at.has_value());
+    REQUIRE(level_2.expired_at.has_value());
+    CHECK(level_1.expired_at.value() - start >= 5ms);
+    CHECK(level_2.expired_at.value() - start >= 80ms);
+
+    reactor.remove(wheel.fd());
+}
+
+class RepeatingTimer : public GuardFW::Timer
+{
+public:
+    void on_expired(GuardFW::TimerWheel& wheel) override
+    {
+        if (++count < 3)
+            wheel.schedule(*this, 1ms);
+    }
+
+    int count {0};
+};
+
+TEST_CASE("timer wheel: rescheduling from handler and destruction of armed timers", "[timer_wheel]")
+{
+    GuardFW::Reactor reactor(16);
+    GuardFW::TimerWheel wheel;
+    reactor.add(wheel.fd(), wheel, EPOLLIN);
+
+    RepeatingTimer repeating;
+    wheel.schedule(repeating, 1ms);
+    {
+        std::vector<int> expirations;
+        RecordingTimer destroyed(expirations, 1);
+        wheel.schedule(destroyed, 1h);
+        CHECK(wheel.size() == 2);
+    }
+    CHECK(wheel.size() == 1);
+
+    run_until_empty(reactor, wheel);
+    CHECK(repeating.count == 3);
+
+    reactor.remove(wheel.fd());
+}
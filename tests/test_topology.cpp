@@ -0,0 +1,184 @@
+/**
+ * Catch2 unit tests for modules/topology.cppm and the scheduling and memory policy wrappers
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cerrno>        // EINVAL, ENOENT, ENOSYS, EPERM
+#include <cstddef>       // size_t
+#include <filesystem>    // std::filesystem
+#include <fstream>       // std::ofstream
+#include <sched.h>       // cpu_set_t, CPU_*
+#include <string>        // std::string, std::to_string()
+#include <sys/mman.h>    // PROT_*, MAP_*
+#include <system_error>  // std::system_error
+#include <unistd.h>      // ::getpid(), ::sysconf()
+#include <vector>        // std::vector<>
+
+#include "test_helpers.hpp"
+
+import guardfw.topology;
+import guardfw.wrapped_mempolicy;
+import guardfw.wrapped_mman;
+import guardfw.wrapped_sched;
+
+/// @return true, if memory policies are blocked, e.g. by the seccomp profile of a container
+static bool mempolicy_blocked(int error)
+{
+    return error == EPERM || error == ENOSYS;
+}
+
+TEST_CASE("topology: scheduling wrappers", "[topology]")
+{
+    unsigned int cpu  = 0;
+    unsigned int node = 0;
+    GuardFW::getcpu(&cpu, &node);
+    CHECK(cpu < static_cast<unsigned int>(CPU_SETSIZE));
+
+    cpu_set_t original;
+    GuardFW::sched_getaffinity(0, sizeof(original), &original);
+    CHECK(CPU_COUNT(&original) > 0);
+
+    cpu_set_t single;
+    CPU_ZERO(&single);
+    CPU_SET(cpu, &single);
+    GuardFW::sched_setaffinity(0, sizeof(single), &single);
+    CHECK(GuardFW::sched_getcpu() == cpu);
+
+    cpu_set_t empty;
+    CPU_ZERO(&empty);
+    CHECK(error_of([&empty] { GuardFW::sched_setaffinity(0, sizeof(empty), &empty); }) == EINVAL);
+
+    GuardFW::sched_setaffinity(0, sizeof(original), &original);
+}
+
+TEST_CASE("topology: memory policy wrappers", "[topology]")
+{
+    const size_t page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    const size_t length    = 4 * page_size;
+    void* const memory     = GuardFW::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    int mode = -1;
+    const int error_get = error_of([&mode] { GuardFW::get_mempolicy(&mode, nullptr, 0, nullptr, 0); });
+    if (mempolicy_blocked(error_get))
+    {
+        WARN("memory policies are not available");
+        GuardFW::munmap(memory, length);
+        return;
+    }
+    CHECK(error_get == 0);
+    CHECK(mode == GuardFW::constants::mpol_default);
+
+    unsigned long mask = 1;  // node 0 exists on every system
+    GuardFW::mbind(memory, length, GuardFW::constants::mpol_bind, &mask, 65, GuardFW::constants::mpol_mf_move);
+    GuardFW::get_mempolicy(&mode, nullptr, 0, memory, GuardFW::constants::mpol_f_addr);
+    CHECK(mode == GuardFW::constants::mpol_bind);
+
+    static_cast<char*>(memory)[0] = 1;  // fault in the first page only
+    std::vector<void*> pages {memory, static_cast<char*>(memory) + page_size};
+    std::vector<int> status(pages.size(), -1);
+    CHECK(GuardFW::move_pages(0, pages.size(), pages.data(), nullptr, status.data(), 0) == 0);  // query only
+    CHECK(status[0] == 0);
+    CHECK(status[1] == -ENOENT);  // not faulted in
+
+    CHECK(error_of([memory, length, &mask] {
+              GuardFW::mbind(static_cast<char*>(memory) + 1, length, GuardFW::constants::mpol_bind, &mask, 65, 0);
+          })
+          == EINVAL);  // not page-aligned
+
+    GuardFW::set_mempolicy(GuardFW::constants::mpol_preferred, &mask, 65);
+    GuardFW::get_mempolicy(&mode, nullptr, 0, nullptr, 0);
+    CHECK(mode == GuardFW::constants::mpol_preferred);
+    GuardFW::set_mempolicy(GuardFW::constants::mpol_default, nullptr, 0);
+
+    GuardFW::munmap(memory, length);
+}
+
+/// Writes a file of a fake sysfs tree.
+static void write_file(const std::filesystem::path& path, const std::string& content)
+{
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream(path) << content << '\n';
+}
+
+TEST_CASE("topology: parse two nodes with SMT", "[topology]")
+{
+    const std::filesystem::path root = "/var/tmp/guardfw-test-topology-" + std::to_string(::getpid());
+    write_file(root / "cpu/online", "0-7");
+    for (unsigned int cpu = 0; cpu < 8; cpu++)  // cpu n and n+4 are SMT siblings, cpus 0,1,4,5 are on node 0
+    {
+        const std::filesystem::path topology = root / ("cpu/cpu" + std::to_string(cpu)) / "topology";
+        write_file(topology / "physical_package_id", std::to_string((cpu % 4) / 2));
+        write_file(topology / "core_id", std::to_string(cpu % 2));
+    }
+    write_file(root / "node/online", "0-1");
+    write_file(root / "node/node0/cpulist", "0-1,4-5");
+    write_file(root / "node/node1/cpulist", "2-3,6-7");
+
+    const GuardFW::Topology topology(root.string());
+    REQUIRE(topology.cpus().size() == 8);
+    REQUIRE(topology.nodes().size() == 2);
+    CHECK(topology.cpus()[6].node == 1);
+    CHECK(topology.cpus()[6].package == 1);
+    CHECK(topology.cpus()[6].core == 0);
+
+    std::vector<unsigned int> node1;
+    for (const GuardFW::Cpu& cpu : topology.cpus_of_node(1))
+        node1.push_back(cpu.id);
+    CHECK(node1 == std::vector<unsigned int> {2, 3, 6, 7});  // cores first, then SMT siblings
+    CHECK(topology.cpus_of_node(2).empty());
+
+    std::filesystem::remove_all(root / "node");  // kernel without NUMA support
+    const GuardFW::Topology uniform(root.string());
+    REQUIRE(uniform.nodes().size() == 1);
+    CHECK(uniform.cpus_of_node(0).size() == 8);
+    CHECK(uniform.cpus_of_node(0)[1].id == 1);
+    CHECK(uniform.cpus_of_node(0)[4].id == 4);
+
+    write_file(root / "cpu/online", std::to_string(CPU_SETSIZE));  // not representable in cpu_set_t
+    const std::filesystem::path topology_large = root / ("cpu/cpu" + std::to_string(CPU_SETSIZE)) / "topology";
+    write_file(topology_large / "physical_package_id", "0");
+    write_file(topology_large / "core_id", "0");
+    const GuardFW::Topology large(root.string());
+    CHECK(error_of([&large] { (void) large.pin_thread(0, 0); }) == EINVAL);
+
+    CHECK(error_of([&root] { GuardFW::Topology missing((root / "missing").string()); }) == ENOENT);
+    std::filesystem::remove_all(root);
+}
+
+TEST_CASE("topology: pin thread to a node", "[topology]")
+{
+    const GuardFW::Topology& topology = GuardFW::Topology::system();
+    REQUIRE(!topology.cpus().empty());
+    REQUIRE(!topology.nodes().empty());
+    CHECK(&topology == &GuardFW::Topology::system());  // parsed once
+
+    cpu_set_t original;
+    GuardFW::sched_getaffinity(0, sizeof(original), &original);
+    const unsigned int node = topology.cpus().front().node;
+
+    unsigned int cpu = 0;
+    const int error  = error_of([&topology, node, &cpu] { cpu = topology.pin_thread(node, 0); });
+    if (mempolicy_blocked(error))
+        WARN("memory policies are not available");
+    else
+    {
+        CHECK(error == 0);
+        CHECK(GuardFW::sched_getcpu() == cpu);
+        CHECK(cpu == topology.cpus_of_node(node).front().id);
+
+        const size_t length = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        void* const memory =
+            GuardFW::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        CHECK_NOTHROW(topology.bind(memory, length, node));
+        GuardFW::munmap(memory, length);
+        GuardFW::set_mempolicy(GuardFW::constants::mpol_default, nullptr, 0);
+    }
+    CHECK(error_of([&topology] { (void) topology.pin_thread(0xFFFF, 0); }) == EINVAL);
+
+    GuardFW::sched_setaffinity(0, sizeof(original), &original);
+}
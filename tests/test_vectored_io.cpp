@@ -0,0 +1,138 @@
+/**
+ * Catch2 unit tests for modules/vectored_io.cppm and the sys/uio.h wrappers
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>       // std::array<>
+#include <chrono>      // std::chrono::milliseconds
+#include <span>        // std::span<>
+#include <string>      // std::string
+#include <sys/mman.h>  // ::memfd_create()
+#include <sys/uio.h>   // iovec, RWF_*
+#include <thread>      // std::thread, std::this_thread::sleep_for()
+#include <fcntl.h>     // O_NONBLOCK
+#include <unistd.h>    // ::lseek()
+
+import guardfw.vectored_io;
+import guardfw.wrapped_uio;     // GuardFW::writev(), ...
+import guardfw.wrapped_unistd;  // GuardFW::close(), ...
+
+TEST_CASE("vectored io: advance iovecs", "[vectored_io]")
+{
+    std::array<char, 10> first {};
+    std::array<char, 5> second {};
+    std::array<struct iovec, 3> iovecs {{
+        {.iov_base = first.data(), .iov_len = first.size()},
+        {.iov_base = nullptr, .iov_len = 0},
+        {.iov_base = second.data(), .iov_len = second.size()},
+    }};
+    std::span<struct iovec> remaining {iovecs};
+
+    GuardFW::advance_iovecs(remaining, 4);
+    REQUIRE(remaining.size() == 3);
+    CHECK(remaining[0].iov_base == first.data() + 4);
+    CHECK(remaining[0].iov_len == 6);
+
+    GuardFW::advance_iovecs(remaining, 7);
+    REQUIRE(remaining.size() == 1);
+    CHECK(remaining[0].iov_base == second.data() + 1);
+    CHECK(remaining[0].iov_len == 4);
+
+    GuardFW::advance_iovecs(remaining, 4);
+    CHECK(remaining.empty());
+}
+
+TEST_CASE("vectored io: write_all and read_exact over a pipe", "[vectored_io]")
+{
+    int fds[2] {-1, -1};
+    GuardFW::pipe(fds);
+
+    std::string header {"header:"};
+    std::string body {"body"};
+
+    // writer delivers the data in several parts, so read_exact() must handle partial reads
+    std::thread writer([&fds, &header, &body]() {
+        std::array<struct iovec, 2> iovecs {{
+            {.iov_base = header.data(), .iov_len = header.size()},
+            {.iov_base = body.data(), .iov_len = 2},
+        }};
+        CHECK(GuardFW::write_all(fds[1], iovecs) == header.size() + 2);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        CHECK(GuardFW::write(fds[1], body.data() + 2, body.size() - 2) == body.size() - 2);
+        GuardFW::close(fds[1]);
+    });
+
+    std::string received_header(header.size(), '\0');
+    std::string received_body(body.size() + 10, '\0');  // larger than sent data, stops at EOF
+    std::array<struct iovec, 2> iovecs {{
+        {.iov_base = received_header.data(), .iov_len = received_header.size()},
+        {.iov_base = received_body.data(), .iov_len = received_body.size()},
+    }};
+    CHECK(GuardFW::read_exact(fds[0], iovecs) == header.size() + body.size());
+    writer.join();
+
+    CHECK(received_header == header);
+    CHECK(received_body.substr(0, body.size()) == body);
+    CHECK_NOTHROW(GuardFW::close(fds[0]));
+}
+
+TEST_CASE("vectored io: positional transfers with flags", "[vectored_io]")
+{
+    const GuardFW::FileDescriptor fd = ::memfd_create("guardfw-vectored-io", 0);
+    REQUIRE(fd >= 0);
+
+    std::string first {"0123"};
+    std::string second {"456789"};
+    std::array<struct iovec, 2> write_iovecs {{
+        {.iov_base = first.data(), .iov_len = first.size()},
+        {.iov_base = second.data(), .iov_len = second.size()},
+    }};
+    CHECK(GuardFW::pwrite_all(fd, write_iovecs, 100, RWF_DSYNC) == 10);
+
+    std::string received(8, '\0');
+    std::array<struct iovec, 1> read_iovecs {{{.iov_base = received.data(), .iov_len = received.size()}}};
+    CHECK(GuardFW::pread_exact(fd, read_iovecs, 102) == received.size());
+    CHECK(received == "23456789");
+
+    CHECK(GuardFW::pread(fd, received.data(), 2, 108) == 2);
+    CHECK(GuardFW::pwrite(fd, "ab", 2, 0) == 2);
+
+    std::array<struct iovec, 1> first_iovecs {{{.iov_base = received.data(), .iov_len = 2}}};
+    CHECK(GuardFW::preadv2(fd, first_iovecs.data(), 1, 0, 0) == 2);
+    CHECK(received.substr(0, 2) == "ab");
+
+    REQUIRE(::lseek(fd, 20, SEEK_SET) == 20);
+    std::array<struct iovec, 2> current_iovecs {{
+        {.iov_base = first.data(), .iov_len = first.size()},
+        {.iov_base = second.data(), .iov_len = second.size()},
+    }};
+    CHECK(GuardFW::pwrite_all(fd, current_iovecs, -1) == 10);  // at and advancing the current file position
+    CHECK(::lseek(fd, 0, SEEK_CUR) == 30);
+    std::string current(10, '\0');
+    std::array<struct iovec, 1> current_read_iovecs {{{.iov_base = current.data(), .iov_len = current.size()}}};
+    CHECK(GuardFW::pread_exact(fd, current_read_iovecs, 20) == current.size());
+    CHECK(current == "0123456789");
+
+    CHECK_NOTHROW(GuardFW::close(fd));
+}
+
+TEST_CASE("vectored io: nonblocking readv", "[vectored_io]")
+{
+    int fds[2] {-1, -1};
+    GuardFW::pipe2(fds, O_NONBLOCK);
+
+    char buffer[4] {};
+    const struct iovec iov {.iov_base = buffer, .iov_len = sizeof(buffer)};
+    CHECK_FALSE(GuardFW::readv_nonblock(fds[0], &iov, 1).has_value());
+    CHECK(GuardFW::writev_nonblock(fds[1], &iov, 1) == sizeof(buffer));
+    CHECK(GuardFW::readv_nonblock(fds[0], &iov, 1) == sizeof(buffer));
+    CHECK_FALSE(GuardFW::preadv2_nonblock(fds[0], &iov, 1, -1, 0).has_value());  // -1: pipes have no offset
+
+    CHECK_NOTHROW(GuardFW::close(fds[0]));
+    CHECK_NOTHROW(GuardFW::close(fds[1]));
+}
@@ -18,10 +18,12 @@
 #include <cstring>           // memset()
 #include <alloca.h>          // alloca()
 #include <system_error>      // std::system_error
+#include <cerrno>            // ECONNRESET, EAGAIN
 
 import guardfw.wrapped_io_uring;
 import guardfw.wrapped_unistd; // GuardFW::close()
 import guardfw.wrapped_mman;   // GuardFW::mmap(), GuardFW::munmap()
+import guardfw.wrapper;        // GuardFW::Context<>
 
 namespace
 {
@@ -163,3 +165,41 @@ TEST_CASE("io_uring working", "[io_uring]")
 
     CHECK_NOTHROW(GuardFW::close(fd_io_uring));
 }
+
+TEST_CASE("io_uring completions", "[io_uring]")
+{
+    const struct io_uring_cqe received {.user_data = 1, .res = 42, .flags = 0};
+    const struct io_uring_cqe failed {.user_data = 2, .res = -ECONNRESET, .flags = 0};
+    const struct io_uring_cqe blocked {.user_data = 3, .res = -EAGAIN, .flags = 0};
+
+    CHECK(GuardFW::recv_completion(received) == 42);
+    CHECK(GuardFW::send_completion(received) == 42);
+    CHECK(GuardFW::accept_completion(received) == 42);
+    CHECK(GuardFW::recvmsg_completion_nonblock(received) == 42);
+    CHECK_FALSE(GuardFW::recv_completion_nonblock(blocked).has_value());
+    CHECK_FALSE(GuardFW::accept_completion_nonblock(blocked).has_value());
+    CHECK_THROWS_AS(GuardFW::send_completion(blocked), std::system_error);
+
+    std::ostringstream what_recv;
+    what_recv << "in function '" << fixloc.function_name() << "' in file '" << fixloc.file_name() << "' at line "
+              << fixloc.line()
+              << ": io_uring operation 'IORING_OP_RECV' failed with error 104: Connection reset by peer";
+    CHECK_THROWS_WITH(GuardFW::recv_completion(failed, fixloc), what_recv.str());
+    CHECK_THROWS_AS(GuardFW::sendmsg_completion_nonblock(failed, fixloc), std::system_error);
+
+    using ContextCompletionDirect =
+        GuardFW::Context<GuardFW::ErrorIndication::lt0_direct, GuardFW::ErrorReport::direct>;
+    const std::expected<size_t, GuardFW::Error> direct =
+        ContextCompletionDirect::complete<IORING_OP_RECV, size_t>(failed, fixloc);
+    REQUIRE_FALSE(direct.has_value());
+    CHECK(direct.error() == ECONNRESET);
+
+    using ContextCompletionSoft = GuardFW::Context<
+        GuardFW::ErrorIndication::lt0_direct,
+        GuardFW::ErrorReport::exception,
+        GuardFW::ErrorSpecial::none,
+        ECONNRESET>;
+    CHECK(ContextCompletionSoft::complete<IORING_OP_SEND, size_t>(received, fixloc) == 42);
+    CHECK(ContextCompletionSoft::complete<IORING_OP_SEND, size_t>(failed, fixloc).error() == ECONNRESET);
+    CHECK_THROWS_AS((ContextCompletionSoft::complete<IORING_OP_SEND, size_t>(blocked, fixloc)), std::system_error);
+}
@@ -0,0 +1,74 @@
+/**
+ * Catch2 unit tests for modules/wrappers/wrapped_syscall.cppm
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cerrno>        // errno, EBADF
+#include <cstdint>       // uint64_t
+#include <fcntl.h>       // O_NONBLOCK
+#include <sys/socket.h>  // ::socketpair(), MSG_NOSIGNAL
+#include <string_view>   // std::string_view
+#include <sys/syscall.h>  // SYS_getpid, SYS_close
+#include <system_error>  // std::system_error
+#include <unistd.h>      // ::pipe2(), ::getpid()
+
+import guardfw.wrapped_syscall;
+import guardfw.wrapped_unistd;  // GuardFW::close()
+
+TEST_CASE("wrapped syscall: direct system calls", "[wrapped_syscall]")
+{
+    CHECK(GuardFW::direct_syscall(SYS_getpid) == ::getpid());
+    CHECK(GuardFW::direct_syscall(SYS_close, -1) == -EBADF);
+}
+
+TEST_CASE("wrapped syscall: read and write on a pipe", "[wrapped_syscall]")
+{
+    int fds[2] {};
+    REQUIRE(::pipe2(fds, O_NONBLOCK) == 0);
+
+    uint64_t value = 0;
+    CHECK_FALSE(GuardFW::kernel::read_nonblock(fds[0], &value, sizeof(value)).has_value());
+
+    const uint64_t written = 0x0123'4567'89ab'cdefULL;
+    CHECK(GuardFW::kernel::write_nonblock(fds[1], &written, sizeof(written)) == sizeof(written));
+    CHECK(GuardFW::kernel::read_nonblock(fds[0], &value, sizeof(value)) == sizeof(value));
+    CHECK(value == written);
+
+    errno = 0;
+    try
+    {
+        (void) GuardFW::kernel::read_nonblock(-1, &value, sizeof(value));
+        FAIL("no exception");
+    }
+    catch (const std::system_error& error)
+    {
+        CHECK(error.code().value() == EBADF);
+        CHECK(std::string_view(error.what()).find("sys_read") != std::string_view::npos);
+    }
+    CHECK(errno == 0);  // errors do not pass errno
+
+    GuardFW::close(fds[0]);
+    GuardFW::close(fds[1]);
+}
+
+TEST_CASE("wrapped syscall: send and recv on a socket pair", "[wrapped_syscall]")
+{
+    int fds[2] {};
+    REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == 0);
+
+    char buffer[8] {};
+    CHECK_FALSE(GuardFW::kernel::recv_nonblock(fds[1], buffer, sizeof(buffer), 0).has_value());
+    CHECK(GuardFW::kernel::send_nonblock(fds[0], "direct", 6, MSG_NOSIGNAL) == 6);
+    CHECK(GuardFW::kernel::send_nonblock(fds[0], "!", 1, MSG_NOSIGNAL) == 1);
+    CHECK(GuardFW::kernel::recv_nonblock(fds[1], buffer, sizeof(buffer), 0) == 7);
+    CHECK(std::string_view(buffer, 7) == "direct!");
+    CHECK_THROWS_AS(GuardFW::kernel::send_nonblock(-1, "x", 1, MSG_NOSIGNAL), std::system_error);
+
+    GuardFW::close(fds[0]);
+    GuardFW::close(fds[1]);
+}
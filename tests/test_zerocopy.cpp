@@ -0,0 +1,109 @@
+/**
+ * Catch2 unit tests for modules/zerocopy.cppm
+ *
+ * @author    Simon Gleissner <simon@gleissner.de>, http://guardfw.de
+ * @copyright MIT license, see file LICENSE
+ * @file
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <arpa/inet.h>   // htonl()
+#include <array>         // std::array<>
+#include <cerrno>        // ECONNREFUSED
+#include <cstddef>       // size_t
+#include <cstdint>       // uint32_t
+#include <netinet/in.h>  // sockaddr_in, INADDR_LOOPBACK
+#include <poll.h>        // ::poll()
+#include <sys/socket.h>  // AF_INET, SOCK_STREAM, SOCK_DGRAM
+#include <vector>        // std::vector<>
+
+#include "test_helpers.hpp"
+
+import guardfw.zerocopy;
+import guardfw.wrapped_socket;  // GuardFW::socket(), ...
+import guardfw.wrapped_unistd;  // GuardFW::close()
+
+TEST_CASE("zerocopy: loopback send with copy fallback", "[zerocopy]")
+{
+    GuardFW::FileDescriptor listener = GuardFW::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address {};
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_len   = sizeof(address);
+    GuardFW::bind(listener, reinterpret_cast<struct sockaddr*>(&address), address_len);
+    GuardFW::listen(listener, 1);
+    REQUIRE(::getsockname(listener, reinterpret_cast<struct sockaddr*>(&address), &address_len) == 0);
+
+    GuardFW::FileDescriptor client = GuardFW::socket(AF_INET, SOCK_STREAM, 0);
+    GuardFW::connect(client, reinterpret_cast<struct sockaddr*>(&address), address_len);
+    GuardFW::FileDescriptor server = GuardFW::accept(listener, nullptr, nullptr);
+
+    GuardFW::ZeroCopySender sender(client);
+    CHECK(sender.socket() == client);
+
+    constexpr size_t sends = 3;
+    std::array<std::vector<char>, sends> buffers;
+    for (uint32_t index = 0; index < sends; index++)
+    {
+        buffers[index].assign(4096, static_cast<char>('a' + index));
+        GuardFW::ZeroCopySend sent = sender.send(buffers[index].data(), buffers[index].size());
+        CHECK(sent.bytes == buffers[index].size());
+        CHECK(sent.id == index);
+    }
+
+    std::vector<char> received(sends * 4096);
+    size_t received_bytes = 0;
+    while (received_bytes < received.size())
+        received_bytes += GuardFW::recv(server, received.data() + received_bytes, received.size() - received_bytes, 0);
+    CHECK(received[0] == 'a');
+    CHECK(received.back() == 'c');
+
+    std::array<bool, sends> completed {};
+    for (int attempt = 0; attempt < 100 && sender.outstanding() > 0; attempt++)
+    {
+        struct pollfd poll_fd {.fd = client, .events = 0, .revents = 0};  // POLLERR is always reported
+        (void) ::poll(&poll_fd, 1, 10);
+        sender.reap([&completed](const GuardFW::ZeroCopyCompletion& completion) {
+            for (uint32_t id = completion.first; id <= completion.last; id++)
+                completed.at(id) = true;
+        });
+    }
+
+    CHECK(sender.outstanding() == 0);
+    CHECK(completed == std::array<bool, sends> {true, true, true});
+    CHECK(sender.copy_fallback());  // loopback always copies
+    CHECK(sender.reap() == 0);
+
+    CHECK_NOTHROW(GuardFW::close(server));
+    CHECK_NOTHROW(GuardFW::close(client));
+    CHECK_NOTHROW(GuardFW::close(listener));
+}
+
+TEST_CASE("zerocopy: send errors in the error queue are thrown", "[zerocopy]")
+{
+    GuardFW::FileDescriptor closed = GuardFW::socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in address {};
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_len   = sizeof(address);
+    GuardFW::bind(closed, reinterpret_cast<struct sockaddr*>(&address), address_len);
+    REQUIRE(::getsockname(closed, reinterpret_cast<struct sockaddr*>(&address), &address_len) == 0);
+    GuardFW::close(closed);  // datagrams to this port cause ICMP port unreachable errors
+
+    GuardFW::FileDescriptor client = GuardFW::socket(AF_INET, SOCK_DGRAM, 0);
+    const int enable               = 1;
+    GuardFW::setsockopt(client, SOL_IP, IP_RECVERR, &enable, sizeof(enable));
+    GuardFW::connect(client, reinterpret_cast<struct sockaddr*>(&address), address_len);
+    GuardFW::ZeroCopySender sender(client);
+
+    const char datagram = 'x';
+    CHECK(GuardFW::send(client, &datagram, sizeof(datagram), 0) == sizeof(datagram));  // no zero-copy send
+
+    struct pollfd poll_fd {.fd = client, .events = 0, .revents = 0};
+    (void) ::poll(&poll_fd, 1, 1000);
+    CHECK((poll_fd.revents & POLLERR) != 0);
+    CHECK(error_of([&sender] { (void) sender.reap(); }) == ECONNREFUSED);
+
+    CHECK_NOTHROW(GuardFW::close(client));
+}